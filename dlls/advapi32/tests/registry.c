@@ -4988,6 +4988,112 @@ static void test_RegRenameKey(void)
     RegCloseKey(key);
 }
 
+static void test_many_values(void)
+{
+    DWORD count = winetest_interactive ? 1000000 : 5000, subkey_count = 1000;
+    DWORD i, j, data, type, size, values, subkeys, start, elapsed, errors;
+    char name[32];
+    HKEY key, subkey;
+    LSTATUS ret;
+
+    ret = RegCreateKeyExA(hkey_main, "TestManyValues", 0, NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL, &key, NULL);
+    ok(!ret, "RegCreateKeyExA failed: %ld\n", ret);
+
+    /* insert in an order unrelated to the name order, and with mixed case */
+    start = GetTickCount();
+    for (i = errors = 0; i < count; i++)
+    {
+        data = (i * 7919ull) % count;
+        sprintf(name, (i & 1) ? "V%07lu" : "v%07lu", data);
+        if (RegSetValueExA(key, name, 0, REG_DWORD, (BYTE *)&data, sizeof(data))) errors++;
+    }
+    elapsed = GetTickCount() - start;
+    ok(!errors, "%lu values failed to be set\n", errors);
+    trace("set %lu values in %lu ms\n", count, elapsed);
+
+    start = GetTickCount();
+    for (i = errors = 0; i < count; i++)
+    {
+        sprintf(name, "v%07lu", i);
+        size = sizeof(data);
+        data = ~0u;
+        if (RegQueryValueExA(key, name, NULL, &type, (BYTE *)&data, &size) || type != REG_DWORD || data != i)
+            errors++;
+    }
+    elapsed = GetTickCount() - start;
+    ok(!errors, "%lu values failed to be queried\n", errors);
+    trace("queried %lu values in %lu ms\n", count, elapsed);
+
+    for (i = errors = 0; i < count; i += 3)
+    {
+        sprintf(name, "V%07lu", i);
+        if (RegDeleteValueA(key, name)) errors++;
+    }
+    ok(!errors, "%lu values failed to be deleted\n", errors);
+
+    ret = RegQueryInfoKeyA(key, NULL, NULL, NULL, NULL, NULL, NULL, &values, NULL, NULL, NULL, NULL);
+    ok(!ret, "RegQueryInfoKeyA failed: %ld\n", ret);
+    ok(values == count - (count + 2) / 3, "got %lu values\n", values);
+
+    /* every enumerated value must match its name */
+    for (i = errors = 0; i < values; i++)
+    {
+        DWORD name_size = sizeof(name);
+        size = sizeof(data);
+        if (RegEnumValueA(key, i, name, &name_size, NULL, &type, (BYTE *)&data, &size) ||
+            strtoul(name + 1, NULL, 10) != data || !(data % 3))
+            errors++;
+    }
+    ok(!errors, "%lu values failed to be enumerated\n", errors);
+    name[0] = 0;
+    size = sizeof(name);
+    ret = RegEnumValueA(key, values, name, &size, NULL, NULL, NULL, NULL);
+    ok(ret == ERROR_NO_MORE_ITEMS, "RegEnumValueA returned %ld\n", ret);
+
+    for (i = errors = 0; i < subkey_count; i++)
+    {
+        sprintf(name, "k%07lu", (i * 7919) % subkey_count);
+        if (RegCreateKeyExA(key, name, 0, NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL, &subkey, NULL)) errors++;
+        else RegCloseKey(subkey);
+    }
+    ok(!errors, "%lu subkeys failed to be created\n", errors);
+
+    ret = RegRenameKey(key, L"k0000500", L"a0000500");
+    ok(!ret, "RegRenameKey failed: %ld\n", ret);
+    ret = RegOpenKeyExA(key, "K0000500", 0, KEY_READ, &subkey);
+    ok(ret == ERROR_FILE_NOT_FOUND, "RegOpenKeyExA returned %ld\n", ret);
+    ret = RegOpenKeyExA(key, "A0000500", 0, KEY_READ, &subkey);
+    ok(!ret, "RegOpenKeyExA failed: %ld\n", ret);
+    RegCloseKey(subkey);
+
+    ret = RegQueryInfoKeyA(key, NULL, NULL, NULL, &subkeys, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    ok(!ret, "RegQueryInfoKeyA failed: %ld\n", ret);
+    ok(subkeys == subkey_count, "got %lu subkeys\n", subkeys);
+
+    /* subkeys are enumerated in name order */
+    for (i = errors = 0; i < subkeys; i++)
+    {
+        ret = RegEnumKeyA(key, i, name, sizeof(name));
+        if (ret) errors++;
+        else if (!i) ok(!strcmp(name, "a0000500"), "got first subkey %s\n", name);
+        else if (strtoul(name + 1, NULL, 10) != i - (i <= 500)) errors++;
+    }
+    ok(!errors, "%lu subkeys failed to be enumerated\n", errors);
+
+    /* delete the subkeys while enumerating them */
+    for (i = j = 0; !RegEnumKeyA(key, i, name, sizeof(name)); j++)
+    {
+        if (j % 2) i++;
+        else if (RegDeleteKeyA(key, name)) break;
+    }
+    ret = RegQueryInfoKeyA(key, NULL, NULL, NULL, &subkeys, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    ok(!ret, "RegQueryInfoKeyA failed: %ld\n", ret);
+    ok(subkeys == subkey_count / 2, "got %lu subkeys\n", subkeys);
+
+    delete_key(key);
+    RegCloseKey(key);
+}
+
 START_TEST(registry)
 {
     /* Load pointers for functions that are not available in all Windows versions */
@@ -5027,6 +5133,7 @@ START_TEST(registry)
     test_EnumDynamicTimeZoneInformation();
     test_perflib_key();
     test_RegRenameKey();
+    test_many_values();
 
     /* cleanup */
     delete_key( hkey_main );
@@ -1211,23 +1211,17 @@ static void test_CopyFileEx(void)
     ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %ld\n", GetLastError());
     SetLastError(0xdeadbeef);
     retok = CopyFileExA(source, dest, copy_progress_cb, hfile, NULL, 0);
-    todo_wine
     ok(!retok, "CopyFileExA unexpectedly succeeded\n");
-    todo_wine
     ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %ld\n", GetLastError());
     ok(GetFileAttributesA(dest) != INVALID_FILE_ATTRIBUTES, "file was deleted\n");
 
     hfile = CreateFileA(dest, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_WRITE | FILE_SHARE_DELETE,
                         NULL, OPEN_EXISTING, 0, 0);
-    todo_wine
     ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %ld\n", GetLastError());
     SetLastError(0xdeadbeef);
     retok = CopyFileExA(source, dest, copy_progress_cb, hfile, NULL, 0);
-    todo_wine
     ok(!retok, "CopyFileExA unexpectedly succeeded\n");
-    todo_wine
     ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %ld\n", GetLastError());
-    todo_wine
     ok(GetFileAttributesA(dest) == INVALID_FILE_ATTRIBUTES, "file was not deleted\n");
 
     retok = CopyFileExA(source, NULL, copy_progress_cb, hfile, NULL, 0);
@@ -1243,6 +1237,125 @@ static void test_CopyFileEx(void)
     ok(!ret, "DeleteFileA unexpectedly succeeded\n");
 }
 
+struct copy_progress_data
+{
+    HANDLE source;
+    LONGLONG size;
+    LONGLONG transferred;
+    DWORD stream_switch;
+    DWORD chunks;
+    DWORD cancel_after;
+};
+
+static DWORD WINAPI copy_progress_chunks_cb(LARGE_INTEGER total_size, LARGE_INTEGER total_transferred,
+                                            LARGE_INTEGER stream_size, LARGE_INTEGER stream_transferred,
+                                            DWORD stream, DWORD reason, HANDLE source, HANDLE dest, LPVOID userdata)
+{
+    struct copy_progress_data *data = userdata;
+
+    ok(total_size.QuadPart == data->size, "got size %s\n", wine_dbgstr_longlong(total_size.QuadPart));
+    ok(stream == 1, "got stream %lu\n", stream);
+    ok(source != INVALID_HANDLE_VALUE && dest != INVALID_HANDLE_VALUE, "got handles %p %p\n", source, dest);
+    if (reason == CALLBACK_STREAM_SWITCH)
+    {
+        ok(!total_transferred.QuadPart, "got transferred %s\n", wine_dbgstr_longlong(total_transferred.QuadPart));
+        data->stream_switch++;
+    }
+    else
+    {
+        ok(reason == CALLBACK_CHUNK_FINISHED, "got reason %lu\n", reason);
+        ok(total_transferred.QuadPart > data->transferred, "got transferred %s, previous %s\n",
+           wine_dbgstr_longlong(total_transferred.QuadPart), wine_dbgstr_longlong(data->transferred));
+        data->transferred = total_transferred.QuadPart;
+        data->chunks++;
+        if (data->chunks == data->cancel_after) return PROGRESS_CANCEL;
+    }
+    return PROGRESS_CONTINUE;
+}
+
+static void test_CopyFileEx_progress(void)
+{
+    DWORD size = (winetest_interactive ? 64 : 4) * 1024 * 1024;
+    char temp_path[MAX_PATH], source[MAX_PATH], dest[MAX_PATH];
+    struct copy_progress_data data;
+    DWORD ret, written, start, elapsed, i;
+    HANDLE hfile, hdest;
+    BOOL cancel;
+    char *buffer;
+
+    GetTempPathA(MAX_PATH, temp_path);
+    GetTempFileNameA(temp_path, "pfx", 0, source);
+    GetTempFileNameA(temp_path, "pfx", 0, dest);
+
+    buffer = HeapAlloc(GetProcessHeap(), 0, 1024 * 1024);
+    for (i = 0; i < 1024 * 1024; i++) buffer[i] = i * 7;
+    hfile = CreateFileA(source, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0);
+    ok(hfile != INVALID_HANDLE_VALUE, "failed to create source file, error %ld\n", GetLastError());
+    for (i = 0; i < size / (1024 * 1024); i++)
+    {
+        ret = WriteFile(hfile, buffer, 1024 * 1024, &written, NULL);
+        ok(ret && written == 1024 * 1024, "WriteFile failed, error %ld\n", GetLastError());
+    }
+    /* make the size unaligned */
+    WriteFile(hfile, buffer, 123, &written, NULL);
+    CloseHandle(hfile);
+
+    memset(&data, 0, sizeof(data));
+    data.size = size + 123;
+    start = GetTickCount();
+    ret = CopyFileExA(source, dest, copy_progress_chunks_cb, &data, NULL, 0);
+    elapsed = GetTickCount() - start;
+    ok(ret, "CopyFileExA failed, error %ld\n", GetLastError());
+    ok(data.stream_switch == 1, "got %lu stream switches\n", data.stream_switch);
+    ok(data.chunks > 0, "got %lu chunks\n", data.chunks);
+    ok(data.transferred == data.size, "got transferred %s\n", wine_dbgstr_longlong(data.transferred));
+    trace("CopyFileEx copied %lu bytes in %lu ms\n", size + 123, elapsed);
+
+    hfile = CreateFileA(dest, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, 0);
+    ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %ld\n", GetLastError());
+    ok(GetFileSize(hfile, NULL) == size + 123, "got size %lu\n", GetFileSize(hfile, NULL));
+    SetFilePointer(hfile, size - 1024 * 1024, NULL, FILE_BEGIN);
+    ret = ReadFile(hfile, buffer, 1024 * 1024, &written, NULL);
+    ok(ret && written == 1024 * 1024, "ReadFile failed, error %ld\n", GetLastError());
+    for (i = 0; i < 1024 * 1024; i++) if (buffer[i] != (char)(i * 7)) break;
+    ok(i == 1024 * 1024, "data differs at offset %lu\n", i);
+    CloseHandle(hfile);
+
+    if (winetest_interactive)
+    {
+        /* compare with a plain buffered copy */
+        start = GetTickCount();
+        hfile = CreateFileA(source, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, 0);
+        hdest = CreateFileA(dest, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0);
+        while (ReadFile(hfile, buffer, 65536, &written, NULL) && written)
+            WriteFile(hdest, buffer, written, &written, NULL);
+        CloseHandle(hfile);
+        CloseHandle(hdest);
+        trace("ReadFile/WriteFile copied %lu bytes in %lu ms\n", size + 123, GetTickCount() - start);
+    }
+
+    memset(&data, 0, sizeof(data));
+    data.size = size + 123;
+    data.cancel_after = 1;
+    SetLastError(0xdeadbeef);
+    ret = CopyFileExA(source, dest, copy_progress_chunks_cb, &data, NULL, 0);
+    ok(!ret, "CopyFileExA succeeded\n");
+    ok(GetLastError() == ERROR_REQUEST_ABORTED, "got error %ld\n", GetLastError());
+    ok(data.chunks == 1, "got %lu chunks\n", data.chunks);
+    ok(GetFileAttributesA(dest) == INVALID_FILE_ATTRIBUTES, "file was not deleted\n");
+
+    cancel = TRUE;
+    SetLastError(0xdeadbeef);
+    ret = CopyFileExA(source, dest, NULL, NULL, &cancel, 0);
+    ok(!ret, "CopyFileExA succeeded\n");
+    ok(GetLastError() == ERROR_REQUEST_ABORTED, "got error %ld\n", GetLastError());
+    ok(GetFileAttributesA(dest) == INVALID_FILE_ATTRIBUTES, "file was not deleted\n");
+
+    HeapFree(GetProcessHeap(), 0, buffer);
+    DeleteFileA(source);
+    DeleteFileA(dest);
+}
+
 /*
  *   Debugging routine to dump a buffer in a hexdump-like fashion.
  */
@@ -5786,6 +5899,129 @@ static void test_overlapped_read(void)
     ok(ret, "Unexpected error %lu.\n", GetLastError());
 }
 
+/* wait for an overlapped request that is expected to succeed, and return its size */
+static DWORD finish_queued_io(HANDLE file, OVERLAPPED *ovl, BOOL ret)
+{
+    DWORD count = 0xdeadbeef;
+
+    ok(ret || GetLastError() == ERROR_IO_PENDING, "got error %lu\n", GetLastError());
+    ret = GetOverlappedResult(file, ovl, &count, TRUE);
+    ok(ret, "GetOverlappedResult failed, error %lu\n", GetLastError());
+    return count;
+}
+
+static void test_queued_io(void)
+{
+    static const DWORD size = 0x10000;
+    char temp_path[MAX_PATH], file_name[MAX_PATH];
+    unsigned char *buffer, *buffer2;
+    OVERLAPPED ovl, *povl;
+    HANDLE file, event, port;
+    ULONG_PTR key;
+    DWORD count, i;
+    BOOL ret;
+
+    GetTempPathA(MAX_PATH, temp_path);
+    GetTempFileNameA(temp_path, "qio", 0, file_name);
+    file = CreateFileA(file_name, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                       CREATE_ALWAYS, FILE_FLAG_OVERLAPPED | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "CreateFile failed, error %lu\n", GetLastError());
+    event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    buffer = HeapAlloc(GetProcessHeap(), 0, size);
+    buffer2 = HeapAlloc(GetProcessHeap(), 0, size);
+    for (i = 0; i < size; i++) buffer[i] = i * 7;
+
+    memset(&ovl, 0, sizeof(ovl));
+    ovl.hEvent = event;
+    ret = WriteFile(file, buffer, size, NULL, &ovl);
+    count = finish_queued_io(file, &ovl, ret);
+    ok(count == size, "wrote %lu bytes\n", count);
+
+    memset(buffer2, 0, size);
+    ovl.Offset = 0x100;
+    ret = ReadFile(file, buffer2, size, NULL, &ovl);
+    count = finish_queued_io(file, &ovl, ret);
+    ok(count == size - 0x100, "read %lu bytes\n", count);
+    ok(!memcmp(buffer2, buffer + 0x100, count), "wrong data\n");
+
+    /* without an event, GetOverlappedResult() waits on the file handle */
+    memset(buffer2, 0, size);
+    memset(&ovl, 0, sizeof(ovl));
+    ret = ReadFile(file, buffer2, size, NULL, &ovl);
+    count = finish_queued_io(file, &ovl, ret);
+    ok(count == size, "read %lu bytes\n", count);
+    ok(!memcmp(buffer2, buffer, size), "wrong data\n");
+
+    memset(&ovl, 0, sizeof(ovl));
+    ovl.hEvent = event;
+    ovl.Offset = size;
+    count = 0xdeadbeef;
+    ret = ReadFile(file, buffer2, size, NULL, &ovl);
+    if (!ret && GetLastError() == ERROR_IO_PENDING)
+        ret = GetOverlappedResult(file, &ovl, &count, TRUE);
+    ok(!ret && GetLastError() == ERROR_HANDLE_EOF, "got ret %d, error %lu\n", ret, GetLastError());
+
+    /* the request may be canceled or complete normally, but it must finish */
+    memset(&ovl, 0, sizeof(ovl));
+    ovl.hEvent = event;
+    ret = ReadFile(file, buffer2, size, NULL, &ovl);
+    ok(ret || GetLastError() == ERROR_IO_PENDING, "got error %lu\n", GetLastError());
+    ret = CancelIoEx(file, &ovl);
+    ok(ret || GetLastError() == ERROR_NOT_FOUND, "CancelIoEx failed, error %lu\n", GetLastError());
+    count = 0xdeadbeef;
+    ret = GetOverlappedResult(file, &ovl, &count, TRUE);
+    ok(ret ? count == size : GetLastError() == ERROR_OPERATION_ABORTED,
+       "got ret %d, count %lu, error %lu\n", ret, count, GetLastError());
+
+    port = CreateIoCompletionPort(file, NULL, 0xdead, 0);
+    ok(port != NULL, "CreateIoCompletionPort failed, error %lu\n", GetLastError());
+
+    /* the completion is still posted if the handle is closed before it */
+    memset(buffer2, 0, size);
+    memset(&ovl, 0, sizeof(ovl));
+    ovl.hEvent = event;
+    ret = ReadFile(file, buffer2, size, NULL, &ovl);
+    ok(ret || GetLastError() == ERROR_IO_PENDING, "got error %lu\n", GetLastError());
+    CloseHandle(file);
+    ret = WaitForSingleObject(event, 5000);
+    ok(!ret, "wait failed %d\n", ret);
+    ok(!ovl.Internal && ovl.InternalHigh == size, "got status %#Ix, size %Iu\n", ovl.Internal, ovl.InternalHigh);
+    ok(!memcmp(buffer2, buffer, size), "wrong data\n");
+
+    count = 0xdeadbeef;
+    key = 0;
+    povl = NULL;
+    ret = GetQueuedCompletionStatus(port, &count, &key, &povl, 5000);
+    ok(ret, "GetQueuedCompletionStatus failed, error %lu\n", GetLastError());
+    ok(key == 0xdead, "got key %#Ix\n", key);
+    ok(povl == &ovl, "got overlapped %p\n", povl);
+    ok(count == size, "got size %lu\n", count);
+
+    CloseHandle(port);
+    CloseHandle(event);
+    HeapFree(GetProcessHeap(), 0, buffer);
+    HeapFree(GetProcessHeap(), 0, buffer2);
+}
+
+/* run test_queued_io() with Wine's io_uring support enabled */
+static void test_queued_io_uring(void)
+{
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    char cmdline[MAX_PATH + 32], **argv;
+    BOOL ret;
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" file queued_io", argv[0]);
+    SetEnvironmentVariableA("WINEIOURING", "1");
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    SetEnvironmentVariableA("WINEIOURING", NULL);
+    ok(ret, "CreateProcess failed, error %lu\n", GetLastError());
+    wait_child_process(pi.hProcess);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+}
+
 static void test_file_readonly_access(void)
 {
     static const DWORD default_sharing = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
@@ -6295,11 +6531,19 @@ static void test_eof(void)
 
 START_TEST(file)
 {
-    char temp_path[MAX_PATH];
+    char temp_path[MAX_PATH], **argv;
     DWORD ret;
+    int argc;
 
     InitFunctionPointers();
 
+    argc = winetest_get_mainargs(&argv);
+    if (argc >= 3 && !strcmp(argv[2], "queued_io"))
+    {
+        test_queued_io();
+        return;
+    }
+
     ret = GetTempPathA(MAX_PATH, temp_path);
     ok(ret != 0, "GetTempPath error %lu\n", GetLastError());
     ret = GetTempFileNameA(temp_path, "tmp", 0, filename);
@@ -6320,6 +6564,7 @@ START_TEST(file)
     test_CopyFileW();
     test_CopyFile2();
     test_CopyFileEx();
+    test_CopyFileEx_progress();
     test_CreateFile();
     test_CreateFileA();
     test_CreateFileW();
@@ -6364,6 +6609,8 @@ START_TEST(file)
     test_GetFileAttributesExW();
     test_post_completion();
     test_overlapped_read();
+    test_queued_io();
+    test_queued_io_uring();
     test_file_readonly_access();
     test_find_file_stream();
     test_SetFileTime();
@@ -28,6 +28,7 @@
 #include "winbase.h"
 #include "winternl.h"
 #include "winnls.h"
+#include "winuser.h"
 #include "wine/test.h"
 #include "delayloadhandler.h"
 
@@ -4641,6 +4642,81 @@ static void test_Wow64Transition(void)
             debugstr_wn(name->SectionFileName.Buffer, name->SectionFileName.Length / sizeof(WCHAR)));
 }
 
+/* load the dlls of the system directory, to measure the time spent resolving imports */
+static void load_perf_dlls(void)
+{
+    char path[MAX_PATH];
+    WIN32_FIND_DATAA data;
+    DWORD start, count = 0, total = 0;
+    HANDLE handle;
+
+    GetSystemDirectoryA(path, MAX_PATH);
+    strcat(path, "\\*.dll");
+    start = GetTickCount();
+    handle = FindFirstFileA(path, &data);
+    ok(handle != INVALID_HANDLE_VALUE, "FindFirstFile failed with %lu\n", GetLastError());
+    if (handle == INVALID_HANDLE_VALUE) return;
+    do
+    {
+        total++;
+        if (LoadLibraryA(data.cFileName)) count++;
+    } while (count < 200 && FindNextFileA(handle, &data));
+    FindClose(handle);
+    trace("loaded %lu of %lu dlls in %lu ms\n", count, total, GetTickCount() - start);
+}
+
+static void test_load_performance(const char *selfname)
+{
+    static const char * const import_cache[] = { "0", "1" };
+    char self_cmd[MAX_PATH + 32], cmdline[MAX_PATH + 32];
+    const char *commands[] = { "cmd.exe /c exit", "notepad.exe", self_cmd };
+    DWORD i, j, start, elapsed, count, ret;
+    PROCESS_INFORMATION pi;
+    STARTUPINFOA si;
+
+    if (!winetest_interactive)
+    {
+        skip("process startup benchmark only runs in interactive mode\n");
+        return;
+    }
+
+    sprintf(self_cmd, "\"%s\" loader load_dlls", selfname);
+    memset(&si, 0, sizeof(si));
+    si.cb = sizeof(si);
+
+    /* the first process with the import cache enabled fills it, the others reuse it */
+    for (i = 0; i < ARRAY_SIZE(import_cache); i++)
+    {
+        SetEnvironmentVariableA("WINEIMPORTCACHE", import_cache[i]);
+        for (j = 0; j < ARRAY_SIZE(commands); j++)
+        {
+            start = GetTickCount();
+            count = 0;
+            do
+            {
+                strcpy(cmdline, commands[j]);
+                ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+                ok(ret, "CreateProcess(%s) failed with %lu\n", commands[j], GetLastError());
+                if (!ret) break;
+                /* notepad doesn't exit by itself, measure the time until it waits for input */
+                if (j == 1)
+                {
+                    WaitForInputIdle(pi.hProcess, 10000);
+                    TerminateProcess(pi.hProcess, 0);
+                }
+                ret = WaitForSingleObject(pi.hProcess, 30000);
+                ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %lu\n", ret);
+                CloseHandle(pi.hThread);
+                CloseHandle(pi.hProcess);
+                count++;
+            } while ((elapsed = GetTickCount() - start) < 5000);
+            if (count) trace("import cache %s, %s: %lu ms per process\n",
+                             import_cache[i], commands[j], elapsed / count);
+        }
+    }
+    SetEnvironmentVariableA("WINEIMPORTCACHE", NULL);
+}
+
 START_TEST(loader)
 {
     int argc;
@@ -4704,6 +4780,11 @@ START_TEST(loader)
         child_process(argv[2], atol(argv[3]));
         return;
     }
+    if (argc > 2 && !strcmp(argv[2], "load_dlls"))
+    {
+        load_perf_dlls();
+        return;
+    }
 
     len = GetSystemDirectoryA(system_dir, ARRAY_SIZE(system_dir));
     ok(len && len < ARRAY_SIZE(system_dir), "Couldn't get system directory: %lu\n", GetLastError());
@@ -4728,6 +4809,7 @@ START_TEST(loader)
     test_dll_file( "advapi32.dll" );
     test_dll_file( "user32.dll" );
     test_Wow64Transition();
+    test_load_performance(argv[0]);
     /* loader test must be last, it can corrupt the internal loader state on Windows */
     test_Loader();
 }
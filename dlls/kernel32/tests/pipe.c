@@ -4308,6 +4308,103 @@ static void test_CancelSynchronousIo(void)
     CloseHandle(pipe);
 }
 
+static DWORD CALLBACK pipe_echo_thread(void *arg)
+{
+    HANDLE pipe = arg;
+    DWORD size, written;
+    char *buf;
+
+    buf = HeapAlloc(GetProcessHeap(), 0, 65536);
+    while (ReadFile(pipe, buf, 65536, &size, NULL))
+        if (!WriteFile(pipe, buf, size, &written, NULL)) break;
+    HeapFree(GetProcessHeap(), 0, buf);
+    return 0;
+}
+
+static BOOL read_pipe_data(HANDLE pipe, char *buf, DWORD size)
+{
+    DWORD read, total = 0;
+
+    while (total < size)
+    {
+        if (!ReadFile(pipe, buf + total, size - total, &read, NULL)) return FALSE;
+        total += read;
+    }
+    return TRUE;
+}
+
+static void test_pipe_performance(DWORD pipe_type)
+{
+    DWORD start, count, size, mode, duration = winetest_interactive ? 5000 : 200, chunk = 16384;
+    HANDLE server, client, thread;
+    char msg[16], *buf;
+    BOOL res;
+
+    server = CreateNamedPipeA(PIPENAME, PIPE_ACCESS_DUPLEX,
+                              pipe_type | (pipe_type == PIPE_TYPE_MESSAGE ? PIPE_READMODE_MESSAGE : 0) | PIPE_WAIT,
+                              1, 65536, 65536, NMPWAIT_USE_DEFAULT_WAIT, NULL);
+    ok(server != INVALID_HANDLE_VALUE, "CreateNamedPipe failed with %lu\n", GetLastError());
+    client = CreateFileA(PIPENAME, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, 0);
+    ok(client != INVALID_HANDLE_VALUE, "CreateFile failed with %lu\n", GetLastError());
+
+    if (pipe_type == PIPE_TYPE_MESSAGE)
+    {
+        mode = PIPE_READMODE_MESSAGE;
+        res = SetNamedPipeHandleState(client, &mode, NULL, NULL);
+        ok(res, "SetNamedPipeHandleState failed with %lu\n", GetLastError());
+
+        /* message boundaries are kept when a message is read in several parts */
+        res = WriteFile(client, "abcdef", 6, &size, NULL);
+        ok(res && size == 6, "WriteFile returned %x, size %lu\n", res, size);
+        res = WriteFile(client, "gh", 2, &size, NULL);
+        ok(res && size == 2, "WriteFile returned %x, size %lu\n", res, size);
+        res = ReadFile(server, msg, 4, &size, NULL);
+        ok(!res && GetLastError() == ERROR_MORE_DATA, "ReadFile returned %x(%lu)\n", res, GetLastError());
+        ok(size == 4 && !memcmp(msg, "abcd", 4), "got size %lu\n", size);
+        res = ReadFile(server, msg, sizeof(msg), &size, NULL);
+        ok(res, "ReadFile failed with %lu\n", GetLastError());
+        ok(size == 2 && !memcmp(msg, "ef", 2), "got size %lu\n", size);
+        res = ReadFile(server, msg, sizeof(msg), &size, NULL);
+        ok(res, "ReadFile failed with %lu\n", GetLastError());
+        ok(size == 2 && !memcmp(msg, "gh", 2), "got size %lu\n", size);
+    }
+
+    thread = CreateThread(NULL, 0, pipe_echo_thread, client, 0, NULL);
+    ok(thread != NULL, "CreateThread failed with %lu\n", GetLastError());
+
+    memset(msg, 0x55, sizeof(msg));
+    start = GetTickCount();
+    count = 0;
+    do
+    {
+        res = WriteFile(server, msg, sizeof(msg), &size, NULL);
+        if (res) res = read_pipe_data(server, msg, sizeof(msg));
+        ok(res, "round trip %lu failed with %lu\n", count, GetLastError());
+        count++;
+    } while (res && GetTickCount() - start < duration);
+    trace("%s pipe: %d round trips per second.\n", pipe_type == PIPE_TYPE_MESSAGE ? "message" : "byte",
+          MulDiv(count, 1000, duration));
+
+    buf = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, chunk);
+    start = GetTickCount();
+    count = 0;
+    do
+    {
+        res = WriteFile(server, buf, chunk, &size, NULL);
+        if (res) res = read_pipe_data(server, buf, chunk);
+        ok(res, "transfer %lu failed with %lu\n", count, GetLastError());
+        count++;
+    } while (res && GetTickCount() - start < duration);
+    trace("%s pipe: %d KiB echoed per second.\n", pipe_type == PIPE_TYPE_MESSAGE ? "message" : "byte",
+          MulDiv(count, chunk, duration) * 1000 / 1024);
+    HeapFree(GetProcessHeap(), 0, buf);
+
+    CloseHandle(server);
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+    CloseHandle(client);
+}
+
 START_TEST(pipe)
 {
     char **argv;
@@ -4390,4 +4487,6 @@ START_TEST(pipe)
     test_GetOverlappedResultEx();
     test_exit_process_async();
     test_CancelSynchronousIo();
+    test_pipe_performance(PIPE_TYPE_BYTE);
+    test_pipe_performance(PIPE_TYPE_MESSAGE);
 }
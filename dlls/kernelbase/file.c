@@ -40,6 +40,7 @@
 
 #include "kernelbase.h"
 #include "wine/exception.h"
+#include "wine/fsctl.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(file);
@@ -485,38 +486,168 @@ BOOL WINAPI DECLSPEC_HOTPATCH AreFileApisANSI(void)
     return !oem_file_apis;
 }
 
+/* state of a file copy, for progress notifications */
+struct copy_progress
+{
+    LPPROGRESS_ROUTINE          progress;   /* CopyFileEx-style callback */
+    PCOPYFILE2_PROGRESS_ROUTINE progress2;  /* CopyFile2-style callback */
+    void                       *param;
+    BOOL                       *cancel;
+    HANDLE                      source;
+    HANDLE                      dest;
+    ULARGE_INTEGER              size;
+    ULARGE_INTEGER              transferred;
+    ULARGE_INTEGER              chunk;
+    ULONGLONG                   chunk_count;
+};
+
+/* size of the chunks cloned or copied in the kernel between progress notifications */
+#define COPY_CHUNK_SIZE (16 * 1024 * 1024)
+
+/******************************************************************************
+ *  notify_copy_progress
+ */
+static DWORD notify_copy_progress( struct copy_progress *copy, DWORD reason )
+{
+    DWORD ret = PROGRESS_CONTINUE;
+
+    if (copy->progress)
+    {
+        LARGE_INTEGER size, transferred;
+
+        size.QuadPart = copy->size.QuadPart;
+        transferred.QuadPart = copy->transferred.QuadPart;
+        ret = copy->progress( size, transferred, size, transferred, 1, reason,
+                              copy->source, copy->dest, copy->param );
+    }
+    else if (copy->progress2)
+    {
+        COPYFILE2_MESSAGE msg;
+
+        memset( &msg, 0, sizeof(msg) );
+        if (reason == CALLBACK_STREAM_SWITCH)
+        {
+            msg.Type = COPYFILE2_CALLBACK_STREAM_STARTED;
+            msg.Info.StreamStarted.dwStreamNumber   = 1;
+            msg.Info.StreamStarted.hSourceFile      = copy->source;
+            msg.Info.StreamStarted.hDestinationFile = copy->dest;
+            msg.Info.StreamStarted.uliStreamSize    = copy->size;
+            msg.Info.StreamStarted.uliTotalFileSize = copy->size;
+        }
+        else
+        {
+            msg.Type = COPYFILE2_CALLBACK_CHUNK_FINISHED;
+            msg.Info.ChunkFinished.dwStreamNumber            = 1;
+            msg.Info.ChunkFinished.hSourceFile               = copy->source;
+            msg.Info.ChunkFinished.hDestinationFile          = copy->dest;
+            msg.Info.ChunkFinished.uliChunkNumber.QuadPart   = copy->chunk_count++;
+            msg.Info.ChunkFinished.uliChunkSize              = copy->chunk;
+            msg.Info.ChunkFinished.uliStreamSize             = copy->size;
+            msg.Info.ChunkFinished.uliStreamBytesTransferred = copy->transferred;
+            msg.Info.ChunkFinished.uliTotalFileSize          = copy->size;
+            msg.Info.ChunkFinished.uliTotalBytesTransferred  = copy->transferred;
+        }
+        switch (copy->progress2( &msg, copy->param ))
+        {
+        case COPYFILE2_PROGRESS_CONTINUE: ret = PROGRESS_CONTINUE; break;
+        case COPYFILE2_PROGRESS_CANCEL:   ret = PROGRESS_CANCEL; break;
+        case COPYFILE2_PROGRESS_QUIET:    ret = PROGRESS_QUIET; break;
+        case COPYFILE2_PROGRESS_PAUSE:
+            FIXME( "COPYFILE2_PROGRESS_PAUSE is not supported, stopping\n" );
+            /* fall through */
+        default:                          ret = PROGRESS_STOP; break;
+        }
+    }
+
+    if (ret == PROGRESS_QUIET)
+    {
+        copy->progress = NULL;
+        copy->progress2 = NULL;
+        ret = PROGRESS_CONTINUE;
+    }
+    if (copy->cancel && *copy->cancel) ret = PROGRESS_CANCEL;
+    return ret;
+}
+
+/******************************************************************************
+ *  clone_file_chunk
+ *
+ * Clone the next chunk of the file, sharing its extents instead of copying the data.
+ * Returns STATUS_INVALID_DEVICE_REQUEST if the file system doesn't support it.
+ */
+static NTSTATUS clone_file_chunk( struct copy_progress *copy )
+{
+    DUPLICATE_EXTENTS_DATA data;
+    IO_STATUS_BLOCK io;
+    NTSTATUS status;
+
+    copy->chunk.QuadPart = min( copy->size.QuadPart - copy->transferred.QuadPart, COPY_CHUNK_SIZE );
+    data.FileHandle                = copy->source;
+    data.SourceFileOffset.QuadPart = copy->transferred.QuadPart;
+    data.TargetFileOffset.QuadPart = copy->transferred.QuadPart;
+    data.ByteCount.QuadPart        = copy->chunk.QuadPart;
+    status = NtFsControlFile( copy->dest, NULL, NULL, NULL, &io, FSCTL_DUPLICATE_EXTENTS_TO_FILE,
+                              &data, sizeof(data), NULL, 0 );
+    if (!status) copy->transferred.QuadPart += copy->chunk.QuadPart;
+    return status;
+}
+
+/******************************************************************************
+ *  copy_file_chunk
+ *
+ * Copy the next chunk of the file in the kernel, without going through a buffer.
+ * Returns STATUS_INVALID_DEVICE_REQUEST if this isn't supported.
+ */
+static NTSTATUS copy_file_chunk( struct copy_progress *copy )
+{
+    struct wine_copy_file_range data;
+    IO_STATUS_BLOCK io;
+    NTSTATUS status;
+
+    copy->chunk.QuadPart = min( copy->size.QuadPart - copy->transferred.QuadPart, COPY_CHUNK_SIZE );
+    data.source        = HandleToULong( copy->source );
+    data.reserved      = 0;
+    data.source_offset = copy->transferred.QuadPart;
+    data.target_offset = copy->transferred.QuadPart;
+    data.count         = copy->chunk.QuadPart;
+    status = NtFsControlFile( copy->dest, NULL, NULL, NULL, &io, FSCTL_WINE_COPY_FILE_RANGE,
+                              &data, sizeof(data), NULL, 0 );
+    if (!status) copy->transferred.QuadPart += copy->chunk.QuadPart;
+    return status;
+}
+
 /******************************************************************************
  *  copy_file
  */
-static BOOL copy_file( const WCHAR *source, const WCHAR *dest, COPYFILE2_EXTENDED_PARAMETERS *params )
+static BOOL copy_file( const WCHAR *source, const WCHAR *dest, COPYFILE2_EXTENDED_PARAMETERS *params,
+                       LPPROGRESS_ROUTINE progress, void *param )
 {
     DWORD flags = params ? params->dwCopyFlags : 0;
-    BOOL *cancel_ptr = params ? params->pfCancel : NULL;
-    PCOPYFILE2_PROGRESS_ROUTINE progress = params ? params->pProgressRoutine : NULL;
+    struct copy_progress copy = { 0 };
 
     static const int buffer_size = 65536;
     HANDLE h1, h2;
     FILE_BASIC_INFORMATION info;
+    FILE_STANDARD_INFORMATION std_info;
+    FILE_DISPOSITION_INFORMATION disp;
+    FILE_END_OF_FILE_INFORMATION eof;
     IO_STATUS_BLOCK io;
-    DWORD count;
+    LARGE_INTEGER pos;
+    NTSTATUS status = STATUS_SUCCESS;
+    DWORD count, action = PROGRESS_CONTINUE, access = GENERIC_WRITE;
     BOOL ret = FALSE;
-    char *buffer;
-
-    if (cancel_ptr)
-        FIXME("pfCancel is not supported\n");
-    if (progress)
-        FIXME("PCOPYFILE2_PROGRESS_ROUTINE is not supported\n");
+    char *buffer = NULL;
 
     if (!source || !dest)
     {
         SetLastError( ERROR_INVALID_PARAMETER );
         return FALSE;
     }
-    if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size )))
-    {
-        SetLastError( ERROR_NOT_ENOUGH_MEMORY );
-        return FALSE;
-    }
+
+    copy.progress  = progress;
+    copy.progress2 = progress ? NULL : params ? params->pProgressRoutine : NULL;
+    copy.param     = progress ? param : params ? params->pvCallbackContext : NULL;
+    copy.cancel    = params ? params->pfCancel : NULL;
 
     TRACE("%s -> %s, %lx\n", debugstr_w(source), debugstr_w(dest), flags);
 
@@ -531,14 +662,13 @@ static BOOL copy_file( const WCHAR *source, const WCHAR *dest, COPYFILE2_EXTENDE
                            NULL, OPEN_EXISTING, 0, 0 )) == INVALID_HANDLE_VALUE)
     {
         WARN("Unable to open source %s\n", debugstr_w(source));
-        HeapFree( GetProcessHeap(), 0, buffer );
         return FALSE;
     }
 
-    if (!set_ntstatus( NtQueryInformationFile( h1, &io, &info, sizeof(info), FileBasicInformation )))
+    if (!set_ntstatus( NtQueryInformationFile( h1, &io, &info, sizeof(info), FileBasicInformation )) ||
+        !set_ntstatus( NtQueryInformationFile( h1, &io, &std_info, sizeof(std_info), FileStandardInformation )))
     {
         WARN("GetFileInformationByHandle returned error for %s\n", debugstr_w(source));
-        HeapFree( GetProcessHeap(), 0, buffer );
         CloseHandle( h1 );
         return FALSE;
     }
@@ -554,26 +684,94 @@ static BOOL copy_file( const WCHAR *source, const WCHAR *dest, COPYFILE2_EXTENDE
         }
         if (same_file)
         {
-            HeapFree( GetProcessHeap(), 0, buffer );
             CloseHandle( h1 );
             SetLastError( ERROR_SHARING_VIOLATION );
             return FALSE;
         }
     }
 
-    if ((h2 = CreateFileW( dest, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
-                           (flags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
-                           info.FileAttributes, h1 )) == INVALID_HANDLE_VALUE)
+    /* a cancelled copy deletes the destination, if it can be opened for that */
+    if (copy.progress || copy.progress2 || copy.cancel) access |= DELETE;
+    for (;;)
+    {
+        h2 = CreateFileW( dest, access, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                          (flags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
+                          info.FileAttributes, h1 );
+        if (h2 != INVALID_HANDLE_VALUE || !(access & DELETE)) break;
+        if (GetLastError() != ERROR_SHARING_VIOLATION && GetLastError() != ERROR_ACCESS_DENIED) break;
+        access &= ~DELETE;
+    }
+    if (h2 == INVALID_HANDLE_VALUE)
     {
         WARN("Unable to open dest %s\n", debugstr_w(dest));
-        HeapFree( GetProcessHeap(), 0, buffer );
         CloseHandle( h1 );
         return FALSE;
     }
 
+    copy.source = h1;
+    copy.dest   = h2;
+    copy.size.QuadPart = std_info.EndOfFile.QuadPart;
+    if ((action = notify_copy_progress( &copy, CALLBACK_STREAM_SWITCH )) != PROGRESS_CONTINUE) goto done;
+
+    /* let the file system share the data if it can */
+    if (copy.size.QuadPart)
+    {
+        /* cloning doesn't extend the destination, so give it the final size first */
+        eof.EndOfFile.QuadPart = copy.size.QuadPart;
+        if (!set_ntstatus( NtSetInformationFile( h2, &io, &eof, sizeof(eof), FileEndOfFileInformation )))
+            goto done;
+
+        while (copy.transferred.QuadPart < copy.size.QuadPart)
+        {
+            if ((status = clone_file_chunk( &copy ))) break;
+            if ((action = notify_copy_progress( &copy, CALLBACK_CHUNK_FINISHED )) != PROGRESS_CONTINUE) break;
+        }
+        if (copy.transferred.QuadPart < copy.size.QuadPart)
+        {
+            /* only keep what has been cloned */
+            eof.EndOfFile.QuadPart = copy.transferred.QuadPart;
+            NtSetInformationFile( h2, &io, &eof, sizeof(eof), FileEndOfFileInformation );
+        }
+        if (action != PROGRESS_CONTINUE) goto done;
+        if (status && status != STATUS_INVALID_DEVICE_REQUEST && status != STATUS_NOT_SUPPORTED)
+        {
+            WARN("cloning failed for %s, status %#lx\n", debugstr_w(source), status);
+            SetLastError( RtlNtStatusToDosError( status ));
+            goto done;
+        }
+        TRACE("cloned %s bytes\n", wine_dbgstr_longlong( copy.transferred.QuadPart ));
+    }
+
+    /* then let the kernel copy the data, and copy anything left with a buffer */
+    status = STATUS_SUCCESS;
+    while (copy.transferred.QuadPart < copy.size.QuadPart)
+    {
+        if ((status = copy_file_chunk( &copy ))) break;
+        if ((action = notify_copy_progress( &copy, CALLBACK_CHUNK_FINISHED )) != PROGRESS_CONTINUE) goto done;
+    }
+    /* the buffered copy also handles a source file that has been truncated in the meantime */
+    if (status && status != STATUS_INVALID_DEVICE_REQUEST && status != STATUS_NOT_SUPPORTED &&
+        status != STATUS_END_OF_FILE)
+    {
+        WARN("kernel copy failed for %s, status %#lx\n", debugstr_w(source), status);
+        SetLastError( RtlNtStatusToDosError( status ));
+        goto done;
+    }
+
+    if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size )))
+    {
+        SetLastError( ERROR_NOT_ENOUGH_MEMORY );
+        goto done;
+    }
+    pos.QuadPart = copy.transferred.QuadPart;
+    if (!SetFilePointerEx( h1, pos, NULL, FILE_BEGIN ) || !SetFilePointerEx( h2, pos, NULL, FILE_BEGIN ))
+        goto done;
+
     while (ReadFile( h1, buffer, buffer_size, &count, NULL ) && count)
     {
         char *p = buffer;
+
+        copy.chunk.QuadPart = count;
         while (count != 0)
         {
             DWORD res;
@@ -581,9 +779,18 @@ static BOOL copy_file( const WCHAR *source, const WCHAR *dest, COPYFILE2_EXTENDE
             p += res;
             count -= res;
         }
+        copy.transferred.QuadPart += copy.chunk.QuadPart;
+        if (copy.transferred.QuadPart > copy.size.QuadPart) copy.size.QuadPart = copy.transferred.QuadPart;
+        if ((action = notify_copy_progress( &copy, CALLBACK_CHUNK_FINISHED )) != PROGRESS_CONTINUE) goto done;
     }
     ret = TRUE;
 done:
+    if (action == PROGRESS_CANCEL && (access & DELETE))
+    {
+        disp.DoDeleteFile = TRUE;
+        NtSetInformationFile( h2, &io, &disp, sizeof(disp), FileDispositionInformation );
+    }
+    if (action != PROGRESS_CONTINUE) SetLastError( ERROR_REQUEST_ABORTED );
     /* Maintain the timestamp of source file to destination file and read-only attribute */
     info.FileAttributes &= FILE_ATTRIBUTE_READONLY;
     NtSetInformationFile( h2, &io, &info, sizeof(info), FileBasicInformation );
@@ -599,7 +806,7 @@ done:
  */
 HRESULT WINAPI CopyFile2( const WCHAR *source, const WCHAR *dest, COPYFILE2_EXTENDED_PARAMETERS *params )
 {
-    return copy_file(source, dest, params) ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+    return copy_file(source, dest, params, NULL, NULL) ? S_OK : HRESULT_FROM_WIN32(GetLastError());
 }
 
 
@@ -611,18 +818,13 @@ BOOL WINAPI CopyFileExW( const WCHAR *source, const WCHAR *dest, LPPROGRESS_ROUT
 {
     COPYFILE2_EXTENDED_PARAMETERS params;
 
-    if (progress)
-        FIXME("LPPROGRESS_ROUTINE is not supported\n");
-    if (cancel_ptr)
-        FIXME("cancel_ptr is not supported\n");
-
     params.dwSize = sizeof(params);
     params.dwCopyFlags = flags;
     params.pProgressRoutine = NULL;
     params.pvCallbackContext = NULL;
-    params.pfCancel = NULL;
+    params.pfCancel = cancel_ptr;
 
-    return copy_file( source, dest, &params );
+    return copy_file( source, dest, &params, progress, param );
 }
 
 
@@ -300,6 +300,10 @@ struct heap
     RTL_CRITICAL_SECTION cs;
     struct entry     free_lists[FREE_LIST_COUNT];
     struct bin      *bins;
+    LONG             serial;        /* unique heap serial, to detect destroyed heaps in thread caches */
+    LONG64           cache_hits;    /* thread cache statistics */
+    LONG64           cache_misses;
+    LONG64           cache_flushes;
     SUBHEAP          subheap;
 };
 
@@ -329,6 +333,8 @@ C_ASSERT( HEAP_MIN_LARGE_BLOCK_SIZE <= HEAP_INITIAL_GROW_SIZE );
 #define HEAP_CHECKING_ENABLED 0x80000000
 
 static struct heap *process_heap;  /* main process heap */
+static LONG next_heap_serial;      /* serial of the last created heap */
+static LONG heap_destroy_count;    /* number of destroyed heaps */
 
 static NTSTATUS heap_free_block_lfh( struct heap *heap, ULONG flags, struct block *block );
 
@@ -1561,6 +1567,7 @@ HANDLE WINAPI RtlCreateHeap( ULONG flags, void *addr, SIZE_T total_size, SIZE_T
     insert_free_block( heap, flags, subheap, first_block( subheap ) );
     list_add_head( &heap->subheap_list, &subheap->entry );
 
+    heap->serial = InterlockedIncrement( &next_heap_serial );
     heap_set_debug_flags( heap );
 
     if (heap->flags & HEAP_GROWABLE)
@@ -1643,6 +1650,7 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE handle )
     /* remove it from the per-process list */
     RtlEnterCriticalSection( &process_heap->cs );
     list_remove( &heap->entry );
+    heap_destroy_count++;
     RtlLeaveCriticalSection( &process_heap->cs );
 
     heap->cs.DebugInfo->Spare[0] = 0;
@@ -1912,6 +1920,16 @@ static struct block *find_free_bin_block( struct heap *heap, ULONG flags, SIZE_T
     return block;
 }
 
+static void *lfh_block_init_used( struct block *block, ULONG flags, SIZE_T block_size, SIZE_T size )
+{
+    block_set_type( block, BLOCK_TYPE_USED );
+    block_set_flags( block, (BYTE)~BLOCK_FLAG_LFH, BLOCK_USER_FLAGS( flags ) );
+    block->tail_size = block_size - sizeof(*block) - size;
+    initialize_block( block, 0, size, flags );
+    mark_block_tail( block, flags );
+    return block + 1;
+}
+
 static NTSTATUS heap_allocate_block_lfh( struct heap *heap, ULONG flags, SIZE_T block_size,
                                          SIZE_T size, void **ret )
 {
@@ -1927,14 +1945,7 @@ static NTSTATUS heap_allocate_block_lfh( struct heap *heap, ULONG flags, SIZE_T
     block_size = BLOCK_BIN_SIZE( BLOCK_SIZE_BIN( block_size ) );
 
     if ((block = find_free_bin_block( heap, flags, block_size, bin )))
-    {
-        block_set_type( block, BLOCK_TYPE_USED );
-        block_set_flags( block, (BYTE)~BLOCK_FLAG_LFH, BLOCK_USER_FLAGS( flags ) );
-        block->tail_size = block_size - sizeof(*block) - size;
-        initialize_block( block, 0, size, flags );
-        mark_block_tail( block, flags );
-        *ret = block + 1;
-    }
+        *ret = lfh_block_init_used( block, flags, block_size, size );
 
     return block ? STATUS_SUCCESS : STATUS_NO_MEMORY;
 }
@@ -2012,12 +2023,250 @@ static void heap_thread_detach_bin_groups( struct heap *heap )
     }
 }
 
+/* Per-thread cache of free LFH blocks, in front of the bins.
+ *
+ * Small blocks freed by a thread are kept in a thread private array and handed back to
+ * the next allocations of the same size without any interlocked operation. When an array
+ * is full, half of it is released back to the owning groups at once, with a single
+ * interlocked operation for all the blocks that belong to the same group.
+ */
+
+#define THREAD_CACHE_BIN_COUNT  0x20  /* cache blocks up to BIN_SIZE_MIN_2 bytes */
+#define THREAD_CACHE_DEPTH      8     /* max number of cached blocks per bin */
+#define THREAD_CACHE_HEAP_COUNT 2     /* max number of heaps cached per thread */
+#define THREAD_CACHE_STATS_BATCH 1024 /* number of events before publishing statistics */
+
+struct thread_cache_bin
+{
+    UINT          count;
+    struct block *blocks[THREAD_CACHE_DEPTH];
+};
+
+struct thread_cache
+{
+    struct heap *heap;       /* heap owning the cached blocks */
+    LONG         serial;     /* serial of the heap, to detect when it has been destroyed */
+    LONG         hits;       /* statistics not yet published to the heap */
+    LONG         misses;
+    LONG         flushes;
+    struct thread_cache_bin bins[THREAD_CACHE_BIN_COUNT];
+};
+
+struct thread_caches
+{
+    LONG                destroy_count;  /* heap_destroy_count when the caches were last checked */
+    struct thread_cache caches[THREAD_CACHE_HEAP_COUNT];
+};
+
+/* check if a heap still exists, process heap lock must be held */
+static BOOL heap_is_alive( struct heap *heap, LONG serial )
+{
+    struct heap *iter;
+
+    if (heap == process_heap) return TRUE;
+    LIST_FOR_EACH_ENTRY( iter, &process_heap->entry, struct heap, entry )
+        if (iter == heap) return heap->serial == serial;
+    return FALSE;
+}
+
+static void thread_cache_publish_stats( struct thread_cache *cache )
+{
+    if (cache->hits) InterlockedExchangeAdd64( &cache->heap->cache_hits, cache->hits );
+    if (cache->misses) InterlockedExchangeAdd64( &cache->heap->cache_misses, cache->misses );
+    if (cache->flushes) InterlockedExchangeAdd64( &cache->heap->cache_flushes, cache->flushes );
+    cache->hits = cache->misses = cache->flushes = 0;
+}
+
+/* count a cache event, publishing the statistics once enough of them have accumulated */
+static inline void thread_cache_count( struct thread_cache *cache, LONG *counter )
+{
+    if (++*counter == THREAD_CACHE_STATS_BATCH) thread_cache_publish_stats( cache );
+}
+
+/* release the cached blocks of a bin back to their groups, heap must be alive */
+static void thread_cache_flush_bin( struct thread_cache *cache, struct thread_cache_bin *bin, UINT count )
+{
+    struct heap *heap = cache->heap;
+    struct bin *heap_bin = heap->bins + (bin - cache->bins);
+    struct block *block;
+    struct group *group;
+    LONG free_bits;
+    UINT i, j;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!(block = bin->blocks[i])) continue;
+
+        /* collect all the blocks of the same group, to free them at once */
+        group = block_get_group( block );
+        for (j = i, free_bits = 0; j < count; j++)
+        {
+            if (!(block = bin->blocks[j]) || block_get_group( block ) != group) continue;
+            mark_block_free( block + 1, block_get_size( block ) - sizeof(*block), heap->flags );
+            free_bits |= 1 << block_get_group_index( block );
+            bin->blocks[j] = NULL;
+        }
+
+        /* if these were the last used blocks in the group and GROUP_FLAG_FREE was set */
+        if (InterlockedOr( &group->free_bits, free_bits ) == ~free_bits)
+        {
+            /* thread now owns the group, and can release it to its bin */
+            group->free_bits = ~GROUP_FLAG_FREE;
+            if (heap_release_bin_group( heap, heap->flags, heap_bin, group ))
+                ERR( "heap %p, group %p: failed to release cached blocks\n", heap, group );
+        }
+    }
+
+    memmove( bin->blocks, bin->blocks + count, (bin->count - count) * sizeof(*bin->blocks) );
+    bin->count -= count;
+    thread_cache_count( cache, &cache->flushes );
+}
+
+/* release all the cached blocks, and forget about the heap */
+static void thread_cache_release( struct thread_cache *cache, BOOL alive )
+{
+    UINT i;
+
+    if (!cache->heap) return;
+    if (alive)
+    {
+        for (i = 0; i < THREAD_CACHE_BIN_COUNT; i++)
+            if (cache->bins[i].count) thread_cache_flush_bin( cache, &cache->bins[i], cache->bins[i].count );
+        thread_cache_publish_stats( cache );
+    }
+    memset( cache, 0, sizeof(*cache) );
+}
+
+/* forget about the cached heaps that have been destroyed */
+static void thread_caches_purge( struct thread_caches *caches )
+{
+    UINT i;
+
+    RtlEnterCriticalSection( &process_heap->cs );
+    caches->destroy_count = heap_destroy_count;
+    for (i = 0; i < THREAD_CACHE_HEAP_COUNT; i++)
+    {
+        struct thread_cache *cache = caches->caches + i;
+        if (cache->heap && !heap_is_alive( cache->heap, cache->serial )) thread_cache_release( cache, FALSE );
+    }
+    RtlLeaveCriticalSection( &process_heap->cs );
+}
+
+/* find the current thread cache for a heap */
+static struct thread_cache *find_thread_cache( struct thread_caches *caches, struct heap *heap )
+{
+    struct thread_cache *cache, *free = NULL;
+    UINT i;
+
+    for (i = 0; i < THREAD_CACHE_HEAP_COUNT; i++)
+    {
+        cache = caches->caches + i;
+        if (cache->heap == heap && cache->serial != heap->serial)
+        {
+            /* the heap has been destroyed and another one created at the same address */
+            thread_cache_release( cache, FALSE );
+        }
+        if (cache->heap == heap) return cache;
+        if (!cache->heap && !free) free = cache;
+    }
+    if (!free) return NULL;
+
+    free->heap = heap;
+    free->serial = heap->serial;
+    return free;
+}
+
+/* get the current thread cache for a heap, returns NULL if blocks shouldn't be cached */
+static struct thread_cache *heap_get_thread_cache( struct heap *heap, ULONG flags, SIZE_T index )
+{
+    struct thread_caches *caches = NtCurrentTeb()->TlsSlots[NTDLL_TLS_HEAP];
+    struct thread_cache *cache;
+
+    if (index >= THREAD_CACHE_BIN_COUNT) return NULL;
+    if ((flags & HEAP_CHECKING_ENABLED) || heap->pending_free) return NULL;
+
+    if (!caches)
+    {
+        if (!(caches = RtlAllocateHeap( process_heap, HEAP_ZERO_MEMORY, sizeof(*caches) ))) return NULL;
+        caches->destroy_count = ReadNoFence( &heap_destroy_count );
+        NtCurrentTeb()->TlsSlots[NTDLL_TLS_HEAP] = caches;
+    }
+
+    if ((cache = find_thread_cache( caches, heap ))) return cache;
+
+    /* all the caches are in use, check if some heaps have been destroyed since last time */
+    if (caches->destroy_count == ReadNoFence( &heap_destroy_count )) return NULL;
+    thread_caches_purge( caches );
+    return find_thread_cache( caches, heap );
+}
+
+static NTSTATUS heap_allocate_block_cached( struct heap *heap, ULONG flags, SIZE_T block_size,
+                                            SIZE_T size, void **ret )
+{
+    SIZE_T index = BLOCK_SIZE_BIN( block_size );
+    struct thread_cache_bin *bin;
+    struct thread_cache *cache;
+
+    if (!(cache = heap_get_thread_cache( heap, flags, index ))) return STATUS_UNSUCCESSFUL;
+    if (!ReadNoFence( &heap->bins[index].enabled )) return STATUS_UNSUCCESSFUL;
+
+    bin = cache->bins + index;
+    if (!bin->count)
+    {
+        thread_cache_count( cache, &cache->misses );
+        return STATUS_UNSUCCESSFUL;
+    }
+
+    thread_cache_count( cache, &cache->hits );
+    *ret = lfh_block_init_used( bin->blocks[--bin->count], flags, BLOCK_BIN_SIZE( index ), size );
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS heap_free_block_cached( struct heap *heap, ULONG flags, struct block *block )
+{
+    SIZE_T block_size = block_get_size( block ), index = BLOCK_SIZE_BIN( block_size );
+    struct thread_cache_bin *bin;
+    struct thread_cache *cache;
+
+    if (!(block_get_flags( block ) & BLOCK_FLAG_LFH)) return STATUS_UNSUCCESSFUL;
+    if (!(cache = heap_get_thread_cache( heap, flags, index ))) return STATUS_UNSUCCESSFUL;
+
+    valgrind_make_writable( block, sizeof(*block) );
+    block_set_type( block, BLOCK_TYPE_FREE );
+    block_set_flags( block, (BYTE)~BLOCK_FLAG_LFH, BLOCK_FLAG_FREE );
+
+    bin = cache->bins + index;
+    if (bin->count == THREAD_CACHE_DEPTH) thread_cache_flush_bin( cache, bin, THREAD_CACHE_DEPTH / 2 );
+    bin->blocks[bin->count++] = block;
+    return STATUS_SUCCESS;
+}
+
+/* release the current thread cache, process heap lock must be held */
+static void heap_thread_detach_cache(void)
+{
+    struct thread_caches *caches = NtCurrentTeb()->TlsSlots[NTDLL_TLS_HEAP];
+    UINT i;
+
+    if (!caches) return;
+
+    for (i = 0; i < THREAD_CACHE_HEAP_COUNT; i++)
+    {
+        struct thread_cache *cache = caches->caches + i;
+        if (cache->heap) thread_cache_release( cache, heap_is_alive( cache->heap, cache->serial ) );
+    }
+
+    NtCurrentTeb()->TlsSlots[NTDLL_TLS_HEAP] = NULL;
+    RtlFreeHeap( process_heap, 0, caches );
+}
+
 void heap_thread_detach(void)
 {
     struct heap *heap;
 
     RtlEnterCriticalSection( &process_heap->cs );
 
+    heap_thread_detach_cache();
+
     LIST_FOR_EACH_ENTRY( heap, &process_heap->entry, struct heap, entry )
         heap_thread_detach_bin_groups( heap );
 
@@ -2042,6 +2291,8 @@ void *WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE handle, ULONG flags, SIZE
         status = STATUS_NO_MEMORY;
     else if (block_size >= HEAP_MIN_LARGE_BLOCK_SIZE)
         status = heap_allocate_large( heap, heap_flags, block_size, size, &ptr );
+    else if (heap->bins && !heap_allocate_block_cached( heap, heap_flags, block_size, size, &ptr ))
+        status = STATUS_SUCCESS;
     else if (heap->bins && !heap_allocate_block_lfh( heap, heap_flags, block_size, size, &ptr ))
         status = STATUS_SUCCESS;
     else
@@ -2088,6 +2339,8 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE handle, ULONG flags, void *
         status = heap_free_large( heap, heap_flags, block );
     else if (!(block = heap_delay_free( heap, heap_flags, block )))
         status = STATUS_SUCCESS;
+    else if (heap->bins && !heap_free_block_cached( heap, heap_flags, block ))
+        status = STATUS_SUCCESS;
     else if (!heap_free_block_lfh( heap, heap_flags, block ))
         status = STATUS_SUCCESS;
     else
@@ -2546,6 +2799,28 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
     return total;
 }
 
+static NTSTATUS query_thread_cache_info( HANDLE handle, HEAP_WINE_THREAD_CACHE_INFORMATION *info,
+                                         SIZE_T size_in, SIZE_T *size_out )
+{
+    struct thread_caches *caches = NtCurrentTeb()->TlsSlots[NTDLL_TLS_HEAP];
+    struct heap *heap;
+    ULONG flags;
+    UINT i;
+
+    if (!(heap = unsafe_heap_from_handle( handle, 0, &flags ))) return STATUS_ACCESS_VIOLATION;
+    if (size_out) *size_out = sizeof(*info);
+    if (size_in < sizeof(*info)) return STATUS_BUFFER_TOO_SMALL;
+
+    /* statistics of other threads are published in batches */
+    for (i = 0; caches && i < THREAD_CACHE_HEAP_COUNT; i++)
+        if (caches->caches[i].heap == heap) thread_cache_publish_stats( caches->caches + i );
+
+    info->Hits    = InterlockedExchangeAdd64( &heap->cache_hits, 0 );
+    info->Misses  = InterlockedExchangeAdd64( &heap->cache_misses, 0 );
+    info->Flushes = InterlockedExchangeAdd64( &heap->cache_flushes, 0 );
+    return STATUS_SUCCESS;
+}
+
 /***********************************************************************
  *           RtlQueryHeapInformation    (NTDLL.@)
  */
@@ -2557,6 +2832,9 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE handle, HEAP_INFORMATION_CLASS i
 
     TRACE( "handle %p, info_class %u, info %p, size_in %Iu, size_out %p.\n", handle, info_class, info, size_in, size_out );
 
+    if (info_class == HeapWineThreadCacheInformation)
+        return query_thread_cache_info( handle, info, size_in, size_out );
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
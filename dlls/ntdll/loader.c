@@ -90,6 +90,7 @@ static const WCHAR system_path[] = L"C:\\windows\\system32;C:\\windows\\system;C
 static BOOL is_prefix_bootstrap;  /* are we bootstrapping the prefix? */
 static BOOL imports_fixup_done = FALSE;  /* set once the imports have been fixed up, before attaching them */
 static BOOL process_detaching = FALSE;  /* set on process detach to avoid deadlocks with thread detach */
+static BOOL use_import_cache = TRUE;  /* cleared if the import cache isn't enabled */
 static int free_lib_count;   /* recursion depth of LdrUnloadDll calls */
 static LONG path_safe_mode;  /* path mode set by RtlSetSearchPathMode */
 static LONG dll_safe_mode = 1;  /* dll search mode */
@@ -133,10 +134,20 @@ typedef struct _wine_modref
 {
     LDR_DATA_TABLE_ENTRY  ldr;
     struct file_id        id;
+    LIST_ENTRY            id_hash_links;    /* entry in the file id hash table */
     ULONG                 CheckSum;
     BOOL                  system;
+    DWORD                *export_hash;      /* hash table of export name indexes, if built */
+    DWORD                 export_hash_mask; /* size of the export hash table minus one */
+    ULONGLONG             export_key[2];    /* import cache key of the export table, if computed */
 } WINE_MODREF;
 
+#define HASH_MAP_SIZE 32  /* number of buckets in the module hash tables */
+static LIST_ENTRY basename_hash_table[HASH_MAP_SIZE];  /* modules by base name, in load order */
+static LIST_ENTRY fileid_hash_table[HASH_MAP_SIZE];    /* modules by file id, in load order */
+
+#define EXPORT_HASH_MIN_NAMES 512  /* minimum number of exported names to use a hash table */
+
 static UINT tls_module_count;      /* number of modules with TLS directory */
 static IMAGE_TLS_DIRECTORY *tls_dirs;  /* array of TLS directories */
 static LIST_ENTRY tls_links = { &tls_links, &tls_links };
@@ -581,6 +592,35 @@ static WINE_MODREF *get_modref( HMODULE hmod )
 }
 
 
+/**********************************************************************
+ *	    hash_basename
+ *
+ * Return the hash table bucket for a module base name.
+ */
+static LIST_ENTRY *hash_basename( const UNICODE_STRING *name )
+{
+    ULONG hash = 0;
+
+    RtlHashUnicodeString( name, TRUE, HASH_STRING_ALGORITHM_DEFAULT, &hash );
+    return &basename_hash_table[hash % HASH_MAP_SIZE];
+}
+
+
+/**********************************************************************
+ *	    hash_fileid
+ *
+ * Return the hash table bucket for a module file id.
+ */
+static LIST_ENTRY *hash_fileid( const struct file_id *id )
+{
+    ULONG hash = 0;
+    unsigned int i;
+
+    for (i = 0; i < sizeof(*id); i++) hash = hash * 65599 + ((const BYTE *)id)[i];
+    return &fileid_hash_table[hash % HASH_MAP_SIZE];
+}
+
+
 /**********************************************************************
  *	    find_basename_module
  *
@@ -597,10 +637,10 @@ static WINE_MODREF *find_basename_module( LPCWSTR name )
     if (cached_modref && RtlEqualUnicodeString( &name_str, &cached_modref->ldr.BaseDllName, TRUE ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    mark = hash_basename( &name_str );
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        WINE_MODREF *mod = CONTAINING_RECORD(entry, WINE_MODREF, ldr.InLoadOrderLinks);
+        WINE_MODREF *mod = CONTAINING_RECORD(entry, WINE_MODREF, ldr.HashLinks);
         if (RtlEqualUnicodeString( &name_str, &mod->ldr.BaseDllName, TRUE ) && !mod->system)
         {
             cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
@@ -620,7 +660,8 @@ static WINE_MODREF *find_basename_module( LPCWSTR name )
 static WINE_MODREF *find_fullname_module( const UNICODE_STRING *nt_name )
 {
     PLIST_ENTRY mark, entry;
-    UNICODE_STRING name = *nt_name;
+    UNICODE_STRING name = *nt_name, base_name;
+    USHORT i;
 
     if (name.Length <= 4 * sizeof(WCHAR)) return NULL;
     name.Length -= 4 * sizeof(WCHAR);  /* for \??\ prefix */
@@ -629,10 +670,15 @@ static WINE_MODREF *find_fullname_module( const UNICODE_STRING *nt_name )
     if (cached_modref && RtlEqualUnicodeString( &name, &cached_modref->ldr.FullDllName, TRUE ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    /* a module with the same full name also has the same base name */
+    for (i = name.Length / sizeof(WCHAR); i > 0; i--) if (name.Buffer[i - 1] == '\\') break;
+    base_name.Buffer = name.Buffer + i;
+    base_name.Length = base_name.MaximumLength = name.Length - i * sizeof(WCHAR);
+
+    mark = hash_basename( &base_name );
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks);
+        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, HashLinks);
         if (RtlEqualUnicodeString( &name, &mod->FullDllName, TRUE ))
         {
             cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
@@ -655,11 +701,10 @@ static WINE_MODREF *find_fileid_module( const struct file_id *id )
 
     if (cached_modref && !memcmp( &cached_modref->id, id, sizeof(*id) )) return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    mark = hash_fileid( id );
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD( entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks );
-        WINE_MODREF *wm = CONTAINING_RECORD( mod, WINE_MODREF, ldr );
+        WINE_MODREF *wm = CONTAINING_RECORD( entry, WINE_MODREF, id_hash_links );
 
         if (!memcmp( &wm->id, id, sizeof(*id) ))
         {
@@ -1039,6 +1084,54 @@ static int find_name_in_exports( HMODULE module, const IMAGE_EXPORT_DIRECTORY *e
 }
 
 
+/*************************************************************************
+ *		hash_export_name
+ */
+static inline DWORD hash_export_name( const char *name )
+{
+    DWORD hash = 0;
+
+    while (*name) hash = hash * 65599 + (unsigned char)*name++;
+    return hash;
+}
+
+
+/*************************************************************************
+ *		find_hashed_export
+ *
+ * Helper for find_named_export, using a hash table of the export names for large export tables.
+ * Return -2 if the hash table can't be used.
+ * The loader_section must be locked while calling this function.
+ */
+static int find_hashed_export( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports, const char *name )
+{
+    const WORD *ordinals = get_rva( wm->ldr.DllBase, exports->AddressOfNameOrdinals );
+    const DWORD *names = get_rva( wm->ldr.DllBase, exports->AddressOfNames );
+    DWORD i, pos, size;
+
+    if (!wm->export_hash)
+    {
+        /* use a table at least twice as large as the number of names, so that chains remain short */
+        for (size = 1; size < 2 * exports->NumberOfNames; size *= 2) ;
+        if (!(wm->export_hash = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                                 size * sizeof(*wm->export_hash) )))
+            return -2;
+        wm->export_hash_mask = size - 1;
+        /* store index + 1 so that 0 can be used for empty entries */
+        for (i = 0; i < exports->NumberOfNames; i++)
+        {
+            pos = hash_export_name( get_rva( wm->ldr.DllBase, names[i] ));
+            while (wm->export_hash[pos & wm->export_hash_mask]) pos++;
+            wm->export_hash[pos & wm->export_hash_mask] = i + 1;
+        }
+    }
+
+    for (pos = hash_export_name( name ); (i = wm->export_hash[pos & wm->export_hash_mask]); pos++)
+        if (!strcmp( get_rva( wm->ldr.DllBase, names[i - 1] ), name )) return ordinals[i - 1];
+    return -1;
+}
+
+
 /*************************************************************************
  *		find_named_export
  *
@@ -1050,6 +1143,7 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
 {
     const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
     const DWORD *names = get_rva( module, exports->AddressOfNames );
+    WINE_MODREF *wm;
     int ordinal;
 
     /* first check the hint */
@@ -1060,8 +1154,12 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
             return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path );
     }
 
-    /* then do a binary search */
-    if ((ordinal = find_name_in_exports( module, exports, name )) == -1) return NULL;
+    /* then use a hash table for large export tables, or do a binary search */
+    ordinal = -2;
+    if (exports->NumberOfNames >= EXPORT_HASH_MIN_NAMES && (wm = get_modref( module )))
+        ordinal = find_hashed_export( wm, exports, name );
+    if (ordinal == -2) ordinal = find_name_in_exports( module, exports, name );
+    if (ordinal == -1) return NULL;
     return find_ordinal_export( module, exports, exp_size, ordinal, load_path );
 
 }
@@ -1094,6 +1192,129 @@ void * WINAPI RtlFindExportedRoutineByName( HMODULE module, const char *name )
 }
 
 
+/*************************************************************************
+ *		hash_import_data
+ *
+ * Helper for the import cache keys, which use two independent 64-bit hashes.
+ */
+static void hash_import_data( ULONGLONG key[2], const void *data, SIZE_T size )
+{
+    const BYTE *ptr = data;
+    DWORD val;
+
+    for ( ; size; ptr += sizeof(val), size -= min( size, sizeof(val) ))
+    {
+        val = 0;
+        memcpy( &val, ptr, min( size, sizeof(val) ));
+        key[0] = (key[0] ^ val) * 0x100000001b3;
+        key[1] = ((key[1] + val) * 0x9e3779b97f4a7c15) ^ (key[1] >> 29);
+    }
+}
+
+
+/*************************************************************************
+ *		get_export_key
+ *
+ * Get the part of the import cache key that identifies the exporting module and its address.
+ * The loader_section must be locked while calling this function.
+ */
+static const ULONGLONG *get_export_key( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports, DWORD exp_size )
+{
+    HMODULE module = wm->ldr.DllBase;
+
+    if (wm->export_key[0] || wm->export_key[1]) return wm->export_key;
+
+    wm->export_key[0] = 0xcbf29ce484222325;
+    hash_import_data( wm->export_key, &module, sizeof(module) );
+    hash_import_data( wm->export_key, &wm->ldr.SizeOfImage, sizeof(wm->ldr.SizeOfImage) );
+    hash_import_data( wm->export_key, &wm->id, sizeof(wm->id) );
+    hash_import_data( wm->export_key, &exp_size, sizeof(exp_size) );
+    hash_import_data( wm->export_key, exports, sizeof(*exports) );
+    hash_import_data( wm->export_key, get_rva( module, exports->AddressOfFunctions ),
+                      exports->NumberOfFunctions * sizeof(DWORD) );
+    hash_import_data( wm->export_key, get_rva( module, exports->AddressOfNames ),
+                      exports->NumberOfNames * sizeof(DWORD) );
+    hash_import_data( wm->export_key, get_rva( module, exports->AddressOfNameOrdinals ),
+                      exports->NumberOfNames * sizeof(WORD) );
+    return wm->export_key;
+}
+
+
+/*************************************************************************
+ *		get_cached_imports
+ *
+ * Retrieve the import address table of an import descriptor from the import cache,
+ * with 0 for the entries that need to be resolved. Also return the cache key.
+ * The loader_section must be locked while calling this function.
+ */
+static BOOL get_cached_imports( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports, DWORD exp_size,
+                                HMODULE module, const char *name, const IMAGE_THUNK_DATA *import_list,
+                                ULONG_PTR *values, SIZE_T count, ULONGLONG key[2] )
+{
+    ULONG_PTR base = (ULONG_PTR)wm->ldr.DllBase;
+    struct import_cache_params params;
+    const IMAGE_IMPORT_BY_NAME *pe_name;
+    NTSTATUS status;
+    SIZE_T i;
+
+    memcpy( key, get_export_key( wm, exports, exp_size ), sizeof(params.key) );
+    hash_import_data( key, name, strlen(name) + 1 );
+    for (i = 0; i < count; i++)
+    {
+        if (IMAGE_SNAP_BY_ORDINAL(import_list[i].u1.Ordinal))
+            hash_import_data( key, &import_list[i].u1.Ordinal, sizeof(import_list[i].u1.Ordinal) );
+        else
+        {
+            pe_name = get_rva( module, (DWORD)import_list[i].u1.AddressOfData );
+            hash_import_data( key, pe_name->Name, strlen( (const char *)pe_name->Name ) + 1 );
+        }
+    }
+
+    memcpy( params.key, key, sizeof(params.key) );
+    params.values = values;
+    params.count  = count;
+    if ((status = WINE_UNIX_CALL( unix_get_import_cache, &params )))
+    {
+        if (status == STATUS_NOT_SUPPORTED) use_import_cache = FALSE;
+        return FALSE;
+    }
+
+    /* only direct exports of the module are cached */
+    for (i = 0; i < count; i++)
+        if (values[i] && (values[i] < base || values[i] >= base + wm->ldr.SizeOfImage)) return FALSE;
+    return TRUE;
+}
+
+
+/*************************************************************************
+ *		set_cached_imports
+ *
+ * Store a resolved import address table in the import cache. Forwarded exports and stubs are
+ * left out, since they need to be resolved again to load the modules they depend on.
+ */
+static void set_cached_imports( WINE_MODREF *wm, const ULONGLONG key[2], const IMAGE_THUNK_DATA *thunk_list,
+                                ULONG_PTR *values, SIZE_T count )
+{
+    ULONG_PTR base = (ULONG_PTR)wm->ldr.DllBase;
+    struct import_cache_params params;
+    BOOL found = FALSE;
+    SIZE_T i;
+
+    for (i = 0; i < count; i++)
+    {
+        values[i] = thunk_list[i].u1.Function;
+        if (values[i] < base || values[i] >= base + wm->ldr.SizeOfImage) values[i] = 0;
+        else found = TRUE;
+    }
+    if (!found) return;
+
+    memcpy( params.key, key, sizeof(params.key) );
+    params.values = values;
+    params.count  = count;
+    if (WINE_UNIX_CALL( unix_set_import_cache, &params ) == STATUS_NOT_SUPPORTED) use_import_cache = FALSE;
+}
+
+
 /*************************************************************************
  *		import_dll
  *
@@ -1114,8 +1335,11 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
     const char *name = get_rva( module, descr->Name );
     DWORD len = strlen(name);
     PVOID protect_base;
-    SIZE_T protect_size = 0;
+    SIZE_T i, count, protect_size = 0;
     DWORD protect_old;
+    ULONG_PTR *cache = NULL;
+    ULONGLONG key[2];
+    BOOL cached = FALSE;
 
     thunk_list = get_rva( module, (DWORD)descr->FirstThunk );
     if (descr->OriginalFirstThunk)
@@ -1147,6 +1371,7 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
     /* unprotect the import address table since it can be located in
      * readonly section */
     while (import_list[protect_size].u1.Ordinal) protect_size++;
+    count = protect_size;
     protect_base = thunk_list;
     protect_size *= sizeof(*thunk_list);
     NtProtectVirtualMemory( NtCurrentProcess(), &protect_base,
@@ -1181,9 +1406,17 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
         goto done;
     }
 
-    while (import_list->u1.Ordinal)
+    if (use_import_cache && !TRACE_ON(relay) && !TRACE_ON(snoop) && !TRACE_ON(imports) &&
+        (cache = RtlAllocateHeap( GetProcessHeap(), 0, count * sizeof(*cache) )))
+        cached = get_cached_imports( wmImp, exports, exp_size, module, name, import_list, cache, count, key );
+
+    for (i = 0; import_list->u1.Ordinal; i++)
     {
-        if (IMAGE_SNAP_BY_ORDINAL(import_list->u1.Ordinal))
+        if (cached && cache[i])
+        {
+            thunk_list->u1.Function = cache[i];
+        }
+        else if (IMAGE_SNAP_BY_ORDINAL(import_list->u1.Ordinal))
         {
             int ordinal = IMAGE_ORDINAL(import_list->u1.Ordinal);
 
@@ -1219,6 +1452,9 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
         thunk_list++;
     }
 
+    if (cache && !cached && use_import_cache) set_cached_imports( wmImp, key, thunk_list - count, cache, count );
+    RtlFreeHeap( GetProcessHeap(), 0, cache );
+
 done:
     /* restore old protection of the import address table */
     NtProtectVirtualMemory( NtCurrentProcess(), &protect_base, &protect_size, protect_old, &protect_old );
@@ -1546,6 +1782,8 @@ static WINE_MODREF *alloc_module( HMODULE hModule, const UNICODE_STRING *nt_name
                    &wm->ldr.InLoadOrderLinks);
     InsertTailList(&NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList,
                    &wm->ldr.InMemoryOrderLinks);
+    InsertTailList( hash_basename( &wm->ldr.BaseDllName ), &wm->ldr.HashLinks );
+    InsertTailList( hash_fileid( &wm->id ), &wm->id_hash_links );
     /* wait until init is called for inserting into InInitializationOrderModuleList */
 
     if (!(nt->OptionalHeader.DllCharacteristics & IMAGE_DLLCHARACTERISTICS_NX_COMPAT))
@@ -2222,7 +2460,12 @@ static NTSTATUS build_module( LPCWSTR load_path, const UNICODE_STRING *nt_name,
 
     if (!(wm = alloc_module( *module, nt_name, is_builtin ))) return STATUS_NO_MEMORY;
 
-    if (id) wm->id = *id;
+    if (id)
+    {
+        wm->id = *id;
+        RemoveEntryList( &wm->id_hash_links );
+        InsertTailList( hash_fileid( &wm->id ), &wm->id_hash_links );
+    }
     if (image_info->LoaderFlags) wm->ldr.Flags |= LDR_COR_IMAGE;
     if (image_info->ComPlusILOnly) wm->ldr.Flags |= LDR_COR_ILONLY;
     wm->system = system;
@@ -2241,9 +2484,11 @@ static NTSTATUS build_module( LPCWSTR load_path, const UNICODE_STRING *nt_name,
             status = fixup_imports( wm, load_path );
         if (status != STATUS_SUCCESS)
         {
-            /* the module has only be inserted in the load & memory order lists */
+            /* the module has only be inserted in the load & memory order lists and hash tables */
             RemoveEntryList(&wm->ldr.InLoadOrderLinks);
             RemoveEntryList(&wm->ldr.InMemoryOrderLinks);
+            RemoveEntryList(&wm->ldr.HashLinks);
+            RemoveEntryList(&wm->id_hash_links);
 
             /* FIXME: there are several more dangling references
              * left. Including dlls loaded by this dll before the
@@ -3323,6 +3568,24 @@ NTSTATUS WINAPI __wine_ctrl_routine( void *arg )
 }
 
 
+/***********************************************************************
+ *              __wine_io_uring_thread
+ */
+NTSTATUS WINAPI __wine_io_uring_thread( void *arg )
+{
+    RtlExitUserThread( WINE_UNIX_CALL( unix_io_uring_thread, NULL ));
+}
+
+
+/***********************************************************************
+ *              __wine_sock_poll_thread
+ */
+NTSTATUS WINAPI __wine_sock_poll_thread( void *arg )
+{
+    RtlExitUserThread( WINE_UNIX_CALL( unix_sock_poll_thread, NULL ));
+}
+
+
 /***********************************************************************
  *           __wine_unix_spawnvp
  */
@@ -3918,6 +4181,8 @@ static void free_modref( WINE_MODREF *wm )
 
     RemoveEntryList(&wm->ldr.InLoadOrderLinks);
     RemoveEntryList(&wm->ldr.InMemoryOrderLinks);
+    RemoveEntryList(&wm->ldr.HashLinks);
+    RemoveEntryList(&wm->id_hash_links);
     if (wm->ldr.InInitializationOrderLinks.Flink)
         RemoveEntryList(&wm->ldr.InInitializationOrderLinks);
 
@@ -3950,6 +4215,7 @@ static void free_modref( WINE_MODREF *wm )
     NtUnmapViewOfSection( NtCurrentProcess(), wm->ldr.DllBase );
     if (cached_modref == wm) cached_modref = NULL;
     RtlFreeUnicodeString( &wm->ldr.FullDllName );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
     RtlFreeHeap( GetProcessHeap(), 0, wm );
 }
 
@@ -4304,6 +4570,7 @@ void loader_init( CONTEXT *context, void **entry )
         ANSI_STRING ctrl_routine = RTL_CONSTANT_STRING( "CtrlRoutine" );
         WINE_MODREF *kernel32;
         PEB *peb = NtCurrentTeb()->Peb;
+        unsigned int i;
 
         peb->LdrData            = &ldr;
         peb->FastPebLock        = &peb_lock;
@@ -4318,6 +4585,14 @@ void loader_init( CONTEXT *context, void **entry )
         /* TLS index 0 is always reserved, and wow64 reserves extra TLS entries */
         RtlSetBits( peb->TlsBitmap, 0, NtCurrentTeb()->WowTebOffset ? WOW64_TLS_MAX_NUMBER : 1 );
         RtlSetBits( peb->TlsBitmap, NTDLL_TLS_ERRNO, 1 );
+        RtlSetBits( peb->TlsBitmap, NTDLL_TLS_HEAP, 1 );
+        RtlSetBits( peb->TlsBitmap, NTDLL_TLS_THREADPOOL, 1 );
+
+        for (i = 0; i < HASH_MAP_SIZE; i++)
+        {
+            InitializeListHead( &basename_hash_table[i] );
+            InitializeListHead( &fileid_hash_table[i] );
+        }
 
         init_user_process_params();
         load_global_options();
@@ -33,7 +33,19 @@
 
 #define MAX_NT_PATH_LENGTH 277
 
-#define NTDLL_TLS_ERRNO 16  /* TLS slot for _errno() */
+#define NTDLL_TLS_ERRNO      16  /* TLS slot for _errno() */
+#define NTDLL_TLS_HEAP       17  /* TLS slot for the heap thread cache */
+#define NTDLL_TLS_THREADPOOL 18  /* TLS slot for the threadpool worker state */
+
+/* Wine-specific heap information class returning the thread cache statistics */
+#define HeapWineThreadCacheInformation ((HEAP_INFORMATION_CLASS)1000)
+
+typedef struct
+{
+    ULONGLONG Hits;
+    ULONGLONG Misses;
+    ULONGLONG Flushes;
+} HEAP_WINE_THREAD_CACHE_INFORMATION;
 
 #ifdef __i386__
 static const USHORT current_machine = IMAGE_FILE_MACHINE_I386;
@@ -1134,6 +1134,80 @@ static void test_redirection(void)
     pRtlWow64EnableFsRedirectionEx( old, &cur );
 }
 
+static void test_directory_enum_rate(void)
+{
+    static const FILE_INFORMATION_CLASS classes[] = { FileNamesInformation, FileIdBothDirectoryInformation };
+    DWORD i, j, start, count, file_count = winetest_interactive ? 100000 : 1000;
+    char testdir[MAX_PATH], name[MAX_PATH];
+    IO_STATUS_BLOCK io;
+    NTSTATUS status;
+    HANDLE handle;
+    BOOLEAN restart;
+    BYTE *data;
+
+    GetTempPathA( MAX_PATH, testdir );
+    strcat( testdir, "enumrate.tmp" );
+    if (!CreateDirectoryA( testdir, NULL ))
+    {
+        skip( "cannot create %s, error %lu\n", testdir, GetLastError() );
+        return;
+    }
+    for (i = 0; i < file_count; i++)
+    {
+        sprintf( name, "%s\\file%06lu.txt", testdir, i );
+        handle = CreateFileA( name, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, NULL );
+        if (handle == INVALID_HANDLE_VALUE) break;
+        CloseHandle( handle );
+    }
+    ok( i == file_count, "created %lu files, error %lu\n", i, GetLastError() );
+    file_count = i;
+
+    data = malloc( 65536 );
+    handle = CreateFileA( testdir, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                          NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL );
+    ok( handle != INVALID_HANDLE_VALUE, "failed to open %s, error %lu\n", testdir, GetLastError() );
+
+    for (i = 0; i < ARRAY_SIZE(classes); i++)
+    {
+        for (j = 0; j < 2; j++)  /* the second pass restarts the scan of the same handle */
+        {
+            start = GetTickCount();
+            count = 0;
+            restart = TRUE;
+            while (!(status = pNtQueryDirectoryFile( handle, NULL, NULL, NULL, &io, data, 65536,
+                                                     classes[i], FALSE, NULL, restart )))
+            {
+                FILE_NAMES_INFORMATION *info = (FILE_NAMES_INFORMATION *)data;
+                FILE_ID_BOTH_DIRECTORY_INFORMATION *id_info = (FILE_ID_BOTH_DIRECTORY_INFORMATION *)data;
+                ULONG next;
+
+                for (;;)
+                {
+                    count++;
+                    next = classes[i] == FileNamesInformation ? info->NextEntryOffset : id_info->NextEntryOffset;
+                    if (!next) break;
+                    info = (FILE_NAMES_INFORMATION *)((BYTE *)info + next);
+                    id_info = (FILE_ID_BOTH_DIRECTORY_INFORMATION *)((BYTE *)id_info + next);
+                }
+                restart = FALSE;
+            }
+            ok( status == STATUS_NO_MORE_FILES, "class %u: got status %#lx\n", classes[i], status );
+            ok( count == file_count + 2, "class %u: got %lu entries, expected %lu\n",
+                classes[i], count, file_count + 2 );
+            trace( "class %u pass %lu: %lu entries in %lu ms\n", classes[i], j, count, GetTickCount() - start );
+        }
+    }
+
+    CloseHandle( handle );
+    free( data );
+    for (i = 0; i < file_count; i++)
+    {
+        sprintf( name, "%s\\file%06lu.txt", testdir, i );
+        DeleteFileA( name );
+    }
+    RemoveDirectoryA( testdir );
+}
+
 START_TEST(directory)
 {
     WCHAR sysdir[MAX_PATH];
@@ -1158,4 +1232,5 @@ START_TEST(directory)
     test_NtQueryDirectoryFile();
     test_NtQueryDirectoryFile_case();
     test_redirection();
+    test_directory_enum_rate();
 }
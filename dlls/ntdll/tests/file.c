@@ -1087,6 +1087,84 @@ static void test_set_io_completion(void)
     pNtClose( h );
 }
 
+#define IO_COMPLETION_PACKETS 100000
+
+static DWORD WINAPI io_completion_post_thread( void *arg )
+{
+    HANDLE h = arg;
+    NTSTATUS res;
+    ULONG i;
+
+    for (i = 0; i < IO_COMPLETION_PACKETS; i++)
+    {
+        res = pNtSetIoCompletion( h, i, ~(ULONG_PTR)i, STATUS_SUCCESS, i );
+        if (res) break;
+    }
+    ok( i == IO_COMPLETION_PACKETS, "NtSetIoCompletion failed: %#lx\n", res );
+    return 0;
+}
+
+static void test_io_completion_throughput(void)
+{
+    FILE_IO_COMPLETION_INFORMATION info[64];
+    LARGE_INTEGER timeout;
+    ULONG i, count, total = 0, expect = 0;
+    DWORD start, elapsed;
+    NTSTATUS res;
+    HANDLE h, thread;
+
+    if (!pNtRemoveIoCompletionEx)
+    {
+        skip("NtRemoveIoCompletionEx() not present\n");
+        return;
+    }
+
+    res = pNtCreateIoCompletion( &h, IO_COMPLETION_ALL_ACCESS, NULL, 0 );
+    ok( res == STATUS_SUCCESS, "NtCreateIoCompletion failed: %#lx\n", res );
+
+    /* packets must be dequeued in order, including when more are queued than fit in a fast path */
+    for (i = 0; i < 3000; i++) pNtSetIoCompletion( h, i, 0, STATUS_SUCCESS, 0 );
+    count = get_pending_msgs( h );
+    ok( count == 3000, "Unexpected msg count: %lu\n", count );
+    timeout.QuadPart = 0;
+    while (!(res = pNtRemoveIoCompletionEx( h, info, ARRAY_SIZE(info), &count, &timeout, FALSE )))
+    {
+        for (i = 0; i < count; i++, expect++)
+            if (info[i].CompletionKey != expect) break;
+        if (i < count) break;
+    }
+    ok( res == STATUS_TIMEOUT, "NtRemoveIoCompletionEx failed: %#lx\n", res );
+    ok( expect == 3000, "got %lu packets in order\n", expect );
+
+    start = GetTickCount();
+    thread = CreateThread( NULL, 0, io_completion_post_thread, h, 0, NULL );
+    timeout.QuadPart = -10000000 * 10;
+    expect = 0;
+    while (total < IO_COMPLETION_PACKETS)
+    {
+        res = pNtRemoveIoCompletionEx( h, info, ARRAY_SIZE(info), &count, &timeout, FALSE );
+        if (res) break;
+        for (i = 0; i < count; i++, expect++)
+        {
+            if (info[i].CompletionKey != expect) break;
+            if (info[i].CompletionValue != ~(ULONG_PTR)expect) break;
+            if (info[i].IoStatusBlock.Information != expect) break;
+        }
+        total += count;
+        if (i < count) break;
+    }
+    elapsed = GetTickCount() - start;
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %#lx\n", res );
+    ok( expect == IO_COMPLETION_PACKETS, "got %lu packets in order\n", expect );
+    trace( "%u packets in %lu ms\n", IO_COMPLETION_PACKETS, elapsed );
+
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+    count = get_pending_msgs( h );
+    ok( !count, "Unexpected msg count: %lu\n", count );
+    pNtClose( h );
+}
+
 static void test_file_io_completion(void)
 {
     static const char pipe_name[] = "\\\\.\\pipe\\iocompletiontestnamedpipe";
@@ -4701,7 +4779,9 @@ static void test_file_access_information(void)
     FILE_ACCESS_INFORMATION info;
     IO_STATUS_BLOCK io;
     NTSTATUS status;
-    HANDLE h;
+    HANDLE h, dup;
+    DWORD flags;
+    BOOL ret;
 
     if (!(h = create_temp_file(0))) return;
 
@@ -4716,6 +4796,35 @@ static void test_file_access_information(void)
     ok( status == STATUS_SUCCESS, "expected STATUS_SUCCESS, got %08lx\n", status );
     ok( info.AccessFlags == 0x13019f, "got %08lx\n", info.AccessFlags );
 
+    /* duplicates share the object but not the handle access and flags */
+    ret = DuplicateHandle( GetCurrentProcess(), h, GetCurrentProcess(), &dup, 0, TRUE, DUPLICATE_SAME_ACCESS );
+    ok( ret, "DuplicateHandle failed %lu\n", GetLastError() );
+    memset( &info, 0x11, sizeof(info) );
+    status = pNtQueryInformationFile( dup, &io, &info, sizeof(info), FileAccessInformation );
+    ok( status == STATUS_SUCCESS, "expected STATUS_SUCCESS, got %08lx\n", status );
+    ok( info.AccessFlags == 0x13019f, "got %08lx\n", info.AccessFlags );
+    ret = GetHandleInformation( dup, &flags );
+    ok( ret, "GetHandleInformation failed %lu\n", GetLastError() );
+    ok( flags == HANDLE_FLAG_INHERIT, "got flags %#lx\n", flags );
+    ret = SetHandleInformation( dup, HANDLE_FLAG_INHERIT | HANDLE_FLAG_PROTECT_FROM_CLOSE, HANDLE_FLAG_PROTECT_FROM_CLOSE );
+    ok( ret, "SetHandleInformation failed %lu\n", GetLastError() );
+    ret = GetHandleInformation( dup, &flags );
+    ok( ret, "GetHandleInformation failed %lu\n", GetLastError() );
+    ok( flags == HANDLE_FLAG_PROTECT_FROM_CLOSE, "got flags %#lx\n", flags );
+    ret = GetHandleInformation( h, &flags );
+    ok( ret, "GetHandleInformation failed %lu\n", GetLastError() );
+    ok( !flags, "got flags %#lx\n", flags );
+    SetHandleInformation( dup, HANDLE_FLAG_PROTECT_FROM_CLOSE, 0 );
+    CloseHandle( dup );
+
+    ret = DuplicateHandle( GetCurrentProcess(), h, GetCurrentProcess(), &dup, FILE_READ_DATA, FALSE, 0 );
+    ok( ret, "DuplicateHandle failed %lu\n", GetLastError() );
+    memset( &info, 0x11, sizeof(info) );
+    status = pNtQueryInformationFile( dup, &io, &info, sizeof(info), FileAccessInformation );
+    ok( status == STATUS_SUCCESS, "expected STATUS_SUCCESS, got %08lx\n", status );
+    ok( info.AccessFlags == FILE_READ_DATA, "got %08lx\n", info.AccessFlags );
+    CloseHandle( dup );
+
     CloseHandle( h );
 }
 
@@ -5952,6 +6061,84 @@ static void test_read_write(void)
     CloseHandle(hfile);
 }
 
+/* overlapped reads into write watched memory, which may use an io_uring in Wine */
+static void test_read_write_watch(void)
+{
+    static const SIZE_T size = 0x10000;
+    char temp_path[MAX_PATH], filename[MAX_PATH];
+    void *results[0x10000 / 0x1000];
+    OVERLAPPED ovl = { 0 };
+    char *buffer, *data;
+    ULONG_PTR count;
+    DWORD len, pagesize;
+    HANDLE file;
+    unsigned int i;
+    BOOL ret;
+
+    GetTempPathA( MAX_PATH, temp_path );
+    GetTempFileNameA( temp_path, "wwt", 0, filename );
+    file = CreateFileA( filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                        FILE_FLAG_OVERLAPPED | FILE_FLAG_DELETE_ON_CLOSE, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed %lu\n", GetLastError() );
+
+    data = malloc( size );
+    for (i = 0; i < size; i++) data[i] = i * 7;
+    ovl.hEvent = CreateEventA( NULL, TRUE, FALSE, NULL );
+    ret = WriteFile( file, data, size, NULL, &ovl );
+    ok( ret || GetLastError() == ERROR_IO_PENDING, "WriteFile failed %lu\n", GetLastError() );
+    ret = GetOverlappedResult( file, &ovl, &len, TRUE );
+    ok( ret, "GetOverlappedResult failed %lu\n", GetLastError() );
+    ok( len == size, "got %lu bytes\n", len );
+
+    buffer = VirtualAlloc( NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_WRITE_WATCH, PAGE_READWRITE );
+    ok( buffer != NULL, "VirtualAlloc failed %lu\n", GetLastError() );
+
+    for (i = 0; i < 2; i++)
+    {
+        count = ARRAY_SIZE(results);
+        ret = GetWriteWatch( WRITE_WATCH_FLAG_RESET, buffer, size, results, &count, &pagesize );
+        ok( !ret, "GetWriteWatch failed %lu\n", GetLastError() );
+        ok( count == (i ? size / pagesize : 0), "%u: got %Iu pages\n", i, count );
+
+        ResetEvent( ovl.hEvent );
+        ret = ReadFile( file, buffer, size, NULL, &ovl );
+        ok( ret || GetLastError() == ERROR_IO_PENDING, "%u: ReadFile failed %lu\n", i, GetLastError() );
+        ret = GetOverlappedResult( file, &ovl, &len, TRUE );
+        ok( ret, "%u: GetOverlappedResult failed %lu\n", i, GetLastError() );
+        ok( len == size, "%u: got %lu bytes\n", i, len );
+        ok( !memcmp( buffer, data, size ), "%u: wrong data\n", i );
+
+        count = ARRAY_SIZE(results);
+        ret = GetWriteWatch( 0, buffer, size, results, &count, &pagesize );
+        ok( !ret, "%u: GetWriteWatch failed %lu\n", i, GetLastError() );
+        ok( count == size / pagesize, "%u: got %Iu pages\n", i, count );
+    }
+
+    VirtualFree( buffer, 0, MEM_RELEASE );
+    CloseHandle( ovl.hEvent );
+    CloseHandle( file );
+    free( data );
+}
+
+static void test_read_write_watch_io_uring(void)
+{
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup = { sizeof(startup) };
+    char cmdline[MAX_PATH + 32], **argv;
+    BOOL ret;
+
+    winetest_get_mainargs( &argv );
+    sprintf( cmdline, "\"%s\" file read_write_watch", argv[0] );
+    SetEnvironmentVariableA( "WINEIOURING", "1" );
+    ret = CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info );
+    SetEnvironmentVariableA( "WINEIOURING", NULL );
+    ok( ret, "CreateProcess failed %lu\n", GetLastError() );
+    wait_child_process( info.hProcess );
+    CloseHandle( info.hProcess );
+    CloseHandle( info.hThread );
+}
+
+
 static void test_ioctl(void)
 {
     HANDLE event = CreateEventA(NULL, TRUE, FALSE, NULL);
@@ -6294,12 +6481,22 @@ START_TEST(file)
 {
     HMODULE hkernel32 = GetModuleHandleA("kernel32.dll");
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
+    char **argv;
+    int argc;
+
     if (!hntdll)
     {
         skip("not running on NT, skipping test\n");
         return;
     }
 
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 3 && !strcmp( argv[2], "read_write_watch" ))
+    {
+        test_read_write_watch();
+        return;
+    }
+
     pGetVolumePathNameW = (void *)GetProcAddress(hkernel32, "GetVolumePathNameW");
     pGetSystemWow64DirectoryW = (void *)GetProcAddress(hkernel32, "GetSystemWow64DirectoryW");
 
@@ -6333,6 +6530,8 @@ START_TEST(file)
     pNtQueryEaFile          = (void *)GetProcAddress(hntdll, "NtQueryEaFile");
 
     test_read_write();
+    test_read_write_watch();
+    test_read_write_watch_io_uring();
     test_NtCreateFile();
     create_file_test();
     open_file_test();
@@ -6341,6 +6540,7 @@ START_TEST(file)
     append_file_test();
     nt_mailslot_test();
     test_set_io_completion();
+    test_io_completion_throughput();
     test_file_io_completion();
     test_file_basic_information();
     test_file_all_information();
@@ -3380,6 +3380,43 @@ static void test_object_permanence(void)
     ok( status == STATUS_SUCCESS, "NtSetInformationThread returned %08lx\n", status );
 }
 
+static void test_request_rate(void)
+{
+    DWORD start, count, duration = winetest_interactive ? 5000 : 200;
+    OBJECT_BASIC_INFORMATION obi;
+    char buffer[256];
+    NTSTATUS status;
+    HANDLE handle;
+    ULONG len;
+
+    handle = CreateEventA( NULL, FALSE, FALSE, "test_request_rate_event" );
+    ok( handle != NULL, "CreateEvent failed err %lu\n", GetLastError() );
+
+    /* small requests without variable size data */
+    start = GetTickCount();
+    count = 0;
+    do
+    {
+        status = NtQueryObject( handle, ObjectBasicInformation, &obi, sizeof(obi), &len );
+        count++;
+    } while (GetTickCount() - start < duration);
+    ok( status == STATUS_SUCCESS, "NtQueryObject returned %08lx\n", status );
+    trace( "%d ObjectBasicInformation queries per second.\n", MulDiv( count, 1000, duration ));
+
+    /* small requests with a variable size reply */
+    start = GetTickCount();
+    count = 0;
+    do
+    {
+        status = NtQueryObject( handle, ObjectNameInformation, buffer, sizeof(buffer), &len );
+        count++;
+    } while (GetTickCount() - start < duration);
+    ok( status == STATUS_SUCCESS, "NtQueryObject returned %08lx\n", status );
+    trace( "%d ObjectNameInformation queries per second.\n", MulDiv( count, 1000, duration ));
+
+    NtClose( handle );
+}
+
 START_TEST(om)
 {
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
@@ -3444,4 +3481,5 @@ START_TEST(om)
     test_object_identity();
     test_query_directory();
     test_object_permanence();
+    test_request_rate();
 }
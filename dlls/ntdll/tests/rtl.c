@@ -3784,6 +3784,119 @@ static void test_RtlGetDeviceFamilyInfoEnum(void)
     trace( "UAP version is %#I64x, device family is %lu, form factor is %lu\n", version, family, form );
 }
 
+#define HEAP_CACHE_THREADS 4
+#define HEAP_CACHE_ITERATIONS 100000
+
+/* Wine-specific information class, see dlls/ntdll/ntdll_misc.h */
+#define HeapWineThreadCacheInformation ((HEAP_INFORMATION_CLASS)1000)
+
+typedef struct
+{
+    ULONGLONG Hits;
+    ULONGLONG Misses;
+    ULONGLONG Flushes;
+} HEAP_WINE_THREAD_CACHE_INFORMATION;
+
+static DWORD WINAPI heap_cache_thread( void *arg )
+{
+    HANDLE heap = arg;
+    void *ptrs[16];
+    unsigned int i, j;
+
+    for (i = 0; i < HEAP_CACHE_ITERATIONS; i++)
+    {
+        for (j = 0; j < ARRAY_SIZE(ptrs); j++)
+            ptrs[j] = RtlAllocateHeap( heap, 0, 16 + 8 * (j % 8) );
+        for (j = 0; j < ARRAY_SIZE(ptrs); j++)
+            RtlFreeHeap( heap, 0, ptrs[j] );
+    }
+    return 0;
+}
+
+struct heap_cache_free_params
+{
+    HANDLE heap;
+    void *ptrs[1000];
+};
+
+static DWORD WINAPI heap_cache_free_thread( void *arg )
+{
+    struct heap_cache_free_params *params = arg;
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(params->ptrs); i++) RtlFreeHeap( params->heap, 0, params->ptrs[i] );
+    return 0;
+}
+
+static void test_heap_thread_cache(void)
+{
+    HEAP_WINE_THREAD_CACHE_INFORMATION info, prev_info;
+    HANDLE heap, thread, threads[HEAP_CACHE_THREADS];
+    struct heap_cache_free_params *params;
+    ULONGLONG total = (ULONGLONG)HEAP_CACHE_THREADS * HEAP_CACHE_ITERATIONS * 16;
+    ULONG compat_info = 2;
+    DWORD start, elapsed;
+    NTSTATUS status;
+    unsigned int i;
+    SIZE_T size;
+
+    heap = RtlCreateHeap( HEAP_GROWABLE, NULL, 0, 0, NULL, NULL );
+    ok( !!heap, "Failed to create a heap.\n" );
+    status = RtlSetHeapInformation( heap, HeapCompatibilityInformation, &compat_info, sizeof(compat_info) );
+    ok( !status, "RtlSetHeapInformation returned %#lx\n", status );
+
+    status = RtlQueryHeapInformation( heap, HeapWineThreadCacheInformation, &info, sizeof(info), &size );
+    if (status == STATUS_INVALID_INFO_CLASS || status == STATUS_INVALID_PARAMETER)
+    {
+        win_skip( "HeapWineThreadCacheInformation not supported\n" );
+        RtlDestroyHeap( heap );
+        return;
+    }
+    ok( !status, "RtlQueryHeapInformation returned %#lx\n", status );
+    ok( size == sizeof(info), "got size %Iu\n", size );
+
+    start = GetTickCount();
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+        threads[i] = CreateThread( NULL, 0, heap_cache_thread, heap, 0, NULL );
+    WaitForMultipleObjects( ARRAY_SIZE(threads), threads, TRUE, INFINITE );
+    elapsed = max( GetTickCount() - start, 1 );
+    for (i = 0; i < ARRAY_SIZE(threads); i++) CloseHandle( threads[i] );
+
+    trace( "%u threads: %lu alloc/free pairs per ms\n", HEAP_CACHE_THREADS, (DWORD)(total / elapsed) );
+
+    /* the statistics of the threads are all published when they exit */
+    memset( &info, 0, sizeof(info) );
+    status = RtlQueryHeapInformation( heap, HeapWineThreadCacheInformation, &info, sizeof(info), &size );
+    ok( !status, "RtlQueryHeapInformation returned %#lx\n", status );
+    trace( "hits %I64u, misses %I64u, flushes %I64u\n", info.Hits, info.Misses, info.Flushes );
+    ok( info.Hits + info.Misses <= total, "got %I64u cached allocations out of %I64u\n",
+        info.Hits + info.Misses, total );
+    /* blocks freed in an iteration are allocated again in the next one */
+    ok( info.Hits >= total / 2, "got %I64u hits out of %I64u\n", info.Hits, total );
+    ok( info.Misses < info.Hits / 10, "got %I64u misses for %I64u hits\n", info.Misses, info.Hits );
+    /* the caches never overflow, they are only flushed on thread exit, once per used bin */
+    ok( info.Flushes <= HEAP_CACHE_THREADS * 8, "got %I64u flushes\n", info.Flushes );
+
+    /* blocks freed by another thread are returned to their groups in batches */
+    params = malloc( sizeof(*params) );
+    params->heap = heap;
+    for (i = 0; i < ARRAY_SIZE(params->ptrs); i++) params->ptrs[i] = RtlAllocateHeap( heap, 0, 32 );
+    prev_info = info;
+    thread = CreateThread( NULL, 0, heap_cache_free_thread, params, 0, NULL );
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+    free( params );
+
+    status = RtlQueryHeapInformation( heap, HeapWineThreadCacheInformation, &info, sizeof(info), &size );
+    ok( !status, "RtlQueryHeapInformation returned %#lx\n", status );
+    ok( info.Flushes - prev_info.Flushes >= 1000 / 8, "got %I64u flushes for 1000 frees\n",
+        info.Flushes - prev_info.Flushes );
+    ok( info.Flushes - prev_info.Flushes <= 1000 / 4 + 1, "got %I64u flushes for 1000 frees\n",
+        info.Flushes - prev_info.Flushes );
+
+    RtlDestroyHeap( heap );
+}
+
 START_TEST(rtl)
 {
     InitFunctionPtrs();
@@ -3828,6 +3941,7 @@ START_TEST(rtl)
     test_DbgPrint();
     test_RtlDestroyHeap();
     test_RtlCreateHeap();
+    test_heap_thread_cache();
     test_RtlFirstFreeAce();
     test_RtlInitializeSid();
     test_RtlValidSecurityDescriptor();
@@ -529,6 +529,141 @@ static void test_semaphore(void)
     NtClose( semaphore );
 }
 
+struct ping_pong_params
+{
+    HANDLE ping;
+    HANDLE pong;
+    unsigned int count;
+};
+
+static DWORD WINAPI ping_pong_thread( void *arg )
+{
+    struct ping_pong_params *params = arg;
+    unsigned int i;
+    NTSTATUS status;
+    DWORD ret;
+
+    for (i = 0; i < params->count; i++)
+    {
+        ret = WaitForSingleObject( params->ping, 5000 );
+        if (ret != WAIT_OBJECT_0) return ret;
+        status = pNtSetEvent( params->pong, NULL );
+        if (status) return status;
+    }
+    return 0;
+}
+
+static DWORD WINAPI wait_any_thread( void *arg )
+{
+    HANDLE *handles = arg;
+
+    return WaitForMultipleObjects( 2, handles, FALSE, 5000 );
+}
+
+static DWORD WINAPI wait_short_thread( void *arg )
+{
+    return WaitForSingleObject( arg, 300 );
+}
+
+static void test_signal_wait_round_trips(void)
+{
+    static const unsigned int count = 10000;
+    struct ping_pong_params params;
+    LARGE_INTEGER freq, start, end;
+    HANDLE thread, handles[2];
+    NTSTATUS status;
+    unsigned int i;
+    DWORD ret;
+    LONG prev;
+
+    status = pNtCreateEvent( &params.ping, EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE );
+    ok( !status, "NtCreateEvent failed %08lx\n", status );
+    status = pNtCreateEvent( &params.pong, EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE );
+    ok( !status, "NtCreateEvent failed %08lx\n", status );
+    params.count = count;
+
+    thread = CreateThread( NULL, 0, ping_pong_thread, &params, 0, NULL );
+    QueryPerformanceFrequency( &freq );
+    QueryPerformanceCounter( &start );
+    for (i = 0; i < count; i++)
+    {
+        status = pNtSetEvent( params.ping, NULL );
+        if (status) break;
+        ret = WaitForSingleObject( params.pong, 5000 );
+        if (ret != WAIT_OBJECT_0) break;
+    }
+    QueryPerformanceCounter( &end );
+    ok( i == count, "stopped after %u round trips, status %08lx ret %08lx\n", i, status, ret );
+    ret = WaitForSingleObject( thread, 5000 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject failed %08lx\n", ret );
+    GetExitCodeThread( thread, &ret );
+    ok( !ret, "thread failed %08lx\n", ret );
+    CloseHandle( thread );
+    if (end.QuadPart > start.QuadPart)
+        trace( "%u event round trips in %lu ms (%I64u per second)\n", count,
+               (DWORD)((end.QuadPart - start.QuadPart) * 1000 / freq.QuadPart),
+               count * freq.QuadPart / (end.QuadPart - start.QuadPart) );
+
+    /* an auto-reset event must not stay signaled once a waiter consumed it */
+    status = pNtSetEvent( params.ping, &prev );
+    ok( !status, "NtSetEvent failed %08lx\n", status );
+    ok( !prev, "got prev state %ld\n", prev );
+    ret = WaitForSingleObject( params.ping, 0 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject failed %08lx\n", ret );
+    ret = WaitForSingleObject( params.ping, 0 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %08lx\n", ret );
+
+    /* signaling an object must also wake waiters blocked on several objects */
+    status = pNtCreateSemaphore( &handles[1], SEMAPHORE_ALL_ACCESS, NULL, 0, 1 );
+    ok( !status, "NtCreateSemaphore failed %08lx\n", status );
+    handles[0] = params.ping;
+    thread = CreateThread( NULL, 0, wait_any_thread, handles, 0, NULL );
+    ret = WaitForSingleObject( thread, 100 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %08lx\n", ret );
+    status = pNtReleaseSemaphore( handles[1], 1, NULL );
+    ok( !status, "NtReleaseSemaphore failed %08lx\n", status );
+    ret = WaitForSingleObject( thread, 5000 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject failed %08lx\n", ret );
+    GetExitCodeThread( thread, &ret );
+    ok( ret == WAIT_OBJECT_0 + 1, "got %lu\n", ret );
+    CloseHandle( thread );
+    ret = WaitForSingleObject( handles[1], 0 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %08lx\n", ret );
+
+    thread = CreateThread( NULL, 0, wait_any_thread, handles, 0, NULL );
+    ret = WaitForSingleObject( thread, 100 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %08lx\n", ret );
+    status = pNtSetEvent( params.ping, NULL );
+    ok( !status, "NtSetEvent failed %08lx\n", status );
+    ret = WaitForSingleObject( thread, 5000 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject failed %08lx\n", ret );
+    GetExitCodeThread( thread, &ret );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    CloseHandle( thread );
+    ret = WaitForSingleObject( params.ping, 0 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %08lx\n", ret );
+
+    NtClose( handles[1] );
+    NtClose( params.ping );
+    NtClose( params.pong );
+
+    /* closing the handle doesn't end the wait, and the waiter must not see the state of a new object */
+    status = pNtCreateEvent( &handles[0], EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE );
+    ok( !status, "NtCreateEvent failed %08lx\n", status );
+    thread = CreateThread( NULL, 0, wait_short_thread, handles[0], 0, NULL );
+    ret = WaitForSingleObject( thread, 50 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %08lx\n", ret );
+    NtClose( handles[0] );
+    status = pNtCreateEvent( &handles[1], EVENT_ALL_ACCESS, NULL, NotificationEvent, TRUE );
+    ok( !status, "NtCreateEvent failed %08lx\n", status );
+    ret = WaitForSingleObject( thread, 5000 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject failed %08lx\n", ret );
+    GetExitCodeThread( thread, &ret );
+    ok( ret == WAIT_TIMEOUT, "got %lu\n", ret );
+    CloseHandle( thread );
+    NtClose( handles[1] );
+}
+
 static void test_wait_on_address(void)
 {
     SIZE_T size;
@@ -881,6 +1016,7 @@ START_TEST(sync)
     test_event();
     test_mutant();
     test_semaphore();
+    test_signal_wait_round_trips();
     test_keyed_events();
     test_resource();
     test_tid_alert( argv );
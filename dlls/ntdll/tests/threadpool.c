@@ -48,6 +48,7 @@ static VOID     (WINAPI *pTpReleaseTimer)(TP_TIMER *);
 static VOID     (WINAPI *pTpReleaseWait)(TP_WAIT *);
 static VOID     (WINAPI *pTpReleaseWork)(TP_WORK *);
 static VOID     (WINAPI *pTpSetPoolMaxThreads)(TP_POOL *,DWORD);
+static BOOL     (WINAPI *pTpSetPoolMinThreads)(TP_POOL *,DWORD);
 static NTSTATUS (WINAPI *pTpSetPoolStackInformation)(TP_POOL *,TP_POOL_STACK_INFORMATION *);
 static VOID     (WINAPI *pTpSetTimer)(TP_TIMER *,LARGE_INTEGER *,LONG,LONG);
 static VOID     (WINAPI *pTpSetWait)(TP_WAIT *,HANDLE,LARGE_INTEGER *);
@@ -96,6 +97,7 @@ static BOOL init_threadpool(void)
     GET_PROC(TpReleaseWait);
     GET_PROC(TpReleaseWork);
     GET_PROC(TpSetPoolMaxThreads);
+    GET_PROC(TpSetPoolMinThreads);
     GET_PROC(TpSetPoolStackInformation);
     GET_PROC(TpSetTimer);
     GET_PROC(TpSetWait);
@@ -838,6 +840,84 @@ static void test_tp_work_scheduler(void)
     pTpReleasePool(pool);
 }
 
+struct work_throughput_data
+{
+    LONG to_post;
+    LONG remaining;
+    HANDLE done;
+};
+
+static void CALLBACK work_throughput_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    struct work_throughput_data *data = userdata;
+
+    /* repost from the worker thread, other workers have to steal the work */
+    if (InterlockedDecrement(&data->to_post) >= 0)
+        pTpPostWork(work);
+    if (!InterlockedDecrement(&data->remaining))
+        SetEvent(data->done);
+}
+
+static void test_tp_work_throughput(void)
+{
+    LONG total = winetest_interactive ? 200000 : 2000;
+    struct work_throughput_data data;
+    TP_CALLBACK_ENVIRON environment;
+    SYSTEM_INFO info;
+    TP_WORK *works[64];
+    DWORD threads, start, elapsed, ret;
+    TP_POOL *pool;
+    NTSTATUS status;
+    int i;
+
+    if (!pTpSetPoolMinThreads)
+    {
+        win_skip("TpSetPoolMinThreads not supported\n");
+        return;
+    }
+
+    GetSystemInfo(&info);
+    data.done = CreateEventW(NULL, FALSE, FALSE, NULL);
+    ok(data.done != NULL, "CreateEvent failed with %lu\n", GetLastError());
+
+    for (threads = 1; threads <= min(info.dwNumberOfProcessors, 16); threads *= 2)
+    {
+        pool = NULL;
+        status = pTpAllocPool(&pool, NULL);
+        ok(!status, "TpAllocPool failed with status %lx\n", status);
+        pTpSetPoolMaxThreads(pool, threads);
+        ok(pTpSetPoolMinThreads(pool, threads), "TpSetPoolMinThreads failed\n");
+
+        memset(&environment, 0, sizeof(environment));
+        environment.Version = 1;
+        environment.Pool = pool;
+        for (i = 0; i < ARRAY_SIZE(works); i++)
+        {
+            status = pTpAllocWork(&works[i], work_throughput_cb, &data, &environment);
+            ok(!status, "TpAllocWork failed with status %lx\n", status);
+        }
+
+        data.to_post = total - ARRAY_SIZE(works);
+        data.remaining = total;
+        start = GetTickCount();
+        for (i = 0; i < ARRAY_SIZE(works); i++)
+            pTpPostWork(works[i]);
+        ret = WaitForSingleObject(data.done, 30000);
+        ok(!ret, "WaitForSingleObject returned %lu\n", ret);
+        elapsed = max(GetTickCount() - start, 1);
+        trace("%lu threads: %lu work items per ms\n", threads, total / elapsed);
+
+        for (i = 0; i < ARRAY_SIZE(works); i++)
+        {
+            pTpWaitForWork(works[i], FALSE);
+            pTpReleaseWork(works[i]);
+        }
+        pTpReleasePool(pool);
+    }
+
+    CloseHandle(data.done);
+}
+
 static void CALLBACK simple_release_cb(TP_CALLBACK_INSTANCE *instance, void *userdata)
 {
     HANDLE *semaphores = userdata;
@@ -2398,6 +2478,7 @@ START_TEST(threadpool)
     test_tp_simple();
     test_tp_work();
     test_tp_work_scheduler();
+    test_tp_work_throughput();
     test_tp_group_wait();
     test_tp_group_cancel();
     test_tp_instance();
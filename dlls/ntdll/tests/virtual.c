@@ -30,6 +30,7 @@
 static unsigned int page_size;
 
 static DWORD64 (WINAPI *pGetEnabledXStateFeatures)(void);
+static SIZE_T (WINAPI *pGetLargePageMinimum)(void);
 static NTSTATUS (WINAPI *pRtlCreateUserStack)(SIZE_T, SIZE_T, ULONG, SIZE_T, SIZE_T, INITIAL_TEB *);
 static NTSTATUS (WINAPI *pRtlCreateUserThread)(HANDLE, SECURITY_DESCRIPTOR*, BOOLEAN, ULONG, SIZE_T,
                                                SIZE_T, PRTL_THREAD_START_ROUTINE, void*, HANDLE*, CLIENT_ID* );
@@ -2705,6 +2706,158 @@ static void test_query_image_information(void)
     NtClose( file );
 }
 
+static LONG query_contention_done;
+
+static DWORD WINAPI query_contention_thread( void *arg )
+{
+    SIZE_T size;
+    ULONG old_prot;
+    NTSTATUS status;
+    void *addr;
+    ULONG count = 0;
+
+    while (!ReadAcquire( &query_contention_done ))
+    {
+        addr = NULL;
+        size = 4 * page_size;
+        status = NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size, MEM_RESERVE | MEM_COMMIT,
+                                          PAGE_READWRITE );
+        if (status) break;
+        size = page_size;
+        NtProtectVirtualMemory( NtCurrentProcess(), &addr, &size, PAGE_READONLY, &old_prot );
+        size = 0;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+        count++;
+    }
+    return count;
+}
+
+static void test_query_contention(void)
+{
+    static const unsigned int thread_count = 4;
+    MEMORY_BASIC_INFORMATION info;
+    HANDLE threads[4];
+    DWORD start, elapsed, allocs, total_allocs = 0;
+    unsigned int i, queries = 0, failures = 0;
+    NTSTATUS status;
+    SIZE_T size;
+    char *addr = NULL;
+
+    size = 16 * page_size;
+    status = NtAllocateVirtualMemory( NtCurrentProcess(), (void **)&addr, 0, &size, MEM_RESERVE, PAGE_NOACCESS );
+    ok( !status, "NtAllocateVirtualMemory returned %08lx\n", status );
+    size = 4 * page_size;
+    status = NtAllocateVirtualMemory( NtCurrentProcess(), (void **)&addr, 0, &size, MEM_COMMIT, PAGE_READWRITE );
+    ok( !status, "NtAllocateVirtualMemory returned %08lx\n", status );
+
+    query_contention_done = 0;
+    for (i = 0; i < thread_count; i++)
+        threads[i] = CreateThread( NULL, 0, query_contention_thread, NULL, 0, NULL );
+
+    /* queries of a stable region must stay consistent while other threads modify the views */
+    start = GetTickCount();
+    while ((elapsed = GetTickCount() - start) < 500)
+    {
+        char *query = addr + ((queries & 1) ? 6 : 2) * page_size;
+
+        status = NtQueryVirtualMemory( NtCurrentProcess(), query, MemoryBasicInformation, &info, sizeof(info), NULL );
+        if (status || info.BaseAddress != query || info.AllocationBase != addr ||
+            info.AllocationProtect != PAGE_NOACCESS || info.Type != MEM_PRIVATE ||
+            info.State != ((queries & 1) ? MEM_RESERVE : MEM_COMMIT) ||
+            info.Protect != ((queries & 1) ? 0 : PAGE_READWRITE) ||
+            info.RegionSize != ((queries & 1) ? 10 : 2) * page_size)
+            failures++;
+        queries++;
+    }
+
+    WriteRelease( &query_contention_done, 1 );
+    for (i = 0; i < thread_count; i++)
+    {
+        WaitForSingleObject( threads[i], INFINITE );
+        GetExitCodeThread( threads[i], &allocs );
+        total_allocs += allocs;
+        CloseHandle( threads[i] );
+    }
+    ok( !failures, "%u/%u queries returned inconsistent data\n", failures, queries );
+    trace( "%u queries, %lu allocations in %lu ms\n", queries, total_allocs, elapsed );
+
+    size = 0;
+    status = NtFreeVirtualMemory( NtCurrentProcess(), (void **)&addr, &size, MEM_RELEASE );
+    ok( !status, "NtFreeVirtualMemory returned %08lx\n", status );
+}
+
+static DWORD random_access_time( char *addr, SIZE_T size )
+{
+    unsigned int i, seed = 12345;
+    DWORD start = GetTickCount();
+
+    for (i = 0; i < 0x1000000; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        addr[((SIZE_T)seed * 64) % size]++;
+    }
+    return GetTickCount() - start;
+}
+
+static void test_large_pages(void)
+{
+    MEMORY_BASIC_INFORMATION info;
+    SIZE_T size, large_page_size, count;
+    DWORD large_time, normal_time;
+    NTSTATUS status;
+    void *addr;
+
+    if (!pGetLargePageMinimum || !(large_page_size = pGetLargePageMinimum()))
+    {
+        skip( "large pages not supported\n" );
+        return;
+    }
+
+    /* 16 pages of 2MB, but a single one when they are much larger, e.g. 512MB on aarch64 */
+    count = max( 1, (32 << 20) / large_page_size );
+
+    addr = NULL;
+    size = large_page_size;
+    status = NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size, MEM_RESERVE | MEM_LARGE_PAGES,
+                                      PAGE_READWRITE );
+    ok( status == STATUS_INVALID_PARAMETER || broken(status == STATUS_PRIVILEGE_NOT_HELD),
+        "NtAllocateVirtualMemory returned %08lx\n", status );
+
+    addr = NULL;
+    size = count * large_page_size;
+    status = NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size,
+                                      MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE );
+    if (status == STATUS_PRIVILEGE_NOT_HELD)
+    {
+        skip( "SeLockMemoryPrivilege not held\n" );
+        return;
+    }
+    ok( !status, "NtAllocateVirtualMemory returned %08lx\n", status );
+    ok( !((UINT_PTR)addr & (large_page_size - 1)), "unaligned large page allocation %p\n", addr );
+    ok( size == count * large_page_size, "wrong size %Ix\n", size );
+
+    status = NtQueryVirtualMemory( NtCurrentProcess(), addr, MemoryBasicInformation, &info, sizeof(info), NULL );
+    ok( !status, "NtQueryVirtualMemory returned %08lx\n", status );
+    ok( info.State == MEM_COMMIT, "wrong state %#lx\n", info.State );
+    ok( info.Protect == PAGE_READWRITE, "wrong protection %#lx\n", info.Protect );
+    ok( info.RegionSize == size, "wrong region size %Ix\n", info.RegionSize );
+
+    large_time = random_access_time( addr, size );
+    size = 0;
+    NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+
+    addr = NULL;
+    size = count * large_page_size;
+    status = NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE );
+    ok( !status, "NtAllocateVirtualMemory returned %08lx\n", status );
+    normal_time = random_access_time( addr, size );
+    size = 0;
+    NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+
+    trace( "random access over %Iu MB: %lu ms with large pages, %lu ms without\n",
+           count * large_page_size >> 20, large_time, normal_time );
+}
+
 START_TEST(virtual)
 {
     HMODULE mod;
@@ -2726,6 +2879,7 @@ START_TEST(virtual)
     mod = GetModuleHandleA("kernel32.dll");
     pIsWow64Process = (void *)GetProcAddress(mod, "IsWow64Process");
     pGetEnabledXStateFeatures = (void *)GetProcAddress(mod, "GetEnabledXStateFeatures");
+    pGetLargePageMinimum = (void *)GetProcAddress(mod, "GetLargePageMinimum");
     mod = GetModuleHandleA("ntdll.dll");
     pRtlCreateUserStack = (void *)GetProcAddress(mod, "RtlCreateUserStack");
     pRtlCreateUserThread = (void *)GetProcAddress(mod, "RtlCreateUserThread");
@@ -2755,4 +2909,6 @@ START_TEST(virtual)
     test_syscalls();
     test_query_region_information();
     test_query_image_information();
+    test_query_contention();
+    test_large_pages();
 }
@@ -97,27 +97,57 @@ struct timer_queue
  */
 
 #define THREADPOOL_WORKER_TIMEOUT 5000
+#define THREADPOOL_WORKER_SPIN    64    /* default number of queue scans before a worker goes to sleep */
+#define THREADPOOL_DEQUE_SIZE     256   /* must be a power of two */
+#define THREADPOOL_MAX_DEQUES     64
 #define MAXIMUM_WAITQUEUE_OBJECTS (MAXIMUM_WAIT_OBJECTS - 1)
 
+/* work-stealing deque of a worker thread, one ring per callback priority;
+ * only the owner pushes and pops at the bottom, other workers steal from the top */
+struct threadpool_deque
+{
+    LONG                    owned;
+    struct
+    {
+        LONG                top;
+        LONG                bottom;
+        struct threadpool_object *objects[THREADPOOL_DEQUE_SIZE];
+    } rings[3];
+};
+
 /* internal threadpool representation */
 struct threadpool
 {
+    /* Objects queued by threads which are not workers of the pool, order matches
+     * TP_CALLBACK_PRIORITY - high, normal, low. Workers queue to their own deque. */
+    SLIST_HEADER            queues[3];
     LONG                    refcount;
     LONG                    objcount;
     BOOL                    shutdown;
     CRITICAL_SECTION        cs;
-    /* Pools of work items, locked via .cs, order matches TP_CALLBACK_PRIORITY - high, normal, low. */
-    struct list             pools[3];
     RTL_CONDITION_VARIABLE  update_event;
-    /* information about worker threads, locked via .cs */
-    int                     max_workers;
-    int                     min_workers;
-    int                     num_workers;
-    int                     num_busy_workers;
+    /* deques of the worker threads, allocated on demand and freed with the pool */
+    struct threadpool_deque *deques[THREADPOOL_MAX_DEQUES];
+    LONG                    num_deques;
+    /* information about worker threads, modified while holding .cs */
+    LONG                    max_workers;
+    LONG                    min_workers;
+    LONG                    num_workers;
+    LONG                    num_busy_workers;
+    LONG                    num_idle_workers;
+    LONG                    spin_count;
     HANDLE                  compl_port;
     TP_POOL_STACK_INFORMATION stack_info;
 };
 
+/* per-thread state of a worker, stored in the NTDLL_TLS_THREADPOOL slot */
+struct threadpool_worker
+{
+    struct threadpool       *pool;
+    struct threadpool_deque *deque;
+    unsigned int            index;
+};
+
 enum threadpool_objtype
 {
     TP_OBJECT_TYPE_SIMPLE,
@@ -152,14 +182,18 @@ struct threadpool_object
     /* information about the group, locked via .group->cs */
     struct list             group_entry;
     BOOL                    is_group_member;
-    /* information about the pool, locked via .pool->cs */
-    struct list             pool_entry;
-    RTL_CONDITION_VARIABLE  finished_event;
-    RTL_CONDITION_VARIABLE  group_finished_event;
-    HANDLE                  completed_event;
+    /* scheduling information, updated with interlocked operations; the queue holds
+     * a reference to the object, and it is queued at most once at any time */
+    SLIST_ENTRY             queue_entry;
+    LONG                    queued;
     LONG                    num_pending_callbacks;
     LONG                    num_running_callbacks;
     LONG                    num_associated_callbacks;
+    LONG                    num_waiters;
+    /* waiting for callbacks to finish, locked via .pool->cs */
+    RTL_CONDITION_VARIABLE  finished_event;
+    RTL_CONDITION_VARIABLE  group_finished_event;
+    HANDLE                  completed_event;
     /* arguments for callback */
     union
     {
@@ -363,7 +397,7 @@ static inline struct threadpool_instance *impl_from_TP_CALLBACK_INSTANCE( TP_CAL
 
 static void CALLBACK threadpool_worker_proc( void *param );
 static void tp_object_submit( struct threadpool_object *object, BOOL signaled );
-static void tp_object_execute( struct threadpool_object *object, BOOL wait_thread );
+static BOOL tp_object_execute( struct threadpool_object *object, BOOL wait_thread );
 static void tp_object_prepare_shutdown( struct threadpool_object *object );
 static BOOL tp_object_release( struct threadpool_object *object );
 static struct threadpool *default_threadpool = NULL;
@@ -1276,7 +1310,7 @@ static void CALLBACK waitqueue_thread_proc( void *param )
                 if ((wait->u.wait.flags & (WT_EXECUTEINWAITTHREAD | WT_EXECUTEINIOTHREAD)))
                 {
                     InterlockedIncrement( &wait->refcount );
-                    wait->num_pending_callbacks++;
+                    InterlockedIncrement( &wait->num_pending_callbacks );
                     RtlEnterCriticalSection( &wait->pool->cs );
                     tp_object_execute( wait, TRUE );
                     RtlLeaveCriticalSection( &wait->pool->cs );
@@ -1333,7 +1367,7 @@ static void CALLBACK waitqueue_thread_proc( void *param )
                     if ((wait->u.wait.flags & (WT_EXECUTEINWAITTHREAD | WT_EXECUTEINIOTHREAD)))
                     {
                         wait->u.wait.signaled++;
-                        wait->num_pending_callbacks++;
+                        InterlockedIncrement( &wait->num_pending_callbacks );
                         RtlEnterCriticalSection( &wait->pool->cs );
                         tp_object_execute( wait, TRUE );
                         RtlLeaveCriticalSection( &wait->pool->cs );
@@ -1656,6 +1690,32 @@ static NTSTATUS tp_ioqueue_lock( struct threadpool_object *io, HANDLE file )
     return status;
 }
 
+/***********************************************************************
+ *           threadpool_spin_count    (internal)
+ *
+ * Returns how many times an idle worker scans the queues before going to
+ * sleep. The default can be overridden with WINETHREADPOOLSPIN.
+ */
+static LONG threadpool_spin_count(void)
+{
+    static LONG spin_count = -1;
+    WCHAR buffer[16];
+    SIZE_T len;
+    LONG count;
+
+    if ((count = ReadNoFence( &spin_count )) != -1) return count;
+
+    if (!RtlQueryEnvironmentVariable( NULL, L"WINETHREADPOOLSPIN", 18, buffer, ARRAY_SIZE(buffer) - 1, &len ))
+    {
+        buffer[len] = 0;
+        count = min( wcstoul( buffer, NULL, 10 ), INT_MAX );
+    }
+    else count = NtCurrentTeb()->Peb->NumberOfProcessors > 1 ? THREADPOOL_WORKER_SPIN : 0;
+
+    WriteNoFence( &spin_count, count );
+    return count;
+}
+
 /***********************************************************************
  *           tp_threadpool_alloc    (internal)
  *
@@ -1678,14 +1738,18 @@ static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
     RtlInitializeCriticalSectionEx( &pool->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
     pool->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": threadpool.cs");
 
-    for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
-        list_init( &pool->pools[i] );
+    for (i = 0; i < ARRAY_SIZE(pool->queues); ++i)
+        RtlInitializeSListHead( &pool->queues[i] );
     RtlInitializeConditionVariable( &pool->update_event );
+    memset( pool->deques, 0, sizeof(pool->deques) );
+    pool->num_deques              = 0;
 
     pool->max_workers             = 500;
     pool->min_workers             = 0;
     pool->num_workers             = 0;
     pool->num_busy_workers        = 0;
+    pool->num_idle_workers        = 0;
+    pool->spin_count              = threadpool_spin_count();
     pool->stack_info.StackReserve = nt->OptionalHeader.SizeOfStackReserve;
     pool->stack_info.StackCommit  = nt->OptionalHeader.SizeOfStackCommit;
 
@@ -1726,8 +1790,10 @@ static BOOL tp_threadpool_release( struct threadpool *pool )
 
     assert( pool->shutdown );
     assert( !pool->objcount );
-    for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
-        assert( list_empty( &pool->pools[i] ) );
+    for (i = 0; i < ARRAY_SIZE(pool->queues); ++i)
+        assert( !RtlQueryDepthSList( &pool->queues[i] ) );
+    for (i = 0; i < pool->num_deques; ++i)
+        RtlFreeHeap( GetProcessHeap(), 0, pool->deques[i] );
 
     pool->cs.DebugInfo->Spare[0] = 0;
     RtlDeleteCriticalSection( &pool->cs );
@@ -1907,13 +1973,15 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
     memset( &object->group_entry, 0, sizeof(object->group_entry) );
     object->is_group_member         = FALSE;
 
-    memset( &object->pool_entry, 0, sizeof(object->pool_entry) );
-    RtlInitializeConditionVariable( &object->finished_event );
-    RtlInitializeConditionVariable( &object->group_finished_event );
-    object->completed_event         = NULL;
+    memset( &object->queue_entry, 0, sizeof(object->queue_entry) );
+    object->queued                  = FALSE;
     object->num_pending_callbacks   = 0;
     object->num_running_callbacks   = 0;
     object->num_associated_callbacks = 0;
+    object->num_waiters             = 0;
+    RtlInitializeConditionVariable( &object->finished_event );
+    RtlInitializeConditionVariable( &object->group_finished_event );
+    object->completed_event         = NULL;
 
     if (environment)
     {
@@ -1930,7 +1998,7 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
             TP_CALLBACK_ENVIRON_V3 *environment_v3 = (TP_CALLBACK_ENVIRON_V3 *)environment;
 
             object->priority = environment_v3->CallbackPriority;
-            assert( object->priority < ARRAY_SIZE(pool->pools) );
+            assert( object->priority < ARRAY_SIZE(pool->queues) );
         }
 
         if (environment->ActivationContext)
@@ -1967,10 +2035,121 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
         tp_object_release( object );
 }
 
-static void tp_object_prio_queue( struct threadpool_object *object )
+static BOOL deque_push( struct threadpool_deque *deque, TP_CALLBACK_PRIORITY priority,
+                        struct threadpool_object *object )
+{
+    ULONG bottom = deque->rings[priority].bottom, top = ReadAcquire( &deque->rings[priority].top );
+
+    if (bottom - top >= THREADPOOL_DEQUE_SIZE) return FALSE;
+    deque->rings[priority].objects[bottom % THREADPOOL_DEQUE_SIZE] = object;
+    WriteRelease( &deque->rings[priority].bottom, bottom + 1 );
+    return TRUE;
+}
+
+static struct threadpool_object *deque_pop( struct threadpool_deque *deque, TP_CALLBACK_PRIORITY priority )
+{
+    struct threadpool_object *object = NULL;
+    ULONG bottom = deque->rings[priority].bottom - 1, top;
+
+    InterlockedExchange( &deque->rings[priority].bottom, bottom );
+    top = ReadNoFence( &deque->rings[priority].top );
+    if ((LONG)(bottom - top) >= 0)
+    {
+        object = deque->rings[priority].objects[bottom % THREADPOOL_DEQUE_SIZE];
+        if (bottom != top) return object;
+        /* last object, race against thieves */
+        if (InterlockedCompareExchange( &deque->rings[priority].top, top + 1, top ) != top) object = NULL;
+    }
+    WriteNoFence( &deque->rings[priority].bottom, bottom + 1 );
+    return object;
+}
+
+static struct threadpool_object *deque_steal( struct threadpool_deque *deque, TP_CALLBACK_PRIORITY priority )
+{
+    struct threadpool_object *object;
+    ULONG top = ReadAcquire( &deque->rings[priority].top ), bottom;
+
+    MemoryBarrier();
+    bottom = ReadAcquire( &deque->rings[priority].bottom );
+    if ((LONG)(bottom - top) <= 0) return NULL;
+    object = deque->rings[priority].objects[top % THREADPOOL_DEQUE_SIZE];
+    if (InterlockedCompareExchange( &deque->rings[priority].top, top + 1, top ) != top) return NULL;
+    return object;
+}
+
+/***********************************************************************
+ *           tp_object_enqueue    (internal)
+ *
+ * Queues an object with pending callbacks, unless it is queued already.
+ * Worker threads of the pool use their own deque, other threads the
+ * shared queues of the pool. Objects with remaining pending callbacks are
+ * requeued to the shared queues as well, so that they don't starve the
+ * objects already queued to the deque.
+ */
+static void tp_object_enqueue( struct threadpool_object *object, BOOL requeue )
+{
+    struct threadpool_worker *worker = NtCurrentTeb()->TlsSlots[NTDLL_TLS_THREADPOOL];
+    struct threadpool *pool = object->pool;
+
+    if (InterlockedCompareExchange( &object->queued, TRUE, FALSE )) return;
+
+    InterlockedIncrement( &object->refcount );
+    InterlockedIncrement( &pool->num_busy_workers );
+    if (requeue || !worker || worker->pool != pool || !worker->deque ||
+        !deque_push( worker->deque, object->priority, object ))
+        RtlInterlockedPushEntrySList( &pool->queues[object->priority], &object->queue_entry );
+}
+
+/***********************************************************************
+ *           tp_object_consume    (internal)
+ *
+ * Takes one pending callback from an object. Returns the number of
+ * pending callbacks before, or 0 if they have been cancelled.
+ */
+static LONG tp_object_consume( struct threadpool_object *object )
+{
+    LONG pending;
+
+    do
+    {
+        if (!(pending = ReadNoFence( &object->num_pending_callbacks ))) break;
+    }
+    while (InterlockedCompareExchange( &object->num_pending_callbacks, pending - 1, pending ) != pending);
+
+    return pending;
+}
+
+/***********************************************************************
+ *           tp_threadpool_wake    (internal)
+ *
+ * Makes sure that a worker picks up newly queued objects, starting a
+ * new worker thread if all of them are busy.
+ */
+static void tp_threadpool_wake( struct threadpool *pool )
 {
-    ++object->pool->num_busy_workers;
-    list_add_tail( &object->pool->pools[object->priority], &object->pool_entry );
+    NTSTATUS status = STATUS_UNSUCCESSFUL;
+
+    MemoryBarrier();
+    if (ReadNoFence( &pool->num_idle_workers ) ||
+        (ReadNoFence( &pool->num_busy_workers ) >= ReadNoFence( &pool->num_workers ) &&
+         ReadNoFence( &pool->num_workers ) < ReadNoFence( &pool->max_workers )))
+    {
+        RtlEnterCriticalSection( &pool->cs );
+
+        /* Start new worker threads if required. */
+        if (pool->num_busy_workers >= pool->num_workers &&
+            pool->num_workers < pool->max_workers)
+            status = tp_new_worker_thread( pool );
+
+        /* No new thread started - wake up one existing thread. */
+        if (status != STATUS_SUCCESS)
+        {
+            assert( pool->num_workers > 0 );
+            if (pool->num_idle_workers) RtlWakeConditionVariable( &pool->update_event );
+        }
+
+        RtlLeaveCriticalSection( &pool->cs );
+    }
 }
 
 /***********************************************************************
@@ -1982,57 +2161,45 @@ static void tp_object_prio_queue( struct threadpool_object *object )
 static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 {
     struct threadpool *pool = object->pool;
-    NTSTATUS status = STATUS_UNSUCCESSFUL;
 
     assert( !object->shutdown );
     assert( !pool->shutdown );
 
-    RtlEnterCriticalSection( &pool->cs );
-
-    /* Start new worker threads if required. */
-    if (pool->num_busy_workers >= pool->num_workers &&
-        pool->num_workers < pool->max_workers)
-        status = tp_new_worker_thread( pool );
+    /* Wait and I/O objects carry additional state for each callback, which
+     * is protected by the pool lock. Other objects are queued lock-free. */
+    if (object->type == TP_OBJECT_TYPE_WAIT || object->type == TP_OBJECT_TYPE_IO)
+        RtlEnterCriticalSection( &pool->cs );
 
-    /* Queue work item and increment refcount. */
+    /* Increment refcount and queue work item. */
     InterlockedIncrement( &object->refcount );
-    if (!object->num_pending_callbacks++)
-        tp_object_prio_queue( object );
+    InterlockedIncrement( &object->num_pending_callbacks );
 
     /* Count how often the object was signaled. */
     if (object->type == TP_OBJECT_TYPE_WAIT && signaled)
         object->u.wait.signaled++;
 
-    /* No new thread started - wake up one existing thread. */
-    if (status != STATUS_SUCCESS)
-    {
-        assert( pool->num_workers > 0 );
-        RtlWakeConditionVariable( &pool->update_event );
-    }
+    if (object->type == TP_OBJECT_TYPE_WAIT || object->type == TP_OBJECT_TYPE_IO)
+        RtlLeaveCriticalSection( &pool->cs );
 
-    RtlLeaveCriticalSection( &pool->cs );
+    tp_object_enqueue( object, FALSE );
+    tp_threadpool_wake( pool );
 }
 
 /***********************************************************************
  *           tp_object_cancel    (internal)
  *
- * Cancels all currently pending callbacks for a specific object.
+ * Cancels all currently pending callbacks for a specific object. If the
+ * object is still queued, the worker dequeuing it will just release it.
  */
 static void tp_object_cancel( struct threadpool_object *object )
 {
     struct threadpool *pool = object->pool;
-    LONG pending_callbacks = 0;
+    LONG pending_callbacks;
 
     RtlEnterCriticalSection( &pool->cs );
-    if (object->num_pending_callbacks)
-    {
-        pending_callbacks = object->num_pending_callbacks;
-        object->num_pending_callbacks = 0;
-        list_remove( &object->pool_entry );
-
-        if (object->type == TP_OBJECT_TYPE_WAIT)
-            object->u.wait.signaled = 0;
-    }
+    pending_callbacks = InterlockedExchange( &object->num_pending_callbacks, 0 );
+    if (object->type == TP_OBJECT_TYPE_WAIT)
+        object->u.wait.signaled = 0;
     if (object->type == TP_OBJECT_TYPE_IO)
     {
         object->u.io.skipped_count += object->u.io.pending_count;
@@ -2046,15 +2213,41 @@ static void tp_object_cancel( struct threadpool_object *object )
 
 static BOOL object_is_finished( struct threadpool_object *object, BOOL group )
 {
-    if (object->num_pending_callbacks)
+    /* Pending callbacks are consumed only after the running counters are
+     * incremented, so they have to be checked first. */
+    if (ReadAcquire( &object->num_pending_callbacks ))
         return FALSE;
     if (object->type == TP_OBJECT_TYPE_IO && object->u.io.pending_count)
         return FALSE;
 
     if (group)
-        return !object->num_running_callbacks;
+        return !ReadNoFence( &object->num_running_callbacks );
     else
-        return !object->num_associated_callbacks;
+        return !ReadNoFence( &object->num_associated_callbacks );
+}
+
+/***********************************************************************
+ *           tp_object_finish    (internal)
+ *
+ * Marks a callback of a threadpool object as finished, and wakes up
+ * threads waiting for the object if necessary.
+ */
+static void tp_object_finish( struct threadpool_object *object, BOOL associated )
+{
+    struct threadpool *pool = object->pool;
+
+    InterlockedDecrement( &object->num_running_callbacks );
+    if (associated) InterlockedDecrement( &object->num_associated_callbacks );
+
+    /* Waiters register themselves before checking the counters. */
+    if (!ReadAcquire( &object->num_waiters )) return;
+
+    RtlEnterCriticalSection( &pool->cs );
+    if (object_is_finished( object, TRUE ))
+        RtlWakeAllConditionVariable( &object->group_finished_event );
+    if (associated && object_is_finished( object, FALSE ))
+        RtlWakeAllConditionVariable( &object->finished_event );
+    RtlLeaveCriticalSection( &pool->cs );
 }
 
 /***********************************************************************
@@ -2068,6 +2261,7 @@ static void tp_object_wait( struct threadpool_object *object, BOOL group_wait )
     struct threadpool *pool = object->pool;
 
     RtlEnterCriticalSection( &pool->cs );
+    InterlockedIncrement( &object->num_waiters );
     while (!object_is_finished( object, group_wait ))
     {
         if (group_wait)
@@ -2075,6 +2269,7 @@ static void tp_object_wait( struct threadpool_object *object, BOOL group_wait )
         else
             RtlSleepConditionVariableCS( &object->finished_event, &pool->cs, NULL );
     }
+    InterlockedDecrement( &object->num_waiters );
     RtlLeaveCriticalSection( &pool->cs );
 }
 
@@ -2152,36 +2347,41 @@ static BOOL tp_object_release( struct threadpool_object *object )
     return TRUE;
 }
 
-static struct list *threadpool_get_next_item( const struct threadpool *pool )
-{
-    struct list *ptr;
-    unsigned int i;
-
-    for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
-    {
-        if ((ptr = list_head( &pool->pools[i] )))
-            break;
-    }
-
-    return ptr;
-}
-
 /***********************************************************************
  *           tp_object_execute    (internal)
  *
- * Executes a threadpool object callback, object->pool->cs has to be
- * held.
+ * Executes a pending threadpool object callback. For wait and I/O objects
+ * object->pool->cs has to be held. Returns FALSE if the pending callbacks
+ * have been cancelled in the meantime.
  */
-static void tp_object_execute( struct threadpool_object *object, BOOL wait_thread )
+static BOOL tp_object_execute( struct threadpool_object *object, BOOL wait_thread )
 {
     TP_CALLBACK_INSTANCE *callback_instance;
     struct threadpool_instance instance;
     struct io_completion completion;
     struct threadpool *pool = object->pool;
+    BOOL locked = (object->type == TP_OBJECT_TYPE_WAIT || object->type == TP_OBJECT_TYPE_IO);
     TP_WAIT_RESULT wait_result = 0;
     NTSTATUS status;
+    LONG pending;
 
-    object->num_pending_callbacks--;
+    /* Account the callback as running before consuming it, see object_is_finished. */
+    InterlockedIncrement( &object->num_associated_callbacks );
+    InterlockedIncrement( &object->num_running_callbacks );
+
+    if (!(pending = tp_object_consume( object )))
+    {
+        tp_object_finish( object, TRUE );
+        return FALSE;
+    }
+
+    /* If further pending callbacks are queued, queue the object again so
+     * that other workers can pick them up. */
+    if (pending > 1)
+    {
+        tp_object_enqueue( object, TRUE );
+        tp_threadpool_wake( pool );
+    }
 
     /* For wait objects check if they were signaled or have timed out. */
     if (object->type == TP_OBJECT_TYPE_WAIT)
@@ -2196,9 +2396,7 @@ static void tp_object_execute( struct threadpool_object *object, BOOL wait_threa
     }
 
     /* Leave critical section and do the actual callback. */
-    object->num_associated_callbacks++;
-    object->num_running_callbacks++;
-    RtlLeaveCriticalSection( &pool->cs );
+    if (locked) RtlLeaveCriticalSection( &pool->cs );
     if (wait_thread) RtlLeaveCriticalSection( &waitqueue.cs );
 
     /* Initialize threadpool instance struct. */
@@ -2304,7 +2502,7 @@ static void tp_object_execute( struct threadpool_object *object, BOOL wait_threa
 
 skip_cleanup:
     if (wait_thread) RtlEnterCriticalSection( &waitqueue.cs );
-    RtlEnterCriticalSection( &pool->cs );
+    if (locked) RtlEnterCriticalSection( &pool->cs );
 
     /* Simple callbacks are automatically shutdown after execution. */
     if (object->type == TP_OBJECT_TYPE_SIMPLE)
@@ -2313,16 +2511,137 @@ skip_cleanup:
         object->shutdown = TRUE;
     }
 
-    object->num_running_callbacks--;
-    if (object_is_finished( object, TRUE ))
-        RtlWakeAllConditionVariable( &object->group_finished_event );
+    tp_object_finish( object, instance.associated );
+    return TRUE;
+}
 
-    if (instance.associated)
+/***********************************************************************
+ *           tp_worker_attach    (internal)
+ *
+ * Assigns a deque to a new worker thread. Workers beyond
+ * THREADPOOL_MAX_DEQUES only use the shared queues.
+ */
+static void tp_worker_attach( struct threadpool_worker *worker, struct threadpool *pool )
+{
+    struct threadpool_deque *deque;
+    unsigned int i;
+
+    worker->pool  = pool;
+    worker->deque = NULL;
+    worker->index = 0;
+
+    RtlEnterCriticalSection( &pool->cs );
+    for (i = 0; i < ARRAY_SIZE(pool->deques); i++)
     {
-        object->num_associated_callbacks--;
-        if (object_is_finished( object, FALSE ))
-            RtlWakeAllConditionVariable( &object->finished_event );
+        if (!(deque = pool->deques[i]))
+        {
+            if (!(deque = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*deque) ))) break;
+            pool->deques[i] = deque;
+            WriteRelease( &pool->num_deques, i + 1 );
+        }
+        if (deque->owned) continue;
+        deque->owned  = TRUE;
+        worker->deque = deque;
+        worker->index = i;
+        break;
     }
+    RtlLeaveCriticalSection( &pool->cs );
+
+    NtCurrentTeb()->TlsSlots[NTDLL_TLS_THREADPOOL] = worker;
+}
+
+/***********************************************************************
+ *           tp_worker_detach    (internal)
+ *
+ * Releases the deque of a terminating worker, pool->cs has to be held.
+ * The deque is empty at this point, as only its owner queues objects to it.
+ */
+static void tp_worker_detach( struct threadpool_worker *worker )
+{
+    NtCurrentTeb()->TlsSlots[NTDLL_TLS_THREADPOOL] = NULL;
+    if (worker->deque) worker->deque->owned = FALSE;
+}
+
+/***********************************************************************
+ *           tp_worker_next_object    (internal)
+ *
+ * Dequeues the next object to execute, in priority order. For each priority
+ * the worker's own deque is checked first, then the shared queue of the
+ * pool, and finally the deques of the other workers.
+ */
+static struct threadpool_object *tp_worker_next_object( struct threadpool_worker *worker )
+{
+    struct threadpool *pool = worker->pool;
+    struct threadpool_object *object;
+    SLIST_ENTRY *entry, *next, *last;
+    unsigned int i, count, priority;
+
+    for (priority = 0; priority < ARRAY_SIZE(pool->queues); priority++)
+    {
+        if (worker->deque && (object = deque_pop( worker->deque, priority )))
+            return object;
+
+        if (!worker->deque)
+        {
+            if ((entry = RtlInterlockedPopEntrySList( &pool->queues[priority] )))
+                return CONTAINING_RECORD( entry, struct threadpool_object, queue_entry );
+        }
+        else if ((entry = RtlInterlockedFlushSList( &pool->queues[priority] )))
+        {
+            /* The shared queue is in LIFO order. Move all objects but the oldest one
+             * to our deque, where other workers can steal them, and execute the oldest. */
+            while ((next = entry->Next))
+            {
+                object = CONTAINING_RECORD( entry, struct threadpool_object, queue_entry );
+                if (!deque_push( worker->deque, priority, object ))
+                {
+                    /* deque is full, put the remaining objects back */
+                    for (last = entry, count = 1; last->Next->Next; last = last->Next) count++;
+                    next = last->Next;
+                    last->Next = NULL;
+                    RtlInterlockedPushListSListEx( &pool->queues[priority], entry, last, count );
+                }
+                entry = next;
+            }
+            return CONTAINING_RECORD( entry, struct threadpool_object, queue_entry );
+        }
+
+        count = ReadAcquire( &pool->num_deques );
+        for (i = 1; i <= count; i++)
+        {
+            struct threadpool_deque *deque = pool->deques[(worker->index + i) % count];
+            if (deque == worker->deque) continue;
+            if ((object = deque_steal( deque, priority ))) return object;
+        }
+    }
+
+    return NULL;
+}
+
+/***********************************************************************
+ *           tp_worker_run_object    (internal)
+ *
+ * Executes a pending callback of a dequeued object, and releases the
+ * reference held by the queue.
+ */
+static void tp_worker_run_object( struct threadpool_object *object )
+{
+    struct threadpool *pool = object->pool;
+    BOOL locked = (object->type == TP_OBJECT_TYPE_WAIT || object->type == TP_OBJECT_TYPE_IO);
+    BOOL executed;
+
+    /* Allow the object to be queued again, before consuming the pending callback. */
+    InterlockedExchange( &object->queued, FALSE );
+
+    if (locked) RtlEnterCriticalSection( &pool->cs );
+    executed = tp_object_execute( object, FALSE );
+    if (locked) RtlLeaveCriticalSection( &pool->cs );
+
+    assert( ReadNoFence( &pool->num_busy_workers ) );
+    InterlockedDecrement( &pool->num_busy_workers );
+
+    if (executed) tp_object_release( object );  /* reference of the executed callback */
+    tp_object_release( object );                /* reference of the queue */
 }
 
 /***********************************************************************
@@ -2331,52 +2650,63 @@ skip_cleanup:
 static void CALLBACK threadpool_worker_proc( void *param )
 {
     struct threadpool *pool = param;
+    struct threadpool_object *object;
+    struct threadpool_worker worker;
     LARGE_INTEGER timeout;
-    struct list *ptr;
+    NTSTATUS status;
+    LONG spin;
 
     TRACE( "starting worker thread for pool %p\n", pool );
     set_thread_name(L"wine_threadpool_worker");
+    tp_worker_attach( &worker, pool );
 
-    RtlEnterCriticalSection( &pool->cs );
     for (;;)
     {
-        while ((ptr = threadpool_get_next_item( pool )))
+        /* Scan the queues for a while before going to sleep, waking up
+         * a sleeping thread is much more expensive. */
+        for (spin = ReadNoFence( &pool->spin_count ), object = NULL; spin >= 0; spin--)
         {
-            struct threadpool_object *object = LIST_ENTRY( ptr, struct threadpool_object, pool_entry );
-            assert( object->num_pending_callbacks > 0 );
-
-            /* If further pending callbacks are queued, move the work item to
-             * the end of the pool list. Otherwise remove it from the pool. */
-            list_remove( &object->pool_entry );
-            if (object->num_pending_callbacks > 1)
-                tp_object_prio_queue( object );
-
-            tp_object_execute( object, FALSE );
-
-            assert(pool->num_busy_workers);
-            pool->num_busy_workers--;
-
-            tp_object_release( object );
+            if ((object = tp_worker_next_object( &worker ))) break;
+            YieldProcessor();
+        }
+        if (object)
+        {
+            tp_worker_run_object( object );
+            continue;
         }
 
-        /* Shutdown worker thread if requested. */
-        if (pool->shutdown)
-            break;
-
-        /* Wait for new tasks or until the timeout expires. A thread only terminates
-         * when no new tasks are available, and the number of threads can be
-         * decreased without violating the min_workers limit. An exception is when
-         * min_workers == 0, then objcount is used to detect if the last thread
-         * can be terminated. */
-        timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
-        if (RtlSleepConditionVariableCS( &pool->update_event, &pool->cs, &timeout ) == STATUS_TIMEOUT &&
-            !threadpool_get_next_item( pool ) && (pool->num_workers > max( pool->min_workers, 1 ) ||
-            (!pool->min_workers && !pool->objcount)))
+        RtlEnterCriticalSection( &pool->cs );
+        InterlockedIncrement( &pool->num_idle_workers );
+        status = STATUS_SUCCESS;
+        for (;;)
         {
-            break;
+            /* Check the queues again now that we are registered as idle, objects
+             * queued from now on wake us up. */
+            if ((object = tp_worker_next_object( &worker ))) break;
+
+            /* Shutdown worker thread if requested. */
+            if (pool->shutdown) break;
+
+            /* Wait for new tasks or until the timeout expires. A thread only terminates
+             * when no new tasks are available, and the number of threads can be
+             * decreased without violating the min_workers limit. An exception is when
+             * min_workers == 0, then objcount is used to detect if the last thread
+             * can be terminated. */
+            if (status == STATUS_TIMEOUT && (pool->num_workers > max( pool->min_workers, 1 ) ||
+                (!pool->min_workers && !pool->objcount)))
+                break;
+
+            timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
+            status = RtlSleepConditionVariableCS( &pool->update_event, &pool->cs, &timeout );
         }
+        InterlockedDecrement( &pool->num_idle_workers );
+        if (!object) break;
+        RtlLeaveCriticalSection( &pool->cs );
+
+        tp_worker_run_object( object );
     }
     pool->num_workers--;
+    tp_worker_detach( &worker );
     RtlLeaveCriticalSection( &pool->cs );
 
     TRACE( "terminating worker thread for pool %p\n", pool );
@@ -2723,7 +3053,7 @@ VOID WINAPI TpDisassociateCallback( TP_CALLBACK_INSTANCE *instance )
     pool = object->pool;
     RtlEnterCriticalSection( &pool->cs );
 
-    object->num_associated_callbacks--;
+    InterlockedDecrement( &object->num_associated_callbacks );
     if (object_is_finished( object, FALSE ))
         RtlWakeAllConditionVariable( &object->finished_event );
 
@@ -87,6 +87,10 @@
 #ifdef HAVE_LINUX_MAJOR_H
 # include <linux/major.h>
 #endif
+#ifdef HAVE_LINUX_IO_URING_H
+# include <linux/io_uring.h>
+# include <sys/mman.h>
+#endif
 #ifdef HAVE_SYS_PARAM_H
 #include <sys/param.h>
 #endif
@@ -106,6 +110,9 @@
 #undef XATTR_ADDITIONAL_OPTIONS
 #include <sys/extattr.h>
 #endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 #include <time.h>
 #include <unistd.h>
 
@@ -121,6 +128,7 @@
 #define WINE_MOUNTMGR_EXTENSIONS
 #include "ddk/mountmgr.h"
 #include "wine/server.h"
+#include "wine/fsctl.h"
 #include "wine/list.h"
 #include "wine/debug.h"
 #include "unix_private.h"
@@ -230,6 +238,37 @@ struct dir_data
     struct dir_data_buffer *buffer;  /* head of data buffers list */
 };
 
+struct lookup_name
+{
+    unsigned int    hash;        /* hash of the upper-case name */
+    unsigned int    next;        /* next entry in the hash bucket, ~0u if none */
+    unsigned int    index;       /* index of the file in directory order */
+    unsigned int    name;        /* offset of the Unicode name in the names buffer */
+    unsigned int    unix_name;   /* offset of the Unix name in the unix_names buffer */
+    unsigned short  length;      /* length of the Unicode name */
+    BOOLEAN         is_short;    /* whether this is a generated short name */
+};
+
+struct lookup_dir
+{
+    struct list          entry;            /* entry in the lookup cache */
+    dev_t                dev;              /* directory device */
+    ino_t                ino;              /* directory inode */
+    LONGLONG             mtime;            /* directory modification time */
+    LONGLONG             ctime;            /* directory change time */
+    struct lookup_name  *entries;          /* names, in directory order */
+    unsigned int         entries_size;     /* size of the entries buffer in bytes */
+    unsigned int         entries_len;      /* used size of the entries buffer in bytes */
+    unsigned int        *buckets;          /* hash table of the entries */
+    unsigned int         bucket_count;     /* number of buckets, a power of two */
+    char                *names;            /* Unicode names */
+    unsigned int         names_size;
+    unsigned int         names_len;
+    char                *unix_names;       /* Unix names */
+    unsigned int         unix_names_size;
+    unsigned int         unix_names_len;
+};
+
 static const unsigned int dir_data_buffer_initial_size = 4096;
 static const unsigned int dir_data_cache_initial_size  = 256;
 static const unsigned int dir_data_names_initial_size  = 64;
@@ -238,7 +277,7 @@ static struct dir_data **dir_data_cache;
 static unsigned int dir_data_cache_size;
 
 static BOOL show_dot_files;
-static mode_t start_umask;
+mode_t start_umask;
 
 /* at some point we may want to allow Winelib apps to set this */
 static const BOOL is_case_sensitive = FALSE;
@@ -2035,6 +2074,10 @@ static unsigned int server_get_unix_name( HANDLE handle, char **unix_name )
     unsigned int ret;
     char *name;
 
+    /* objects that are known not to support fds don't have a unix name either */
+    if (server_get_cached_fd_status( handle ) == STATUS_OBJECT_TYPE_MISMATCH)
+        return STATUS_OBJECT_TYPE_MISMATCH;
+
     for (;;)
     {
         if (!(name = malloc( size + 1 ))) return STATUS_NO_MEMORY;
@@ -2315,9 +2358,14 @@ static NTSTATUS get_dir_data_entry( struct dir_data *dir_data, void *info_ptr, I
     const struct dir_data_names *names = &dir_data->names[dir_data->pos];
     union file_directory_info *info;
     struct stat st;
-    ULONG name_len, start, dir_size, attributes;
+    ULONG name_len, start, dir_size, attributes = 0;
+    int ret;
+
+    /* only the names are returned for FileNamesInformation, don't bother with attributes */
+    if (class == FileNamesInformation) ret = stat( names->unix_name, &st );
+    else ret = get_file_info( names->unix_name, &st, &attributes );
 
-    if (get_file_info( names->unix_name, &st, &attributes ) == -1)
+    if (ret == -1)
     {
         TRACE( "file no longer exists %s\n", names->unix_name );
         return STATUS_SUCCESS;
@@ -2519,6 +2567,64 @@ static NTSTATUS read_directory_data_stat( struct dir_data *data, const char *uni
 }
 
 
+#if defined(__linux__) && defined(__NR_getdents64)
+
+struct linux_dirent64
+{
+    ULONG64        d_ino;
+    LONG64         d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[1];
+};
+
+/***********************************************************************
+ *           read_directory_data_getdents
+ *
+ * Read the directory contents with large getdents64 calls, to avoid the small buffers of some libcs.
+ */
+static NTSTATUS read_directory_data_getdents( struct dir_data *data, int fd, const UNICODE_STRING *mask )
+{
+    static const unsigned int buffer_size = 65536;
+    const struct linux_dirent64 *de;
+    NTSTATUS status = STATUS_NO_MEMORY;
+    off_t old_pos = lseek( fd, 0, SEEK_CUR );
+    long ret, pos;
+    char *buffer;
+
+    if (!(buffer = malloc( buffer_size ))) return STATUS_NO_MEMORY;
+
+    lseek( fd, 0, SEEK_SET );
+    if ((ret = syscall( __NR_getdents64, fd, buffer, buffer_size )) == -1)
+    {
+        status = STATUS_NOT_SUPPORTED;
+        goto done;
+    }
+
+    if (!append_entry( data, ".", NULL, mask )) goto done;
+    if (!append_entry( data, "..", NULL, mask )) goto done;
+
+    while (ret > 0)
+    {
+        for (pos = 0; pos < ret; pos += de->d_reclen)
+        {
+            de = (const struct linux_dirent64 *)(buffer + pos);
+            if (!strcmp( de->d_name, "." ) || !strcmp( de->d_name, ".." )) continue;
+            if (!append_entry( data, de->d_name, NULL, mask )) goto done;
+        }
+        ret = syscall( __NR_getdents64, fd, buffer, buffer_size );
+    }
+    status = ret ? errno_to_status( errno ) : STATUS_SUCCESS;
+
+done:
+    lseek( fd, old_pos, SEEK_SET );
+    free( buffer );
+    return status;
+}
+
+#endif  /* __linux__ && __NR_getdents64 */
+
+
 /***********************************************************************
  *           read_directory_readdir
  *
@@ -2576,6 +2682,10 @@ static NTSTATUS read_directory_data( struct dir_data *data, int fd, const UNICOD
         }
     }
 
+#if defined(__linux__) && defined(__NR_getdents64)
+    /* any other failure leaves partial data behind, so don't read the directory again */
+    if ((status = read_directory_data_getdents( data, fd, mask )) != STATUS_NOT_SUPPORTED) return status;
+#endif
     return read_directory_data_readdir( data, mask );
 }
 
@@ -2782,6 +2892,218 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
 }
 
 
+/***********************************************************************
+ *           Case-insensitive lookup cache
+ *
+ * Directories that have been scanned for a case-insensitive match are
+ * kept in a cache keyed by device and inode, with a hash table of their
+ * names. Creating, deleting or renaming an entry updates the modification
+ * time of the directory, so cached directories are checked against it on
+ * each lookup. File systems only update timestamps with a coarse
+ * granularity, so directories modified within the last few seconds are
+ * not cached at all, otherwise a later change could leave the same time.
+ */
+
+static const LONGLONG lookup_cache_min_age = 2 * TICKSPERSEC;  /* covers the 2 seconds of FAT */
+static struct list lookup_cache = LIST_INIT( lookup_cache );  /* cached directories, most recent first */
+static unsigned int lookup_cache_count;
+static pthread_mutex_t lookup_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+static unsigned int hash_lookup_name( const WCHAR *name, int length )
+{
+    unsigned int hash = 0;
+
+    while (length--) hash = hash * 65599 + towupper( *name++ );
+    return hash;
+}
+
+
+/* append data to a growing buffer, returning its offset or -1 on failure */
+static int append_lookup_data( char **data, unsigned int *size, unsigned int *len,
+                               const void *ptr, unsigned int count )
+{
+    int ret = *len;
+
+    if (*len + count > *size)
+    {
+        unsigned int new_size = max( 4096, max( *size * 2, *len + count ));
+        char *new_data = realloc( *data, new_size );
+
+        if (!new_data) return -1;
+        *data = new_data;
+        *size = new_size;
+    }
+    memcpy( *data + *len, ptr, count );
+    *len += count;
+    return ret;
+}
+
+
+/* add a name to a cached directory; caller must hold lookup_cache_mutex */
+static BOOL add_lookup_name( struct lookup_dir *dir, const WCHAR *name, int length,
+                             unsigned int index, int unix_name, BOOL is_short )
+{
+    struct lookup_name entry;
+    int pos;
+
+    if ((pos = append_lookup_data( &dir->names, &dir->names_size, &dir->names_len,
+                                   name, length * sizeof(WCHAR) )) == -1)
+        return FALSE;
+
+    entry.hash      = hash_lookup_name( name, length );
+    entry.next      = ~0u;
+    entry.index     = index;
+    entry.name      = pos;
+    entry.unix_name = unix_name;
+    entry.length    = length;
+    entry.is_short  = is_short;
+    return append_lookup_data( (char **)&dir->entries, &dir->entries_size, &dir->entries_len,
+                               &entry, sizeof(entry) ) != -1;
+}
+
+
+/* free a cached directory; caller must hold lookup_cache_mutex */
+static void free_lookup_dir( struct lookup_dir *dir )
+{
+    free( dir->buckets );
+    free( dir->entries );
+    free( dir->names );
+    free( dir->unix_names );
+    free( dir );
+}
+
+
+/* read the contents of a directory into a new cache entry; caller must hold lookup_cache_mutex */
+static struct lookup_dir *read_lookup_dir( const char *unix_name, const struct stat *st,
+                                           LONGLONG mtime, LONGLONG ctime )
+{
+    WCHAR buffer[MAX_DIR_ENTRY_LEN], short_nameW[12];
+    struct lookup_dir *dir;
+    struct dirent *de;
+    unsigned int i, count, index = 0;
+    int ret, len, pos;
+    DIR *dirp;
+
+    if (!(dir = calloc( 1, sizeof(*dir) ))) return NULL;
+
+    dir->dev   = st->st_dev;
+    dir->ino   = st->st_ino;
+    dir->mtime = mtime;
+    dir->ctime = ctime;
+
+    if (!(dirp = opendir( unix_name ))) goto failed;
+    while ((de = readdir( dirp )))
+    {
+        len = strlen( de->d_name );
+        if ((pos = append_lookup_data( &dir->unix_names, &dir->unix_names_size, &dir->unix_names_len,
+                                       de->d_name, len + 1 )) == -1)
+            break;
+        ret = ntdll_umbstowcs( de->d_name, len, buffer, MAX_DIR_ENTRY_LEN );
+        if (!add_lookup_name( dir, buffer, ret, index, pos, FALSE )) break;
+        if (!is_legal_8dot3_name( buffer, ret ))
+        {
+            ret = hash_short_file_name( buffer, ret, short_nameW );
+            if (!add_lookup_name( dir, short_nameW, ret, index, pos, TRUE )) break;
+        }
+        index++;
+    }
+    closedir( dirp );
+    if (de) goto failed;  /* out of memory */
+
+    count = dir->entries_len / sizeof(*dir->entries);
+    for (dir->bucket_count = 16; dir->bucket_count < count; dir->bucket_count *= 2) ;
+    if (!(dir->buckets = malloc( dir->bucket_count * sizeof(*dir->buckets) ))) goto failed;
+    memset( dir->buckets, 0xff, dir->bucket_count * sizeof(*dir->buckets) );
+    for (i = 0; i < count; i++)
+    {
+        unsigned int bucket = dir->entries[i].hash & (dir->bucket_count - 1);
+        dir->entries[i].next = dir->buckets[bucket];
+        dir->buckets[bucket] = i;
+    }
+    return dir;
+
+failed:
+    free_lookup_dir( dir );
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           find_file_in_lookup_cache
+ *
+ * Helper for find_file_in_dir. Look for a name in the cached contents of the
+ * directory unix_name, which is terminated at pos - 1.
+ * Return STATUS_NOT_SUPPORTED if the cache can't be used.
+ */
+static NTSTATUS find_file_in_lookup_cache( char *unix_name, int pos, const WCHAR *name, int length,
+                                           BOOLEAN check_short )
+{
+    static const unsigned int max_dirs = 128;
+    const struct lookup_name *found = NULL;
+    struct lookup_dir *dir;
+    NTSTATUS status = STATUS_NOT_SUPPORTED;
+    LARGE_INTEGER mtime, ctime, atime, creation, now;
+    unsigned int i, hash;
+    struct stat st;
+
+    if (stat( unix_name, &st ) == -1) return STATUS_NOT_SUPPORTED;
+    get_file_times( &st, &mtime, &ctime, &atime, &creation );
+
+    mutex_lock( &lookup_cache_mutex );
+
+    LIST_FOR_EACH_ENTRY( dir, &lookup_cache, struct lookup_dir, entry )
+    {
+        if (dir->dev != st.st_dev || dir->ino != st.st_ino) continue;
+        list_remove( &dir->entry );
+        if (dir->mtime == mtime.QuadPart && dir->ctime == ctime.QuadPart) goto found;
+        lookup_cache_count--;
+        free_lookup_dir( dir );
+        break;
+    }
+
+    /* a recently modified directory may change again without a visible time change */
+    NtQuerySystemTime( &now );
+    if (now.QuadPart - max( mtime.QuadPart, ctime.QuadPart ) < lookup_cache_min_age) goto done;
+
+    if (lookup_cache_count == max_dirs)
+    {
+        struct lookup_dir *last = LIST_ENTRY( list_tail( &lookup_cache ), struct lookup_dir, entry );
+        list_remove( &last->entry );
+        lookup_cache_count--;
+        free_lookup_dir( last );
+    }
+    if (!(dir = read_lookup_dir( unix_name, &st, mtime.QuadPart, ctime.QuadPart ))) goto done;
+    lookup_cache_count++;
+
+found:
+    list_add_head( &lookup_cache, &dir->entry );
+
+    /* return the first match in directory order, as a directory scan would */
+    hash = hash_lookup_name( name, length );
+    for (i = dir->buckets[hash & (dir->bucket_count - 1)]; i != ~0u; i = dir->entries[i].next)
+    {
+        const struct lookup_name *entry = &dir->entries[i];
+
+        if (entry->hash != hash || entry->length != length) continue;
+        if (entry->is_short && !check_short) continue;
+        if (found && found->index <= entry->index) continue;
+        if (!wcsnicmp( (const WCHAR *)(dir->names + entry->name), name, length )) found = entry;
+    }
+    if (found)
+    {
+        unix_name[pos - 1] = '/';
+        strcpy( unix_name + pos, dir->unix_names + found->unix_name );
+        status = STATUS_SUCCESS;
+    }
+    else status = STATUS_OBJECT_NAME_NOT_FOUND;
+
+done:
+    mutex_unlock( &lookup_cache_mutex );
+    return status;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2794,6 +3116,7 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
 {
     WCHAR buffer[MAX_DIR_ENTRY_LEN];
     BOOLEAN is_name_8_dot_3;
+    NTSTATUS status;
     DIR *dir;
     struct dirent *de;
     struct stat st;
@@ -2872,6 +3195,10 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    status = find_file_in_lookup_cache( unix_name, pos, name, length, is_name_8_dot_3 );
+    if (status == STATUS_SUCCESS) return STATUS_SUCCESS;
+    if (status == STATUS_OBJECT_NAME_NOT_FOUND) goto not_found;
+
     if (!(dir = opendir( unix_name ))) return errno_to_status( errno );
 
     unix_name[pos - 1] = '/';
@@ -4435,6 +4762,7 @@ NTSTATUS WINAPI NtQueryInformationFile( HANDLE handle, IO_STATUS_BLOCK *io,
     ULONG attr;
     unsigned int options;
     unsigned int status;
+    enum server_fd_type type;
 
     TRACE( "(%p,%p,%p,0x%08x,0x%08x)\n", handle, io, ptr, (int)len, class);
 
@@ -4442,16 +4770,42 @@ NTSTATUS WINAPI NtQueryInformationFile( HANDLE handle, IO_STATUS_BLOCK *io,
 
     if (class <= 0 || class >= FileMaximumInformation)
         return io->Status = STATUS_INVALID_INFO_CLASS;
+    if (class == FileAccessInformation || class == FileModeInformation)
+    {
+        unsigned int access;
+
+        /* the access and options of cached file handles don't need the server */
+        if (server_get_file_access_mode( handle, &access, &options ))
+        {
+            if (len < sizeof(ULONG)) return io->Status = STATUS_INFO_LENGTH_MISMATCH;
+            if (class == FileAccessInformation)
+                ((FILE_ACCESS_INFORMATION *)ptr)->AccessFlags = access;
+            else
+                ((FILE_MODE_INFORMATION *)ptr)->Mode = options & (FILE_WRITE_THROUGH |
+                                                                  FILE_SEQUENTIAL_ONLY |
+                                                                  FILE_NO_INTERMEDIATE_BUFFERING |
+                                                                  FILE_SYNCHRONOUS_IO_ALERT |
+                                                                  FILE_SYNCHRONOUS_IO_NONALERT);
+            io->Information = sizeof(ULONG);
+            return io->Status = STATUS_SUCCESS;
+        }
+    }
     if (!info_sizes[class])
         return server_get_file_info( handle, io, ptr, len, class );
     if (len < info_sizes[class])
         return io->Status = STATUS_INFO_LENGTH_MISMATCH;
 
-    if ((status = server_get_unix_fd( handle, 0, &fd, &needs_close, NULL, &options )))
+    if ((status = server_get_unix_fd( handle, 0, &fd, &needs_close, &type, &options )))
     {
         if (status != STATUS_BAD_DEVICE_TYPE) return io->Status = status;
         return server_get_file_info( handle, io, ptr, len, class );
     }
+    if (type == FD_TYPE_PIPE)
+    {
+        /* the socket of a named pipe doesn't know about the pipe state */
+        if (needs_close) close( fd );
+        return server_get_file_info( handle, io, ptr, len, class );
+    }
 
     switch (class)
     {
@@ -4765,6 +5119,8 @@ NTSTATUS WINAPI NtSetInformationFile( HANDLE handle, IO_STATUS_BLOCK *io,
                 status = wine_server_call( req );
             }
             SERVER_END_REQ;
+            /* the pipe may now be accessed through a different fd */
+            if (!status) server_remove_cached_fd( handle );
         }
         else status = STATUS_INVALID_PARAMETER_3;
         break;
@@ -5097,17 +5453,37 @@ static BOOL irp_completion( void *user, ULONG_PTR *info, unsigned int *status )
     return TRUE;
 }
 
+/* receive data from the unix socket of a named pipe end connected directly to its peer */
+static unsigned int pipe_recv( int fd, char *buffer, ULONG length, ULONG *total )
+{
+    struct pollfd pfd;
+    ssize_t ret;
+
+    if (!length)
+    {
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        return poll( &pfd, 1, 0 ) == 1 ? STATUS_SUCCESS : STATUS_PENDING;
+    }
+    while ((ret = virtual_locked_read( fd, buffer + *total, length - *total )) < 0 && errno == EINTR);
+    if (ret > 0) *total += ret;
+    else if (!ret) return STATUS_PIPE_BROKEN;
+    else return errno == EAGAIN ? STATUS_PENDING : errno_to_status( errno );
+    return STATUS_SUCCESS;
+}
+
 static BOOL async_read_proc( void *user, ULONG_PTR *info, unsigned int *status )
 {
     struct async_fileio_read *fileio = user;
     int fd, needs_close, result;
+    enum server_fd_type type;
 
     switch (*status)
     {
     case STATUS_ALERTED: /* got some new data */
         /* check to see if the data is ready (non-blocking) */
         if ((*status = server_get_unix_fd( fileio->io.handle, FILE_READ_DATA, &fd,
-                                          &needs_close, NULL, NULL )))
+                                          &needs_close, &type, NULL )))
             break;
 
         result = virtual_locked_read(fd, &fileio->buffer[fileio->already], fileio->count-fileio->already);
@@ -5172,6 +5548,11 @@ static BOOL async_write_proc( void *user, ULONG_PTR *info, unsigned int *status
         {
             if (errno == EAGAIN || errno == EINTR) return FALSE;
             *status = errno_to_status( errno );
+            if (errno == EPIPE && type == FD_TYPE_PIPE)
+            {
+                server_remove_cached_fd( fileio->io.handle );
+                *status = STATUS_PIPE_CLOSING;
+            }
         }
         else
         {
@@ -5383,6 +5764,7 @@ static unsigned int get_io_timeouts( HANDLE handle, enum server_fd_type type, UL
         break;
     case FD_TYPE_SOCKET:
     case FD_TYPE_CHAR:
+    case FD_TYPE_PIPE:
         if (is_read) timeouts->interval = 0;  /* return as soon as we got something */
         break;
     default:
@@ -5435,6 +5817,7 @@ static NTSTATUS get_io_avail_mode( HANDLE handle, enum server_fd_type type, BOOL
     case FD_TYPE_MAILSLOT:
     case FD_TYPE_SOCKET:
     case FD_TYPE_CHAR:
+    case FD_TYPE_PIPE:
         *avail_mode = TRUE;
         break;
     default:
@@ -5488,6 +5871,345 @@ void add_completion( HANDLE handle, ULONG_PTR value, NTSTATUS status, ULONG info
     SERVER_END_REQ;
 }
 
+#if defined(HAVE_LINUX_IO_URING_H) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+
+/* overlapped I/O on regular files submitted to an io_uring; the completions
+ * are reaped by a dedicated thread that also signals events and completion ports */
+
+#define URING_ENTRIES 256
+
+struct uring_io
+{
+    struct list  entry;     /* entry in the list of in-flight requests */
+    HANDLE       handle;    /* handle the request was issued on, for cancellation */
+    HANDLE       file;      /* duplicate of the handle, to post the completion */
+    HANDLE       event;     /* duplicate of the event */
+    client_ptr_t iosb;
+    ULONG_PTR    cvalue;
+    DWORD        tid;       /* thread that issued the request */
+    int          unix_fd;   /* closed on completion, or -1 if cached */
+    ULONG        length;
+    BOOL         write;
+    BOOL         cancelled; /* a cancel request has been submitted */
+};
+
+static struct
+{
+    int                  fd;
+    unsigned int        *sq_head;
+    unsigned int        *sq_tail;
+    unsigned int        *sq_mask;
+    unsigned int        *sq_array;
+    unsigned int        *cq_head;
+    unsigned int        *cq_tail;
+    unsigned int        *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned int         cq_entries;
+    unsigned int         inflight;
+    struct list          requests;
+} uring = { -1 };
+
+static int uring_state;  /* 0: not initialized yet, 1: ready, -1: disabled */
+static pthread_mutex_t uring_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int uring_enter( unsigned int to_submit, unsigned int min_complete, unsigned int flags )
+{
+    int ret;
+
+    while ((ret = syscall( __NR_io_uring_enter, uring.fd, to_submit, min_complete, flags, NULL, 0 )) == -1
+           && errno == EINTR) /* nothing */;
+    return ret;
+}
+
+static BOOL uring_create(void)
+{
+    struct io_uring_params params;
+    size_t sq_size, cq_size;
+    char *sq_ring, *cq_ring;
+    void *sqes;
+    int fd;
+
+    memset( &params, 0, sizeof(params) );
+    if ((fd = syscall( __NR_io_uring_setup, URING_ENTRIES, &params )) == -1)
+    {
+        WARN( "io_uring_setup failed: %s\n", strerror( errno ));
+        return FALSE;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        close( fd );
+        return FALSE;
+    }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    sq_ring = mmap( NULL, max( sq_size, cq_size ), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    fd, IORING_OFF_SQ_RING );
+    if (sq_ring == MAP_FAILED)
+    {
+        close( fd );
+        return FALSE;
+    }
+    sqes = mmap( NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES );
+    if (sqes == MAP_FAILED)
+    {
+        munmap( sq_ring, max( sq_size, cq_size ));
+        close( fd );
+        return FALSE;
+    }
+    cq_ring = sq_ring;
+
+    uring.fd         = fd;
+    uring.sq_head    = (unsigned int *)(sq_ring + params.sq_off.head);
+    uring.sq_tail    = (unsigned int *)(sq_ring + params.sq_off.tail);
+    uring.sq_mask    = (unsigned int *)(sq_ring + params.sq_off.ring_mask);
+    uring.sq_array   = (unsigned int *)(sq_ring + params.sq_off.array);
+    uring.cq_head    = (unsigned int *)(cq_ring + params.cq_off.head);
+    uring.cq_tail    = (unsigned int *)(cq_ring + params.cq_off.tail);
+    uring.cq_mask    = (unsigned int *)(cq_ring + params.cq_off.ring_mask);
+    uring.cqes       = (struct io_uring_cqe *)(cq_ring + params.cq_off.cqes);
+    uring.sqes       = sqes;
+    uring.cq_entries = params.cq_entries;
+    list_init( &uring.requests );
+    return TRUE;
+}
+
+/* called with uring_mutex held */
+static BOOL uring_init(void)
+{
+    const char *env = getenv( "WINEIOURING" );
+    HANDLE thread;
+
+    if (!env || !atoi( env ) || !p__wine_io_uring_thread) return FALSE;
+    if (!uring_create()) return FALSE;
+
+    if (NtCreateThreadEx( &thread, THREAD_ALL_ACCESS, NULL, NtCurrentProcess(), p__wine_io_uring_thread,
+                          NULL, THREAD_CREATE_FLAGS_HIDE_FROM_DEBUGGER, 0, 0, 0, NULL ))
+    {
+        close( uring.fd );
+        uring.fd = -1;
+        return FALSE;
+    }
+    NtClose( thread );
+    TRACE( "using io_uring for overlapped file I/O\n" );
+    return TRUE;
+}
+
+static void uring_complete( struct uring_io *req, int res )
+{
+    unsigned int status;
+    ULONG total = 0;
+
+    if (res < 0)
+    {
+        if (res == -ECANCELED) status = STATUS_CANCELLED;
+        else if (res == -EFAULT && req->write) status = STATUS_INVALID_USER_BUFFER;
+        else status = errno_to_status( -res );
+    }
+    else
+    {
+        total = res;
+        status = (total || !req->length || req->write) ? STATUS_SUCCESS : STATUS_END_OF_FILE;
+    }
+
+    TRACE( "handle %p status %#x total %u\n", req->handle, status, (int)total );
+    set_async_iosb( req->iosb, status, total );
+    NtSetEvent( req->event, NULL );
+    if (req->cvalue) add_completion( req->file, req->cvalue, status, total, TRUE );
+    if (req->unix_fd != -1) close( req->unix_fd );
+    NtClose( req->event );
+    NtClose( req->file );
+    free( req );
+}
+
+/***********************************************************************
+ *           io_uring_thread
+ *
+ * Unix call running on the io_uring completion thread; never returns.
+ */
+NTSTATUS io_uring_thread( void *args )
+{
+    for (;;)
+    {
+        unsigned int head = *uring.cq_head, tail = ReadAcquire( (LONG *)uring.cq_tail ), count = 0;
+
+        if (head == tail)
+        {
+            if (uring_enter( 0, 1, IORING_ENTER_GETEVENTS ) == -1)
+                ERR( "io_uring_enter failed: %s\n", strerror( errno ));
+            continue;
+        }
+        for (; head != tail; head++, count++)
+        {
+            struct io_uring_cqe *cqe = &uring.cqes[head & *uring.cq_mask];
+            struct uring_io *req = wine_server_get_ptr( cqe->user_data );
+
+            if (!req) continue;  /* cancel request */
+            mutex_lock( &uring_mutex );
+            list_remove( &req->entry );
+            mutex_unlock( &uring_mutex );
+            uring_complete( req, cqe->res );
+        }
+        WriteRelease( (LONG *)uring.cq_head, head );
+
+        mutex_lock( &uring_mutex );
+        uring.inflight -= count;
+        mutex_unlock( &uring_mutex );
+    }
+}
+
+/* queue a submission entry; called with uring_mutex held */
+static BOOL uring_push( UINT8 opcode, int fd, ULONG_PTR addr, ULONG len, LONGLONG offset, client_ptr_t user_data )
+{
+    struct io_uring_sqe *sqe;
+    unsigned int tail, index;
+
+    if (uring.inflight >= uring.cq_entries) return FALSE;
+
+    tail = *uring.sq_tail;
+    index = tail & *uring.sq_mask;
+    sqe = &uring.sqes[index];
+    memset( sqe, 0, sizeof(*sqe) );
+    sqe->opcode    = opcode;
+    sqe->fd        = fd;
+    sqe->addr      = addr;
+    sqe->len       = len;
+    sqe->off       = offset;
+    sqe->user_data = user_data;
+    uring.sq_array[index] = index;
+    WriteRelease( (LONG *)uring.sq_tail, tail + 1 );
+
+    if (uring_enter( 1, 0, 0 ) != 1)
+    {
+        /* nothing consumed the entry without SQPOLL, so we can take it back */
+        WARN( "io_uring_enter failed: %s\n", strerror( errno ));
+        WriteRelease( (LONG *)uring.sq_tail, tail );
+        return FALSE;
+    }
+    uring.inflight++;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           uring_submit
+ *
+ * Queue an overlapped read or write of a regular file. Returns STATUS_PENDING
+ * on success; any other status means the caller should perform the I/O itself.
+ */
+static unsigned int uring_submit( HANDLE handle, int unix_fd, BOOL needs_close, HANDLE event,
+                                  void *apc_user, client_ptr_t iosb, void *buffer, ULONG length,
+                                  LONGLONG offset, BOOL write )
+{
+    struct uring_io *req;
+    unsigned int status;
+
+    /* without an event, waiters use the file handle, which is always signaled for
+     * regular files, so only the synchronous path gives them a valid result */
+    if (uring_state < 0 || !event) return STATUS_NOT_SUPPORTED;
+
+    /* the kernel accesses the buffer on its own, so it must not fault: write watches
+     * are only updated by faults of the writing thread, and may be reset at any time */
+    if (write ? !virtual_check_buffer_for_read( buffer, length )
+              : !virtual_check_buffer_for_write( buffer, length ) || virtual_has_write_watch( buffer, length ))
+        return STATUS_NOT_SUPPORTED;
+
+    if (!(req = malloc( sizeof(*req) ))) return STATUS_NO_MEMORY;
+
+    /* the application may close its handles before the I/O completes */
+    if ((status = NtDuplicateObject( NtCurrentProcess(), handle, NtCurrentProcess(), &req->file,
+                                     0, 0, DUPLICATE_SAME_ACCESS )))
+    {
+        free( req );
+        return status;
+    }
+    if ((status = NtDuplicateObject( NtCurrentProcess(), event, NtCurrentProcess(), &req->event,
+                                     0, 0, DUPLICATE_SAME_ACCESS )))
+    {
+        NtClose( req->file );
+        free( req );
+        return status;
+    }
+    req->handle    = handle;
+    req->iosb      = iosb;
+    req->cvalue    = (ULONG_PTR)apc_user;
+    req->tid       = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    req->unix_fd   = needs_close ? unix_fd : -1;
+    req->length    = length;
+    req->write     = write;
+    req->cancelled = FALSE;
+
+    /* the event is reset when the I/O starts, like for server asyncs */
+    NtResetEvent( event, NULL );
+
+    mutex_lock( &uring_mutex );
+    if (!uring_state) uring_state = uring_init() ? 1 : -1;
+    if (uring_state < 0 || !uring_push( write ? IORING_OP_WRITE : IORING_OP_READ, unix_fd,
+                                        (ULONG_PTR)buffer, length, offset, wine_server_client_ptr( req )))
+    {
+        mutex_unlock( &uring_mutex );
+        NtClose( req->event );
+        NtClose( req->file );
+        free( req );
+        return STATUS_NOT_SUPPORTED;
+    }
+    list_add_tail( &uring.requests, &req->entry );
+    mutex_unlock( &uring_mutex );
+    return STATUS_PENDING;
+}
+
+/***********************************************************************
+ *           uring_cancel
+ *
+ * Request the cancellation of the in-flight requests of a handle, optionally
+ * only the ones of the current thread or of a given IO status block.
+ * Returns TRUE if any matching request was found.
+ */
+static BOOL uring_cancel( HANDLE handle, client_ptr_t iosb, BOOL only_thread )
+{
+    DWORD tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    struct uring_io *req;
+    BOOL found = FALSE;
+
+    if (uring_state <= 0) return FALSE;
+
+    mutex_lock( &uring_mutex );
+    LIST_FOR_EACH_ENTRY( req, &uring.requests, struct uring_io, entry )
+    {
+        if (req->handle != handle) continue;
+        if (iosb && req->iosb != iosb) continue;
+        if (only_thread && req->tid != tid) continue;
+        found = TRUE;
+        /* the request may complete anyway if it's already being processed */
+        if (!req->cancelled)
+            req->cancelled = uring_push( IORING_OP_ASYNC_CANCEL, -1, wine_server_client_ptr( req ), 0, 0, 0 );
+    }
+    mutex_unlock( &uring_mutex );
+    return found;
+}
+
+#else  /* HAVE_LINUX_IO_URING_H */
+
+NTSTATUS io_uring_thread( void *args )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+static unsigned int uring_submit( HANDLE handle, int unix_fd, BOOL needs_close, HANDLE event,
+                                  void *apc_user, client_ptr_t iosb, void *buffer, ULONG length,
+                                  LONGLONG offset, BOOL write )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+static BOOL uring_cancel( HANDLE handle, client_ptr_t iosb, BOOL only_thread )
+{
+    return FALSE;
+}
+
+#endif  /* HAVE_LINUX_IO_URING_H */
+
 static unsigned int set_pending_write( HANDLE device )
 {
     unsigned int status;
@@ -5503,6 +6225,38 @@ static unsigned int set_pending_write( HANDLE device )
 }
 
 
+/* read from a named pipe end connected to its peer through a unix socket */
+static unsigned int pipe_read( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
+                               IO_STATUS_BLOCK *io, void *buffer, ULONG length )
+{
+    ULONG_PTR cvalue = apc ? 0 : (ULONG_PTR)apc_user;
+    unsigned int status;
+    ULONG total = 0;
+
+    status = pipe_recv( fd, buffer, length, &total );
+
+    /* let the server wait for data, it knows about the pipe mode and handles
+     * cancellation and alertable waits; a broken socket means the server shut it
+     * down, and then it reports the pipe state */
+    if (status == STATUS_PIPE_BROKEN) server_remove_cached_fd( handle );
+    if (status == STATUS_PENDING || status == STATUS_PIPE_BROKEN)
+        return server_read_file( handle, event, apc, apc_user, io, buffer, length, NULL, NULL );
+
+    if (status == STATUS_SUCCESS)
+    {
+        io->Status = status;
+        io->Information = total;
+        TRACE("= 0x%08x (%u)\n", status, (int)total);
+        if (event) NtSetEvent( event, NULL );
+        if (apc) NtQueueApcThread( GetCurrentThread(), (PNTAPCFUNC)apc, (ULONG_PTR)apc_user,
+                                   iosb_client_ptr(io), 0 );
+        if (cvalue) add_completion( handle, cvalue, status, total, FALSE );
+    }
+    else if (event) NtResetEvent( event, NULL );
+    return status;
+}
+
+
 /******************************************************************************
  *              NtReadFile   (NTDLL.@)
  */
@@ -5545,6 +6299,11 @@ NTSTATUS WINAPI NtReadFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, vo
 
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
         {
+            if (async_read && !apc && length &&
+                uring_submit( handle, unix_handle, needs_close, event, apc_user, iosb_ptr,
+                              buffer, length, offset->QuadPart, FALSE ) == STATUS_PENDING)
+                return STATUS_PENDING;
+
             /* async I/O doesn't make sense on regular files */
             while ((result = virtual_locked_pread( unix_handle, buffer, length, offset->QuadPart )) == -1)
             {
@@ -5576,6 +6335,12 @@ NTSTATUS WINAPI NtReadFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, vo
         if (needs_close) close( unix_handle );
         return status;
     }
+    else if (type == FD_TYPE_PIPE)
+    {
+        status = pipe_read( handle, unix_handle, event, apc, apc_user, io, buffer, length );
+        if (needs_close) close( unix_handle );
+        return status;
+    }
 
     if (type == FD_TYPE_SERIAL && async_read && length)
     {
@@ -5862,6 +6627,11 @@ NTSTATUS WINAPI NtWriteFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, v
                 goto done;
             }
 
+            if (async_write && !apc && length && offset->QuadPart >= 0 &&
+                uring_submit( handle, unix_handle, needs_close, event, apc_user, iosb_ptr,
+                              (void *)buffer, length, off, TRUE ) == STATUS_PENDING)
+                return STATUS_PENDING;
+
             /* async I/O doesn't make sense on regular files */
             while ((result = pwrite( unix_handle, buffer, length, off )) == -1)
             {
@@ -5918,6 +6688,13 @@ NTSTATUS WINAPI NtWriteFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, v
         else if (errno != EAGAIN)
         {
             if (errno == EINTR) continue;
+            if (errno == EPIPE && !total && type == FD_TYPE_PIPE)
+            {
+                /* the server shut the socket down, let it report the pipe state */
+                if (needs_close) close( unix_handle );
+                server_remove_cached_fd( handle );
+                return server_write_file( handle, event, apc, apc_user, io, buffer, length, NULL, NULL );
+            }
             if (!total)
             {
                 if (errno == EFAULT) status = STATUS_INVALID_USER_BUFFER;
@@ -5926,6 +6703,23 @@ NTSTATUS WINAPI NtWriteFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, v
             goto err;
         }
 
+        if (type == FD_TYPE_PIPE && (!async_write || !total))
+        {
+            /* let the server wait for the socket, it knows about the pipe mode and
+             * handles cancellation and alertable waits */
+            if (!total)
+            {
+                if (needs_close) close( unix_handle );
+                return server_write_file( handle, event, apc, apc_user, io, buffer, length, NULL, NULL );
+            }
+            /* the completion is reported here, with the part already written */
+            status = server_write_file( handle, event, NULL, NULL, io, (const char *)buffer + total,
+                                        length - total, NULL, NULL );
+            if (status) goto err;
+            total += io->Information;
+            goto done;
+        }
+
         if (async_write)
         {
             struct async_fileio_write *fileio;
@@ -6153,6 +6947,171 @@ NTSTATUS WINAPI NtDeviceIoControlFile( HANDLE handle, HANDLE event, PIO_APC_ROUT
 }
 
 
+#ifdef __linux__
+
+#ifndef FICLONERANGE
+struct file_clone_range
+{
+    int64_t  src_fd;
+    uint64_t src_offset;
+    uint64_t src_length;
+    uint64_t dest_offset;
+};
+#define FICLONERANGE _IOW(0x94, 13, struct file_clone_range)
+#endif
+
+/* share the extents of a range of data between two files, if the file system supports it */
+static NTSTATUS clone_file_range( int dst_fd, int src_fd, ULONGLONG src_pos, ULONGLONG dst_pos, ULONGLONG count )
+{
+    struct file_clone_range range;
+
+    range.src_fd      = src_fd;
+    range.src_offset  = src_pos;
+    range.src_length  = count;
+    range.dest_offset = dst_pos;
+    if (!ioctl( dst_fd, FICLONERANGE, &range )) return STATUS_SUCCESS;
+    TRACE( "FICLONERANGE failed: %s\n", strerror( errno ));
+    switch (errno)
+    {
+    case EOPNOTSUPP:
+    case EXDEV:
+    case EINVAL:
+    case ENOTTY:
+    case ENOSYS:
+        return STATUS_INVALID_DEVICE_REQUEST;
+    default:
+        return errno_to_status( errno );
+    }
+}
+
+/* copy a range of data between two files in the kernel, with copy_file_range() or sendfile() */
+static NTSTATUS copy_file_range_data( int dst_fd, int src_fd, ULONGLONG src_pos, ULONGLONG dst_pos,
+                                      ULONGLONG count )
+{
+    off_t src_off = src_pos, dst_off = dst_pos, cur_pos;
+    ssize_t ret;
+
+#ifdef __NR_copy_file_range
+    while (count)
+    {
+        ret = syscall( __NR_copy_file_range, src_fd, &src_off, dst_fd, &dst_off,
+                       (size_t)min( count, 0x40000000 ), 0 );
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            if (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP) break;
+            return errno_to_status( errno );
+        }
+        if (!ret) return STATUS_END_OF_FILE;
+        count -= ret;
+    }
+    if (!count) return STATUS_SUCCESS;
+    TRACE( "copy_file_range failed (%s), using sendfile\n", strerror( errno ));
+#endif
+
+    /* sendfile() writes at the current position of the destination file, restore it afterwards */
+    if ((cur_pos = lseek( dst_fd, 0, SEEK_CUR )) == -1) return errno_to_status( errno );
+    if (lseek( dst_fd, dst_off, SEEK_SET ) == -1) return errno_to_status( errno );
+    while (count)
+    {
+        ret = sendfile( dst_fd, src_fd, &src_off, (size_t)min( count, 0x40000000 ));
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (!ret)
+        {
+            errno = 0;
+            break;
+        }
+        count -= ret;
+    }
+    ret = errno;
+    lseek( dst_fd, cur_pos, SEEK_SET );
+    if (!count) return STATUS_SUCCESS;
+    if (!ret) return STATUS_END_OF_FILE;
+    if (ret == EINVAL || ret == ENOSYS) return STATUS_INVALID_DEVICE_REQUEST;
+    return errno_to_status( ret );
+}
+
+#else  /* __linux__ */
+
+static NTSTATUS clone_file_range( int dst_fd, int src_fd, ULONGLONG src_pos, ULONGLONG dst_pos, ULONGLONG count )
+{
+    return STATUS_INVALID_DEVICE_REQUEST;
+}
+
+static NTSTATUS copy_file_range_data( int dst_fd, int src_fd, ULONGLONG src_pos, ULONGLONG dst_pos,
+                                      ULONGLONG count )
+{
+    return STATUS_INVALID_DEVICE_REQUEST;
+}
+
+#endif  /* __linux__ */
+
+/* FSCTL_DUPLICATE_EXTENTS_TO_FILE: share file data between two files, without copying it
+ * like Windows, this only works when the file system supports it, and doesn't extend the target */
+static NTSTATUS duplicate_extents( HANDLE handle, const DUPLICATE_EXTENTS_DATA *data, ULONG size )
+{
+    int src_fd, dst_fd, src_needs_close, dst_needs_close;
+    enum server_fd_type type;
+    NTSTATUS status;
+    struct stat st;
+
+    if (!data || size < sizeof(*data)) return STATUS_INVALID_PARAMETER;
+    if (data->SourceFileOffset.QuadPart < 0 || data->TargetFileOffset.QuadPart < 0 ||
+        data->ByteCount.QuadPart < 0)
+        return STATUS_INVALID_PARAMETER;
+
+    if ((status = server_get_unix_fd( handle, FILE_WRITE_DATA, &dst_fd, &dst_needs_close, &type, NULL )))
+        return status;
+    if (type != FD_TYPE_FILE) status = STATUS_INVALID_DEVICE_REQUEST;
+    else if (!(status = server_get_unix_fd( data->FileHandle, FILE_READ_DATA, &src_fd, &src_needs_close,
+                                            &type, NULL )))
+    {
+        if (type != FD_TYPE_FILE) status = STATUS_INVALID_DEVICE_REQUEST;
+        else if (fstat( dst_fd, &st ) == -1) status = errno_to_status( errno );
+        else if (data->ByteCount.QuadPart > st.st_size - data->TargetFileOffset.QuadPart)
+            status = STATUS_INVALID_PARAMETER;
+        else if (data->ByteCount.QuadPart)
+            status = clone_file_range( dst_fd, src_fd, data->SourceFileOffset.QuadPart,
+                                       data->TargetFileOffset.QuadPart, data->ByteCount.QuadPart );
+        if (src_needs_close) close( src_fd );
+    }
+    if (dst_needs_close) close( dst_fd );
+    return status;
+}
+
+/* FSCTL_WINE_COPY_FILE_RANGE: copy file data between two files without going through client buffers */
+static NTSTATUS copy_file_range_fsctl( HANDLE handle, const struct wine_copy_file_range *data, ULONG size )
+{
+    int src_fd, dst_fd, src_needs_close, dst_needs_close;
+    enum server_fd_type type;
+    NTSTATUS status;
+
+    if (!data || size < sizeof(*data)) return STATUS_INVALID_PARAMETER;
+    if ((LONGLONG)data->source_offset < 0 || (LONGLONG)data->target_offset < 0 ||
+        (LONGLONG)data->count < 0)
+        return STATUS_INVALID_PARAMETER;
+
+    if ((status = server_get_unix_fd( handle, FILE_WRITE_DATA, &dst_fd, &dst_needs_close, &type, NULL )))
+        return status;
+    if (type != FD_TYPE_FILE) status = STATUS_INVALID_DEVICE_REQUEST;
+    else if (!(status = server_get_unix_fd( ULongToHandle( data->source ), FILE_READ_DATA, &src_fd,
+                                            &src_needs_close, &type, NULL )))
+    {
+        if (type != FD_TYPE_FILE) status = STATUS_INVALID_DEVICE_REQUEST;
+        else if (data->count)
+            status = copy_file_range_data( dst_fd, src_fd, data->source_offset, data->target_offset,
+                                           data->count );
+        if (src_needs_close) close( src_fd );
+    }
+    if (dst_needs_close) close( dst_fd );
+    return status;
+}
+
+
 /* Tell Valgrind to ignore any holes in structs we will be passing to the
  * server */
 static void ignore_server_ioctl_struct_holes( ULONG code, const void *in_buffer, ULONG in_size )
@@ -6270,6 +7229,16 @@ NTSTATUS WINAPI NtFsControlFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE ap
         break;
     }
 
+    case FSCTL_DUPLICATE_EXTENTS_TO_FILE:
+        io->Information = 0;
+        status = duplicate_extents( handle, in_buffer, in_size );
+        break;
+
+    case FSCTL_WINE_COPY_FILE_RANGE:
+        io->Information = 0;
+        status = copy_file_range_fsctl( handle, in_buffer, in_size );
+        break;
+
     case FSCTL_SET_SPARSE:
         TRACE("FSCTL_SET_SPARSE: Ignoring request\n");
         io->Information = 0;
@@ -6349,21 +7318,27 @@ NTSTATUS WINAPI NtFlushBuffersFile( HANDLE handle, IO_STATUS_BLOCK *io )
 NTSTATUS WINAPI NtCancelIoFile( HANDLE handle, IO_STATUS_BLOCK *io_status )
 {
     unsigned int status;
+    BOOL found;
 
     TRACE( "%p %p\n", handle, io_status );
 
+    found = uring_cancel( handle, 0, TRUE );
+
     SERVER_START_REQ( cancel_async )
     {
         req->handle      = wine_server_obj_handle( handle );
         req->only_thread = TRUE;
-        if (!(status = wine_server_call( req )))
-        {
-            io_status->Status = status;
-            io_status->Information = 0;
-        }
+        status = wine_server_call( req );
     }
     SERVER_END_REQ;
 
+    if (status == STATUS_NOT_FOUND && found) status = STATUS_SUCCESS;
+    if (!status)
+    {
+        io_status->Status = status;
+        io_status->Information = 0;
+    }
+
     return status;
 }
 
@@ -6374,21 +7349,27 @@ NTSTATUS WINAPI NtCancelIoFile( HANDLE handle, IO_STATUS_BLOCK *io_status )
 NTSTATUS WINAPI NtCancelIoFileEx( HANDLE handle, IO_STATUS_BLOCK *io, IO_STATUS_BLOCK *io_status )
 {
     unsigned int status;
+    BOOL found;
 
     TRACE( "%p %p %p\n", handle, io, io_status );
 
+    found = uring_cancel( handle, wine_server_client_ptr( io ), FALSE );
+
     SERVER_START_REQ( cancel_async )
     {
         req->handle = wine_server_obj_handle( handle );
         req->iosb   = wine_server_client_ptr( io );
-        if (!(status = wine_server_call( req )))
-        {
-            io_status->Status = status;
-            io_status->Information = 0;
-        }
+        status = wine_server_call( req );
     }
     SERVER_END_REQ;
 
+    if (status == STATUS_NOT_FOUND && found) status = STATUS_SUCCESS;
+    if (!status)
+    {
+        io_status->Status = status;
+        io_status->Information = 0;
+    }
+
     return status;
 }
 
@@ -7305,23 +8286,17 @@ NTSTATUS WINAPI NtQueryObject( HANDLE handle, OBJECT_INFORMATION_CLASS info_clas
     case ObjectHandleFlagInformation:
     {
         OBJECT_HANDLE_FLAG_INFORMATION* p = ptr;
+        unsigned int flags;
 
         if (len < sizeof(*p)) return STATUS_INVALID_BUFFER_SIZE;
 
-        SERVER_START_REQ( set_handle_info )
+        status = server_get_handle_flags( handle, &flags );
+        if (status == STATUS_SUCCESS)
         {
-            req->handle = wine_server_obj_handle( handle );
-            req->flags  = 0;
-            req->mask   = 0;
-            status = wine_server_call( req );
-            if (status == STATUS_SUCCESS)
-            {
-                p->Inherit = (reply->old_flags & HANDLE_FLAG_INHERIT) != 0;
-                p->ProtectFromClose = (reply->old_flags & HANDLE_FLAG_PROTECT_FROM_CLOSE) != 0;
-                if (used_len) *used_len = sizeof(*p);
-            }
+            p->Inherit = (flags & HANDLE_FLAG_INHERIT) != 0;
+            p->ProtectFromClose = (flags & HANDLE_FLAG_PROTECT_FROM_CLOSE) != 0;
+            if (used_len) *used_len = sizeof(*p);
         }
-        SERVER_END_REQ;
         break;
     }
 
@@ -7349,18 +8324,13 @@ NTSTATUS WINAPI NtSetInformationObject( HANDLE handle, OBJECT_INFORMATION_CLASS
     case ObjectHandleFlagInformation:
     {
         OBJECT_HANDLE_FLAG_INFORMATION* p = ptr;
+        unsigned int flags = 0;
 
         if (len < sizeof(*p)) return STATUS_INVALID_BUFFER_SIZE;
 
-        SERVER_START_REQ( set_handle_info )
-        {
-            req->handle = wine_server_obj_handle( handle );
-            req->mask   = HANDLE_FLAG_INHERIT | HANDLE_FLAG_PROTECT_FROM_CLOSE;
-            if (p->Inherit) req->flags |= HANDLE_FLAG_INHERIT;
-            if (p->ProtectFromClose) req->flags |= HANDLE_FLAG_PROTECT_FROM_CLOSE;
-            status = wine_server_call( req );
-        }
-        SERVER_END_REQ;
+        if (p->Inherit) flags |= HANDLE_FLAG_INHERIT;
+        if (p->ProtectFromClose) flags |= HANDLE_FLAG_PROTECT_FROM_CLOSE;
+        status = server_set_handle_flags( handle, HANDLE_FLAG_INHERIT | HANDLE_FLAG_PROTECT_FROM_CLOSE, flags );
     break;
     }
 
@@ -27,6 +27,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <signal.h>
@@ -36,7 +37,11 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
+#ifdef HAVE_SYS_UN_H
+# include <sys/un.h>
+#endif
 #include <unistd.h>
 #include <dlfcn.h>
 #ifdef HAVE_PWD_H
@@ -115,6 +120,8 @@ void *pKiUserCallbackDispatcher = NULL;
 void *pLdrInitializeThunk = NULL;
 void *pRtlUserThreadStart = NULL;
 void *p__wine_ctrl_routine = NULL;
+void *p__wine_io_uring_thread = NULL;
+void *p__wine_sock_poll_thread = NULL;
 SYSTEM_DLL_INIT_BLOCK *pLdrSystemDllInitBlock = NULL;
 
 static void * const syscalls[] =
@@ -627,6 +634,395 @@ void start_server( BOOL debug )
 }
 
 
+#if defined(HAVE_SYS_UN_H) && defined(SCM_RIGHTS) && !defined(__APPLE__)
+
+/* The zygote is a Wine process that stops right after loading ntdll, and forks new processes
+ * on request. There is one per prefix and session, since children must be able to join the
+ * process group of the process that created them. The fork happens before anything reads
+ * the environment, so that every child sets up its address space and debug options itself;
+ * the children share the library addresses of the zygote though. */
+
+#define ZYGOTE_NAME "zygote-%04x-%x"
+#define ZYGOTE_FDS  5  /* server socket, stdin, stdout, stderr, current directory */
+
+struct zygote_request
+{
+    unsigned int size;    /* size of the strings following the request */
+    unsigned int argc;    /* number of arguments, the environment follows them */
+    int          detach;  /* start a new session */
+    pid_t        pgid;    /* process group to join otherwise */
+    mode_t       umask;   /* file creation mask */
+};
+
+static int use_zygote = -1;
+
+/***********************************************************************
+ *           start_zygote
+ *
+ * Bind the zygote socket and start a new zygote listening on it.
+ */
+static void start_zygote( const char *dir, const struct sockaddr_un *addr, int len, BOOL stale )
+{
+    static BOOL started;  /* we only try once */
+    char socket_env[64], *argv[3];
+    int i, fd, null_fd;
+    pid_t pid, wret;
+
+    if (started) return;
+    started = TRUE;
+
+    if ((fd = socket( AF_UNIX, SOCK_STREAM, 0 )) == -1) return;
+    if (stale) unlink( addr->sun_path );
+    if (bind( fd, (const struct sockaddr *)addr, len ) == -1 || listen( fd, 16 ) == -1)
+    {
+        close( fd );
+        return;
+    }
+
+    if (!(pid = fork()))  /* child */
+    {
+        if (!fork())  /* grandchild */
+        {
+            static char reserve_env[] = "WINEPRELOADRESERVE=0-0";
+
+            /* don't receive the terminal signals, and don't keep the files of the parent open */
+            setpgid( 0, 0 );
+            if ((null_fd = open( "/dev/null", O_RDWR )) != -1)
+            {
+                for (i = 0; i < 3; i++) dup2( null_fd, i );
+                if (null_fd > 2) close( null_fd );
+            }
+            for (i = sysconf( _SC_OPEN_MAX ) - 1; i > 2; i--) if (i != fd) close( i );
+            if (chdir( dir ) == -1) _exit(1);
+
+            snprintf( socket_env, sizeof(socket_env), "WINEZYGOTESOCKET=%u", fd );
+            putenv( socket_env );
+            putenv( reserve_env );
+            argv[0] = argv[1] = argv[2] = NULL;
+            loader_exec( argv, current_machine );
+            _exit(1);
+        }
+        _exit(0);
+    }
+
+    if (pid != -1)
+    {
+        do {
+            wret = waitpid( pid, NULL, 0 );
+        } while (wret < 0 && errno == EINTR);
+    }
+    close( fd );
+}
+
+
+/***********************************************************************
+ *           zygote_spawn
+ *
+ * Ask the zygote to fork a new process. Returns an error if the process
+ * needs to be started the normal way.
+ */
+NTSTATUS zygote_spawn( char **argv, int socketfd, int stdin_fd, int stdout_fd, int unixdir,
+                       BOOL detach, const char *winedebug, const pe_image_info_t *pe_info )
+{
+    static const char winedebugA[] = "WINEDEBUG=";
+    char cmsg_buffer[CMSG_SPACE( ZYGOTE_FDS * sizeof(int) )];
+    struct zygote_request *req;
+    struct sockaddr_un addr;
+    struct msghdr msghdr;
+    struct cmsghdr *cmsg;
+    struct iovec vec;
+    WORD machine = pe_info->machine;
+    int i, fd, len, null_fd = -1, cwd_fd = -1, fds[ZYGOTE_FDS], reply;
+    size_t size, pos, total;
+    const char *dir;
+    char *loader, *data, *p, **env;
+    ssize_t ret;
+    NTSTATUS status = STATUS_NOT_SUPPORTED;
+
+    if (use_zygote == -1)
+    {
+        const char *str = getenv( "WINEZYGOTE" );
+        use_zygote = str && atoi( str );
+    }
+    if (!use_zygote) return STATUS_NOT_SUPPORTED;
+
+    /* the zygote doesn't reserve the image range, and only runs the default loader */
+    if (!pe_info->wine_fakedll && (pe_info->image_charact & IMAGE_FILE_RELOCS_STRIPPED))
+        return STATUS_NOT_SUPPORTED;
+    if (pe_info->image_flags & IMAGE_FLAGS_ComPlusNativeReady) machine = native_machine;
+    if ((loader = get_alternate_wineloader( machine )))
+    {
+        free( loader );
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    if (!(dir = server_get_dir())) return STATUS_NOT_SUPPORTED;
+    addr.sun_family = AF_UNIX;
+    len = snprintf( addr.sun_path, sizeof(addr.sun_path), "%s/" ZYGOTE_NAME,
+                    dir, current_machine, (unsigned int)getsid( 0 ) );
+    if (len >= sizeof(addr.sun_path)) return STATUS_NOT_SUPPORTED;
+    len += sizeof(addr) - sizeof(addr.sun_path) + 1;
+#ifdef HAVE_STRUCT_SOCKADDR_UN_SUN_LEN
+    addr.sun_len = len;
+#endif
+
+    if ((fd = socket( AF_UNIX, SOCK_STREAM, 0 )) == -1) return STATUS_NOT_SUPPORTED;
+    fcntl( fd, F_SETFD, FD_CLOEXEC );
+    if (connect( fd, (struct sockaddr *)&addr, len ) == -1)
+    {
+        if (errno == ENOENT || errno == ECONNREFUSED)
+            start_zygote( dir, &addr, len, errno == ECONNREFUSED );
+        close( fd );
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    size = strlen( wineloader ) + 1;
+    for (i = 2; argv[i]; i++) size += strlen( argv[i] ) + 1;
+    for (env = environ; *env; env++)
+        if (!winedebug || strncmp( *env, winedebugA, strlen(winedebugA) )) size += strlen( *env ) + 1;
+    if (winedebug) size += strlen( winedebug ) + 1;
+
+    total = sizeof(*req) + size;
+    if (!(data = malloc( total ))) goto done;
+    req = (struct zygote_request *)data;
+    req->size   = size;
+    req->argc   = i - 2;
+    req->detach = detach;
+    req->pgid   = getpgrp();
+    req->umask  = start_umask;
+
+    p = data + sizeof(*req);
+    p += strlen( strcpy( p, wineloader ) ) + 1;
+    for (i = 2; argv[i]; i++) p += strlen( strcpy( p, argv[i] ) ) + 1;
+    for (env = environ; *env; env++)
+        if (!winedebug || strncmp( *env, winedebugA, strlen(winedebugA) )) p += strlen( strcpy( p, *env ) ) + 1;
+    if (winedebug) strcpy( p, winedebug );
+
+    if (stdin_fd == -1 || stdout_fd == -1 || fcntl( 2, F_GETFD ) == -1)
+        null_fd = open( "/dev/null", O_RDWR | O_CLOEXEC );
+    if (unixdir == -1 && (cwd_fd = open( ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC )) == -1) goto done;
+    fds[0] = socketfd;
+    fds[1] = stdin_fd != -1 ? stdin_fd : null_fd;
+    fds[2] = stdout_fd != -1 ? stdout_fd : null_fd;
+    fds[3] = fcntl( 2, F_GETFD ) != -1 ? 2 : null_fd;
+    fds[4] = unixdir != -1 ? unixdir : cwd_fd;
+    for (i = 0; i < ZYGOTE_FDS; i++) if (fds[i] == -1) goto done;
+
+    vec.iov_base = data;
+    vec.iov_len  = total;
+    msghdr.msg_name       = NULL;
+    msghdr.msg_namelen    = 0;
+    msghdr.msg_iov        = &vec;
+    msghdr.msg_iovlen     = 1;
+    msghdr.msg_control    = cmsg_buffer;
+    msghdr.msg_controllen = sizeof(cmsg_buffer);
+    msghdr.msg_flags      = 0;
+    cmsg = CMSG_FIRSTHDR( &msghdr );
+    cmsg->cmsg_len   = CMSG_LEN( sizeof(fds) );
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    memcpy( CMSG_DATA(cmsg), fds, sizeof(fds) );
+    msghdr.msg_controllen = cmsg->cmsg_len;
+
+    while ((ret = sendmsg( fd, &msghdr, 0 )) == -1 && errno == EINTR);
+    if (ret == -1) goto done;
+    for (pos = ret; pos < total; pos += ret)
+    {
+        while ((ret = write( fd, data + pos, total - pos )) == -1 && errno == EINTR);
+        if (ret <= 0) goto done;
+    }
+
+    /* once the zygote got the whole request it may have forked the process, so from now
+     * on failures are reported by the server when the process socket gets closed */
+    status = STATUS_SUCCESS;
+    while ((ret = read( fd, &reply, sizeof(reply) )) == -1 && errno == EINTR);
+    if (ret == sizeof(reply) && reply < 0) status = STATUS_NOT_SUPPORTED;  /* nothing was forked */
+
+done:
+    if (null_fd != -1) close( null_fd );
+    if (cwd_fd != -1) close( cwd_fd );
+    free( data );
+    close( fd );
+    return status;
+}
+
+
+/***********************************************************************
+ *           zygote_server_running
+ *
+ * Check whether the server holds the lock of its directory.
+ */
+static BOOL zygote_server_running(void)
+{
+    struct flock fl;
+    BOOL ret;
+    int fd;
+
+    if ((fd = open( "lock", O_WRONLY )) == -1) return FALSE;
+    fl.l_type   = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start  = 0;
+    fl.l_len    = 1;
+    ret = fcntl( fd, F_GETLK, &fl ) != -1 && fl.l_type == F_WRLCK;
+    close( fd );
+    return ret;
+}
+
+
+/***********************************************************************
+ *           zygote_fork
+ *
+ * Handle a request on a zygote connection. Returns TRUE in the new process.
+ */
+static BOOL zygote_fork( int fd, int listen_fd )
+{
+    static char socket_env[64];
+    char cmsg_buffer[CMSG_SPACE( ZYGOTE_FDS * sizeof(int) )];
+    struct zygote_request req;
+    struct msghdr msghdr;
+    struct cmsghdr *cmsg;
+    struct iovec vec;
+    int i, count = 0, fds[ZYGOTE_FDS], reply = -EINVAL;
+    unsigned int nb_strings = 0;
+    char *data = NULL, *p, **args = NULL, **env;
+    ssize_t ret;
+    pid_t pid;
+
+    vec.iov_base = &req;
+    vec.iov_len  = sizeof(req);
+    msghdr.msg_name       = NULL;
+    msghdr.msg_namelen    = 0;
+    msghdr.msg_iov        = &vec;
+    msghdr.msg_iovlen     = 1;
+    msghdr.msg_control    = cmsg_buffer;
+    msghdr.msg_controllen = sizeof(cmsg_buffer);
+    msghdr.msg_flags      = 0;
+
+    while ((ret = recvmsg( fd, &msghdr, MSG_WAITALL )) == -1 && errno == EINTR);
+    for (cmsg = CMSG_FIRSTHDR( &msghdr ); ret != -1 && cmsg; cmsg = CMSG_NXTHDR( &msghdr, cmsg ))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        count = min( (cmsg->cmsg_len - CMSG_LEN( 0 )) / sizeof(int), ZYGOTE_FDS );
+        memcpy( fds, CMSG_DATA(cmsg), count * sizeof(int) );
+    }
+    if (ret != sizeof(req) || count != ZYGOTE_FDS || !req.size) goto done;
+
+    if (!(data = malloc( req.size ))) goto done;
+    while ((ret = recv( fd, data, req.size, MSG_WAITALL )) == -1 && errno == EINTR);
+    if (ret != req.size || data[req.size - 1]) goto done;
+
+    /* refuse requests from a different Wine installation */
+    if (strcmp( data, wineloader )) goto done;
+    for (p = data; p < data + req.size; p += strlen(p) + 1) nb_strings++;
+    if (req.argc >= nb_strings) goto done;
+    if (!(args = malloc( (nb_strings + 2) * sizeof(*args) ))) goto done;
+
+    /* arguments and environment share the array, both preceded by the loader */
+    for (i = 0, p = data; i < nb_strings; i++, p += strlen(p) + 1) args[i] = p;
+    args[i] = NULL;
+    env = args + req.argc + 1;
+    memmove( env + 1, env, (nb_strings - req.argc) * sizeof(*args) );
+    *env++ = NULL;
+
+    if (!(pid = fork()))  /* child */
+    {
+        close( listen_fd );
+        close( fd );
+        signal( SIGCHLD, SIG_DFL );
+        signal( SIGPIPE, SIG_DFL );
+        if (req.detach) setsid();
+        else setpgid( 0, req.pgid );
+        for (i = 0; i < 3; i++)
+        {
+            dup2( fds[i + 1], i );
+            close( fds[i + 1] );
+        }
+        fchdir( fds[4] );
+        close( fds[4] );
+        umask( req.umask );
+
+        environ = env;
+        snprintf( socket_env, sizeof(socket_env), "WINESERVERSOCKET=%u", fds[0] );
+        putenv( socket_env );
+        /* the preloader of the zygote didn't reserve the range of the parent image */
+        unsetenv( "WINEPRELOADRESERVE" );
+        main_argc = req.argc + 1;
+        main_argv = args;
+        main_envp = environ;
+
+        set_dll_path();
+        set_home_dir();
+        set_config_dir();
+        return TRUE;
+    }
+    reply = pid == -1 ? -errno : pid;
+
+done:
+    write( fd, &reply, sizeof(reply) );
+    for (i = 0; i < count; i++) close( fds[i] );
+    free( args );
+    free( data );
+    return FALSE;
+}
+
+
+/***********************************************************************
+ *           zygote_main
+ *
+ * Run as a zygote if we have been started as one. Returns only in the forked processes.
+ */
+static void zygote_main(void)
+{
+    const char *env = getenv( "WINEZYGOTESOCKET" );
+    struct pollfd pfd;
+    struct stat st;
+    char name[64];
+    int fd, ret;
+    ino_t ino;
+
+    if (!env) return;
+    pfd.fd = atoi( env );
+    pfd.events = POLLIN;
+    unsetenv( "WINEZYGOTESOCKET" );
+    fcntl( pfd.fd, F_SETFD, FD_CLOEXEC );
+    signal( SIGCHLD, SIG_IGN );  /* let the system reap our children */
+    signal( SIGPIPE, SIG_IGN );
+
+    snprintf( name, sizeof(name), ZYGOTE_NAME, current_machine, (unsigned int)getsid( 0 ) );
+    if (lstat( name, &st ) == -1) exit(1);
+    ino = st.st_ino;
+
+    for (;;)
+    {
+        if ((ret = poll( &pfd, 1, 10000 )) <= 0)
+        {
+            /* exit once the server is gone, or if another zygote replaced us */
+            if (!ret && (!zygote_server_running() || lstat( name, &st ) == -1 || st.st_ino != ino)) break;
+            continue;
+        }
+        if ((fd = accept( pfd.fd, NULL, NULL )) == -1) continue;
+        if (zygote_fork( fd, pfd.fd )) return;
+        close( fd );
+    }
+    if (!lstat( name, &st ) && st.st_ino == ino) unlink( name );
+    exit(0);
+}
+
+#else  /* HAVE_SYS_UN_H && SCM_RIGHTS && !__APPLE__ */
+
+NTSTATUS zygote_spawn( char **argv, int socketfd, int stdin_fd, int stdout_fd, int unixdir,
+                       BOOL detach, const char *winedebug, const pe_image_info_t *pe_info )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+static void zygote_main(void)
+{
+}
+
+#endif  /* HAVE_SYS_UN_H && SCM_RIGHTS && !__APPLE__ */
+
+
 /***********************************************************************
  *           KeAddSystemServiceTable
  */
@@ -975,6 +1371,163 @@ static NTSTATUS load_so_dll( void *args )
 }
 
 
+/* cache of resolved import address tables, shared by the processes of a prefix */
+
+struct import_cache_record
+{
+    ULONGLONG    key[2];    /* identifies the imports and the module they resolve to */
+    unsigned int count;     /* number of ULONG_PTR values following the record */
+    unsigned int checksum;  /* checksum of the key and values, to detect incomplete writes */
+};
+
+#define IMPORT_CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+static pthread_mutex_t import_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int import_cache_enabled = -1;
+static char *import_cache_path;
+static const struct import_cache_record **import_cache_index;  /* hash table of the cached records */
+static unsigned int import_cache_mask;
+
+static unsigned int import_cache_checksum( const struct import_cache_record *record, const ULONG_PTR *values )
+{
+    const unsigned char *ptr = (const unsigned char *)record->key;
+    unsigned int i, sum = record->count;
+
+    for (i = 0; i < sizeof(record->key); i++) sum = sum * 65599 + ptr[i];
+    ptr = (const unsigned char *)values;
+    for (i = 0; i < record->count * sizeof(*values); i++) sum = sum * 65599 + ptr[i];
+    return sum;
+}
+
+/***********************************************************************
+ *           init_import_cache
+ *
+ * Map the cache file and index its records. The import_cache_mutex must be held.
+ */
+static BOOL init_import_cache(void)
+{
+    const struct import_cache_record *record, **index;
+    const char *dir, *env = getenv( "WINEIMPORTCACHE" );
+    unsigned int count = 0, size;
+    const char *data, *end, *ptr;
+    struct stat st;
+    int fd;
+
+    if (import_cache_enabled != -1) return import_cache_enabled;
+    import_cache_enabled = FALSE;
+    if (!env || !atoi( env ) || !(dir = server_get_dir())) return FALSE;
+    if (asprintf( &import_cache_path, "%s/importcache-%04x", dir, current_machine ) == -1) return FALSE;
+    import_cache_enabled = TRUE;
+
+    if ((fd = open( import_cache_path, O_RDONLY | O_CLOEXEC )) == -1) return TRUE;
+    if (fstat( fd, &st ) == -1 || !st.st_size || st.st_size > IMPORT_CACHE_MAX_SIZE ||
+        (data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 )) == MAP_FAILED)
+    {
+        close( fd );
+        return TRUE;
+    }
+    close( fd );
+    end = data + st.st_size;
+
+    /* the file only grows, so the mapping remains valid; stop at the first incomplete record */
+    for (ptr = data; ptr + sizeof(*record) <= end; count++)
+    {
+        record = (const struct import_cache_record *)ptr;
+        if (record->count > (end - ptr - sizeof(*record)) / sizeof(ULONG_PTR)) break;
+        if (record->checksum != import_cache_checksum( record, (const ULONG_PTR *)(record + 1) )) break;
+        ptr += sizeof(*record) + record->count * sizeof(ULONG_PTR);
+    }
+    if (!count) return TRUE;
+
+    for (size = 16; size < 2 * count; size *= 2) ;
+    if (!(index = calloc( size, sizeof(*index) ))) return TRUE;
+    for (ptr = data; count--; ptr += sizeof(*record) + record->count * sizeof(ULONG_PTR))
+    {
+        unsigned int pos;
+
+        record = (const struct import_cache_record *)ptr;
+        for (pos = record->key[0]; index[pos & (size - 1)]; pos++)
+            if (!memcmp( index[pos & (size - 1)]->key, record->key, sizeof(record->key) )) break;
+        if (!index[pos & (size - 1)]) index[pos & (size - 1)] = record;
+    }
+    import_cache_index = index;
+    import_cache_mask = size - 1;
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           get_import_cache
+ */
+static NTSTATUS get_import_cache( void *args )
+{
+    struct import_cache_params *params = args;
+    const struct import_cache_record *record;
+    NTSTATUS status = STATUS_NOT_FOUND;
+    unsigned int pos;
+
+    mutex_lock( &import_cache_mutex );
+    if (!init_import_cache()) status = STATUS_NOT_SUPPORTED;
+    else if (import_cache_index)
+    {
+        for (pos = params->key[0]; (record = import_cache_index[pos & import_cache_mask]); pos++)
+        {
+            if (memcmp( record->key, params->key, sizeof(record->key) )) continue;
+            if (record->count == params->count)
+            {
+                memcpy( params->values, record + 1, record->count * sizeof(ULONG_PTR) );
+                status = STATUS_SUCCESS;
+            }
+            break;
+        }
+    }
+    mutex_unlock( &import_cache_mutex );
+    return status;
+}
+
+
+/***********************************************************************
+ *           set_import_cache
+ */
+static NTSTATUS set_import_cache( void *args )
+{
+    struct import_cache_params *params = args;
+    struct import_cache_record *record;
+    NTSTATUS status = STATUS_SUCCESS;
+    size_t size = sizeof(*record) + params->count * sizeof(ULONG_PTR);
+    struct stat st;
+    int fd;
+
+    mutex_lock( &import_cache_mutex );
+    if (!init_import_cache()) status = STATUS_NOT_SUPPORTED;
+    else if ((record = malloc( size )))
+    {
+        memcpy( record->key, params->key, sizeof(record->key) );
+        record->count = params->count;
+        memcpy( record + 1, params->values, params->count * sizeof(ULONG_PTR) );
+        record->checksum = import_cache_checksum( record, params->values );
+
+        if ((fd = open( import_cache_path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600 )) != -1)
+        {
+            /* start over once stale records have accumulated, processes keep their mapping */
+            if (!fstat( fd, &st ) && st.st_size + size > IMPORT_CACHE_MAX_SIZE)
+            {
+                close( fd );
+                unlink( import_cache_path );
+                fd = open( import_cache_path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600 );
+            }
+            /* a single append, other processes discard it if it's incomplete */
+            if (fd != -1 && write( fd, record, size ) != size) status = STATUS_UNSUCCESSFUL;
+            if (fd != -1) close( fd );
+        }
+        free( record );
+    }
+    else status = STATUS_NO_MEMORY;
+    mutex_unlock( &import_cache_mutex );
+    return status;
+}
+
+
 static const unixlib_entry_t unix_call_funcs[] =
 {
     load_so_dll,
@@ -985,6 +1538,10 @@ static const unixlib_entry_t unix_call_funcs[] =
     unixcall_wine_server_handle_to_fd,
     unixcall_wine_spawnvp,
     system_time_precise,
+    io_uring_thread,
+    sock_poll_thread,
+    get_import_cache,
+    set_import_cache,
 };
 
 
@@ -992,6 +1549,7 @@ static const unixlib_entry_t unix_call_funcs[] =
 
 static NTSTATUS wow64_load_so_dll( void *args ) { return STATUS_INVALID_IMAGE_FORMAT; }
 static NTSTATUS wow64_unwind_builtin_dll( void *args ) { return STATUS_UNSUCCESSFUL; }
+static NTSTATUS wow64_import_cache( void *args ) { return STATUS_NOT_SUPPORTED; }
 
 const unixlib_entry_t unix_call_wow64_funcs[] =
 {
@@ -1003,6 +1561,10 @@ const unixlib_entry_t unix_call_wow64_funcs[] =
     wow64_wine_server_handle_to_fd,
     wow64_wine_spawnvp,
     system_time_precise,
+    io_uring_thread,
+    sock_poll_thread,
+    wow64_import_cache,
+    wow64_import_cache,
 };
 
 #endif  /* _WIN64 */
@@ -1542,6 +2104,8 @@ static void load_ntdll_functions( HMODULE module )
     GET_FUNC( LdrSystemDllInitBlock );
     GET_FUNC( RtlUserThreadStart );
     GET_FUNC( __wine_ctrl_routine );
+    GET_FUNC( __wine_io_uring_thread );
+    GET_FUNC( __wine_sock_poll_thread );
     GET_FUNC( __wine_syscall_dispatcher );
     GET_FUNC( __wine_unix_call_dispatcher );
     GET_FUNC( __wine_unixlib_handle );
@@ -1586,6 +2150,8 @@ static void load_ntdll_wow64_functions( HMODULE module )
 #undef GET_FUNC
 
     p__wine_ctrl_routine = (void *)find_named_export( module, exports, "__wine_ctrl_routine" );
+    p__wine_io_uring_thread = (void *)find_named_export( module, exports, "__wine_io_uring_thread" );
+    p__wine_sock_poll_thread = (void *)find_named_export( module, exports, "__wine_sock_poll_thread" );
 
 #ifdef _WIN64
     {
@@ -2172,6 +2738,7 @@ DECLSPEC_EXPORT void __wine_main( int argc, char *argv[], char *envp[] )
     set_max_limit( RLIMIT_AS );
 #endif
 
+    zygote_main();
     virtual_init();
     init_environment();
 
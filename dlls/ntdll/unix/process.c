@@ -81,15 +81,19 @@ static UINT process_error_mode;
 
 static char **build_argv( const UNICODE_STRING *cmdline, int reserved )
 {
-    char **argv, *arg, *src, *dst;
+    char **argv, *arg, *src, *dst, *buffer;
     int argc, in_quotes = 0, bcount = 0, len = cmdline->Length / sizeof(WCHAR);
 
-    if (!(src = malloc( len * 3 + 1 ))) return NULL;
+    if (!(src = buffer = malloc( len * 3 + 1 ))) return NULL;
     len = ntdll_wcstoumbs( cmdline->Buffer, len, src, len * 3, FALSE );
     src[len++] = 0;
 
     argc = reserved + 2 + len / 2;
-    argv = malloc( argc * sizeof(*argv) + len );
+    if (!(argv = malloc( argc * sizeof(*argv) + len )))
+    {
+        free( buffer );
+        return NULL;
+    }
     arg = dst = (char *)(argv + argc);
     argc = reserved;
     while (*src)
@@ -142,6 +146,7 @@ static char **build_argv( const UNICODE_STRING *cmdline, int reserved )
     *dst = 0;
     argv[argc++] = arg;
     argv[argc] = NULL;
+    free( buffer );
     return argv;
 }
 
@@ -428,6 +433,7 @@ static NTSTATUS spawn_process( const RTL_USER_PROCESS_PARAMETERS *params, int so
 {
     NTSTATUS status = STATUS_SUCCESS;
     int stdin_fd = -1, stdout_fd = -1;
+    BOOL detach;
     pid_t pid;
     char **argv;
 
@@ -439,14 +445,25 @@ static NTSTATUS spawn_process( const RTL_USER_PROCESS_PARAMETERS *params, int so
         isatty(1) && is_unix_console_handle( params->hStdOutput ))
         stdout_fd = 1;
 
+    detach = ((peb->ProcessParameters && params->ProcessGroupId != peb->ProcessParameters->ProcessGroupId) ||
+              params->ConsoleHandle == CONSOLE_HANDLE_ALLOC ||
+              params->ConsoleHandle == CONSOLE_HANDLE_ALLOC_NO_WINDOW ||
+              params->ConsoleHandle == NULL);
+
+    if (!(argv = build_argv( &params->CommandLine, 2 )))
+    {
+        status = STATUS_NO_MEMORY;
+        goto done;
+    }
+    if (!zygote_spawn( argv, socketfd, detach ? -1 : stdin_fd, detach ? -1 : stdout_fd,
+                       unixdir, detach, winedebug, pe_info ))
+        goto done;
+
     if (!(pid = fork()))  /* child */
     {
         if (!(pid = fork()))  /* grandchild */
         {
-            if ((peb->ProcessParameters && params->ProcessGroupId != peb->ProcessParameters->ProcessGroupId) ||
-                params->ConsoleHandle == CONSOLE_HANDLE_ALLOC ||
-                params->ConsoleHandle == CONSOLE_HANDLE_ALLOC_NO_WINDOW ||
-                params->ConsoleHandle == NULL)
+            if (detach)
             {
                 setsid();
                 set_stdio_fd( -1, -1 );  /* close stdin and stdout */
@@ -462,7 +479,6 @@ static NTSTATUS spawn_process( const RTL_USER_PROCESS_PARAMETERS *params, int so
                 fchdir( unixdir );
                 close( unixdir );
             }
-            argv = build_argv( &params->CommandLine, 2 );
 
             exec_wineloader( argv, socketfd, pe_info );
             _exit(1);
@@ -481,6 +497,8 @@ static NTSTATUS spawn_process( const RTL_USER_PROCESS_PARAMETERS *params, int so
     }
     else status = STATUS_NO_MEMORY;
 
+done:
+    free( argv );
     if (stdin_fd != -1 && stdin_fd != 0) close( stdin_fd );
     if (stdout_fd != -1 && stdout_fd != 1) close( stdout_fd );
     return status;
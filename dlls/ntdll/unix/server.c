@@ -179,6 +179,8 @@ static DECLSPEC_NORETURN void server_protocol_perror( const char *err )
  *           send_request
  *
  * Send a request to the server.
+ * The request pipe also wakes up the server, which waits for all its clients
+ * in a single poll loop; a shared memory ring would still need a write to it.
  */
 static unsigned int send_request( const struct __server_request_info *req )
 {
@@ -1108,6 +1110,77 @@ static int remove_fd_from_cache( HANDLE handle )
 }
 
 
+/***********************************************************************/
+/* handle information cache support */
+
+union handle_info_cache_entry
+{
+    LONG64 data;
+    struct
+    {
+        unsigned int access;            /* granted access rights */
+        unsigned int options : 24;      /* file open options */
+        unsigned int flags : 2;         /* handle flags (HANDLE_FLAG_*) */
+        unsigned int file_info : 1;     /* generic file information can be queried in-process */
+        unsigned int cached : 1;        /* access, options and file_info are valid */
+        unsigned int flags_cached : 1;  /* flags are valid */
+    } s;
+};
+
+C_ASSERT( sizeof(union handle_info_cache_entry) == sizeof(LONG64) );
+
+/* the handle information uses the same indexing as the fd cache */
+static union handle_info_cache_entry *handle_info_cache[FD_CACHE_ENTRIES];
+
+
+/***********************************************************************
+ *           get_cached_handle_info
+ */
+static inline BOOL get_cached_handle_info( HANDLE handle, union handle_info_cache_entry *info )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry >= FD_CACHE_ENTRIES || !handle_info_cache[entry]) return FALSE;
+
+    info->data = InterlockedCompareExchange64( &handle_info_cache[entry][idx].data, 0, 0 );
+    return info->s.cached || info->s.flags_cached;
+}
+
+
+/***********************************************************************
+ *           set_cached_handle_info
+ *
+ * Caller must hold fd_cache_mutex.
+ */
+static void set_cached_handle_info( HANDLE handle, union handle_info_cache_entry info )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry >= FD_CACHE_ENTRIES) return;
+
+    if (!handle_info_cache[entry])  /* do we need to allocate a new block of entries? */
+    {
+        void *ptr = anon_mmap_alloc( FD_CACHE_BLOCK_SIZE * sizeof(union handle_info_cache_entry),
+                                     PROT_READ | PROT_WRITE );
+        if (ptr == MAP_FAILED) return;
+        handle_info_cache[entry] = ptr;
+    }
+    interlocked_xchg64( &handle_info_cache[entry][idx].data, info.data );
+}
+
+
+/***********************************************************************
+ *           remove_handle_info_from_cache
+ */
+static void remove_handle_info_from_cache( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry < FD_CACHE_ENTRIES && handle_info_cache[entry])
+        interlocked_xchg64( &handle_info_cache[entry][idx].data, 0 );
+}
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
@@ -1146,6 +1219,18 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
                     *needs_close = (!reply->cacheable ||
                                     !add_fd_to_cache( handle, fd, reply->type,
                                                       reply->access, reply->options ));
+                    if (!*needs_close)
+                    {
+                        union handle_info_cache_entry info;
+
+                        info.data = 0;
+                        info.s.access = reply->access;
+                        info.s.options = reply->options;
+                        info.s.flags = reply->handle_flags;
+                        info.s.file_info = !!reply->file_info;
+                        info.s.cached = info.s.flags_cached = 1;
+                        set_cached_handle_info( handle, info );
+                    }
                 }
                 else ret = STATUS_TOO_MANY_OPENED_FILES;
             }
@@ -1169,6 +1254,359 @@ done:
 }
 
 
+/***********************************************************************
+ *           server_remove_cached_fd
+ *
+ * Forget the cached unix fd of a handle whose server-side fd may have changed.
+ */
+void server_remove_cached_fd( HANDLE handle )
+{
+    sigset_t sigset;
+    int fd;
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    fd = remove_fd_from_cache( handle );
+    remove_handle_info_from_cache( handle );
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    if (fd != -1) close( fd );
+}
+
+
+/***********************************************************************
+ *           server_get_cached_fd_status
+ *
+ * Return the cached error status of server_get_unix_fd for a handle that
+ * has no unix fd, without calling the server; STATUS_SUCCESS if unknown.
+ */
+unsigned int server_get_cached_fd_status( HANDLE handle )
+{
+    unsigned int ret;
+    int fd;
+
+    ret = get_cached_fd( handle, &fd, NULL, NULL, NULL );
+    return ret == STATUS_INVALID_HANDLE ? STATUS_SUCCESS : ret;
+}
+
+
+/***********************************************************************
+ *           server_get_file_access_mode
+ *
+ * Return the granted access and the open options of a file handle for the
+ * generic file information classes, without calling the server once the
+ * handle is cached. Return FALSE if the server has to be asked instead.
+ */
+BOOL server_get_file_access_mode( HANDLE handle, unsigned int *access, unsigned int *options )
+{
+    union handle_info_cache_entry info;
+    int fd, needs_close;
+
+    if (!get_cached_handle_info( handle, &info ) || !info.s.cached)
+    {
+        /* this also fills the cache */
+        if (server_get_unix_fd( handle, 0, &fd, &needs_close, NULL, NULL )) return FALSE;
+        if (needs_close) close( fd );
+        if (!get_cached_handle_info( handle, &info ) || !info.s.cached) return FALSE;
+    }
+    if (!info.s.file_info) return FALSE;
+    *access = info.s.access;
+    *options = info.s.options;
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           server_get_handle_flags
+ *
+ * Return the HANDLE_FLAG_* flags of a handle.
+ */
+unsigned int server_get_handle_flags( HANDLE handle, unsigned int *flags )
+{
+    union handle_info_cache_entry info;
+    unsigned int ret;
+    sigset_t sigset;
+
+    if (get_cached_handle_info( handle, &info ) && info.s.flags_cached)
+    {
+        *flags = info.s.flags;
+        return STATUS_SUCCESS;
+    }
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    SERVER_START_REQ( set_handle_info )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        req->flags  = 0;
+        req->mask   = 0;
+        if (!(ret = wine_server_call( req )))
+        {
+            *flags = reply->old_flags;
+            if (HandleToLong( handle ) >= 0)  /* not a pseudo-handle */
+            {
+                if (!get_cached_handle_info( handle, &info )) info.data = 0;
+                info.s.flags = reply->old_flags;
+                info.s.flags_cached = 1;
+                set_cached_handle_info( handle, info );
+            }
+        }
+    }
+    SERVER_END_REQ;
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    return ret;
+}
+
+
+/***********************************************************************
+ *           server_set_handle_flags
+ *
+ * Change the HANDLE_FLAG_* flags of a handle.
+ */
+unsigned int server_set_handle_flags( HANDLE handle, unsigned int mask, unsigned int flags )
+{
+    union handle_info_cache_entry info;
+    unsigned int ret;
+    sigset_t sigset;
+
+    /* the cache is updated under the mutex so that concurrent changes are stored in server order */
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    SERVER_START_REQ( set_handle_info )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        req->flags  = flags;
+        req->mask   = mask;
+        if (!(ret = wine_server_call( req )) && get_cached_handle_info( handle, &info ) &&
+            info.s.flags_cached)
+        {
+            info.s.flags = (reply->old_flags & ~mask) | (flags & mask);
+            set_cached_handle_info( handle, info );
+        }
+    }
+    SERVER_END_REQ;
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    return ret;
+}
+
+
+/***********************************************************************/
+/* in-process synchronization support */
+
+union inproc_sync_cache_entry
+{
+    LONG64 data;
+    struct
+    {
+        unsigned int index : 24;  /* index of the object state, 0 if the object has none */
+        unsigned int access : 7;  /* handle access rights, see inproc_sync_cache_access() */
+        unsigned int cached : 1;  /* entry is valid */
+        unsigned int serial;      /* serial number of the object state */
+    } s;
+};
+
+C_ASSERT( sizeof(union inproc_sync_cache_entry) == sizeof(LONG64) );
+
+#define INPROC_SYNC_CACHE_BLOCK_SIZE  (65536 / sizeof(union inproc_sync_cache_entry))
+#define INPROC_SYNC_CACHE_ENTRIES     128
+
+static union inproc_sync_cache_entry *inproc_sync_cache[INPROC_SYNC_CACHE_ENTRIES];
+static inproc_sync_t *inproc_sync_shm;
+static SIZE_T inproc_sync_shm_size;
+static BOOL inproc_sync_disabled;
+
+/* only the specific rights used by the in-process operations, and SYNCHRONIZE, are cached */
+#define INPROC_SYNC_CACHE_RIGHTS 0x3f
+#define INPROC_SYNC_CACHE_SYNCHRONIZE 0x40
+
+static inline unsigned int inproc_sync_cache_access( unsigned int access )
+{
+    return (access & INPROC_SYNC_CACHE_RIGHTS) | (access & SYNCHRONIZE ? INPROC_SYNC_CACHE_SYNCHRONIZE : 0);
+}
+
+static inline unsigned int inproc_sync_handle_access( unsigned int cached )
+{
+    return (cached & INPROC_SYNC_CACHE_RIGHTS) | (cached & INPROC_SYNC_CACHE_SYNCHRONIZE ? SYNCHRONIZE : 0);
+}
+
+/***********************************************************************
+ *           init_inproc_sync
+ *
+ * Map the shared memory holding the state of in-process synchronization objects.
+ * Caller must hold fd_cache_mutex.
+ */
+static BOOL init_inproc_sync(void)
+{
+    obj_handle_t fd_handle;
+    unsigned int ret;
+    void *ptr;
+    int fd = -1;
+
+    if (inproc_sync_shm) return TRUE;
+    if (inproc_sync_disabled) return FALSE;
+
+    SERVER_START_REQ( get_inproc_sync_shm )
+    {
+        if (!(ret = wine_server_call( req )))
+        {
+            inproc_sync_shm_size = reply->size;
+            fd = receive_fd( &fd_handle );
+        }
+    }
+    SERVER_END_REQ;
+
+    if (fd != -1)
+    {
+        ptr = mmap( NULL, inproc_sync_shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        close( fd );
+        if (ptr != MAP_FAILED)
+        {
+            TRACE( "using in-process synchronization\n" );
+            inproc_sync_shm = ptr;
+            return TRUE;
+        }
+    }
+    if (ret != STATUS_NOT_SUPPORTED) ERR( "failed to map in-process synchronization memory\n" );
+    inproc_sync_disabled = TRUE;
+    return FALSE;
+}
+
+
+/***********************************************************************
+ *           get_cached_inproc_sync
+ */
+static inline BOOL get_cached_inproc_sync( HANDLE handle, unsigned int *index, unsigned int *serial,
+                                           unsigned int *access )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union inproc_sync_cache_entry cache;
+
+    if (entry >= INPROC_SYNC_CACHE_ENTRIES || !inproc_sync_cache[entry]) return FALSE;
+
+    cache.data = InterlockedCompareExchange64( &inproc_sync_cache[entry][idx].data, 0, 0 );
+    if (!cache.s.cached) return FALSE;
+    *index = cache.s.index;
+    *serial = cache.s.serial;
+    *access = inproc_sync_handle_access( cache.s.access );
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           add_inproc_sync_to_cache
+ *
+ * Caller must hold fd_cache_mutex.
+ */
+static void add_inproc_sync_to_cache( HANDLE handle, unsigned int index, unsigned int serial, unsigned int access )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union inproc_sync_cache_entry cache;
+
+    if (entry >= INPROC_SYNC_CACHE_ENTRIES) return;
+
+    if (!inproc_sync_cache[entry])  /* do we need to allocate a new block of entries? */
+    {
+        void *ptr = anon_mmap_alloc( INPROC_SYNC_CACHE_BLOCK_SIZE * sizeof(union inproc_sync_cache_entry),
+                                     PROT_READ | PROT_WRITE );
+        if (ptr == MAP_FAILED) return;
+        inproc_sync_cache[entry] = ptr;
+    }
+
+    cache.s.index = index;
+    cache.s.access = inproc_sync_cache_access( access );
+    cache.s.cached = 1;
+    cache.s.serial = serial;
+    interlocked_xchg64( &inproc_sync_cache[entry][idx].data, cache.data );
+}
+
+
+/***********************************************************************
+ *           remove_inproc_sync_from_cache
+ */
+static void remove_inproc_sync_from_cache( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry < INPROC_SYNC_CACHE_ENTRIES && inproc_sync_cache[entry])
+        interlocked_xchg64( &inproc_sync_cache[entry][idx].data, 0 );
+}
+
+
+/***********************************************************************
+ *           server_get_inproc_sync
+ *
+ * Return the shared state of an event, mutex, semaphore or completion port,
+ * or NULL if the object has to be accessed through the server. The state
+ * is referenced and must be released with server_release_inproc_sync().
+ */
+inproc_sync_t *server_get_inproc_sync( HANDLE handle, unsigned int *access )
+{
+    inproc_sync_t *sync;
+    sigset_t sigset;
+    unsigned int index, serial;
+
+    if (inproc_sync_disabled) return NULL;
+
+    if (!get_cached_inproc_sync( handle, &index, &serial, access ))
+    {
+        if (HandleToLong( handle ) < 0) return NULL;  /* pseudo-handle */
+
+        index = 0;
+        server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+        if (init_inproc_sync() && !get_cached_inproc_sync( handle, &index, &serial, access ))
+        {
+            SERVER_START_REQ( get_inproc_sync )
+            {
+                req->handle = wine_server_obj_handle( handle );
+                if (!wine_server_call( req ))
+                {
+                    if (reply->index < INPROC_SYNC_MAX_OBJECTS &&
+                        reply->index < inproc_sync_shm_size / sizeof(*inproc_sync_shm)) index = reply->index;
+                    serial = reply->serial;
+                    *access = reply->access;
+                    add_inproc_sync_to_cache( handle, index, serial, reply->access );
+                }
+            }
+            SERVER_END_REQ;
+        }
+        server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    }
+    if (!index) return NULL;
+
+    /* the server doesn't reuse the state while it's referenced, but it may already
+     * belong to another object if the handle has been closed in the meantime */
+    sync = &inproc_sync_shm[index];
+    InterlockedIncrement( (LONG *)&sync->refs );
+    if ((unsigned int)ReadAcquire( (LONG *)&sync->serial ) != serial)
+    {
+        server_release_inproc_sync( sync );
+        return NULL;
+    }
+    return sync;
+}
+
+
+/***********************************************************************
+ *           server_release_inproc_sync
+ */
+void server_release_inproc_sync( inproc_sync_t *sync )
+{
+    InterlockedDecrement( (LONG *)&sync->refs );
+}
+
+
+/***********************************************************************
+ *           server_get_inproc_completion
+ *
+ * Return the packet queue of a completion port, or NULL if it's not available.
+ */
+inproc_completion_t *server_get_inproc_completion( inproc_sync_t *sync )
+{
+    unsigned int pos = sync->count;
+
+    if (sync->type != INPROC_SYNC_COMPLETION || pos >= INPROC_COMPLETION_MAX_PORTS) return NULL;
+    if (inproc_sync_shm_size < INPROC_SYNC_MAX_OBJECTS * sizeof(*inproc_sync_shm) +
+                               (pos + 1) * sizeof(inproc_completion_t)) return NULL;
+    return (inproc_completion_t *)(inproc_sync_shm + INPROC_SYNC_MAX_OBJECTS) + pos;
+}
+
+
 /***********************************************************************
  *           wine_server_fd_to_handle
  */
@@ -1274,6 +1712,20 @@ static const char *init_server_dir( dev_t dev, ino_t ino )
 }
 
 
+/***********************************************************************
+ *           server_get_dir
+ *
+ * Return the server directory of the current prefix.
+ */
+const char *server_get_dir(void)
+{
+    struct stat st;
+
+    if (!server_dir && !stat( config_dir, &st )) server_dir = init_server_dir( st.st_dev, st.st_ino );
+    return server_dir;
+}
+
+
 /***********************************************************************
  *           setup_config_dir
  *
@@ -1758,9 +2210,12 @@ void server_init_thread( void *entry_point, BOOL *suspend )
 NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE dest_process, HANDLE *dest,
                                    ACCESS_MASK access, ULONG attributes, ULONG options )
 {
+    union handle_info_cache_entry info;
+    enum server_fd_type type = FD_TYPE_INVALID;
+    unsigned int ret, fd_access = 0, fd_options = 0;
     sigset_t sigset;
-    unsigned int ret;
-    int fd = -1;
+    int fd = -1, cached_fd = -1, new_fd = -1;
+    BOOL cached;
 
     if (dest) *dest = 0;
 
@@ -1787,10 +2242,21 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
 
     server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
 
+    /* a duplicate with the same access within the process can use the cached
+     * fd and information of the source handle */
+    cached = (dest && source_process == NtCurrentProcess() && dest_process == NtCurrentProcess() &&
+              (options & (DUPLICATE_SAME_ACCESS | DUPLICATE_MAKE_GLOBAL)) == DUPLICATE_SAME_ACCESS &&
+              get_cached_handle_info( source, &info ) && info.s.cached &&
+              !get_cached_fd( source, &cached_fd, &type, &fd_access, &fd_options ));
+
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     if (options & DUPLICATE_CLOSE_SOURCE)
+    {
         fd = remove_fd_from_cache( source );
+        remove_handle_info_from_cache( source );
+        remove_inproc_sync_from_cache( source );
+    }
 
     SERVER_START_REQ( dup_handle )
     {
@@ -1807,9 +2273,31 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
     }
     SERVER_END_REQ;
 
+    if (!ret && cached && get_cached_fd( *dest, &new_fd, NULL, NULL, NULL ) == STATUS_INVALID_HANDLE)
+    {
+        if (options & DUPLICATE_CLOSE_SOURCE)
+        {
+            new_fd = fd;
+            fd = -1;
+        }
+        else new_fd = dup( cached_fd );
+
+        if (new_fd != -1 && add_fd_to_cache( *dest, new_fd, type, fd_access, fd_options ))
+        {
+            new_fd = -1;
+            if (!(options & DUPLICATE_SAME_ATTRIBUTES))
+            {
+                info.s.flags = (attributes & OBJ_INHERIT) ? HANDLE_FLAG_INHERIT : 0;
+                info.s.flags_cached = 1;
+            }
+            set_cached_handle_info( *dest, info );
+        }
+    }
+
     server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
 
     if (fd != -1) close( fd );
+    if (new_fd != -1) close( new_fd );
     return ret;
 }
 
@@ -1861,6 +2349,8 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     fd = remove_fd_from_cache( handle );
+    remove_handle_info_from_cache( handle );
+    remove_inproc_sync_from_cache( handle );
 
     SERVER_START_REQ( close_handle )
     {
@@ -25,10 +25,16 @@
 #include "config.h"
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
 #ifdef HAVE_IFADDRS_H
 # include <ifaddrs.h>
 #endif
@@ -79,6 +85,7 @@
 #include "wsipx.h"
 #include "af_irda.h"
 #include "wine/afd.h"
+#include "wine/rbtree.h"
 
 #include "unix_private.h"
 
@@ -108,9 +115,13 @@ union unix_sockaddr
 #endif
 };
 
+struct client_poll_async;
+
 struct async_recv_ioctl
 {
     struct async_fileio io;
+    struct client_poll_async *poll;
+    BOOL client_polled;
     void *control;
     struct WS_sockaddr *addr;
     int *addr_len;
@@ -124,6 +135,8 @@ struct async_recv_ioctl
 struct async_send_ioctl
 {
     struct async_fileio io;
+    struct client_poll_async *poll;
+    BOOL client_polled;
     const struct WS_sockaddr *addr;
     int addr_len;
     int unix_flags;
@@ -796,6 +809,375 @@ static NTSTATUS try_recv( int fd, struct async_recv_ioctl *async, ULONG_PTR *siz
     return status;
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+
+/* pending receives and sends on sockets that are not shared with other processes
+ * can be polled by a dedicated thread of the process instead of the server */
+
+struct client_poll_socket
+{
+    struct wine_rb_entry entry;
+    struct list          poll_entry;  /* entry in the free list once unused */
+    ino_t                ino;         /* identifies the socket, handles may be reused */
+    int                  fd;          /* our own copy of the unix fd, or -1 once unused */
+    unsigned int         events;      /* events in the epoll set */
+    struct list          reads;       /* pending receives, in order */
+    struct list          writes;      /* pending sends, in order */
+};
+
+struct client_poll_async
+{
+    struct list                entry;
+    struct client_poll_socket *sock;
+    struct async_fileio       *io;
+    struct client_poll_async **owner;  /* back pointer in the async data */
+    HANDLE                     wait;   /* wait handle, used to report the result */
+    client_ptr_t               iosb;
+    BOOL                       done;       /* I/O performed by the poll thread, result being reported */
+    BOOL                       reported;   /* result rejected by the server, waiting for the callback */
+    BOOL                       terminated; /* callback called while the result was being reported */
+    unsigned int               status;     /* result of the I/O performed by the poll thread */
+    ULONG_PTR                  info;
+};
+
+#define CLIENT_POLL_BATCH 64  /* maximum number of results reported with a single request */
+
+static int client_poll_state;  /* 0: not initialized yet, 1: enabled, -1: disabled */
+static int client_poll_epoll = -1;
+static struct wine_rb_tree client_poll_sockets;
+static struct list client_poll_free_sockets = LIST_INIT( client_poll_free_sockets );
+static pthread_mutex_t client_poll_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static NTSTATUS try_send( int fd, struct async_send_ioctl *async );
+
+static int compare_client_poll_socket( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct client_poll_socket *sock = WINE_RB_ENTRY_VALUE( entry, struct client_poll_socket, entry );
+    ino_t ino = *(const ino_t *)key;
+
+    if (ino < sock->ino) return -1;
+    if (ino > sock->ino) return 1;
+    return 0;
+}
+
+/* check if pending socket I/O can be polled by the client, starting the poll thread on first use */
+static BOOL use_client_poll(void)
+{
+    const char *env;
+    HANDLE thread;
+
+    if (client_poll_state) return client_poll_state > 0;
+
+    mutex_lock( &client_poll_mutex );
+    if (!client_poll_state)
+    {
+        client_poll_state = -1;
+        if ((env = getenv( "WINEINPROCSOCK" )) && atoi( env ) && p__wine_sock_poll_thread &&
+            (client_poll_epoll = epoll_create1( EPOLL_CLOEXEC )) != -1)
+        {
+            wine_rb_init( &client_poll_sockets, compare_client_poll_socket );
+            if (!NtCreateThreadEx( &thread, THREAD_ALL_ACCESS, NULL, NtCurrentProcess(), p__wine_sock_poll_thread,
+                                   NULL, THREAD_CREATE_FLAGS_HIDE_FROM_DEBUGGER, 0, 0, 0, NULL ))
+            {
+                NtClose( thread );
+                TRACE( "polling sockets in process\n" );
+                client_poll_state = 1;
+            }
+            else
+            {
+                close( client_poll_epoll );
+                client_poll_epoll = -1;
+            }
+        }
+    }
+    mutex_unlock( &client_poll_mutex );
+    return client_poll_state > 0;
+}
+
+/* update the epoll set for the pending asyncs of a socket; called with client_poll_mutex held */
+static void update_client_poll_socket( struct client_poll_socket *sock )
+{
+    struct epoll_event ev;
+
+    if (list_empty( &sock->reads ) && list_empty( &sock->writes ))
+    {
+        /* the poll thread may still have an event for it, free it later */
+        epoll_ctl( client_poll_epoll, EPOLL_CTL_DEL, sock->fd, NULL );
+        wine_rb_remove( &client_poll_sockets, &sock->entry );
+        close( sock->fd );
+        sock->fd = -1;
+        list_add_tail( &client_poll_free_sockets, &sock->poll_entry );
+        return;
+    }
+
+    ev.events = (list_empty( &sock->reads ) ? 0 : EPOLLIN) | (list_empty( &sock->writes ) ? 0 : EPOLLOUT);
+    if (ev.events == sock->events) return;
+    ev.data.ptr = sock;
+    if (epoll_ctl( client_poll_epoll, EPOLL_CTL_MOD, sock->fd, &ev ) == -1)
+        ERR( "epoll_ctl failed: %s\n", strerror( errno ));
+    sock->events = ev.events;
+}
+
+/* report the results of client-polled asyncs; status is set to STATUS_CANCELLED for the asyncs
+ * that the server terminated in the meantime, their callback reports the result instead */
+static void set_client_poll_results( const struct async_client_result *results, unsigned int *status,
+                                     unsigned int count )
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++) status[i] = STATUS_CANCELLED;
+
+    SERVER_START_REQ( set_async_client_results )
+    {
+        wine_server_add_data( req, results, count * sizeof(*results) );
+        wine_server_set_reply( req, status, count * sizeof(*status) );
+        wine_server_call( req );
+    }
+    SERVER_END_REQ;
+}
+
+/* store the result of the I/O performed for a client-polled async; called with client_poll_mutex held */
+static struct client_poll_async *set_client_poll_async_done( struct client_poll_async *async,
+                                                             unsigned int status, ULONG_PTR info )
+{
+    list_remove( &async->entry );
+    async->done   = TRUE;
+    async->status = status;
+    async->info   = info;
+    return async;
+}
+
+/* report the results of the asyncs completed by the poll thread with a single request */
+static void complete_client_poll_asyncs( struct client_poll_async **asyncs, unsigned int count )
+{
+    struct async_client_result results[CLIENT_POLL_BATCH];
+    unsigned int status[CLIENT_POLL_BATCH], i;
+
+    for (i = 0; i < count; i++)
+    {
+        set_async_iosb( asyncs[i]->iosb, asyncs[i]->status, asyncs[i]->info );
+        results[i].handle      = wine_server_obj_handle( asyncs[i]->wait );
+        results[i].status      = asyncs[i]->status;
+        results[i].user        = wine_server_client_ptr( asyncs[i]->io );
+        results[i].information = asyncs[i]->info;
+    }
+    set_client_poll_results( results, status, count );
+
+    /* the async I/O is kept until both we and the callback are done with it,
+     * so that the server can't mistake a stale result for a new async */
+    mutex_lock( &client_poll_mutex );
+    for (i = 0; i < count; i++)
+    {
+        if (status[i] && !asyncs[i]->terminated)
+        {
+            asyncs[i]->reported = TRUE;
+            continue;
+        }
+        release_fileio( asyncs[i]->io );
+        free( asyncs[i] );
+    }
+    mutex_unlock( &client_poll_mutex );
+}
+
+/* queue a pending async that the server let us poll */
+static void add_client_poll_async( int fd, struct async_fileio *io, struct client_poll_async **owner,
+                                   HANDLE wait, client_ptr_t iosb, BOOL write )
+{
+    struct client_poll_socket *sock = NULL;
+    struct async_client_result result;
+    struct client_poll_async *async;
+    struct wine_rb_entry *entry;
+    struct epoll_event ev;
+    unsigned int status;
+    struct stat st;
+
+    if (!(async = malloc( sizeof(*async) ))) goto failed;
+    async->io    = io;
+    async->owner = owner;
+    async->wait  = wait;
+    async->iosb  = iosb;
+    async->done  = FALSE;
+    async->reported = FALSE;
+    async->terminated = FALSE;
+
+    if (fstat( fd, &st ) == -1) goto failed;
+
+    mutex_lock( &client_poll_mutex );
+    if ((entry = wine_rb_get( &client_poll_sockets, &st.st_ino )))
+        sock = WINE_RB_ENTRY_VALUE( entry, struct client_poll_socket, entry );
+    else if ((sock = malloc( sizeof(*sock) )))
+    {
+        sock->ino = st.st_ino;
+        sock->events = 0;
+        list_init( &sock->reads );
+        list_init( &sock->writes );
+        ev.events = 0;
+        ev.data.ptr = sock;
+        if ((sock->fd = fcntl( fd, F_DUPFD_CLOEXEC, 0 )) == -1 ||
+            epoll_ctl( client_poll_epoll, EPOLL_CTL_ADD, sock->fd, &ev ) == -1)
+        {
+            if (sock->fd != -1) close( sock->fd );
+            free( sock );
+            sock = NULL;
+        }
+        else wine_rb_put( &client_poll_sockets, &sock->ino, &sock->entry );
+    }
+    if (sock)
+    {
+        async->sock = sock;
+        *owner = async;
+        list_add_tail( write ? &sock->writes : &sock->reads, &async->entry );
+        update_client_poll_socket( sock );
+    }
+    mutex_unlock( &client_poll_mutex );
+    if (sock) return;
+
+failed:
+    /* nobody else would complete it */
+    ERR( "failed to poll socket\n" );
+    free( async );
+    result.handle      = wine_server_obj_handle( wait );
+    result.status      = STATUS_NO_MEMORY;
+    result.user        = wine_server_client_ptr( io );
+    result.information = 0;
+    set_async_iosb( iosb, STATUS_NO_MEMORY, 0 );
+    set_client_poll_results( &result, &status, 1 );
+    if (!status) release_fileio( io );
+}
+
+/* called from the async callback, when the server terminates a client-polled async; if the
+ * poll thread has already performed the I/O, its result replaces the termination status.
+ * Returns FALSE if the poll thread still uses the async I/O and will release it. */
+static BOOL remove_client_poll_async( struct client_poll_async **owner, unsigned int *status, ULONG_PTR *info )
+{
+    struct client_poll_async *async;
+    BOOL ret = TRUE;
+
+    mutex_lock( &client_poll_mutex );
+    if ((async = *owner))
+    {
+        if (async->done)
+        {
+            *status = async->status;
+            *info   = async->info;
+        }
+        else
+        {
+            list_remove( &async->entry );
+            update_client_poll_socket( async->sock );
+        }
+
+        if (async->done && !async->reported)
+        {
+            async->terminated = TRUE;
+            ret = FALSE;
+        }
+        else
+        {
+            *owner = NULL;
+            free( async );
+        }
+    }
+    mutex_unlock( &client_poll_mutex );
+    return ret;
+}
+
+/***********************************************************************
+ *           sock_poll_thread
+ *
+ * Unix call running on the socket poll thread; never returns.
+ */
+NTSTATUS sock_poll_thread( void *args )
+{
+    struct epoll_event events[64];
+    struct client_poll_async *done[CLIENT_POLL_BATCH];
+    struct client_poll_socket *sock, *next_sock;
+    struct client_poll_async *async, *next;
+    unsigned int status, done_count;
+    ULONG_PTR info;
+    int i, count;
+
+    for (;;)
+    {
+        mutex_lock( &client_poll_mutex );
+        LIST_FOR_EACH_ENTRY_SAFE( sock, next_sock, &client_poll_free_sockets, struct client_poll_socket, poll_entry )
+        {
+            list_remove( &sock->poll_entry );
+            free( sock );
+        }
+        mutex_unlock( &client_poll_mutex );
+
+        if ((count = epoll_wait( client_poll_epoll, events, ARRAY_SIZE(events), -1 )) == -1)
+        {
+            if (errno != EINTR) ERR( "epoll_wait failed: %s\n", strerror( errno ));
+            continue;
+        }
+
+        /* the I/O is performed with the mutex held, so that the callback can't free the asyncs
+         * meanwhile; the results are reported to the server once it's released. The sockets
+         * are level-triggered, those left over when the batch is full are polled again. */
+        done_count = 0;
+        mutex_lock( &client_poll_mutex );
+        for (i = 0; i < count; i++)
+        {
+            sock = events[i].data.ptr;
+            if (sock->fd == -1) continue;
+
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+            {
+                LIST_FOR_EACH_ENTRY_SAFE( async, next, &sock->reads, struct client_poll_async, entry )
+                {
+                    if (done_count == ARRAY_SIZE(done)) break;
+                    status = try_recv( sock->fd, (struct async_recv_ioctl *)async->io, &info );
+                    if (status == STATUS_DEVICE_NOT_READY) break;
+                    done[done_count++] = set_client_poll_async_done( async, status, info );
+                }
+            }
+            if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+            {
+                LIST_FOR_EACH_ENTRY_SAFE( async, next, &sock->writes, struct client_poll_async, entry )
+                {
+                    struct async_send_ioctl *send = (struct async_send_ioctl *)async->io;
+
+                    if (done_count == ARRAY_SIZE(done)) break;
+                    status = try_send( sock->fd, send );
+                    if (status == STATUS_DEVICE_NOT_READY) break;
+                    done[done_count++] = set_client_poll_async_done( async, status, send->sent_len );
+                }
+            }
+            update_client_poll_socket( sock );
+        }
+        mutex_unlock( &client_poll_mutex );
+
+        if (done_count) complete_client_poll_asyncs( done, done_count );
+    }
+}
+
+#else  /* HAVE_SYS_EPOLL_H */
+
+static BOOL use_client_poll(void)
+{
+    return FALSE;
+}
+
+static void add_client_poll_async( int fd, struct async_fileio *io, struct client_poll_async **owner,
+                                   HANDLE wait, client_ptr_t iosb, BOOL write )
+{
+    assert( 0 );
+}
+
+static BOOL remove_client_poll_async( struct client_poll_async **owner, unsigned int *status, ULONG_PTR *info )
+{
+    return TRUE;
+}
+
+NTSTATUS sock_poll_thread( void *args )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+#endif  /* HAVE_SYS_EPOLL_H */
+
 static BOOL async_recv_proc( void *user, ULONG_PTR *info, unsigned int *status )
 {
     struct async_recv_ioctl *async = user;
@@ -803,6 +1185,9 @@ static BOOL async_recv_proc( void *user, ULONG_PTR *info, unsigned int *status )
 
     TRACE( "%#x\n", *status );
 
+    /* the poll thread releases the async I/O if it's still reporting its result */
+    if (async->client_polled && !remove_client_poll_async( &async->poll, status, info )) return TRUE;
+
     if (*status == STATUS_ALERTED)
     {
         if ((*status = server_get_unix_fd( async->io.handle, 0, &fd, &needs_close, NULL, NULL )))
@@ -840,7 +1225,7 @@ static NTSTATUS sock_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
                            int fd, struct async_recv_ioctl *async, int force_async )
 {
     HANDLE wait_handle;
-    BOOL nonblocking;
+    BOOL nonblocking, client_poll;
     unsigned int i, status;
     ULONG options;
 
@@ -858,13 +1243,22 @@ static NTSTATUS sock_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
         req->force_async = force_async;
         req->async  = server_async( handle, &async->io, event, apc, apc_user, iosb_client_ptr(io) );
         req->oob    = !!(async->unix_flags & MSG_OOB);
+        req->client_poll = !(async->unix_flags & MSG_OOB) && use_client_poll();
         status = wine_server_call( req );
         wait_handle = wine_server_ptr_handle( reply->wait );
         options     = reply->options;
         nonblocking = reply->nonblocking;
+        client_poll = reply->client_poll;
     }
     SERVER_END_REQ;
 
+    if (status == STATUS_PENDING && client_poll)
+    {
+        async->client_polled = TRUE;
+        add_client_poll_async( fd, &async->io, &async->poll, wait_handle, iosb_client_ptr(io), FALSE );
+        return status;
+    }
+
     /* the server currently will never succeed immediately */
     assert(status == STATUS_ALERTED || status == STATUS_PENDING || NT_ERROR(status));
 
@@ -912,6 +1306,8 @@ static NTSTATUS sock_ioctl_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE ap
     if (!(async = (struct async_recv_ioctl *)alloc_fileio( async_size, async_recv_proc, handle )))
         return STATUS_NO_MEMORY;
 
+    async->poll = NULL;
+    async->client_polled = FALSE;
     async->count = count;
     if (in_wow64_call())
     {
@@ -953,6 +1349,8 @@ NTSTATUS sock_read( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc,
     if (!(async = (struct async_recv_ioctl *)alloc_fileio( async_size, async_recv_proc, handle )))
         return STATUS_NO_MEMORY;
 
+    async->poll = NULL;
+    async->client_polled = FALSE;
     async->count = 1;
     async->iov[0].iov_base = buffer;
     async->iov[0].iov_len = length;
@@ -1055,6 +1453,9 @@ static BOOL async_send_proc( void *user, ULONG_PTR *info, unsigned int *status )
 
     TRACE( "%#x\n", *status );
 
+    /* the poll thread releases the async I/O if it's still reporting its result */
+    if (async->client_polled && !remove_client_poll_async( &async->poll, status, info )) return TRUE;
+
     if (*status == STATUS_ALERTED)
     {
         if ((*status = server_get_unix_fd( async->io.handle, 0, &fd, &needs_close, NULL, NULL )))
@@ -1102,7 +1503,7 @@ static NTSTATUS sock_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
                            IO_STATUS_BLOCK *io, int fd, struct async_send_ioctl *async, int force_async )
 {
     HANDLE wait_handle;
-    BOOL nonblocking;
+    BOOL nonblocking, client_poll;
     unsigned int status;
     ULONG options;
 
@@ -1110,10 +1511,12 @@ static NTSTATUS sock_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
     {
         req->force_async = force_async;
         req->async  = server_async( handle, &async->io, event, apc, apc_user, iosb_client_ptr(io) );
+        req->client_poll = use_client_poll();
         status = wine_server_call( req );
         wait_handle = wine_server_ptr_handle( reply->wait );
         options     = reply->options;
         nonblocking = reply->nonblocking;
+        client_poll = reply->client_poll;
     }
     SERVER_END_REQ;
 
@@ -1123,6 +1526,13 @@ static NTSTATUS sock_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
     if (!NT_ERROR(status) && is_icmp_over_dgram( fd ))
         sock_save_icmp_id( async );
 
+    if (status == STATUS_PENDING && client_poll)
+    {
+        async->client_polled = TRUE;
+        add_client_poll_async( fd, &async->io, &async->poll, wait_handle, iosb_client_ptr(io), TRUE );
+        return status;
+    }
+
     if (status == STATUS_ALERTED)
     {
         ULONG_PTR information;
@@ -1168,6 +1578,8 @@ static NTSTATUS sock_ioctl_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE ap
     if (!(async = (struct async_send_ioctl *)alloc_fileio( async_size, async_send_proc, handle )))
         return STATUS_NO_MEMORY;
 
+    async->poll = NULL;
+    async->client_polled = FALSE;
     async->count = count;
     if (in_wow64_call())
     {
@@ -1208,6 +1620,8 @@ NTSTATUS sock_write( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc,
     if (!(async = (struct async_send_ioctl *)alloc_fileio( async_size, async_recv_proc, handle )))
         return STATUS_NO_MEMORY;
 
+    async->poll = NULL;
+    async->client_polled = FALSE;
     async->count = 1;
     async->iov[0].iov_base = (void *)buffer;
     async->iov[0].iov_len = length;
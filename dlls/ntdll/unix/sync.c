@@ -108,7 +108,7 @@ static inline ULONGLONG monotonic_counter(void)
 
 #include <linux/futex.h>
 
-static inline int futex_wait( const LONG *addr, int val, struct timespec *timeout )
+static inline int futex_call( const LONG *addr, int op, int val, struct timespec *timeout )
 {
 #if (defined(__i386__) || defined(__arm__)) && _TIME_BITS==64
     if (timeout && sizeof(*timeout) != 8)
@@ -118,20 +118,496 @@ static inline int futex_wait( const LONG *addr, int val, struct timespec *timeou
             long tv_nsec;
         } timeout32 = { timeout->tv_sec, timeout->tv_nsec };
 
-        return syscall( __NR_futex, addr, FUTEX_WAIT_PRIVATE, val, &timeout32, 0, 0 );
+        return syscall( __NR_futex, addr, op, val, &timeout32, 0, 0 );
     }
 #endif
-    return syscall( __NR_futex, addr, FUTEX_WAIT_PRIVATE, val, timeout, 0, 0 );
+    return syscall( __NR_futex, addr, op, val, timeout, 0, 0 );
+}
+
+static inline int futex_wait( const LONG *addr, int val, struct timespec *timeout )
+{
+    return futex_call( addr, FUTEX_WAIT_PRIVATE, val, timeout );
 }
 
 static inline int futex_wake( const LONG *addr, int val )
 {
-    return syscall( __NR_futex, addr, FUTEX_WAKE_PRIVATE, val, NULL, 0, 0 );
+    return futex_call( addr, FUTEX_WAKE_PRIVATE, val, NULL );
+}
+
+/* futexes in memory shared with other processes */
+static inline int futex_wait_shared( const LONG *addr, int val, struct timespec *timeout )
+{
+    return futex_call( addr, FUTEX_WAIT, val, timeout );
+}
+
+static inline int futex_wake_shared( const LONG *addr, int val )
+{
+    return futex_call( addr, FUTEX_WAKE, val, NULL );
+}
+
+#endif
+
+#if defined(__linux__) || defined(HAVE_KQUEUE)
+static LONGLONG get_absolute_timeout( const LARGE_INTEGER *timeout )
+{
+    LARGE_INTEGER now;
+
+    if (timeout->QuadPart >= 0) return timeout->QuadPart;
+    NtQuerySystemTime( &now );
+    return now.QuadPart - timeout->QuadPart;
 }
 
+static LONGLONG update_timeout( ULONGLONG end )
+{
+    LARGE_INTEGER now;
+    LONGLONG timeleft;
+
+    NtQuerySystemTime( &now );
+    timeleft = end - now.QuadPart;
+    if (timeleft < 0) timeleft = 0;
+    return timeleft;
+}
 #endif
 
 
+/***********************************************************************/
+/* in-process synchronization objects
+ *
+ * The state of events, mutexes and semaphores may live in memory shared with the
+ * server (see server/inproc_sync.c). Operations on them are then done directly in
+ * the client, unless the server owns the state because it has waiters of its own.
+ * Completion ports also have a shared packet queue (see server/completion.c).
+ * The functions below return STATUS_NOT_IMPLEMENTED when the server has to be used.
+ */
+
+#ifdef __linux__
+
+static inline unsigned int get_inproc_state( inproc_sync_t *sync )
+{
+    return ReadAcquire( (LONG *)&sync->state );
+}
+
+/* replace the object state if it didn't change; fails if the server took it over */
+static inline BOOL update_inproc_state( inproc_sync_t *sync, unsigned int old_state, unsigned int new_state )
+{
+    return InterlockedCompareExchange( (LONG *)&sync->state, new_state, old_state ) == old_state;
+}
+
+static NTSTATUS inproc_event_op( HANDLE handle, int op, LONG *prev_state )
+{
+    unsigned int access, state, new_state = (op == SET_EVENT);
+    inproc_sync_t *sync;
+    NTSTATUS ret = STATUS_NOT_IMPLEMENTED;
+
+    if (!(sync = server_get_inproc_sync( handle, &access ))) return STATUS_NOT_IMPLEMENTED;
+    if (sync->type != INPROC_SYNC_AUTO_EVENT && sync->type != INPROC_SYNC_MANUAL_EVENT) goto done;
+    if (!(access & EVENT_MODIFY_STATE))
+    {
+        ret = STATUS_ACCESS_DENIED;
+        goto done;
+    }
+
+    do
+    {
+        state = get_inproc_state( sync );
+        if (state & INPROC_SYNC_SERVER) goto done;
+    } while (!update_inproc_state( sync, state, new_state ));
+
+    if (new_state && !state)
+        futex_wake_shared( (LONG *)&sync->state, sync->type == INPROC_SYNC_MANUAL_EVENT ? INT_MAX : 1 );
+    if (prev_state) *prev_state = state;
+    ret = STATUS_SUCCESS;
+
+done:
+    server_release_inproc_sync( sync );
+    return ret;
+}
+
+static NTSTATUS inproc_release_semaphore( HANDLE handle, ULONG count, ULONG *previous )
+{
+    unsigned int access, state;
+    inproc_sync_t *sync;
+    NTSTATUS ret = STATUS_NOT_IMPLEMENTED;
+
+    if (!(sync = server_get_inproc_sync( handle, &access ))) return STATUS_NOT_IMPLEMENTED;
+    if (sync->type != INPROC_SYNC_SEMAPHORE) goto done;
+    if (!(access & SEMAPHORE_MODIFY_STATE))
+    {
+        ret = STATUS_ACCESS_DENIED;
+        goto done;
+    }
+
+    do
+    {
+        state = get_inproc_state( sync );
+        if (state & INPROC_SYNC_SERVER) goto done;
+        if (state + count < state || state + count > ReadNoFence( (LONG *)&sync->count ))
+        {
+            ret = STATUS_SEMAPHORE_LIMIT_EXCEEDED;
+            goto done;
+        }
+    } while (!update_inproc_state( sync, state, state + count ));
+
+    if (!state) futex_wake_shared( (LONG *)&sync->state, count );
+    if (previous) *previous = state;
+    ret = STATUS_SUCCESS;
+
+done:
+    server_release_inproc_sync( sync );
+    return ret;
+}
+
+static NTSTATUS inproc_release_mutex( HANDLE handle, LONG *prev_count )
+{
+    unsigned int access, state, count, tid = GetCurrentThreadId();
+    inproc_sync_t *sync;
+    NTSTATUS ret = STATUS_NOT_IMPLEMENTED;
+
+    if (!(sync = server_get_inproc_sync( handle, &access ))) return STATUS_NOT_IMPLEMENTED;
+    if (sync->type != INPROC_SYNC_MUTEX) goto done;
+
+    state = get_inproc_state( sync );
+    if (state & INPROC_SYNC_SERVER) goto done;
+    if (state != tid)
+    {
+        ret = STATUS_MUTANT_NOT_OWNED;
+        goto done;
+    }
+
+    /* only the owner changes the recursion count, but the server reads it */
+    count = ReadNoFence( (LONG *)&sync->count );
+    if (count > 1) InterlockedDecrement( (LONG *)&sync->count );
+    else
+    {
+        InterlockedExchange( (LONG *)&sync->count, 0 );
+        if (!update_inproc_state( sync, tid, 0 ))
+        {
+            InterlockedExchange( (LONG *)&sync->count, count );
+            goto done;
+        }
+        futex_wake_shared( (LONG *)&sync->state, 1 );
+    }
+    if (prev_count) *prev_count = 1 - count;
+    ret = STATUS_SUCCESS;
+
+done:
+    server_release_inproc_sync( sync );
+    return ret;
+}
+
+/* try to acquire the object; return STATUS_PENDING and the current state if it's not signaled */
+static NTSTATUS inproc_acquire( inproc_sync_t *sync, unsigned int *state )
+{
+    unsigned int tid = GetCurrentThreadId();
+
+    for (;;)
+    {
+        *state = get_inproc_state( sync );
+        /* the object has been destroyed while we were using it, nothing can signal it anymore */
+        if (sync->type == INPROC_SYNC_NONE) return STATUS_PENDING;
+        if (*state & INPROC_SYNC_SERVER) return STATUS_NOT_IMPLEMENTED;
+
+        switch (sync->type)
+        {
+        case INPROC_SYNC_MANUAL_EVENT:
+            return *state ? STATUS_SUCCESS : STATUS_PENDING;
+        case INPROC_SYNC_AUTO_EVENT:
+            if (!*state) return STATUS_PENDING;
+            if (update_inproc_state( sync, *state, 0 )) return STATUS_SUCCESS;
+            break;
+        case INPROC_SYNC_SEMAPHORE:
+            if (!*state) return STATUS_PENDING;
+            if (update_inproc_state( sync, *state, *state - 1 )) return STATUS_SUCCESS;
+            break;
+        case INPROC_SYNC_MUTEX:
+            if (*state == tid)
+            {
+                if ((unsigned int)ReadNoFence( (LONG *)&sync->count ) >= MAXLONG)
+                    return STATUS_MUTANT_LIMIT_EXCEEDED;
+                InterlockedIncrement( (LONG *)&sync->count );
+                return STATUS_SUCCESS;
+            }
+            if (*state) return STATUS_PENDING;
+            if (update_inproc_state( sync, 0, tid ))
+            {
+                InterlockedExchange( (LONG *)&sync->count, 1 );
+                if (InterlockedExchange( (LONG *)&sync->abandoned, 0 )) return STATUS_ABANDONED_WAIT_0;
+                return STATUS_SUCCESS;
+            }
+            break;
+        default:
+            return STATUS_NOT_IMPLEMENTED;
+        }
+    }
+}
+
+/* if the wait has to go through the server after all, the returned timeout is the
+ * absolute end time of the in-process wait, so that the total wait is not extended */
+static NTSTATUS inproc_wait( HANDLE handle, BOOLEAN alertable, const LARGE_INTEGER **timeout,
+                             LARGE_INTEGER *end_time )
+{
+    const LARGE_INTEGER *end = NULL;
+    unsigned int access, state;
+    inproc_sync_t *sync;
+    NTSTATUS ret;
+
+    /* user APCs are only delivered by the server */
+    if (alertable) return STATUS_NOT_IMPLEMENTED;
+    if (!(sync = server_get_inproc_sync( handle, &access ))) return STATUS_NOT_IMPLEMENTED;
+    if (!(access & SYNCHRONIZE))
+    {
+        server_release_inproc_sync( sync );
+        return STATUS_ACCESS_DENIED;
+    }
+
+    if (*timeout && (*timeout)->QuadPart != TIMEOUT_INFINITE)
+    {
+        end_time->QuadPart = get_absolute_timeout( *timeout );
+        end = end_time;
+    }
+
+    while ((ret = inproc_acquire( sync, &state )) == STATUS_PENDING)
+    {
+        if (end)
+        {
+            LONGLONG timeleft = update_timeout( end->QuadPart );
+            struct timespec timespec;
+
+            if (!timeleft)
+            {
+                server_release_inproc_sync( sync );
+                /* same as server_wait() */
+                NtYieldExecution();
+                return STATUS_TIMEOUT;
+            }
+            timespec.tv_sec = timeleft / (ULONGLONG)TICKSPERSEC;
+            timespec.tv_nsec = (timeleft % TICKSPERSEC) * 100;
+            futex_wait_shared( (LONG *)&sync->state, state, &timespec );
+        }
+        else
+            futex_wait_shared( (LONG *)&sync->state, state, NULL );
+    }
+    server_release_inproc_sync( sync );
+    if (ret == STATUS_NOT_IMPLEMENTED && end) *timeout = end;
+    return ret;
+}
+
+/* add a packet to the shared queue of a completion port */
+static BOOL inproc_push_completion( inproc_completion_t *queue, ULONG_PTR key, ULONG_PTR value,
+                                    NTSTATUS status, SIZE_T count )
+{
+    inproc_completion_packet_t *packet;
+    unsigned int pos, seq;
+
+    pos = ReadNoFence( (LONG *)&queue->tail );
+    for (;;)
+    {
+        packet = &queue->packets[pos % INPROC_COMPLETION_SIZE];
+        seq = ReadAcquire( (LONG *)&packet->seq );
+        if ((int)(seq - pos) < 0) return FALSE;  /* full */
+        if (seq == pos)
+        {
+            if (InterlockedCompareExchange( (LONG *)&queue->tail, pos + 1, pos ) == pos) break;
+        }
+        pos = ReadNoFence( (LONG *)&queue->tail );
+    }
+
+    packet->ckey        = key;
+    packet->cvalue      = value;
+    packet->status      = status;
+    packet->information = count;
+    WriteRelease( (LONG *)&packet->seq, pos + 1 );
+    return TRUE;
+}
+
+/* remove the oldest packet from the shared queue of a completion port */
+static BOOL inproc_pop_completion( inproc_completion_t *queue, FILE_IO_COMPLETION_INFORMATION *info )
+{
+    inproc_completion_packet_t *packet;
+    unsigned int pos, seq;
+
+    pos = ReadNoFence( (LONG *)&queue->head );
+    for (;;)
+    {
+        packet = &queue->packets[pos % INPROC_COMPLETION_SIZE];
+        seq = ReadAcquire( (LONG *)&packet->seq );
+        if ((int)(seq - (pos + 1)) < 0) return FALSE;  /* empty, or packet still being added */
+        if (seq == pos + 1)
+        {
+            if (InterlockedCompareExchange( (LONG *)&queue->head, pos + 1, pos ) == pos) break;
+        }
+        pos = ReadNoFence( (LONG *)&queue->head );
+    }
+
+    info->CompletionKey             = packet->ckey;
+    info->CompletionValue           = packet->cvalue;
+    info->IoStatusBlock.Information = packet->information;
+    info->IoStatusBlock.Status      = packet->status;
+    WriteRelease( (LONG *)&packet->seq, pos + INPROC_COMPLETION_SIZE );
+    return TRUE;
+}
+
+static NTSTATUS inproc_set_completion( HANDLE handle, ULONG_PTR key, ULONG_PTR value,
+                                       NTSTATUS status, SIZE_T count )
+{
+    inproc_completion_t *queue;
+    unsigned int access, state;
+    inproc_sync_t *sync;
+    NTSTATUS ret = STATUS_NOT_IMPLEMENTED;
+
+    if (!(sync = server_get_inproc_sync( handle, &access ))) return STATUS_NOT_IMPLEMENTED;
+    if (!(queue = server_get_inproc_completion( sync ))) goto done;
+    if (!(access & IO_COMPLETION_MODIFY_STATE))
+    {
+        ret = STATUS_ACCESS_DENIED;
+        goto done;
+    }
+
+    /* account the packet first, so that waiters never miss it */
+    state = InterlockedIncrement( (LONG *)&sync->state ) - 1;
+    if ((state & (INPROC_SYNC_SERVER | INPROC_COMPLETION_OVERFLOW)) ||
+        !inproc_push_completion( queue, key, value, status, count ))
+    {
+        InterlockedDecrement( (LONG *)&sync->state );
+        goto done;
+    }
+
+    if (ReadAcquire( (LONG *)&queue->waiters )) futex_wake_shared( (LONG *)&sync->state, 1 );
+    ret = STATUS_SUCCESS;
+
+done:
+    server_release_inproc_sync( sync );
+    return ret;
+}
+
+/* as for inproc_wait, the returned timeout is the absolute end time when falling back to the server */
+static NTSTATUS inproc_remove_completion( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
+                                          ULONG *written, BOOLEAN alertable, const LARGE_INTEGER **timeout,
+                                          LARGE_INTEGER *end_time )
+{
+    const LARGE_INTEGER *end = NULL;
+    inproc_completion_t *queue;
+    unsigned int access, state;
+    inproc_sync_t *sync;
+    NTSTATUS ret = STATUS_NOT_IMPLEMENTED;
+    ULONG i = 0;
+
+    if (!count) return STATUS_NOT_IMPLEMENTED;
+    if (!(sync = server_get_inproc_sync( handle, &access ))) return STATUS_NOT_IMPLEMENTED;
+    if (!(queue = server_get_inproc_completion( sync ))) goto done;
+    if (!(access & IO_COMPLETION_MODIFY_STATE))
+    {
+        ret = STATUS_ACCESS_DENIED;
+        goto done;
+    }
+
+    if (*timeout && (*timeout)->QuadPart != TIMEOUT_INFINITE)
+    {
+        end_time->QuadPart = get_absolute_timeout( *timeout );
+        end = end_time;
+    }
+
+    for (;;)
+    {
+        state = get_inproc_state( sync );
+
+        /* if the port has been destroyed while we were waiting on it, nothing can be queued anymore */
+        if (sync->type == INPROC_SYNC_COMPLETION)
+        {
+            /* packets queued in the server have to be removed in order */
+            if (state & INPROC_COMPLETION_OVERFLOW) break;
+
+            while (i < count && inproc_pop_completion( queue, &info[i] ))
+            {
+                InterlockedDecrement( (LONG *)&sync->state );
+                i++;
+            }
+            if (i)
+            {
+                *written = i;
+                ret = STATUS_SUCCESS;
+                break;
+            }
+
+            if (state & ~(INPROC_SYNC_SERVER | INPROC_COMPLETION_OVERFLOW))
+            {
+                /* a packet is being added */
+                NtYieldExecution();
+                continue;
+            }
+        }
+
+        /* user APCs are only delivered by the server */
+        if (alertable) break;
+
+        InterlockedIncrement( (LONG *)&queue->waiters );
+        if (end)
+        {
+            LONGLONG timeleft = update_timeout( end->QuadPart );
+            struct timespec timespec;
+
+            if (!timeleft)
+            {
+                InterlockedDecrement( (LONG *)&queue->waiters );
+                server_release_inproc_sync( sync );
+                /* same as server_wait() */
+                NtYieldExecution();
+                return STATUS_TIMEOUT;
+            }
+            timespec.tv_sec = timeleft / (ULONGLONG)TICKSPERSEC;
+            timespec.tv_nsec = (timeleft % TICKSPERSEC) * 100;
+            futex_wait_shared( (LONG *)&sync->state, state, &timespec );
+        }
+        else
+            futex_wait_shared( (LONG *)&sync->state, state, NULL );
+        InterlockedDecrement( (LONG *)&queue->waiters );
+    }
+
+done:
+    server_release_inproc_sync( sync );
+    if (ret == STATUS_NOT_IMPLEMENTED && end) *timeout = end;
+    return ret;
+}
+
+#else  /* __linux__ */
+
+static inline NTSTATUS inproc_event_op( HANDLE handle, int op, LONG *prev_state )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS inproc_release_semaphore( HANDLE handle, ULONG count, ULONG *previous )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS inproc_release_mutex( HANDLE handle, LONG *prev_count )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS inproc_wait( HANDLE handle, BOOLEAN alertable, const LARGE_INTEGER **timeout,
+                                    LARGE_INTEGER *end_time )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS inproc_set_completion( HANDLE handle, ULONG_PTR key, ULONG_PTR value,
+                                              NTSTATUS status, SIZE_T count )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS inproc_remove_completion( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
+                                                 ULONG *written, BOOLEAN alertable, const LARGE_INTEGER **timeout,
+                                                 LARGE_INTEGER *end_time )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+#endif  /* __linux__ */
+
+
 /* create a struct security_descriptor and contained information in one contiguous piece of memory */
 unsigned int alloc_object_attributes( const OBJECT_ATTRIBUTES *attr, struct object_attributes **ret,
                                       data_size_t *ret_len )
@@ -337,6 +813,9 @@ NTSTATUS WINAPI NtReleaseSemaphore( HANDLE handle, ULONG count, ULONG *previous
 {
     unsigned int ret;
 
+    if ((ret = inproc_release_semaphore( handle, count, previous )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( release_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -413,6 +892,9 @@ NTSTATUS WINAPI NtSetEvent( HANDLE handle, LONG *prev_state )
 {
     unsigned int ret;
 
+    if ((ret = inproc_event_op( handle, SET_EVENT, prev_state )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -432,6 +914,9 @@ NTSTATUS WINAPI NtResetEvent( HANDLE handle, LONG *prev_state )
 {
     unsigned int ret;
 
+    if ((ret = inproc_event_op( handle, RESET_EVENT, prev_state )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -567,6 +1052,9 @@ NTSTATUS WINAPI NtReleaseMutant( HANDLE handle, LONG *prev_count )
 {
     unsigned int ret;
 
+    if ((ret = inproc_release_mutex( handle, prev_count )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( release_mutex )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -1514,9 +2002,14 @@ NTSTATUS WINAPI NtWaitForMultipleObjects( DWORD count, const HANDLE *handles, BO
 {
     select_op_t select_op;
     UINT i, flags = SELECT_INTERRUPTIBLE;
+    LARGE_INTEGER end_time;
+    NTSTATUS ret;
 
     if (!count || count > MAXIMUM_WAIT_OBJECTS) return STATUS_INVALID_PARAMETER_1;
 
+    if (count == 1 && (ret = inproc_wait( handles[0], alertable, &timeout, &end_time )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     if (alertable) flags |= SELECT_ALERTABLE;
     select_op.wait.op = wait_any ? SELECT_WAIT : SELECT_WAIT_ALL;
     for (i = 0; i < count; i++) select_op.wait.handles[i] = wine_server_obj_handle( handles[i] );
@@ -1919,6 +2412,9 @@ NTSTATUS WINAPI NtSetIoCompletion( HANDLE handle, ULONG_PTR key, ULONG_PTR value
 
     TRACE( "(%p, %lx, %lx, %x, %lx)\n", handle, key, value, (int)status, count );
 
+    if ((ret = inproc_set_completion( handle, key, value, status, count )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( add_completion )
     {
         req->handle      = wine_server_obj_handle( handle );
@@ -1939,10 +2435,26 @@ NTSTATUS WINAPI NtSetIoCompletion( HANDLE handle, ULONG_PTR key, ULONG_PTR value
 NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *value,
                                       IO_STATUS_BLOCK *io, LARGE_INTEGER *timeout )
 {
+    const LARGE_INTEGER *wait_timeout = timeout;
+    FILE_IO_COMPLETION_INFORMATION info;
+    LARGE_INTEGER end_time;
     unsigned int status;
+    ULONG written;
 
     TRACE( "(%p, %p, %p, %p, %p)\n", handle, key, value, io, timeout );
 
+    if ((status = inproc_remove_completion( handle, &info, 1, &written, FALSE, &wait_timeout,
+                                            &end_time )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (!status)
+        {
+            *key   = info.CompletionKey;
+            *value = info.CompletionValue;
+            *io    = info.IoStatusBlock;
+        }
+        return status;
+    }
+
     for (;;)
     {
         SERVER_START_REQ( remove_completion )
@@ -1958,7 +2470,7 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *
         }
         SERVER_END_REQ;
         if (status != STATUS_PENDING) return status;
-        status = NtWaitForSingleObject( handle, FALSE, timeout );
+        status = NtWaitForSingleObject( handle, FALSE, wait_timeout );
         if (status != WAIT_OBJECT_0) return status;
     }
 }
@@ -1970,11 +2482,20 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *
 NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
                                         ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
 {
+    const LARGE_INTEGER *wait_timeout = timeout;
+    LARGE_INTEGER end_time;
     unsigned int status;
     ULONG i = 0;
 
     TRACE( "%p %p %u %p %p %u\n", handle, info, (int)count, written, timeout, alertable );
 
+    if ((status = inproc_remove_completion( handle, info, count, written, alertable, &wait_timeout,
+                                            &end_time )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (status) *written = 1;
+        return status;
+    }
+
     for (;;)
     {
         while (i < count)
@@ -1999,7 +2520,7 @@ NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORM
             if (status == STATUS_PENDING) status = STATUS_SUCCESS;
             break;
         }
-        status = NtWaitForSingleObject( handle, alertable, timeout );
+        status = NtWaitForSingleObject( handle, alertable, wait_timeout );
         if (status != WAIT_OBJECT_0) break;
     }
     *written = i ? i : 1;
@@ -2537,29 +3058,6 @@ NTSTATUS WINAPI NtAlertThreadByThreadId( HANDLE tid )
 }
 
 
-#if defined(__linux__) || defined(HAVE_KQUEUE)
-static LONGLONG get_absolute_timeout( const LARGE_INTEGER *timeout )
-{
-    LARGE_INTEGER now;
-
-    if (timeout->QuadPart >= 0) return timeout->QuadPart;
-    NtQuerySystemTime( &now );
-    return now.QuadPart - timeout->QuadPart;
-}
-
-static LONGLONG update_timeout( ULONGLONG end )
-{
-    LARGE_INTEGER now;
-    LONGLONG timeleft;
-
-    NtQuerySystemTime( &now );
-    timeleft = end - now.QuadPart;
-    if (timeleft < 0) timeleft = 0;
-    return timeleft;
-}
-#endif
-
-
 #ifdef HAVE_KQUEUE
 
 /***********************************************************************
@@ -140,6 +140,8 @@ extern void *pKiUserCallbackDispatcher;
 extern void *pLdrInitializeThunk;
 extern void *pRtlUserThreadStart;
 extern void *p__wine_ctrl_routine;
+extern void *p__wine_io_uring_thread;
+extern void *p__wine_sock_poll_thread;
 extern SYSTEM_DLL_INIT_BLOCK *pLdrSystemDllInitBlock;
 
 struct _FILE_FS_DEVICE_INFORMATION;
@@ -172,6 +174,7 @@ extern timeout_t server_start_time;
 extern sigset_t server_block_set;
 extern struct _KUSER_SHARED_DATA *user_shared_data;
 extern SYSTEM_CPU_INFORMATION cpu_info;
+extern mode_t start_umask;
 #ifdef __i386__
 extern struct ldt_copy __wine_ldt_copy;
 #endif
@@ -193,6 +196,8 @@ extern NTSTATUS load_main_exe( const WCHAR *name, const char *unix_name, const W
 extern NTSTATUS load_start_exe( WCHAR **image, void **module );
 extern ULONG_PTR redirect_arm64ec_rva( void *module, ULONG_PTR rva, const IMAGE_ARM64EC_METADATA *metadata );
 extern void start_server( BOOL debug );
+extern NTSTATUS zygote_spawn( char **argv, int socketfd, int stdin_fd, int stdout_fd, int unixdir,
+                              BOOL detach, const char *winedebug, const pe_image_info_t *pe_info );
 
 extern unsigned int server_call_unlocked( void *req_ptr );
 extern void server_enter_uninterrupted_section( pthread_mutex_t *mutex, sigset_t *sigset );
@@ -205,7 +210,16 @@ extern unsigned int server_queue_process_apc( HANDLE process, const apc_call_t *
                                               apc_result_t *result );
 extern int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
                                int *needs_close, enum server_fd_type *type, unsigned int *options );
+extern void server_remove_cached_fd( HANDLE handle );
+extern unsigned int server_get_cached_fd_status( HANDLE handle );
+extern BOOL server_get_file_access_mode( HANDLE handle, unsigned int *access, unsigned int *options );
+extern unsigned int server_get_handle_flags( HANDLE handle, unsigned int *flags );
+extern unsigned int server_set_handle_flags( HANDLE handle, unsigned int mask, unsigned int flags );
+extern const char *server_get_dir(void);
 extern void wine_server_send_fd( int fd );
+extern inproc_sync_t *server_get_inproc_sync( HANDLE handle, unsigned int *access );
+extern void server_release_inproc_sync( inproc_sync_t *sync );
+extern inproc_completion_t *server_get_inproc_completion( inproc_sync_t *sync );
 extern void process_exit_wrapper( int status ) DECLSPEC_NORETURN;
 extern size_t server_init_process(void);
 extern void server_init_process_done(void);
@@ -250,6 +264,8 @@ extern NTSTATUS get_thread_context( HANDLE handle, void *context, BOOL *self, US
 extern unsigned int alloc_object_attributes( const OBJECT_ATTRIBUTES *attr, struct object_attributes **ret,
                                              data_size_t *ret_len );
 extern NTSTATUS system_time_precise( void *args );
+extern NTSTATUS io_uring_thread( void *args );
+extern NTSTATUS sock_poll_thread( void *args );
 
 extern void *anon_mmap_fixed( void *start, size_t size, int prot, int flags );
 extern void *anon_mmap_alloc( size_t size, int prot );
@@ -278,6 +294,7 @@ extern ssize_t virtual_locked_read( int fd, void *addr, size_t size );
 extern ssize_t virtual_locked_pread( int fd, void *addr, size_t size, off_t offset );
 extern ssize_t virtual_locked_recvmsg( int fd, struct msghdr *hdr, int flags );
 extern BOOL virtual_is_valid_code_address( const void *addr, SIZE_T size );
+extern BOOL virtual_has_write_watch( const void *addr, SIZE_T size );
 extern void *virtual_setup_exception( void *stack_ptr, size_t size, EXCEPTION_RECORD *rec );
 extern BOOL virtual_check_buffer_for_read( const void *ptr, SIZE_T size );
 extern BOOL virtual_check_buffer_for_write( void *ptr, SIZE_T size );
@@ -152,6 +152,8 @@ static const BYTE VIRTUAL_Win32Flags[16] =
 
 static struct wine_rb_tree views_tree;
 static pthread_mutex_t virtual_mutex;
+static unsigned int virtual_mutex_depth;  /* recursion count of virtual_mutex */
+static unsigned int views_seq;            /* sequence count for lockless lookups, odd while views are modified */
 
 static const UINT page_shift = 12;
 static const UINT_PTR page_mask = 0xfff;
@@ -210,6 +212,7 @@ static const size_t view_block_size = 0x100000;
 static void *preload_reserve_start;
 static void *preload_reserve_end;
 static BOOL force_exec_prot;  /* whether to force PROT_EXEC on all PROT_READ mmaps */
+static BOOL use_huge_pages;   /* whether to advise huge pages for large committed allocations */
 
 struct range_entry
 {
@@ -588,6 +591,97 @@ static void add_builtin_module( void *module, void *handle )
 }
 
 
+/***********************************************************************
+ *           begin_views_update
+ *
+ * Mark the views as being modified, to make concurrent lockless lookups retry.
+ * virtual_mutex must be held by caller; the views are marked stable again when it is released.
+ */
+static inline void begin_views_update(void)
+{
+    if (views_seq & 1) return;
+    __atomic_store_n( &views_seq, views_seq + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+}
+
+
+/***********************************************************************
+ *           end_views_update
+ *
+ * Mark the views as stable again. virtual_mutex must be held by caller.
+ */
+static inline void end_views_update(void)
+{
+    if (!(views_seq & 1)) return;
+    __atomic_store_n( &views_seq, views_seq + 1, __ATOMIC_RELEASE );
+}
+
+
+/***********************************************************************
+ *           views_read_begin
+ *
+ * Start a lockless lookup of the views. Returns an odd value if the views are being modified.
+ */
+static inline unsigned int views_read_begin(void)
+{
+    return __atomic_load_n( &views_seq, __ATOMIC_ACQUIRE );
+}
+
+
+/***********************************************************************
+ *           views_read_retry
+ *
+ * Check whether the views have been modified during a lockless lookup.
+ */
+static inline BOOL views_read_retry( unsigned int seq )
+{
+    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    return __atomic_load_n( &views_seq, __ATOMIC_RELAXED ) != seq;
+}
+
+
+/***********************************************************************
+ *           virtual_enter_section
+ */
+static void virtual_enter_section( sigset_t *sigset )
+{
+    server_enter_uninterrupted_section( &virtual_mutex, sigset );
+    virtual_mutex_depth++;
+}
+
+
+/***********************************************************************
+ *           virtual_leave_section
+ */
+static void virtual_leave_section( sigset_t *sigset )
+{
+    if (!--virtual_mutex_depth) end_views_update();
+    server_leave_uninterrupted_section( &virtual_mutex, sigset );
+}
+
+
+/***********************************************************************
+ *           virtual_mutex_lock
+ *
+ * Lock the virtual mutex without blocking signals, for use inside signal handlers.
+ */
+static void virtual_mutex_lock(void)
+{
+    mutex_lock( &virtual_mutex );
+    virtual_mutex_depth++;
+}
+
+
+/***********************************************************************
+ *           virtual_mutex_unlock
+ */
+static void virtual_mutex_unlock(void)
+{
+    if (!--virtual_mutex_depth) end_views_update();
+    mutex_unlock( &virtual_mutex );
+}
+
+
 /***********************************************************************
  *           release_builtin_module
  */
@@ -620,7 +714,7 @@ void *get_builtin_so_handle( void *module )
     void *ret = NULL;
     struct builtin_module *builtin;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     LIST_FOR_EACH_ENTRY( builtin, &builtin_modules, struct builtin_module, entry )
     {
         if (builtin->module != module) continue;
@@ -628,7 +722,7 @@ void *get_builtin_so_handle( void *module )
         if (ret) builtin->refcount++;
         break;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     return ret;
 }
 
@@ -643,7 +737,7 @@ static NTSTATUS get_builtin_unix_funcs( void *module, BOOL wow, const void **fun
     NTSTATUS status = STATUS_DLL_NOT_FOUND;
     struct builtin_module *builtin;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     LIST_FOR_EACH_ENTRY( builtin, &builtin_modules, struct builtin_module, entry )
     {
         if (builtin->module != module) continue;
@@ -656,7 +750,7 @@ static NTSTATUS get_builtin_unix_funcs( void *module, BOOL wow, const void **fun
         }
         break;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     return status;
 }
 
@@ -670,7 +764,7 @@ NTSTATUS load_builtin_unixlib( void *module, const char *name )
     NTSTATUS status = STATUS_SUCCESS;
     struct builtin_module *builtin;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     LIST_FOR_EACH_ENTRY( builtin, &builtin_modules, struct builtin_module, entry )
     {
         if (builtin->module != module) continue;
@@ -678,7 +772,7 @@ NTSTATUS load_builtin_unixlib( void *module, const char *name )
         else status = STATUS_IMAGE_ALREADY_LOADED;
         break;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     return status;
 }
 
@@ -952,6 +1046,7 @@ static void set_page_vprot( const void *addr, size_t size, BYTE vprot )
     size_t idx = (size_t)addr >> page_shift;
     size_t end = ((size_t)addr + size + page_mask) >> page_shift;
 
+    begin_views_update();
 #ifdef _WIN64
     while (idx >> pages_vprot_shift != end >> pages_vprot_shift)
     {
@@ -976,6 +1071,7 @@ static void set_page_vprot_bits( const void *addr, size_t size, BYTE set, BYTE c
     size_t idx = (size_t)addr >> page_shift;
     size_t end = ((size_t)addr + size + page_mask) >> page_shift;
 
+    begin_views_update();
 #ifdef _WIN64
     for ( ; idx < end; idx++)
     {
@@ -1165,12 +1261,12 @@ static void VIRTUAL_Dump(void)
     struct file_view *view;
 
     TRACE( "Dump of all virtual memory views:\n" );
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     WINE_RB_FOR_EACH_ENTRY( view, &views_tree, struct file_view, entry )
     {
         dump_view( view );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
 }
 #endif
 
@@ -1487,6 +1583,7 @@ static void unmap_area( void *start, size_t size )
  */
 static struct file_view *alloc_view(void)
 {
+    begin_views_update();
     if (next_free_view)
     {
         struct file_view *ret = next_free_view;
@@ -1511,6 +1608,7 @@ static struct file_view *alloc_view(void)
  */
 static void free_view( struct file_view *view )
 {
+    begin_views_update();
     *(struct file_view **)view = next_free_view;
     next_free_view = view;
 }
@@ -1523,6 +1621,7 @@ static void free_view( struct file_view *view )
  */
 static void unregister_view( struct file_view *view )
 {
+    begin_views_update();
     if (mmap_is_in_reserved_area( view->base, view->size ))
         free_ranges_remove_view( view );
     wine_rb_remove( &views_tree, &view->entry );
@@ -1551,6 +1650,7 @@ static void delete_view( struct file_view *view ) /* [in] View */
  */
 static void register_view( struct file_view *view )
 {
+    begin_views_update();
     wine_rb_put( &views_tree, view->base, &view->entry );
     if (mmap_is_in_reserved_area( view->base, view->size ))
         free_ranges_insert_view( view );
@@ -1777,6 +1877,7 @@ static void commit_arm64ec_map( struct file_view *view )
     size_t size = ROUND_SIZE( start, end + 1 - start );
     void *base = ROUND_ADDR( (char *)arm64ec_view->base + start, page_mask );
 
+    begin_views_update();
     view->protect |= VPROT_ARM64EC;
     set_vprot( arm64ec_view, base, size, VPROT_READ | VPROT_WRITE | VPROT_COMMITTED );
 }
@@ -1991,6 +2092,7 @@ static NTSTATUS map_view( struct file_view **view_ret, void *base, size_t size,
 
         TRACE( "found view %p, size %p, protect %#x.\n", view->base, (void *)view->size, view->protect );
 
+        begin_views_update();
         view->protect = vprot | VPROT_PLACEHOLDER;
         set_vprot( view, base, size, vprot );
         if (vprot & VPROT_WRITEWATCH) reset_write_watches( base, size );
@@ -2267,6 +2369,7 @@ static NTSTATUS free_pages_preserve_placeholder( struct file_view *view, char *b
         if (status) return status;
     }
 
+    begin_views_update();
     view->protect = VPROT_PLACEHOLDER | VPROT_FREE_PLACEHOLDER;
     set_page_vprot( view->base, view->size, 0 );
     anon_mmap_fixed( view->base, view->size, PROT_NONE, 0 );
@@ -3076,7 +3179,7 @@ static NTSTATUS virtual_map_image( HANDLE mapping, void **addr_ptr, SIZE_T *size
         SERVER_END_REQ;
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
 
     status = map_image_view( &view, image_info, size, limit_low, limit_high, alloc_type );
     if (status) goto done;
@@ -3105,7 +3208,7 @@ static NTSTATUS virtual_map_image( HANDLE mapping, void **addr_ptr, SIZE_T *size
     else delete_view( view );
 
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     if (needs_close) close( unix_fd );
     if (shared_needs_close) close( shared_fd );
     return status;
@@ -3203,7 +3306,7 @@ static unsigned int virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_P
 
     if ((res = server_get_unix_fd( handle, 0, &unix_handle, &needs_close, NULL, NULL ))) return res;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
 
     res = map_view( &view, base, size, alloc_type, vprot, limit_low, limit_high, 0 );
     if (res) goto done;
@@ -3234,7 +3337,7 @@ static unsigned int virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_P
     else delete_view( view );
 
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     if (needs_close) close( unix_handle );
     return res;
 }
@@ -3281,6 +3384,7 @@ void virtual_init(void)
 {
     const struct preload_info **preload_info = dlsym( RTLD_DEFAULT, "wine_main_preload_info" );
     const char *preload = getenv( "WINEPRELOADRESERVE" );
+    const char *huge_pages = getenv( "WINEHUGEPAGES" );
     size_t size;
     int i;
     pthread_mutexattr_t attr;
@@ -3303,6 +3407,8 @@ void virtual_init(void)
 
     mmap_init( preload_info ? *preload_info : NULL );
 
+    use_huge_pages = huge_pages && atoi( huge_pages );
+
     if ((preload = getenv("WINEPRELOADRESERVE")))
     {
         unsigned long start, end;
@@ -3496,7 +3602,7 @@ NTSTATUS virtual_create_builtin_view( void *module, const UNICODE_STRING *nt_nam
     void *base = wine_server_get_ptr( info->base );
     int i;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     status = create_view( &view, base, size, SEC_IMAGE | SEC_FILE | VPROT_SYSTEM |
                           VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY | VPROT_EXEC );
     if (!status)
@@ -3533,7 +3639,7 @@ NTSTATUS virtual_create_builtin_view( void *module, const UNICODE_STRING *nt_nam
         }
         else delete_view( view );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
 
     return status;
 }
@@ -3703,7 +3809,7 @@ NTSTATUS virtual_alloc_teb( TEB **ret_teb )
     NTSTATUS status = STATUS_SUCCESS;
     SIZE_T block_size = signal_stack_mask + 1;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     if (next_free_teb)
     {
         ptr = next_free_teb;
@@ -3719,7 +3825,7 @@ NTSTATUS virtual_alloc_teb( TEB **ret_teb )
             if ((status = NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, user_space_wow_limit,
                                                    &total, MEM_RESERVE, PAGE_READWRITE )))
             {
-                server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+                virtual_leave_section( &sigset );
                 return status;
             }
             teb_block = ptr;
@@ -3731,14 +3837,14 @@ NTSTATUS virtual_alloc_teb( TEB **ret_teb )
     }
     TRACE_(unixpid)("NtCurrentTeb()=%p teb=%p is_wow64()=%d\n", NtCurrentTeb(), ptr, is_wow64());
     *ret_teb = teb = init_teb( ptr, is_wow64() );
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
 
     if ((status = signal_alloc_thread( teb )))
     {
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_enter_section( &sigset );
         *(void **)ptr = next_free_teb;
         next_free_teb = ptr;
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_leave_section( &sigset );
     }
     return status;
 }
@@ -3779,13 +3885,13 @@ void virtual_free_teb( TEB *teb )
         NtFreeVirtualMemory( GetCurrentProcess(), &ptr, &size, MEM_RELEASE );
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     list_remove( &thread_data->entry );
     ptr = teb;
     if (!is_win64) ptr = (char *)ptr - teb_offset;
     *(void **)ptr = next_free_teb;
     next_free_teb = ptr;
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
 }
 
 
@@ -3799,7 +3905,7 @@ NTSTATUS virtual_clear_tls_index( ULONG index )
 
     if (index < TLS_MINIMUM_AVAILABLE)
     {
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_enter_section( &sigset );
         LIST_FOR_EACH_ENTRY( thread_data, &teb_list, struct ntdll_thread_data, entry )
         {
             TEB *teb = CONTAINING_RECORD( thread_data, TEB, GdiTebBatch );
@@ -3810,14 +3916,14 @@ NTSTATUS virtual_clear_tls_index( ULONG index )
 #endif
             teb->TlsSlots[index] = 0;
         }
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_leave_section( &sigset );
     }
     else
     {
         index -= TLS_MINIMUM_AVAILABLE;
         if (index >= 8 * sizeof(peb->TlsExpansionBitmapBits)) return STATUS_INVALID_PARAMETER;
 
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_enter_section( &sigset );
         LIST_FOR_EACH_ENTRY( thread_data, &teb_list, struct ntdll_thread_data, entry )
         {
             TEB *teb = CONTAINING_RECORD( thread_data, TEB, GdiTebBatch );
@@ -3832,7 +3938,7 @@ NTSTATUS virtual_clear_tls_index( ULONG index )
 #endif
             if (teb->TlsExpansionSlots) teb->TlsExpansionSlots[index] = 0;
         }
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_leave_section( &sigset );
     }
     return STATUS_SUCCESS;
 }
@@ -3856,7 +3962,7 @@ NTSTATUS virtual_alloc_thread_stack( INITIAL_TEB *stack, ULONG_PTR limit_low, UL
     if (size < 1024 * 1024) size = 1024 * 1024;  /* Xlib needs a large stack */
     size = (size + 0xffff) & ~0xffff;  /* round to 64K boundary */
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
 
     status = map_view( &view, NULL, size, 0, VPROT_READ | VPROT_WRITE | VPROT_COMMITTED,
                        limit_low, limit_high, 0 );
@@ -3883,7 +3989,7 @@ NTSTATUS virtual_alloc_thread_stack( INITIAL_TEB *stack, ULONG_PTR limit_low, UL
     stack->StackBase = (char *)view->base + view->size;
     stack->StackLimit = (char *)view->base + (guard_page ? 2 * page_size : 0);
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     return status;
 }
 
@@ -3989,10 +4095,7 @@ NTSTATUS virtual_handle_fault( void *addr, DWORD err, void *stack )
 {
     NTSTATUS ret = STATUS_ACCESS_VIOLATION;
     char *page = ROUND_ADDR( addr, page_mask );
-    BYTE vprot;
-
-    mutex_lock( &virtual_mutex );  /* no need for signal masking inside signal handler */
-    vprot = get_page_vprot( page );
+    BYTE vprot = get_page_vprot( page );
 
 #ifdef __APPLE__
     /* Rosetta on Apple Silicon misreports certain write faults as read faults. */
@@ -4003,6 +4106,14 @@ NTSTATUS virtual_handle_fault( void *addr, DWORD err, void *stack )
     }
 #endif
 
+    /* plain access violations don't modify anything, no need to take the lock for them */
+    if (!(vprot & (VPROT_GUARD | VPROT_WRITEWATCH)) &&
+        !((err & EXCEPTION_WRITE_FAULT) && (get_unix_prot( vprot ) & PROT_WRITE)))
+        return ret;
+
+    virtual_mutex_lock();  /* no need for signal masking inside signal handler */
+    vprot = get_page_vprot( page );
+
     if (!is_inside_signal_stack( stack ) && (vprot & VPROT_GUARD))
     {
         struct thread_stack_info stack_info;
@@ -4028,7 +4139,7 @@ NTSTATUS virtual_handle_fault( void *addr, DWORD err, void *stack )
                 ret = STATUS_SUCCESS;
         }
     }
-    mutex_unlock( &virtual_mutex );
+    virtual_mutex_unlock();
     return ret;
 }
 
@@ -4066,14 +4177,14 @@ void *virtual_setup_exception( void *stack_ptr, size_t size, EXCEPTION_RECORD *r
     }
     else if (stack < stack_info.limit)
     {
-        mutex_lock( &virtual_mutex );  /* no need for signal masking inside signal handler */
+        virtual_mutex_lock();  /* no need for signal masking inside signal handler */
         if ((get_page_vprot( stack ) & VPROT_GUARD) &&
             grow_thread_stack( ROUND_ADDR( stack, page_mask ), &stack_info ))
         {
             rec->ExceptionCode = STATUS_STACK_OVERFLOW;
             rec->NumberParameters = 0;
         }
-        mutex_unlock( &virtual_mutex );
+        virtual_mutex_unlock();
     }
 #if defined(VALGRIND_MAKE_MEM_UNDEFINED)
     VALGRIND_MAKE_MEM_UNDEFINED( stack, size );
@@ -4122,14 +4233,14 @@ unsigned int virtual_locked_server_call( void *req_ptr )
 
     if (!size) return wine_server_call( req_ptr );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     if (!(ret = check_write_access( addr, size, &has_write_watch )))
     {
         ret = server_call_unlocked( req );
         if (has_write_watch) update_write_watches( addr, size, wine_server_reply_size( req ));
     }
     else memset( &req->u.reply, 0, sizeof(req->u.reply) );
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     return ret;
 }
 
@@ -4146,14 +4257,14 @@ ssize_t virtual_locked_read( int fd, void *addr, size_t size )
     ssize_t ret = read( fd, addr, size );
     if (ret != -1 || errno != EFAULT) return ret;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     if (!check_write_access( addr, size, &has_write_watch ))
     {
         ret = read( fd, addr, size );
         err = errno;
         if (has_write_watch) update_write_watches( addr, size, max( 0, ret ));
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     errno = err;
     return ret;
 }
@@ -4171,14 +4282,14 @@ ssize_t virtual_locked_pread( int fd, void *addr, size_t size, off_t offset )
     ssize_t ret = pread( fd, addr, size, offset );
     if (ret != -1 || errno != EFAULT) return ret;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     if (!check_write_access( addr, size, &has_write_watch ))
     {
         ret = pread( fd, addr, size, offset );
         err = errno;
         if (has_write_watch) update_write_watches( addr, size, max( 0, ret ));
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     errno = err;
     return ret;
 }
@@ -4197,7 +4308,7 @@ ssize_t virtual_locked_recvmsg( int fd, struct msghdr *hdr, int flags )
     ssize_t ret = recvmsg( fd, hdr, flags );
     if (ret != -1 || errno != EFAULT) return ret;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     for (i = 0; i < hdr->msg_iovlen; i++)
         if (check_write_access( hdr->msg_iov[i].iov_base, hdr->msg_iov[i].iov_len, &has_write_watch ))
             break;
@@ -4209,7 +4320,7 @@ ssize_t virtual_locked_recvmsg( int fd, struct msghdr *hdr, int flags )
     if (has_write_watch)
         while (i--) update_write_watches( hdr->msg_iov[i].iov_base, hdr->msg_iov[i].iov_len, 0 );
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     errno = err;
     return ret;
 }
@@ -4224,10 +4335,29 @@ BOOL virtual_is_valid_code_address( const void *addr, SIZE_T size )
     BOOL ret = FALSE;
     sigset_t sigset;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     if ((view = find_view( addr, size )))
         ret = !(view->protect & VPROT_SYSTEM);  /* system views are not visible to the app */
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
+    return ret;
+}
+
+
+/***********************************************************************
+ *           virtual_has_write_watch
+ *
+ * Check if a memory range may be write watched, which needs the page faults of
+ * the writing thread. Also returns TRUE if the range isn't part of a single view.
+ */
+BOOL virtual_has_write_watch( const void *addr, SIZE_T size )
+{
+    struct file_view *view;
+    BOOL ret = TRUE;
+    sigset_t sigset;
+
+    virtual_enter_section( &sigset );
+    if ((view = find_view( addr, size ))) ret = !!(view->protect & VPROT_WRITEWATCH);
+    virtual_leave_section( &sigset );
     return ret;
 }
 
@@ -4314,7 +4444,7 @@ SIZE_T virtual_uninterrupted_read_memory( const void *addr, void *buffer, SIZE_T
 
     if (!size) return 0;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     if ((view = find_view( addr, size )))
     {
         if (!(view->protect & VPROT_SYSTEM))
@@ -4330,7 +4460,7 @@ SIZE_T virtual_uninterrupted_read_memory( const void *addr, void *buffer, SIZE_T
             }
         }
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     return bytes_read;
 }
 
@@ -4350,13 +4480,13 @@ NTSTATUS virtual_uninterrupted_write_memory( void *addr, const void *buffer, SIZ
 
     if (!size) return STATUS_SUCCESS;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     if (!(ret = check_write_access( addr, size, &has_write_watch )))
     {
         memcpy( addr, buffer, size );
         if (has_write_watch) update_write_watches( addr, size, size );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     return ret;
 }
 
@@ -4371,7 +4501,7 @@ void virtual_set_force_exec( BOOL enable )
     struct file_view *view;
     sigset_t sigset;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     if (!force_exec_prot != !enable)  /* change all existing views */
     {
         force_exec_prot = enable;
@@ -4384,7 +4514,7 @@ void virtual_set_force_exec( BOOL enable )
             mprotect_range( view->base, view->size, commit, 0 );
         }
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
 }
 
 /* free reserved areas within a given range */
@@ -4457,6 +4587,46 @@ void virtual_set_large_address_space(void)
 }
 
 
+/***********************************************************************
+ *           map_large_pages
+ *
+ * Replace the pages of a newly allocated range by large pages. The range must be aligned
+ * on the large page size. virtual_mutex must be held by caller.
+ */
+static NTSTATUS map_large_pages( void *base, size_t size, unsigned int vprot )
+{
+    int unix_prot = get_unix_prot( vprot );
+
+#ifdef MAP_HUGETLB
+    if (anon_mmap_fixed( base, size, unix_prot, MAP_HUGETLB ) == base) return STATUS_SUCCESS;
+    TRACE( "no huge pages available for %p-%p, falling back to transparent huge pages\n",
+           base, (char *)base + size );
+    /* the failed mmap may have removed the previous mapping */
+    if (anon_mmap_fixed( base, size, unix_prot, 0 ) != base) return STATUS_NO_MEMORY;
+#endif
+#ifdef MADV_HUGEPAGE
+    madvise( base, size, MADV_HUGEPAGE );
+#endif
+    return STATUS_SUCCESS;
+}
+
+
+/***********************************************************************
+ *           advise_huge_pages
+ *
+ * Advise the use of transparent huge pages for large committed ranges, if enabled.
+ */
+static void advise_huge_pages( struct file_view *view, void *base, size_t size )
+{
+#ifdef MADV_HUGEPAGE
+    if (!use_huge_pages) return;
+    if (view->protect & (SEC_FILE | SEC_IMAGE | SEC_RESERVE | SEC_COMMIT)) return;
+    if (size < 8 * (size_t)user_shared_data->LargePageMinimum) return;
+    madvise( base, size, MADV_HUGEPAGE );
+#endif
+}
+
+
 /***********************************************************************
  *             allocate_virtual_memory
  *
@@ -4514,9 +4684,20 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
     if (type & MEM_RESERVE_PLACEHOLDER && (protect != PAGE_NOACCESS)) return STATUS_INVALID_PARAMETER;
     if (!arm64ec_view && (attributes & MEM_EXTENDED_PARAMETER_EC_CODE)) return STATUS_INVALID_PARAMETER;
 
+    if (type & MEM_LARGE_PAGES)
+    {
+        SIZE_T large_page_mask = user_shared_data->LargePageMinimum - 1;
+
+        if (!user_shared_data->LargePageMinimum) return STATUS_NOT_SUPPORTED;
+        if ((type & (MEM_COMMIT | MEM_RESERVE)) != (MEM_COMMIT | MEM_RESERVE)) return STATUS_INVALID_PARAMETER;
+        if (is_dos_memory || ((UINT_PTR)base & large_page_mask) || (size & large_page_mask))
+            return STATUS_INVALID_PARAMETER;
+        if (align <= large_page_mask) align = large_page_mask + 1;
+    }
+
     /* Reserve the memory */
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
 
     if ((type & MEM_RESERVE) || !base)
     {
@@ -4532,7 +4713,15 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
             else status = map_view( &view, base, size, type, vprot, limit_low, limit_high,
                                     align ? align - 1 : granularity_mask );
 
-            if (status == STATUS_SUCCESS) base = view->base;
+            if (status == STATUS_SUCCESS)
+            {
+                base = view->base;
+                if (type & MEM_LARGE_PAGES)
+                {
+                    if ((status = map_large_pages( base, size, vprot ))) delete_view( view );
+                }
+                else if (type & MEM_COMMIT) advise_huge_pages( view, base, size );
+            }
         }
     }
     else if (type & MEM_RESET)
@@ -4556,6 +4745,7 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
             }
             SERVER_END_REQ;
         }
+        else if (!status) advise_huge_pages( view, base, size );
     }
 
     if (!status && (attributes & MEM_EXTENDED_PARAMETER_EC_CODE))
@@ -4566,7 +4756,7 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
 
     if (!status) VIRTUAL_DEBUG_DUMP_VIEW( view );
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
 
     if (status == STATUS_SUCCESS)
     {
@@ -4587,7 +4777,8 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
 NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR zero_bits,
                                          SIZE_T *size_ptr, ULONG type, ULONG protect )
 {
-    static const ULONG type_mask = MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET;
+    static const ULONG type_mask = MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET
+                                   | MEM_LARGE_PAGES;
     ULONG_PTR limit;
 
     TRACE("%p %p %08lx %x %08x\n", process, *ret, *size_ptr, (int)type, (int)protect );
@@ -4727,7 +4918,8 @@ NTSTATUS WINAPI NtAllocateVirtualMemoryEx( HANDLE process, PVOID *ret, SIZE_T *s
                                            ULONG count )
 {
     static const ULONG type_mask = MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH
-                                   | MEM_RESET | MEM_RESERVE_PLACEHOLDER | MEM_REPLACE_PLACEHOLDER;
+                                   | MEM_RESET | MEM_RESERVE_PLACEHOLDER | MEM_REPLACE_PLACEHOLDER
+                                   | MEM_LARGE_PAGES;
     ULONG_PTR limit_low = 0;
     ULONG_PTR limit_high = 0;
     ULONG_PTR align = 0;
@@ -4820,7 +5012,7 @@ NTSTATUS WINAPI NtFreeVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T *si
     if (size) size = ROUND_SIZE( addr, size );
     base = ROUND_ADDR( addr, page_mask );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
 
     /* avoid freeing the DOS area when a broken app passes a NULL pointer */
     if (!base)
@@ -4865,7 +5057,7 @@ NTSTATUS WINAPI NtFreeVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T *si
         *addr_ptr = base;
         *size_ptr = size;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     return status;
 }
 
@@ -4919,7 +5111,7 @@ NTSTATUS WINAPI NtProtectVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T
     size = ROUND_SIZE( addr, size );
     base = ROUND_ADDR( addr, page_mask );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
 
     if ((view = find_view( base, size )))
     {
@@ -4935,7 +5127,7 @@ NTSTATUS WINAPI NtProtectVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T
 
     if (!status) VIRTUAL_DEBUG_DUMP_VIEW( view );
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
 
     if (status == STATUS_SUCCESS)
     {
@@ -4947,6 +5139,88 @@ NTSTATUS WINAPI NtProtectVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T
 }
 
 
+/***********************************************************************
+ *           fill_basic_memory_info_lockless
+ *
+ * Try to fill the memory information without taking virtual_mutex.
+ * Returns FALSE if the views were modified during the lookup, or if the lock is needed.
+ */
+static BOOL fill_basic_memory_info_lockless( char *base, MEMORY_BASIC_INFORMATION *info )
+{
+    char *alloc_base = 0, *alloc_end = working_set_limit;
+    char *view_base = NULL;
+    struct wine_rb_entry *ptr;
+    struct file_view *view = NULL;
+    unsigned int seq, depth = 0, protect;
+    SIZE_T view_size;
+    BYTE vprot;
+
+    if ((seq = views_read_begin()) & 1) return FALSE;
+
+    /* views are never unmapped, so following stale pointers is safe, but they may form a loop */
+    ptr = __atomic_load_n( &views_tree.root, __ATOMIC_RELAXED );
+    while (ptr)
+    {
+        if (++depth > 128) return FALSE;
+        view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+        view_base = __atomic_load_n( &view->base, __ATOMIC_RELAXED );
+        view_size = __atomic_load_n( &view->size, __ATOMIC_RELAXED );
+        if (view_base > base)
+        {
+            alloc_end = view_base;
+            ptr = __atomic_load_n( &ptr->left, __ATOMIC_RELAXED );
+        }
+        else if (view_base + view_size <= base)
+        {
+            alloc_base = view_base + view_size;
+            ptr = __atomic_load_n( &ptr->right, __ATOMIC_RELAXED );
+        }
+        else
+        {
+            alloc_base = view_base;
+            alloc_end = view_base + view_size;
+            break;
+        }
+    }
+
+    info->BaseAddress = base;
+
+    if (!ptr)
+    {
+#ifdef __i386__
+        /* reserved areas need to be checked under the lock */
+        return FALSE;
+#else
+        info->RegionSize        = alloc_end - base;
+        info->State             = MEM_FREE;
+        info->Protect           = PAGE_NOACCESS;
+        info->AllocationBase    = 0;
+        info->AllocationProtect = 0;
+        info->Type              = 0;
+        return !views_read_retry( seq );
+#endif
+    }
+
+    /* committed ranges of SEC_RESERVE mappings are queried from the server */
+    protect = __atomic_load_n( &view->protect, __ATOMIC_RELAXED );
+    if (protect & SEC_RESERVE) return FALSE;
+
+    /* make sure the view was valid before looking at its page protections */
+    if (views_read_retry( seq )) return FALSE;
+
+    info->AllocationBase = alloc_base;
+    info->RegionSize = get_vprot_range_size( base, alloc_end - base, ~VPROT_WRITEWATCH, &vprot );
+    info->State = (vprot & VPROT_COMMITTED) ? MEM_COMMIT : MEM_RESERVE;
+    info->Protect = (vprot & VPROT_COMMITTED) ? get_win32_prot( vprot, protect ) : 0;
+    info->AllocationProtect = get_win32_prot( protect, protect );
+    if (protect & SEC_IMAGE) info->Type = MEM_IMAGE;
+    else if (protect & (SEC_FILE | SEC_RESERVE | SEC_COMMIT)) info->Type = MEM_MAPPED;
+    else info->Type = MEM_PRIVATE;
+
+    return !views_read_retry( seq );
+}
+
+
 static unsigned int fill_basic_memory_info( const void *addr, MEMORY_BASIC_INFORMATION *info )
 {
     char *base, *alloc_base = 0, *alloc_end = working_set_limit;
@@ -4958,9 +5232,11 @@ static unsigned int fill_basic_memory_info( const void *addr, MEMORY_BASIC_INFOR
 
     if (is_beyond_limit( base, 1, working_set_limit )) return STATUS_INVALID_PARAMETER;
 
+    if (fill_basic_memory_info_lockless( base, info )) return STATUS_SUCCESS;
+
     /* Find the view containing the address */
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     ptr = views_tree.root;
     while (ptr)
     {
@@ -5054,7 +5330,7 @@ static unsigned int fill_basic_memory_info( const void *addr, MEMORY_BASIC_INFOR
         else if (view->protect & (SEC_FILE | SEC_RESERVE | SEC_COMMIT)) info->Type = MEM_MAPPED;
         else info->Type = MEM_PRIVATE;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
 
     return STATUS_SUCCESS;
 }
@@ -5164,7 +5440,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
         if (vmentries == NULL)
             WARN( "couldn't get process vmmap, errno %d\n", errno );
 
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_enter_section( &sigset );
         for (p = info; (UINT_PTR)(p + 1) <= (UINT_PTR)info + len; p++)
         {
              int i;
@@ -5191,7 +5467,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
                      p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
              }
         }
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_leave_section( &sigset );
 
         if (vmentries)
             procstat_freevmmap( pstat, vmentries );
@@ -5201,7 +5477,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
             procstat_close( pstat );
     }
 #else
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     if (pagemap_fd == -2)
     {
 #ifdef O_CLOEXEC
@@ -5240,7 +5516,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
                 p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
         }
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
 #endif
 
     if (res_len)
@@ -5618,7 +5894,7 @@ static NTSTATUS unmap_view_of_section( HANDLE process, PVOID addr, ULONG flags )
         return status;
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     if (!(view = find_view( addr, 0 )) || is_view_valloc( view )) goto done;
 
     if (flags & MEM_PRESERVE_PLACEHOLDER && !(view->protect & VPROT_PLACEHOLDER))
@@ -5637,7 +5913,7 @@ static NTSTATUS unmap_view_of_section( HANDLE process, PVOID addr, ULONG flags )
             {
                 TRACE( "not freeing in-use builtin %p\n", view->base );
                 builtin->refcount--;
-                server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+                virtual_leave_section( &sigset );
                 return STATUS_SUCCESS;
             }
         }
@@ -5657,7 +5933,7 @@ static NTSTATUS unmap_view_of_section( HANDLE process, PVOID addr, ULONG flags )
     }
     else FIXME( "failed to unmap %p %x\n", view->base, status );
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     return status;
 }
 
@@ -5809,7 +6085,7 @@ NTSTATUS WINAPI NtFlushVirtualMemory( HANDLE process, LPCVOID *addr_ptr,
         return result.virtual_flush.status;
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
     if (!(view = find_view( addr, *size_ptr ))) status = STATUS_INVALID_PARAMETER;
     else
     {
@@ -5819,7 +6095,7 @@ NTSTATUS WINAPI NtFlushVirtualMemory( HANDLE process, LPCVOID *addr_ptr,
         if (msync( addr, *size_ptr, MS_ASYNC )) status = STATUS_NOT_MAPPED_DATA;
 #endif
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     return status;
 }
 
@@ -5846,7 +6122,7 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
     TRACE( "%p %x %p-%p %p %lu\n", process, (int)flags, base, (char *)base + size,
            addresses, *count );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
 
     if (is_write_watch_range( base, size ))
     {
@@ -5865,7 +6141,7 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
     }
     else status = STATUS_INVALID_PARAMETER;
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     return status;
 }
 
@@ -5886,14 +6162,14 @@ NTSTATUS WINAPI NtResetWriteWatch( HANDLE process, PVOID base, SIZE_T size )
 
     if (!size) return STATUS_INVALID_PARAMETER;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
 
     if (is_write_watch_range( base, size ))
         reset_write_watches( base, size );
     else
         status = STATUS_INVALID_PARAMETER;
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     return status;
 }
 
@@ -5970,7 +6246,7 @@ NTSTATUS WINAPI NtAreMappedFilesTheSame(PVOID addr1, PVOID addr2)
 
     TRACE("%p %p\n", addr1, addr2);
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_enter_section( &sigset );
 
     view1 = find_view( addr1, 0 );
     view2 = find_view( addr2, 0 );
@@ -5994,7 +6270,7 @@ NTSTATUS WINAPI NtAreMappedFilesTheSame(PVOID addr1, PVOID addr2)
         SERVER_END_REQ;
     }
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_leave_section( &sigset );
     return status;
 }
 
@@ -59,6 +59,13 @@ struct load_so_dll_params
     void                      **module;
 };
 
+struct import_cache_params
+{
+    ULONGLONG                   key[2];
+    ULONG_PTR                  *values;
+    unsigned int                count;
+};
+
 struct unwind_builtin_dll_params
 {
     ULONG                       type;
@@ -76,6 +83,10 @@ enum ntdll_unix_funcs
     unix_wine_server_handle_to_fd,
     unix_wine_spawnvp,
     unix_system_time_precise,
+    unix_io_uring_thread,
+    unix_sock_poll_thread,
+    unix_get_import_cache,
+    unix_set_import_cache,
 };
 
 extern unixlib_handle_t __wine_unixlib_handle;
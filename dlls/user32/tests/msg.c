@@ -14450,6 +14450,60 @@ static void test_PeekMessage3(void)
     flush_events();
 }
 
+static DWORD WINAPI peek_message_thread(void *param)
+{
+    HWND hwnd = param;
+
+    PostThreadMessageA(GetWindowThreadProcessId(hwnd, NULL), WM_USER, 0, 0);
+    SendMessageA(hwnd, WM_USER + 1, 0, 0);
+    return 0;
+}
+
+static void test_PeekMessage_other_thread(void)
+{
+    DWORD start, count = 0;
+    BOOL got_msg = FALSE;
+    HANDLE thread;
+    HWND hwnd;
+    MSG msg;
+    BOOL ret;
+
+    hwnd = CreateWindowA("SimpleWindowClass", "PeekMessage", WS_OVERLAPPEDWINDOW,
+                         10, 10, 100, 100, NULL, NULL, NULL, NULL);
+    ok(hwnd != NULL, "expected hwnd != NULL\n");
+    flush_events();
+
+    /* repeated calls on an empty queue may not reach the server, make sure
+     * messages from other threads are still noticed */
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_REMOVE);
+    ok(!ret, "expected PeekMessage to return FALSE, got %u\n", ret);
+    ret = PeekMessageA(&msg, hwnd, 0, 0, PM_REMOVE);
+    ok(!ret, "expected PeekMessage to return FALSE, got %u\n", ret);
+
+    thread = CreateThread(NULL, 0, peek_message_thread, hwnd, 0, NULL);
+    start = GetTickCount();
+    while (GetTickCount() - start < 5000)
+    {
+        count++;
+        if (PeekMessageA(&msg, 0, 0, 0, PM_REMOVE))
+        {
+            if (msg.message == WM_USER && !msg.hwnd) got_msg = TRUE;
+            DispatchMessageA(&msg);
+        }
+        if (got_msg && !WaitForSingleObject(thread, 0)) break;
+    }
+    ok(got_msg, "didn't get posted message after %lu calls\n", count);
+    ok(!WaitForSingleObject(thread, 0), "sent message wasn't processed after %lu calls\n", count);
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_REMOVE);
+    ok(!ret, "expected PeekMessage to return FALSE, got %u\n", ret);
+
+    DestroyWindow(hwnd);
+    flush_events();
+}
+
 static INT_PTR CALLBACK wm_quit_dlg_proc(HWND hwnd, UINT message, WPARAM wp, LPARAM lp)
 {
     struct recvd_message msg;
@@ -20526,6 +20580,7 @@ START_TEST(msg)
     test_PeekMessage();
     test_PeekMessage2();
     test_PeekMessage3();
+    test_PeekMessage_other_thread();
     test_WaitForInputIdle( test_argv[0] );
     test_scrollwindowex();
     test_messages();
@@ -12758,6 +12758,115 @@ static void other_process_proc(HWND hwnd)
     CloseHandle(test_done_event);
 }
 
+static void other_process_state_proc(HWND hwnd)
+{
+    DWORD start, count, duration = winetest_interactive ? 5000 : 200;
+    HANDLE window_ready_event, test_done_event;
+    LONG_PTR style;
+    DWORD ret;
+
+    window_ready_event = OpenEventA(EVENT_ALL_ACCESS, FALSE, "test_ops_window");
+    ok(!!window_ready_event, "OpenEvent failed.\n");
+    test_done_event = OpenEventA(EVENT_ALL_ACCESS, FALSE, "test_ops_test");
+    ok(!!test_done_event, "OpenEvent failed.\n");
+
+    ret = WaitForSingleObject(window_ready_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+    ok(IsWindow(hwnd), "IsWindow failed.\n");
+    style = GetWindowLongPtrA(hwnd, GWL_STYLE);
+    ok((style & (WS_POPUP | WS_VISIBLE)) == (WS_POPUP | WS_VISIBLE), "Unexpected style %#Ix.\n", style);
+    style = GetWindowLongPtrA(hwnd, GWLP_USERDATA);
+    ok(style == 0x1234, "Unexpected user data %#Ix.\n", style);
+
+    start = GetTickCount();
+    count = 0;
+    do
+    {
+        GetWindowLongPtrA(hwnd, GWL_STYLE);
+        count++;
+    } while (GetTickCount() - start < duration);
+    trace("%d GetWindowLongPtr calls per second.\n", MulDiv(count, 1000, duration));
+
+    start = GetTickCount();
+    count = 0;
+    do
+    {
+        GetAsyncKeyState(VK_SHIFT);
+        count++;
+    } while (GetTickCount() - start < duration);
+    trace("%d GetAsyncKeyState calls per second.\n", MulDiv(count, 1000, duration));
+    SetEvent(test_done_event);
+
+    /* changes are visible as soon as the owner returns */
+    ret = WaitForSingleObject(window_ready_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+    style = GetWindowLongPtrA(hwnd, GWL_STYLE);
+    ok(!(style & WS_VISIBLE), "Unexpected style %#Ix.\n", style);
+    style = GetWindowLongPtrA(hwnd, GWLP_USERDATA);
+    ok(style == 0x5678, "Unexpected user data %#Ix.\n", style);
+    SetEvent(test_done_event);
+
+    ret = WaitForSingleObject(window_ready_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+    ok(!IsWindow(hwnd), "IsWindow succeeded.\n");
+    SetLastError(0xdeadbeef);
+    style = GetWindowLongPtrA(hwnd, GWL_STYLE);
+    ok(!style, "Unexpected style %#Ix.\n", style);
+    ok(GetLastError() == ERROR_INVALID_WINDOW_HANDLE, "Unexpected error %lu.\n", GetLastError());
+    SetEvent(test_done_event);
+
+    CloseHandle(window_ready_event);
+    CloseHandle(test_done_event);
+}
+
+static void test_other_process_state(const char *argv0)
+{
+    HANDLE window_ready_event, test_done_event;
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char cmd[MAX_PATH];
+    HWND hwnd;
+    DWORD ret;
+
+    hwnd = CreateWindowExA(0, "static", NULL, WS_POPUP | WS_VISIBLE,
+            100, 100, 100, 100, 0, 0, NULL, NULL);
+    ok(!!hwnd, "CreateWindowEx failed.\n");
+    SetWindowLongPtrA(hwnd, GWLP_USERDATA, 0x1234);
+
+    window_ready_event = CreateEventA(NULL, FALSE, FALSE, "test_ops_window");
+    ok(!!window_ready_event, "CreateEvent failed.\n");
+    test_done_event = CreateEventA(NULL, FALSE, FALSE, "test_ops_test");
+    ok(!!test_done_event, "CreateEvent failed.\n");
+
+    sprintf(cmd, "%s win test_other_process_state %p", argv0, hwnd);
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+
+    ok(CreateProcessA(NULL, cmd, NULL, NULL, FALSE, 0, NULL, NULL,
+            &startup, &info), "CreateProcess failed.\n");
+
+    SetEvent(window_ready_event);
+    ret = WaitForSingleObject(test_done_event, winetest_interactive ? 20000 : 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+
+    ShowWindow(hwnd, SW_HIDE);
+    SetWindowLongPtrA(hwnd, GWLP_USERDATA, 0x5678);
+    SetEvent(window_ready_event);
+    ret = WaitForSingleObject(test_done_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+
+    DestroyWindow(hwnd);
+    SetEvent(window_ready_event);
+    ret = WaitForSingleObject(test_done_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+
+    wait_child_process(info.hProcess);
+    CloseHandle(window_ready_event);
+    CloseHandle(test_done_event);
+    CloseHandle(info.hProcess);
+    CloseHandle(info.hThread);
+}
+
 static void test_SC_SIZE(void)
 {
     HWND hwnd;
@@ -13178,6 +13287,11 @@ START_TEST(win)
             other_process_proc(hwnd);
             return;
         }
+        else if (!strcmp(argv[2], "test_other_process_state"))
+        {
+            other_process_state_proc(hwnd);
+            return;
+        }
     }
 
     if (argc == 3 && !strcmp(argv[2], "winproc_limit"))
@@ -13316,6 +13430,7 @@ START_TEST(win)
     test_window_placement();
     test_arrange_iconic_windows();
     test_other_process_window(argv[0]);
+    test_other_process_state(argv[0]);
     test_SC_SIZE();
     test_cancel_mode();
     test_DragDetect();
@@ -552,8 +552,11 @@ static WCHAR kbd_tables_vkey_to_wchar( const KBDTABLES *tables, UINT vkey, const
  */
 HWND WINAPI NtUserGetForegroundWindow(void)
 {
+    desktop_shm_t desktop;
     HWND ret = 0;
 
+    if (get_shared_desktop( &desktop )) return wine_server_ptr_handle( desktop.foreground );
+
     SERVER_START_REQ( get_thread_input )
     {
         req->tid = 0;
@@ -740,22 +743,32 @@ BOOL WINAPI NtUserSetCursorPos( INT x, INT y )
  */
 BOOL get_cursor_pos( POINT *pt )
 {
+    desktop_shm_t desktop;
     BOOL ret;
     DWORD last_change;
     UINT dpi;
 
     if (!pt) return FALSE;
 
-    SERVER_START_REQ( set_cursor )
+    if ((ret = get_shared_desktop( &desktop )))
     {
-        if ((ret = !wine_server_call( req )))
+        pt->x = desktop.cursor_x;
+        pt->y = desktop.cursor_y;
+        last_change = desktop.cursor_change;
+    }
+    else
+    {
+        SERVER_START_REQ( set_cursor )
         {
-            pt->x = reply->new_x;
-            pt->y = reply->new_y;
-            last_change = reply->last_change;
+            if ((ret = !wine_server_call( req )))
+            {
+                pt->x = reply->new_x;
+                pt->y = reply->new_y;
+                last_change = reply->last_change;
+            }
         }
+        SERVER_END_REQ;
     }
-    SERVER_END_REQ;
 
     /* query new position from graphics driver if we haven't updated recently */
     if (ret && NtGetTickCount() - last_change > 100) ret = user_driver->pGetCursorPos( pt );
@@ -812,6 +825,7 @@ SHORT WINAPI NtUserGetAsyncKeyState( INT key )
 {
     struct user_key_state_info *key_state_info = get_user_thread_info()->key_state;
     INT counter = global_key_state_counter;
+    desktop_shm_t desktop;
     BYTE prev_key_state;
     SHORT ret;
 
@@ -819,6 +833,10 @@ SHORT WINAPI NtUserGetAsyncKeyState( INT key )
 
     check_for_events( QS_INPUT );
 
+    /* the server has to clear the "pressed since last call" bit, otherwise use the shared state */
+    if (get_shared_desktop( &desktop ) && !(desktop.keystate[key] & 0x40))
+        return (desktop.keystate[key] & 0x80) ? 0x8000 : 0;
+
     if (key_state_info && !(key_state_info->state[key] & 0xc0) &&
         key_state_info->counter == counter && NtGetTickCount() - key_state_info->time < 50)
     {
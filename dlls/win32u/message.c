@@ -2132,6 +2132,7 @@ static LRESULT handle_internal_message( HWND hwnd, UINT msg, WPARAM wparam, LPAR
  */
 BOOL WINAPI NtUserGetGUIThreadInfo( DWORD id, GUITHREADINFO *info )
 {
+    input_shm_t input;
     BOOL ret;
 
     if (info->cbSize != sizeof(*info))
@@ -2140,6 +2141,22 @@ BOOL WINAPI NtUserGetGUIThreadInfo( DWORD id, GUITHREADINFO *info )
         return FALSE;
     }
 
+    if (id == GetCurrentThreadId() && get_shared_input( &input ))
+    {
+        info->flags          = 0;
+        info->hwndActive     = wine_server_ptr_handle( input.active );
+        info->hwndFocus      = wine_server_ptr_handle( input.focus );
+        info->hwndCapture    = wine_server_ptr_handle( input.capture );
+        info->hwndMenuOwner  = wine_server_ptr_handle( input.menu_owner );
+        info->hwndMoveSize   = wine_server_ptr_handle( input.move_size );
+        info->hwndCaret      = wine_server_ptr_handle( input.caret );
+        info->rcCaret        = wine_server_get_rect( input.caret_rect );
+        if (input.menu_owner) info->flags |= GUI_INMENUMODE;
+        if (input.move_size) info->flags |= GUI_INMOVESIZE;
+        if (input.caret) info->flags |= GUI_CARETBLINKING;
+        return TRUE;
+    }
+
     SERVER_START_REQ( get_thread_input )
     {
         req->tid = id;
@@ -2643,6 +2660,43 @@ static BOOL process_hardware_message( MSG *msg, UINT hw_id, const struct hardwar
     return ret;
 }
 
+/***********************************************************************
+ *           check_queue_empty
+ *
+ * Check from the shared queue bits whether a get_message request would find
+ * nothing and return STATUS_PENDING without any side effect in the server.
+ */
+static BOOL check_queue_empty( const struct peek_message_filter *filter, HWND hwnd, UINT first, UINT last )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    UINT bits = filter->flags >> 16, clear_bits = 0;
+    thread_shm_t thread;
+
+    if (!get_shared_queue( &thread )) return FALSE;
+    /* driver messages are always checked first */
+    if (thread.wake_bits & QS_RAWINPUT) return FALSE;
+    if (filter->internal) return TRUE;
+
+    /* the server uses the get_message calls to detect hung queues */
+    if (NtGetTickCount() - thread_info->last_get_message > 3000) return FALSE;
+    /* the idle event is set on every HWND_TOPMOST call */
+    if (hwnd == HWND_TOPMOST) return FALSE;
+    if (hwnd && hwnd != (HWND)1 && !is_window( hwnd )) return FALSE;
+    if (thread.wake_mask != (filter->mask & (QS_SENDMESSAGE | QS_SMRESULT))) return FALSE;
+    if (thread.changed_mask != filter->mask) return FALSE;
+
+    if (!bits) bits = QS_ALLINPUT;
+    if (thread.wake_bits & (bits | QS_SENDMESSAGE)) return FALSE;
+    if (bits & QS_POSTMESSAGE)
+    {
+        clear_bits |= QS_POSTMESSAGE | QS_HOTKEY | QS_TIMER;
+        if (first == 0 && last == ~0u) clear_bits |= QS_ALLPOSTMESSAGE;
+    }
+    if (bits & QS_INPUT) clear_bits |= QS_INPUT;
+    if (bits & QS_PAINT) clear_bits |= QS_PAINT;
+    return !(thread.changed_bits & clear_bits);
+}
+
 /***********************************************************************
  *           peek_message
  *
@@ -2662,11 +2716,18 @@ int peek_message( MSG *msg, const struct peek_message_filter *filter )
     void *buffer;
     size_t buffer_size = 1024;
 
-    if (!(buffer = malloc( buffer_size ))) return -1;
-
     if (!first && !last) last = ~0;
     if (hwnd == HWND_BROADCAST) hwnd = HWND_TOPMOST;
 
+    if (check_queue_empty( filter, hwnd, first, last ))
+    {
+        thread_info->wake_mask = filter->mask & (QS_SENDMESSAGE | QS_SMRESULT);
+        thread_info->changed_mask = filter->mask;
+        return 0;
+    }
+
+    if (!(buffer = malloc( buffer_size ))) return -1;
+
     for (;;)
     {
         NTSTATUS res;
@@ -2686,6 +2747,7 @@ int peek_message( MSG *msg, const struct peek_message_filter *filter )
             req->wake_mask = filter->mask & (QS_SENDMESSAGE | QS_SMRESULT);
             req->changed_mask = filter->mask;
             wine_server_set_reply( req, buffer, buffer_size );
+            if (!filter->internal) thread_info->last_get_message = NtGetTickCount();
             if (!(res = wine_server_call( req )))
             {
                 size = wine_server_reply_size( reply );
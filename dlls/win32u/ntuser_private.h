@@ -123,6 +123,8 @@ struct user_thread_info
     UINT                          spy_indent;             /* Current spy indent */
     BOOL                          clipping_cursor;        /* thread is currently clipping */
     DWORD                         clipping_reset;         /* time when clipping was last reset */
+    UINT                          user_shm;               /* Index of the thread entry in the USER shared memory */
+    DWORD                         last_get_message;       /* Time of the last get_message server call */
 };
 
 C_ASSERT( sizeof(struct user_thread_info) <= sizeof(((TEB *)0)->Win32ClientInfo) );
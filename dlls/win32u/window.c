@@ -289,6 +289,7 @@ HWND is_current_process_window( HWND hwnd )
 /* see IsWindow */
 BOOL is_window( HWND hwnd )
 {
+    window_shm_t shared;
     WND *win;
     BOOL ret;
 
@@ -302,6 +303,11 @@ BOOL is_window( HWND hwnd )
     }
 
     /* check other processes */
+    if (get_shared_window( hwnd, &shared ))
+    {
+        if (!shared.handle) RtlSetLastWin32Error( ERROR_INVALID_WINDOW_HANDLE );
+        return !!shared.handle;
+    }
     SERVER_START_REQ( get_window_info )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -314,6 +320,7 @@ BOOL is_window( HWND hwnd )
 /* see GetWindowThreadProcessId */
 DWORD get_window_thread( HWND hwnd, DWORD *process )
 {
+    window_shm_t shared;
     WND *ptr;
     DWORD tid = 0;
 
@@ -333,6 +340,16 @@ DWORD get_window_thread( HWND hwnd, DWORD *process )
     }
 
     /* check other processes */
+    if (get_shared_window( hwnd, &shared ))
+    {
+        if (!shared.handle)
+        {
+            RtlSetLastWin32Error( ERROR_INVALID_WINDOW_HANDLE );
+            return 0;
+        }
+        if (process) *process = shared.pid;
+        return shared.tid;
+    }
     SERVER_START_REQ( get_window_info )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -785,6 +802,7 @@ BOOL is_window_drawable( HWND hwnd, BOOL icon )
 /* see IsWindowUnicode */
 BOOL is_window_unicode( HWND hwnd )
 {
+    window_shm_t shared;
     WND *win;
     BOOL ret = FALSE;
 
@@ -797,6 +815,11 @@ BOOL is_window_unicode( HWND hwnd )
         ret = (win->flags & WIN_ISUNICODE) != 0;
         release_win_ptr( win );
     }
+    else if (get_shared_window( hwnd, &shared ))
+    {
+        if (!shared.handle) RtlSetLastWin32Error( ERROR_INVALID_WINDOW_HANDLE );
+        ret = shared.handle && shared.is_unicode;
+    }
     else
     {
         SERVER_START_REQ( get_window_info )
@@ -971,6 +994,7 @@ BOOL is_zoomed( HWND hwnd )
 
 static LONG_PTR get_window_long_size( HWND hwnd, INT offset, UINT size, BOOL ansi )
 {
+    window_shm_t shared;
     LONG_PTR retval = 0;
     WND *win;
 
@@ -1017,6 +1041,24 @@ static LONG_PTR get_window_long_size( HWND hwnd, INT offset, UINT size, BOOL ans
             RtlSetLastWin32Error( ERROR_ACCESS_DENIED );
             return 0;
         }
+        if (offset < 0 && get_shared_window( hwnd, &shared ))
+        {
+            if (!shared.handle)
+            {
+                RtlSetLastWin32Error( ERROR_INVALID_WINDOW_HANDLE );
+                return 0;
+            }
+            switch (offset)
+            {
+            case GWL_STYLE:      return shared.style;
+            case GWL_EXSTYLE:    return shared.ex_style;
+            case GWLP_ID:        return shared.id;
+            case GWLP_HINSTANCE: return (ULONG_PTR)wine_server_get_ptr( shared.instance );
+            case GWLP_USERDATA:  return shared.user_data;
+            }
+            RtlSetLastWin32Error( ERROR_INVALID_INDEX );
+            return 0;
+        }
         SERVER_START_REQ( set_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
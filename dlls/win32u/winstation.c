@@ -50,6 +50,126 @@ BOOL is_virtual_desktop(void)
     return !!(flags.dwFlags & DF_WINE_VIRTUAL_DESKTOP);
 }
 
+static const user_shm_t *user_shm;
+
+/* map the read-only mirror of the USER state published by the server */
+static const user_shm_t *get_user_shm(void)
+{
+    static const WCHAR nameW[] = {'\\','K','e','r','n','e','l','O','b','j','e','c','t','s',
+                                  '\\','_','_','w','i','n','e','_','u','s','e','r','_','s','h','m'};
+    static BOOL failed;
+    UNICODE_STRING name = { sizeof(nameW), sizeof(nameW), (WCHAR *)nameW };
+    OBJECT_ATTRIBUTES attr;
+    SIZE_T size = 0;
+    void *ptr = NULL;
+    HANDLE handle;
+
+    if (user_shm || failed) return user_shm;
+
+    InitializeObjectAttributes( &attr, &name, 0, 0, NULL );
+    if (!NtOpenSection( &handle, SECTION_MAP_READ, &attr ))
+    {
+        if (!NtMapViewOfSection( handle, GetCurrentProcess(), &ptr, 0, 0, NULL, &size,
+                                 ViewShare, 0, PAGE_READONLY ) &&
+            InterlockedCompareExchangePointer( (void **)&user_shm, ptr, NULL ))
+            NtUnmapViewOfSection( GetCurrentProcess(), ptr );
+        NtClose( handle );
+    }
+    if (!user_shm)
+    {
+        WARN( "USER shared memory not available\n" );
+        failed = TRUE;
+    }
+    return user_shm;
+}
+
+/* copy a consistent snapshot of a shared memory entry, starting with its sequence counter */
+static void read_shared_entry( void *dst, const void *src, size_t size )
+{
+    const LONG *seq = src;
+    LONG start;
+
+    for (;;)
+    {
+        while ((start = ReadAcquire( seq )) & 1) YieldProcessor();
+        memcpy( dst, src, size );
+        MemoryBarrier();
+        if (ReadNoFence( seq ) == start) return;
+    }
+}
+
+/* retrieve the shared memory entry of the current thread */
+static const user_shm_t *get_shared_thread( thread_shm_t *thread )
+{
+    struct user_thread_info *info = get_user_thread_info();
+    const user_shm_t *shm;
+
+    if (!(shm = get_user_shm())) return NULL;
+    if (!info->user_shm)
+    {
+        UINT index = 0;
+
+        SERVER_START_REQ( get_thread_user_shm )
+        {
+            if (!wine_server_call( req )) index = reply->index;
+        }
+        SERVER_END_REQ;
+        info->user_shm = index ? index : ~0u;
+    }
+    if (info->user_shm >= USER_SHM_MAX_THREADS) return NULL;
+    read_shared_entry( thread, &shm->threads[info->user_shm], sizeof(*thread) );
+    return shm;
+}
+
+/* get the shared state of the current thread desktop */
+BOOL get_shared_desktop( desktop_shm_t *desktop )
+{
+    const user_shm_t *shm;
+    thread_shm_t thread;
+
+    if (!(shm = get_shared_thread( &thread ))) return FALSE;
+    if (!thread.desktop || thread.desktop >= USER_SHM_MAX_DESKTOPS) return FALSE;
+    read_shared_entry( desktop, &shm->desktops[thread.desktop], sizeof(*desktop) );
+    return desktop->id == thread.desktop_id;
+}
+
+/* get the shared state of the current thread input */
+BOOL get_shared_input( input_shm_t *input )
+{
+    const user_shm_t *shm;
+    thread_shm_t thread;
+
+    if (!(shm = get_shared_thread( &thread ))) return FALSE;
+    if (!thread.input || thread.input >= USER_SHM_MAX_INPUTS) return FALSE;
+    read_shared_entry( input, &shm->inputs[thread.input], sizeof(*input) );
+    return input->id == thread.input_id;
+}
+
+/* get the shared queue bits and masks of the current thread */
+BOOL get_shared_queue( thread_shm_t *thread )
+{
+    return get_shared_thread( thread ) && thread->queue;
+}
+
+/* get the shared state of a window; window->handle is 0 if it doesn't exist */
+BOOL get_shared_window( HWND hwnd, window_shm_t *window )
+{
+    UINT handle = HandleToUlong( hwnd ), generation = HIWORD( handle );
+    const user_shm_t *shm;
+
+    if (!(shm = get_user_shm())) return FALSE;
+    if (LOWORD( handle ) < FIRST_USER_HANDLE || LOWORD( handle ) > LAST_USER_HANDLE)
+    {
+        window->handle = 0;
+        return TRUE;
+    }
+    read_shared_entry( window, &shm->windows[(LOWORD( handle ) - FIRST_USER_HANDLE) >> 1], sizeof(*window) );
+    if (LOWORD( window->handle ) != LOWORD( handle ) ||
+        (generation && generation != 0xffff && generation != HIWORD( window->handle )))
+        window->handle = 0;
+    return TRUE;
+}
+
 /***********************************************************************
  *           NtUserCreateWindowStation  (win32u.@)
  */
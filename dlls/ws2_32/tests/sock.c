@@ -13263,6 +13263,167 @@ static void test_simultaneous_async_recv(void)
     for (i = 0; i < num_io; i++) CloseHandle(events[i]);
 }
 
+static void test_udp_recv_burst(void)
+{
+    unsigned int count = winetest_interactive ? 200000 : 2000, errors, i, j, n;
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+    OVERLAPPED overlappeds[16] = {{0}}, *overlapped;
+    char bufs[16][16], msg[16];
+    WSABUF wsabufs[16];
+    DWORD flags[16], size, start, elapsed;
+    SOCKET client, server;
+    ULONG_PTR key;
+    HANDLE port;
+    int ret, len;
+
+    server = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(server != INVALID_SOCKET, "got error %u\n", WSAGetLastError());
+    client = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(client != INVALID_SOCKET, "got error %u\n", WSAGetLastError());
+    ret = bind(server, (struct sockaddr *)&addr, sizeof(addr));
+    ok(!ret, "got error %u\n", WSAGetLastError());
+    len = sizeof(addr);
+    ret = getsockname(server, (struct sockaddr *)&addr, &len);
+    ok(!ret, "got error %u\n", WSAGetLastError());
+
+    port = CreateIoCompletionPort((HANDLE)server, NULL, 0, 0);
+    ok(!!port, "got error %lu\n", GetLastError());
+
+    for (i = 0; i < ARRAY_SIZE(overlappeds); i++)
+    {
+        wsabufs[i].buf = bufs[i];
+        wsabufs[i].len = sizeof(bufs[i]);
+        flags[i] = 0;
+        ret = WSARecv(server, &wsabufs[i], 1, NULL, &flags[i], &overlappeds[i], NULL);
+        ok(ret == -1, "got %d\n", ret);
+        ok(WSAGetLastError() == ERROR_IO_PENDING, "got error %u\n", WSAGetLastError());
+    }
+
+    /* send bursts of as many datagrams as there are pending receives; they
+     * should be filled in the order they were queued */
+    start = GetTickCount();
+    for (i = errors = 0; i < count && errors < 10; i += ARRAY_SIZE(overlappeds))
+    {
+        for (j = 0; j < ARRAY_SIZE(overlappeds); j++)
+        {
+            memset(msg, 0, sizeof(msg));
+            sprintf(msg, "%u", i + j);
+            ret = sendto(client, msg, sizeof(msg), 0, (struct sockaddr *)&addr, sizeof(addr));
+            if (ret != sizeof(msg)) errors++;
+        }
+        for (j = 0; j < ARRAY_SIZE(overlappeds); j++)
+        {
+            ret = GetQueuedCompletionStatus(port, &size, &key, &overlapped, 1000);
+            if (!ret || !overlapped)
+            {
+                errors++;
+                break;
+            }
+            n = overlapped - overlappeds;
+            sprintf(msg, "%u", i + j);
+            if (n != j || size != sizeof(bufs[n]) || strcmp(bufs[n], msg)) errors++;
+
+            flags[n] = 0;
+            ret = WSARecv(server, &wsabufs[n], 1, NULL, &flags[n], &overlappeds[n], NULL);
+            if (ret != -1 || WSAGetLastError() != ERROR_IO_PENDING) errors++;
+        }
+    }
+    elapsed = GetTickCount() - start;
+    ok(!errors, "got %u errors\n", errors);
+    trace("received %u datagrams in %lu ms\n", i, elapsed);
+
+    closesocket(client);
+    closesocket(server);
+    CloseHandle(port);
+}
+
+/* cancel pending receives while datagrams arrive; each datagram must be received exactly
+ * once, either by the canceled receive or by the next one */
+static void test_recv_cancel_race(void)
+{
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+    unsigned int count = winetest_interactive ? 10000 : 200, errors = 0, canceled = 0, i;
+    OVERLAPPED overlapped = {0};
+    char buf[16], msg[16];
+    struct timeval timeout = {1, 0};
+    SOCKET client, server;
+    WSABUF wsabuf;
+    fd_set readfds;
+    DWORD flags, size;
+    int ret, len;
+
+    server = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(server != INVALID_SOCKET, "got error %u\n", WSAGetLastError());
+    client = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(client != INVALID_SOCKET, "got error %u\n", WSAGetLastError());
+    ret = bind(server, (struct sockaddr *)&addr, sizeof(addr));
+    ok(!ret, "got error %u\n", WSAGetLastError());
+    len = sizeof(addr);
+    ret = getsockname(server, (struct sockaddr *)&addr, &len);
+    ok(!ret, "got error %u\n", WSAGetLastError());
+    overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    wsabuf.buf = buf;
+    wsabuf.len = sizeof(buf);
+
+    for (i = 0; i < count && errors < 10; i++)
+    {
+        memset(msg, 0, sizeof(msg));
+        sprintf(msg, "%u", i);
+        memset(buf, 0, sizeof(buf));
+        flags = 0;
+        ret = WSARecv(server, &wsabuf, 1, NULL, &flags, &overlapped, NULL);
+        if (ret != -1 || WSAGetLastError() != ERROR_IO_PENDING) errors++;
+        sendto(client, msg, sizeof(msg), 0, (struct sockaddr *)&addr, sizeof(addr));
+        CancelIoEx((HANDLE)server, &overlapped);
+        if (WaitForSingleObject(overlapped.hEvent, 1000))
+        {
+            errors++;
+            break;
+        }
+
+        if (WSAGetOverlappedResult(server, &overlapped, &size, FALSE, &flags))
+        {
+            if (overlapped.Internal || size != sizeof(msg) || strcmp(buf, msg)) errors++;
+            continue;
+        }
+        if (WSAGetLastError() != WSA_OPERATION_ABORTED || overlapped.Internal != (ULONG)STATUS_CANCELLED) errors++;
+        canceled++;
+
+        /* the datagram must still be queued */
+        FD_ZERO(&readfds);
+        FD_SET(server, &readfds);
+        memset(buf, 0, sizeof(buf));
+        if (select(0, &readfds, NULL, NULL, &timeout) != 1 ||
+            recv(server, buf, sizeof(buf), 0) != sizeof(msg) || strcmp(buf, msg))
+            errors++;
+    }
+    ok(!errors, "got %u errors\n", errors);
+    trace("%u receives, %u canceled\n", i, canceled);
+
+    CloseHandle(overlapped.hEvent);
+    closesocket(client);
+    closesocket(server);
+}
+
+/* run test_recv_cancel_race() with Wine's in-process socket polling enabled */
+static void test_inproc_socket_poll(void)
+{
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    char cmdline[MAX_PATH + 32], **argv;
+    BOOL ret;
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" sock inproc", argv[0]);
+    SetEnvironmentVariableA("WINEINPROCSOCK", "1");
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    SetEnvironmentVariableA("WINEINPROCSOCK", NULL);
+    ok(ret, "CreateProcess failed, error %lu\n", GetLastError());
+    wait_child_process(pi.hProcess);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+}
+
 static void test_empty_recv(void)
 {
     OVERLAPPED overlapped = {0};
@@ -14239,8 +14400,17 @@ static void test_msys(void)
 
 START_TEST( sock )
 {
+    char **argv;
     int i;
 
+    if (winetest_get_mainargs(&argv) >= 3 && !strcmp(argv[2], "inproc"))
+    {
+        Init();
+        test_recv_cancel_race();
+        Exit();
+        return;
+    }
+
 /* Leave these tests at the beginning. They depend on WSAStartup not having been
  * called, which is done by Init() below. */
     if (0) {
@@ -14314,6 +14484,9 @@ START_TEST( sock )
     test_WSAGetOverlappedResult();
     test_nonblocking_async_recv();
     test_simultaneous_async_recv();
+    test_udp_recv_burst();
+    test_recv_cancel_race();
+    test_inproc_socket_poll();
     test_empty_recv();
     test_timeout();
     test_tcp_reset();
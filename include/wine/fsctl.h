@@ -0,0 +1,37 @@
+/*
+ * Wine-specific file system controls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_WINE_FSCTL_H
+#define __WINE_WINE_FSCTL_H
+
+#include "winioctl.h"
+
+/* copy a range of data from another file in the kernel, without going through a client buffer;
+ * the target is extended as needed, and the file pointers of both files are left unchanged */
+#define FSCTL_WINE_COPY_FILE_RANGE  CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 0x800, METHOD_BUFFERED, FILE_WRITE_DATA)
+
+struct wine_copy_file_range
+{
+    UINT      source;         /* source file handle, needs FILE_READ_DATA access */
+    UINT      reserved;
+    ULONGLONG source_offset;  /* offset of the data in the source file */
+    ULONGLONG target_offset;  /* offset to copy it to in the target file */
+    ULONGLONG count;          /* number of bytes to copy */
+};
+
+#endif  /* __WINE_WINE_FSCTL_H */
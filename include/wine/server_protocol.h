@@ -880,6 +880,132 @@ struct directory_entry
 };
 
 
+typedef struct
+{
+    unsigned int   state;
+    unsigned int   count;
+    int            type;
+    int            abandoned;
+    unsigned int   serial;
+    unsigned int   refs;
+} inproc_sync_t;
+
+enum inproc_sync_type
+{
+    INPROC_SYNC_NONE,
+    INPROC_SYNC_AUTO_EVENT,
+    INPROC_SYNC_MANUAL_EVENT,
+    INPROC_SYNC_SEMAPHORE,
+    INPROC_SYNC_MUTEX,
+    INPROC_SYNC_COMPLETION
+};
+
+#define INPROC_SYNC_SERVER 0x80000000
+#define INPROC_COMPLETION_OVERFLOW 0x40000000
+
+
+typedef struct
+{
+    unsigned int   seq;
+    unsigned int   status;
+    apc_param_t    ckey;
+    apc_param_t    cvalue;
+    apc_param_t    information;
+} inproc_completion_packet_t;
+
+
+#define INPROC_COMPLETION_SIZE 1024
+typedef struct
+{
+    unsigned int   head;
+    unsigned int   tail;
+    unsigned int   waiters;
+    unsigned int   __pad;
+    inproc_completion_packet_t packets[INPROC_COMPLETION_SIZE];
+} inproc_completion_t;
+
+
+#define INPROC_SYNC_MAX_OBJECTS     0x10000
+#define INPROC_COMPLETION_MAX_PORTS 64
+
+/* Read-only mirror of USER state, published by the server in \KernelObjects\__wine_user_shm.
+ * Every entry is protected by a sequence counter: the server makes it odd while updating
+ * the entry, clients retry their read if it was odd or changed while they were reading. */
+
+
+typedef struct
+{
+    unsigned int   seq;
+    unsigned int   id;
+    user_handle_t  foreground;
+    int            cursor_x;
+    int            cursor_y;
+    unsigned int   cursor_change;
+    unsigned char  keystate[256];
+} desktop_shm_t;
+
+
+typedef struct
+{
+    unsigned int   seq;
+    unsigned int   id;
+    user_handle_t  focus;
+    user_handle_t  capture;
+    user_handle_t  active;
+    user_handle_t  menu_owner;
+    user_handle_t  move_size;
+    user_handle_t  caret;
+    rectangle_t    caret_rect;
+    user_handle_t  cursor;
+    int            cursor_count;
+} input_shm_t;
+
+
+typedef struct
+{
+    unsigned int   seq;
+    unsigned int   id;
+    unsigned int   desktop;
+    unsigned int   desktop_id;
+    unsigned int   input;
+    unsigned int   input_id;
+    int            queue;
+    unsigned int   wake_bits;
+    unsigned int   wake_mask;
+    unsigned int   changed_bits;
+    unsigned int   changed_mask;
+} thread_shm_t;
+
+
+typedef struct
+{
+    unsigned int   seq;
+    user_handle_t  handle;
+    thread_id_t    tid;
+    process_id_t   pid;
+    unsigned int   style;
+    unsigned int   ex_style;
+    lparam_t       id;
+    mod_handle_t   instance;
+    lparam_t       user_data;
+    int            is_unicode;
+    int            __pad;
+} window_shm_t;
+
+
+#define USER_SHM_MAX_DESKTOPS 256
+#define USER_SHM_MAX_INPUTS   4096
+#define USER_SHM_MAX_THREADS  8192
+#define USER_SHM_MAX_WINDOWS  ((LAST_USER_HANDLE - FIRST_USER_HANDLE + 1) >> 1)
+typedef struct
+{
+    desktop_shm_t  desktops[USER_SHM_MAX_DESKTOPS];
+    input_shm_t    inputs[USER_SHM_MAX_INPUTS];
+    thread_shm_t   threads[USER_SHM_MAX_THREADS];
+    window_shm_t   windows[USER_SHM_MAX_WINDOWS];
+} user_shm_t;
+
+
 
 
 
@@ -1623,6 +1749,35 @@ struct open_semaphore_reply
 
 
 
+struct get_inproc_sync_shm_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_inproc_sync_shm_reply
+{
+    struct reply_header __header;
+    mem_size_t   size;
+};
+
+
+
+struct get_inproc_sync_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_inproc_sync_reply
+{
+    struct reply_header __header;
+    unsigned int index;
+    unsigned int serial;
+    unsigned int access;
+    char __pad_20[4];
+};
+
+
+
 struct create_file_request
 {
     struct request_header __header;
@@ -1705,6 +1860,8 @@ struct get_handle_fd_reply
     int          cacheable;
     unsigned int access;
     unsigned int options;
+    unsigned int handle_flags;
+    int          file_info;
 };
 enum server_fd_type
 {
@@ -1820,7 +1977,7 @@ struct recv_socket_request
     int          oob;
     async_data_t async;
     int          force_async;
-    char __pad_60[4];
+    int          client_poll;
 };
 struct recv_socket_reply
 {
@@ -1828,7 +1985,7 @@ struct recv_socket_reply
     obj_handle_t wait;
     unsigned int options;
     int          nonblocking;
-    char __pad_20[4];
+    int          client_poll;
 };
 
 
@@ -1839,7 +1996,7 @@ struct send_socket_request
     char __pad_12[4];
     async_data_t async;
     int          force_async;
-    char __pad_60[4];
+    int          client_poll;
 };
 struct send_socket_reply
 {
@@ -1847,7 +2004,7 @@ struct send_socket_reply
     obj_handle_t wait;
     unsigned int options;
     int          nonblocking;
-    char __pad_20[4];
+    int          client_poll;
 };
 
 
@@ -3113,6 +3270,28 @@ struct set_async_direct_result_reply
 };
 
 
+struct async_client_result
+{
+    obj_handle_t   handle;
+    unsigned int   status;
+    client_ptr_t   user;
+    apc_param_t    information;
+};
+
+
+struct set_async_client_results_request
+{
+    struct request_header __header;
+    /* VARARG(results,async_client_results); */
+    char __pad_12[4];
+};
+struct set_async_client_results_reply
+{
+    struct reply_header __header;
+    /* VARARG(status,uints); */
+};
+
+
 
 struct read_request
 {
@@ -4004,6 +4183,20 @@ struct get_thread_input_reply
 
 
 
+struct get_thread_user_shm_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_thread_user_shm_reply
+{
+    struct reply_header __header;
+    unsigned int   index;
+    char __pad_12[4];
+};
+
+
+
 struct get_last_input_time_request
 {
     struct request_header __header;
@@ -5706,6 +5899,8 @@ enum request
     REQ_release_semaphore,
     REQ_query_semaphore,
     REQ_open_semaphore,
+    REQ_get_inproc_sync_shm,
+    REQ_get_inproc_sync,
     REQ_create_file,
     REQ_open_file_object,
     REQ_alloc_file_handle,
@@ -5796,6 +5991,7 @@ enum request
     REQ_cancel_async,
     REQ_get_async_result,
     REQ_set_async_direct_result,
+    REQ_set_async_client_results,
     REQ_read,
     REQ_write,
     REQ_ioctl,
@@ -5847,6 +6043,7 @@ enum request
     REQ_unregister_hotkey,
     REQ_attach_thread_input,
     REQ_get_thread_input,
+    REQ_get_thread_user_shm,
     REQ_get_last_input_time,
     REQ_get_key_state,
     REQ_set_key_state,
@@ -5998,6 +6195,8 @@ union generic_request
     struct release_semaphore_request release_semaphore_request;
     struct query_semaphore_request query_semaphore_request;
     struct open_semaphore_request open_semaphore_request;
+    struct get_inproc_sync_shm_request get_inproc_sync_shm_request;
+    struct get_inproc_sync_request get_inproc_sync_request;
     struct create_file_request create_file_request;
     struct open_file_object_request open_file_object_request;
     struct alloc_file_handle_request alloc_file_handle_request;
@@ -6088,6 +6287,7 @@ union generic_request
     struct cancel_async_request cancel_async_request;
     struct get_async_result_request get_async_result_request;
     struct set_async_direct_result_request set_async_direct_result_request;
+    struct set_async_client_results_request set_async_client_results_request;
     struct read_request read_request;
     struct write_request write_request;
     struct ioctl_request ioctl_request;
@@ -6139,6 +6339,7 @@ union generic_request
     struct unregister_hotkey_request unregister_hotkey_request;
     struct attach_thread_input_request attach_thread_input_request;
     struct get_thread_input_request get_thread_input_request;
+    struct get_thread_user_shm_request get_thread_user_shm_request;
     struct get_last_input_time_request get_last_input_time_request;
     struct get_key_state_request get_key_state_request;
     struct set_key_state_request set_key_state_request;
@@ -6288,6 +6489,8 @@ union generic_reply
     struct release_semaphore_reply release_semaphore_reply;
     struct query_semaphore_reply query_semaphore_reply;
     struct open_semaphore_reply open_semaphore_reply;
+    struct get_inproc_sync_shm_reply get_inproc_sync_shm_reply;
+    struct get_inproc_sync_reply get_inproc_sync_reply;
     struct create_file_reply create_file_reply;
     struct open_file_object_reply open_file_object_reply;
     struct alloc_file_handle_reply alloc_file_handle_reply;
@@ -6378,6 +6581,7 @@ union generic_reply
     struct cancel_async_reply cancel_async_reply;
     struct get_async_result_reply get_async_result_reply;
     struct set_async_direct_result_reply set_async_direct_result_reply;
+    struct set_async_client_results_reply set_async_client_results_reply;
     struct read_reply read_reply;
     struct write_reply write_reply;
     struct ioctl_reply ioctl_reply;
@@ -6429,6 +6633,7 @@ union generic_reply
     struct unregister_hotkey_reply unregister_hotkey_reply;
     struct attach_thread_input_reply attach_thread_input_reply;
     struct get_thread_input_reply get_thread_input_reply;
+    struct get_thread_user_shm_reply get_thread_user_shm_reply;
     struct get_last_input_time_reply get_last_input_time_reply;
     struct get_key_state_reply get_key_state_reply;
     struct set_key_state_reply set_key_state_reply;
@@ -6534,7 +6739,7 @@ union generic_reply
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 806
+#define SERVER_PROTOCOL_VERSION 816
 
 /* ### protocol_version end ### */
 
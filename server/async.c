@@ -57,6 +57,7 @@ struct async
     unsigned int         canceled :1;     /* have we already queued cancellation for this async? */
     unsigned int         unknown_status :1; /* initial status is not known yet */
     unsigned int         blocking :1;     /* async is blocking */
+    unsigned int         client_poll :1;  /* readiness is polled by the client instead of the server */
     struct completion   *completion;      /* completion associated with fd */
     apc_param_t          comp_key;        /* completion key associated with fd */
     unsigned int         comp_flags;      /* completion flags */
@@ -276,6 +277,7 @@ struct async *create_async( struct fd *fd, struct thread *thread, const async_da
     async->terminated    = 0;
     async->canceled      = 0;
     async->unknown_status = 0;
+    async->client_poll   = 0;
     async->blocking      = !is_fd_overlapped( fd );
     async->completion    = fd_get_completion( fd, &async->comp_key );
     async->comp_flags    = 0;
@@ -402,7 +404,8 @@ obj_handle_t async_handoff( struct async *async, data_size_t *result, int force_
     {
         async->direct_result = 0;
         async->pending = 1;
-        if (!async->blocking)
+        /* the client needs the wait handle to report the result of a client-polled async */
+        if (!async->blocking && !async->client_poll)
         {
             close_handle( async->thread->process, async->wait_handle);
             async->wait_handle = 0;
@@ -540,6 +543,12 @@ void async_set_result( struct object *obj, unsigned int status, apc_param_t tota
 
         async_call_completion_callback( async );
 
+        if (async->client_poll && async->wait_handle)
+        {
+            close_handle( async->thread->process, async->wait_handle );
+            async->wait_handle = 0;
+        }
+
         if (async->queue)
         {
             list_remove( &async->queue_entry );
@@ -569,7 +578,24 @@ int async_waiting( struct async_queue *queue )
 
     if (!(ptr = list_head( &queue->queue ))) return 0;
     async = LIST_ENTRY( ptr, struct async, queue_entry );
-    return !async->terminated;
+    return !async->terminated && !async->client_poll;
+}
+
+/* check if all the asyncs in the queue are polled by the client */
+int async_queue_client_polled( struct async_queue *queue )
+{
+    struct async *async;
+
+    LIST_FOR_EACH_ENTRY( async, &queue->queue, struct async, queue_entry )
+        if (!async->client_poll) return 0;
+
+    return 1;
+}
+
+/* let the client poll the fd and report the result of a pending async itself */
+void async_set_client_poll( struct async *async )
+{
+    async->client_poll = 1;
 }
 
 static int cancel_async( struct process *process, struct object *obj, struct thread *thread, client_ptr_t iosb )
@@ -675,6 +701,24 @@ void async_wake_up( struct async_queue *queue, unsigned int status )
     }
 }
 
+/* alert up to count async operations on the queue, when several of them can make progress;
+ * only consecutive asyncs of the same thread are alerted together, since that thread
+ * processes them in order, while different threads could race for the data */
+void async_wake_up_count( struct async_queue *queue, unsigned int count )
+{
+    struct list *ptr, *next;
+    struct thread *thread = NULL;
+
+    LIST_FOR_EACH_SAFE( ptr, next, &queue->queue )
+    {
+        struct async *async = LIST_ENTRY( ptr, struct async, queue_entry );
+        if (!count-- || async->client_poll) break;
+        if (thread && async->thread != thread) break;
+        thread = async->thread;
+        async_terminate( async, STATUS_ALERTED );
+    }
+}
+
 static void iosb_dump( struct object *obj, int verbose );
 static void iosb_destroy( struct object *obj );
 
@@ -891,3 +935,34 @@ DECL_HANDLER(set_async_direct_result)
 
     release_object( &async->obj );
 }
+
+/* report the results of asyncs whose I/O was performed by the client */
+DECL_HANDLER(set_async_client_results)
+{
+    const struct async_client_result *result = get_req_data();
+    data_size_t i, count = get_req_data_size() / sizeof(*result);
+    struct async *async;
+    unsigned int *status;
+
+    if (!count || !(status = set_reply_data_size( count * sizeof(*status) ))) return;
+
+    for (i = 0; i < count; i++, result++)
+    {
+        status[i] = STATUS_CANCELLED;
+        async = (struct async *)get_handle_obj( current->process, result->handle, 0, &async_ops );
+        if (!async)
+        {
+            clear_error();
+            continue;
+        }
+        /* if it was terminated first, e.g. canceled, the client reports the result from
+         * the async callback instead; the handle may also have been reused since then */
+        if (async->client_poll && !async->terminated && async->data.user == result->user)
+        {
+            async->terminated = 1;
+            async_set_result( &async->obj, result->status, result->information );
+            status[i] = STATUS_SUCCESS;
+        }
+        release_object( &async->obj );
+    }
+}
@@ -26,8 +26,21 @@
  *    + completion handle is waitable, while native isn't
  */
 
+/*
+ * With in-process synchronization enabled, packets are queued in a bounded queue in
+ * memory shared with the clients, which post and remove them without server calls.
+ * The state word of the port counts the queued packets and is used as a futex by
+ * client threads waiting for packets. Packets that don't fit in the shared queue are
+ * queued in the server, and the INPROC_COMPLETION_OVERFLOW bit is set in the state
+ * word until they have all been removed; clients then use server requests, so that
+ * packets are still removed in order. Clients also post packets through the server
+ * while it has waiters of its own (INPROC_SYNC_SERVER), so that they are woken up.
+ */
+
 #include "config.h"
 
+#include <assert.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
 
@@ -61,9 +74,12 @@ struct completion
     struct object  obj;
     struct list    queue;
     unsigned int   depth;
+    struct inproc_sync *sync;   /* in-process state, NULL if none */
 };
 
 static void completion_dump( struct object*, int );
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void completion_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void completion_destroy( struct object * );
 
@@ -72,8 +88,8 @@ static const struct object_ops completion_ops =
     sizeof(struct completion), /* size */
     &completion_type,          /* type */
     completion_dump,           /* dump */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    completion_add_queue,      /* add_queue */
+    completion_remove_queue,   /* remove_queue */
     completion_signaled,       /* signaled */
     no_satisfied,              /* satisfied */
     no_signal,                 /* signal */
@@ -100,6 +116,91 @@ struct comp_msg
     unsigned int  status;
 };
 
+/* the shared queue is writable by the clients, so don't retry forever if it's inconsistent */
+#define SHARED_QUEUE_MAX_RETRIES 64
+
+/* number of packets in the shared queue, including the ones being added */
+static unsigned int get_shared_depth( struct completion *completion )
+{
+    if (!completion->sync) return 0;
+    return get_inproc_sync_state( completion->sync ) & ~INPROC_COMPLETION_OVERFLOW;
+}
+
+/* add a packet to the shared queue; fails if it's full or packets are queued in the server */
+static int add_shared_packet( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
+                              unsigned int status, apc_param_t information )
+{
+    unsigned int *state = &get_inproc_sync( completion->sync )->state;
+    inproc_completion_t *queue = get_inproc_completion( completion->sync );
+    inproc_completion_packet_t *packet;
+    unsigned int pos, seq, retries = 0;
+
+    /* account the packet first, so that the count never drops below the number of queued packets */
+    if (__atomic_fetch_add( state, 1, __ATOMIC_SEQ_CST ) & INPROC_COMPLETION_OVERFLOW) goto failed;
+
+    pos = __atomic_load_n( &queue->tail, __ATOMIC_RELAXED );
+    for (;;)
+    {
+        if (retries++ == SHARED_QUEUE_MAX_RETRIES) goto failed;  /* the caller queues it in the server */
+        packet = &queue->packets[pos % INPROC_COMPLETION_SIZE];
+        seq = __atomic_load_n( &packet->seq, __ATOMIC_ACQUIRE );
+        if ((int)(seq - pos) < 0) goto failed;  /* full */
+        if (seq == pos && __atomic_compare_exchange_n( &queue->tail, &pos, pos + 1, 0,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED ))
+            break;
+        if (seq != pos) pos = __atomic_load_n( &queue->tail, __ATOMIC_RELAXED );
+    }
+
+    packet->ckey        = ckey;
+    packet->cvalue      = cvalue;
+    packet->status      = status;
+    packet->information = information;
+    __atomic_store_n( &packet->seq, pos + 1, __ATOMIC_RELEASE );
+
+    if (__atomic_load_n( &queue->waiters, __ATOMIC_SEQ_CST )) wake_inproc_sync( completion->sync, 1 );
+    return 1;
+
+failed:
+    __atomic_fetch_sub( state, 1, __ATOMIC_SEQ_CST );
+    return 0;
+}
+
+/* remove a packet from the shared queue */
+static int remove_shared_packet( struct completion *completion, struct comp_msg *msg )
+{
+    inproc_completion_t *queue = get_inproc_completion( completion->sync );
+    inproc_completion_packet_t *packet;
+    unsigned int pos, seq, retries = 0;
+
+    pos = __atomic_load_n( &queue->head, __ATOMIC_RELAXED );
+    for (;;)
+    {
+        if (retries++ == SHARED_QUEUE_MAX_RETRIES)
+        {
+            /* make the clients go through the server, new packets are queued in the server */
+            __atomic_fetch_or( &get_inproc_sync( completion->sync )->state, INPROC_COMPLETION_OVERFLOW,
+                               __ATOMIC_SEQ_CST );
+            return 0;
+        }
+        packet = &queue->packets[pos % INPROC_COMPLETION_SIZE];
+        seq = __atomic_load_n( &packet->seq, __ATOMIC_ACQUIRE );
+        if ((int)(seq - (pos + 1)) < 0) return 0;  /* empty, or packet still being added */
+        if (seq == pos + 1 && __atomic_compare_exchange_n( &queue->head, &pos, pos + 1, 0,
+                                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED ))
+            break;
+        if (seq != pos + 1) pos = __atomic_load_n( &queue->head, __ATOMIC_RELAXED );
+    }
+
+    msg->ckey        = packet->ckey;
+    msg->cvalue      = packet->cvalue;
+    msg->status      = packet->status;
+    msg->information = packet->information;
+    __atomic_store_n( &packet->seq, pos + INPROC_COMPLETION_SIZE, __ATOMIC_RELEASE );
+
+    __atomic_fetch_sub( &get_inproc_sync( completion->sync )->state, 1, __ATOMIC_SEQ_CST );
+    return 1;
+}
+
 static void completion_destroy( struct object *obj)
 {
     struct completion *completion = (struct completion *) obj;
@@ -109,6 +210,7 @@ static void completion_destroy( struct object *obj)
     {
         free( tmp );
     }
+    free_inproc_sync( completion->sync );
 }
 
 static void completion_dump( struct object *obj, int verbose )
@@ -116,14 +218,30 @@ static void completion_dump( struct object *obj, int verbose )
     struct completion *completion = (struct completion *) obj;
 
     assert( obj->ops == &completion_ops );
-    fprintf( stderr, "Completion depth=%u\n", completion->depth );
+    fprintf( stderr, "Completion depth=%u\n", completion->depth + get_shared_depth( completion ) );
+}
+
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct completion *completion = (struct completion *)obj;
+
+    assert( obj->ops == &completion_ops );
+    return add_inproc_sync_queue( obj, entry, completion->sync );
+}
+
+static void completion_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct completion *completion = (struct completion *)obj;
+
+    assert( obj->ops == &completion_ops );
+    remove_inproc_sync_queue( obj, entry, completion->sync );
 }
 
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct completion *completion = (struct completion *)obj;
 
-    return !list_empty( &completion->queue );
+    return !list_empty( &completion->queue ) || get_shared_depth( completion );
 }
 
 static struct completion *create_completion( struct object *root, const struct unicode_str *name,
@@ -138,6 +256,7 @@ static struct completion *create_completion( struct object *root, const struct u
         {
             list_init( &completion->queue );
             completion->depth = 0;
+            completion->sync  = alloc_inproc_completion();
         }
     }
 
@@ -149,12 +268,25 @@ struct completion *get_completion_obj( struct process *process, obj_handle_t han
     return (struct completion *) get_handle_obj( process, handle, access, &completion_ops );
 }
 
+struct inproc_sync *get_completion_inproc_sync( struct object *obj )
+{
+    if (obj->ops != &completion_ops) return NULL;
+    return ((struct completion *)obj)->sync;
+}
+
 void add_completion( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
                      unsigned int status, apc_param_t information )
 {
-    struct comp_msg *msg = mem_alloc( sizeof( *msg ) );
+    struct comp_msg *msg;
 
-    if (!msg)
+    if (completion->sync && list_empty( &completion->queue ) &&
+        add_shared_packet( completion, ckey, cvalue, status, information ))
+    {
+        wake_up( &completion->obj, 1 );
+        return;
+    }
+
+    if (!(msg = mem_alloc( sizeof( *msg ) )))
         return;
 
     msg->ckey = ckey;
@@ -164,6 +296,13 @@ void add_completion( struct completion *completion, apc_param_t ckey, apc_param_
 
     list_add_tail( &completion->queue, &msg->queue_entry );
     completion->depth++;
+    if (completion->sync)
+    {
+        /* clients have to remove packets through the server until the queue is empty */
+        __atomic_fetch_or( &get_inproc_sync( completion->sync )->state, INPROC_COMPLETION_OVERFLOW,
+                           __ATOMIC_SEQ_CST );
+        wake_inproc_sync( completion->sync, INT_MAX );
+    }
     wake_up( &completion->obj, 1 );
 }
 
@@ -214,12 +353,19 @@ DECL_HANDLER(remove_completion)
 {
     struct completion* completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
     struct list *entry;
-    struct comp_msg *msg;
+    struct comp_msg *msg, shared;
 
     if (!completion) return;
 
-    entry = list_head( &completion->queue );
-    if (!entry)
+    /* packets in the shared queue are older than the ones queued in the server */
+    if (completion->sync && remove_shared_packet( completion, &shared ))
+    {
+        reply->ckey = shared.ckey;
+        reply->cvalue = shared.cvalue;
+        reply->status = shared.status;
+        reply->information = shared.information;
+    }
+    else if (!(entry = list_head( &completion->queue )))
         set_error( STATUS_PENDING );
     else
     {
@@ -231,6 +377,9 @@ DECL_HANDLER(remove_completion)
         reply->status = msg->status;
         reply->information = msg->information;
         free( msg );
+        if (completion->sync && list_empty( &completion->queue ))
+            __atomic_fetch_and( &get_inproc_sync( completion->sync )->state, ~INPROC_COMPLETION_OVERFLOW,
+                                __ATOMIC_SEQ_CST );
     }
 
     release_object( completion );
@@ -243,7 +392,7 @@ DECL_HANDLER(query_completion)
 
     if (!completion) return;
 
-    reply->depth = completion->depth;
+    reply->depth = completion->depth + get_shared_depth( completion );
 
     release_object( completion );
 }
@@ -584,6 +584,7 @@ static inline void main_loop_epoll(void)
 
         ret = epoll_wait( epoll_fd, events, ARRAY_SIZE( events ), timeout );
         set_current_time();
+        if (server_stats && ret > 0) update_queue_stats( ret );
 
         /* put the events into the pollfd array first, like poll does */
         for (i = 0; i < ret; i++)
@@ -687,6 +688,7 @@ static inline void main_loop_epoll(void)
         else ret = kevent( kqueue_fd, NULL, 0, events, ARRAY_SIZE( events ), NULL );
 
         set_current_time();
+        if (server_stats && ret > 0) update_queue_stats( ret );
 
         /* put the events into the pollfd array first, like poll does */
         for (i = 0; i < ret; i++)
@@ -792,6 +794,7 @@ static inline void main_loop_epoll(void)
 	if (ret == -1) break;  /* an error occurred with event completion */
 
         set_current_time();
+        if (server_stats) update_queue_stats( nget );
 
         /* put the events into the pollfd array first, like poll does */
         for (i = 0; i < nget; i++)
@@ -963,6 +966,7 @@ void main_loop(void)
 
         ret = poll( pollfd, nb_users, timeout );
         set_current_time();
+        if (server_stats && ret > 0) update_queue_stats( ret );
 
         if (ret > 0)
         {
@@ -2859,9 +2863,12 @@ DECL_HANDLER(get_handle_unix_name)
 /* get a Unix fd to access a file */
 DECL_HANDLER(get_handle_fd)
 {
+    struct object *obj;
     struct fd *fd;
 
-    if ((fd = get_handle_fd_obj( current->process, req->handle, 0 )))
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+
+    if ((fd = get_obj_fd( obj )))
     {
         int unix_fd = get_unix_fd( fd );
         reply->cacheable = fd->cacheable;
@@ -2870,10 +2877,16 @@ DECL_HANDLER(get_handle_fd)
             reply->type = fd->fd_ops->get_fd_type( fd );
             reply->options = fd->options;
             reply->access = get_handle_access( current->process, req->handle );
+            reply->handle_flags = get_handle_flags( current->process, req->handle );
+            reply->file_info = (fd->fd_ops->get_file_info == default_fd_get_file_info);
             send_client_fd( current->process, unix_fd, req->handle );
         }
         release_object( fd );
     }
+    /* objects that don't support fds will never have one, let the client remember it */
+    else if (obj->ops->get_fd == no_get_fd) reply->cacheable = 1;
+
+    release_object( obj );
 }
 
 /* perform a read on a file object */
@@ -176,6 +176,7 @@ struct memory_view;
 
 extern void init_memory(void);
 extern int grow_file( int unix_fd, file_pos_t new_size );
+extern int create_temp_file( file_pos_t size );
 extern void free_map_addr( client_ptr_t base, mem_size_t size );
 extern struct memory_view *find_mapped_view( struct process *process, client_ptr_t base );
 extern struct memory_view *get_exe_view( struct process *process );
@@ -188,6 +189,8 @@ extern struct mapping *create_fd_mapping( struct object *root, const struct unic
                                           unsigned int attr, const struct security_descriptor *sd );
 extern struct object *create_user_data_mapping( struct object *root, const struct unicode_str *name,
                                                 unsigned int attr, const struct security_descriptor *sd );
+extern struct object *create_user_shm_mapping( struct object *root, const struct unicode_str *name,
+                                               unsigned int attr, const struct security_descriptor *sd );
 
 /* device functions */
 
@@ -212,6 +215,7 @@ extern struct dir *get_dir_obj( struct process *process, obj_handle_t handle, un
 /* completion */
 
 extern struct completion *get_completion_obj( struct process *process, obj_handle_t handle, unsigned int access );
+extern struct inproc_sync *get_completion_inproc_sync( struct object *obj );
 extern void add_completion( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
                             unsigned int status, apc_param_t information );
 
@@ -238,12 +242,15 @@ extern void async_set_initial_status( struct async *async, unsigned int status )
 extern void async_wake_obj( struct async *async );
 extern int async_waiting( struct async_queue *queue );
 extern int async_queue_has_waiting_asyncs( struct async_queue *queue );
+extern int async_queue_client_polled( struct async_queue *queue );
+extern void async_set_client_poll( struct async *async );
 extern void async_terminate( struct async *async, unsigned int status );
 extern void async_request_complete( struct async *async, unsigned int status, data_size_t result,
                                     data_size_t out_size, void *out_data );
 extern void async_request_complete_alloc( struct async *async, unsigned int status, data_size_t result,
                                           data_size_t out_size, const void *out_data );
 extern void async_wake_up( struct async_queue *queue, unsigned int status );
+extern void async_wake_up_count( struct async_queue *queue, unsigned int count );
 extern struct completion *fd_get_completion( struct fd *fd, apc_param_t *p_key );
 extern void fd_copy_completion( struct fd *src, struct fd *dst );
 extern struct iosb *async_get_iosb( struct async *async );
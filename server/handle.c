@@ -508,6 +508,16 @@ unsigned int get_handle_access( struct process *process, obj_handle_t handle )
     return entry->access & ~RESERVED_ALL;
 }
 
+/* retrieve the flags (HANDLE_FLAG_*) of a handle */
+unsigned int get_handle_flags( struct process *process, obj_handle_t handle )
+{
+    struct handle_entry *entry;
+
+    if (get_magic_handle( handle )) return 0;
+    if (!(entry = get_handle( process, handle ))) return 0;
+    return (entry->access & RESERVED_ALL) >> RESERVED_SHIFT;
+}
+
 /* find the first inherited handle of the given type */
 /* this is needed for window stations and desktops (don't ask...) */
 obj_handle_t find_inherited_handle( struct process *process, const struct object_ops *ops )
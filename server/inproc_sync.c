@@ -0,0 +1,445 @@
+/*
+ * Server-side support for in-process synchronization objects
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * When enabled (WINEINPROCSYNC=1 in the environment of the server), the state of
+ * events, mutexes and semaphores lives in a shared memory block that is mapped by
+ * the process that created them. Threads of that process then signal and wait on
+ * these objects directly, using futexes on the state word, without any server round
+ * trip. Each process has its own block, so that a process can't access the state of
+ * objects created by other processes; it has to use server requests for them.
+ *
+ * As long as no thread is waiting on an object through the server, the shared state
+ * is authoritative and both clients and server update it with atomic operations.
+ * Once a server-side wait is queued on the object, the INPROC_SYNC_SERVER bit is set
+ * in the state word; from then on clients fall back to server requests for that
+ * object, so that the server can safely check and consume the state while waking up
+ * its waiters. The bit is cleared again when the last server-side waiter is removed.
+ *
+ * The shared memory is writable by the client, so the server never trusts its
+ * contents: the object type and the completion queue index are kept on the server
+ * side, and the state is only used as the value of the object.
+ *
+ * Clients increment the reference count of an object state before using it, and then
+ * check that its serial number still matches the one they got with the handle. When
+ * the object is destroyed the serial number is incremented and the INPROC_SYNC_SERVER
+ * bit is set, and the entry is only reused once no client references it anymore.
+ *
+ * Completion ports use the same mechanism: the state word counts the packets in a
+ * queue that follows the object array in the shared memory, so that clients can
+ * post and remove packets without server round trips (see server/completion.c).
+ * The queue of a destroyed port is only reused once the clients have released the
+ * object state that pointed to it.
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#ifdef __linux__
+# include <linux/futex.h>
+# include <sys/syscall.h>
+#endif
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+
+#include "file.h"
+#include "handle.h"
+#include "process.h"
+#include "thread.h"
+#include "request.h"
+
+#define INPROC_SYNC_SHM_SIZE (INPROC_SYNC_MAX_OBJECTS * sizeof(inproc_sync_t) + \
+                              INPROC_COMPLETION_MAX_PORTS * sizeof(inproc_completion_t))
+
+/* number of freed entries that are checked for client references when allocating a new one */
+#define INPROC_SYNC_FREE_SCAN 16
+
+/* shared memory holding the state of the in-process objects created by a process */
+struct inproc_sync_mem
+{
+    struct object         obj;              /* object header */
+    int                   fd;               /* file descriptor of the shared memory */
+    inproc_sync_t        *objects;          /* mapped object states */
+    inproc_completion_t  *completions;      /* completion queues, following the objects */
+    unsigned int         *free_indices;     /* stack of freed object indices */
+    unsigned int          free_count;       /* number of entries in free_indices */
+    unsigned int          free_size;        /* allocated size of free_indices */
+    unsigned int          next_index;       /* first never used index; 0 is reserved */
+    unsigned char         completion_used[INPROC_COMPLETION_MAX_PORTS];  /* completion queue states */
+    unsigned int          completion_owner[INPROC_COMPLETION_MAX_PORTS]; /* object index of the last port */
+};
+
+/* states of the completion queues */
+enum inproc_completion_state
+{
+    INPROC_COMPLETION_FREE,      /* never used, or no longer referenced by clients */
+    INPROC_COMPLETION_USED,      /* belongs to a live completion port */
+    INPROC_COMPLETION_RELEASED,  /* port destroyed, clients may still reference the queue */
+};
+
+/* server-side reference to the shared state of an object */
+struct inproc_sync
+{
+    struct inproc_sync_mem *mem;            /* shared memory holding the state */
+    unsigned int            index;          /* index of the state in the shared memory */
+    enum inproc_sync_type   type;           /* object type */
+    unsigned int            queue;          /* index of the completion queue */
+};
+
+static void inproc_sync_mem_dump( struct object *obj, int verbose );
+static void inproc_sync_mem_destroy( struct object *obj );
+
+static const struct object_ops inproc_sync_mem_ops =
+{
+    sizeof(struct inproc_sync_mem), /* size */
+    &no_type,                  /* type */
+    inproc_sync_mem_dump,      /* dump */
+    no_add_queue,              /* add_queue */
+    NULL,                      /* remove_queue */
+    NULL,                      /* signaled */
+    NULL,                      /* satisfied */
+    no_signal,                 /* signal */
+    no_get_fd,                 /* get_fd */
+    default_map_access,        /* map_access */
+    default_get_sd,            /* get_sd */
+    default_set_sd,            /* set_sd */
+    no_get_full_name,          /* get_full_name */
+    no_lookup_name,            /* lookup_name */
+    no_link_name,              /* link_name */
+    NULL,                      /* unlink_name */
+    no_open_file,              /* open_file */
+    no_kernel_obj_list,        /* get_kernel_obj_list */
+    no_close_handle,           /* close_handle */
+    inproc_sync_mem_destroy    /* destroy */
+};
+
+static int inproc_sync_enabled;
+
+static inline void futex_wake( unsigned int *addr, int count )
+{
+#ifdef __linux__
+    syscall( __NR_futex, addr, FUTEX_WAKE, count, NULL, 0, 0 );
+#endif
+}
+
+static void inproc_sync_mem_dump( struct object *obj, int verbose )
+{
+    struct inproc_sync_mem *mem = (struct inproc_sync_mem *)obj;
+    assert( obj->ops == &inproc_sync_mem_ops );
+    fprintf( stderr, "In-process sync memory objects=%u free=%u\n", mem->next_index, mem->free_count );
+}
+
+static void inproc_sync_mem_destroy( struct object *obj )
+{
+    struct inproc_sync_mem *mem = (struct inproc_sync_mem *)obj;
+    assert( obj->ops == &inproc_sync_mem_ops );
+
+    if (mem->objects) munmap( mem->objects, INPROC_SYNC_SHM_SIZE );
+    if (mem->fd != -1) close( mem->fd );
+    free( mem->free_indices );
+}
+
+/* create the shared memory of a process */
+static struct inproc_sync_mem *create_inproc_sync_mem(void)
+{
+    struct inproc_sync_mem *mem;
+    void *ptr;
+
+    if (!(mem = alloc_object( &inproc_sync_mem_ops ))) return NULL;
+    mem->fd           = -1;
+    mem->objects      = NULL;
+    mem->completions  = NULL;
+    mem->free_indices = NULL;
+    mem->free_count   = 0;
+    mem->free_size    = 0;
+    mem->next_index   = 1;
+    memset( mem->completion_used, INPROC_COMPLETION_FREE, sizeof(mem->completion_used) );
+    memset( mem->completion_owner, 0, sizeof(mem->completion_owner) );
+
+    if ((mem->fd = create_temp_file( INPROC_SYNC_SHM_SIZE )) == -1) goto failed;
+    if ((ptr = mmap( NULL, INPROC_SYNC_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, mem->fd, 0 )) == MAP_FAILED)
+        goto failed;
+
+    mem->objects = ptr;
+    mem->completions = (inproc_completion_t *)(mem->objects + INPROC_SYNC_MAX_OBJECTS);
+    return mem;
+
+failed:
+    fprintf( stderr, "wineserver: failed to create in-process synchronization memory\n" );
+    inproc_sync_enabled = 0;
+    release_object( mem );
+    clear_error();
+    return NULL;
+}
+
+/* retrieve the shared memory of the current process, creating it if needed */
+static struct inproc_sync_mem *get_inproc_sync_mem(void)
+{
+    if (!inproc_sync_enabled || !current) return NULL;
+    if (!current->process->inproc_sync) current->process->inproc_sync = create_inproc_sync_mem();
+    return current->process->inproc_sync;
+}
+
+/* check whether in-process synchronization is enabled */
+void init_inproc_sync(void)
+{
+#ifdef __linux__
+    const char *env;
+
+    if (!(env = getenv( "WINEINPROCSYNC" )) || !atoi( env )) return;
+    inproc_sync_enabled = 1;
+    if (debug_level) fprintf( stderr, "wineserver: using in-process synchronization\n" );
+#endif
+}
+
+/* find a free entry in the shared memory of a process */
+static unsigned int alloc_inproc_sync_index( struct inproc_sync_mem *mem )
+{
+    unsigned int i, index;
+
+    /* entries that are still referenced by clients can't be reused yet */
+    for (i = 0; i < INPROC_SYNC_FREE_SCAN && i < mem->free_count; i++)
+    {
+        unsigned int pos = mem->free_count - 1 - i;
+
+        index = mem->free_indices[pos];
+        if (__atomic_load_n( &mem->objects[index].refs, __ATOMIC_SEQ_CST )) continue;
+        mem->free_indices[pos] = mem->free_indices[--mem->free_count];
+        return index;
+    }
+    if (mem->next_index < INPROC_SYNC_MAX_OBJECTS) return mem->next_index++;
+    return 0;
+}
+
+/* add an entry to the free list of the shared memory */
+static void free_inproc_sync_index( struct inproc_sync_mem *mem, unsigned int index )
+{
+    if (mem->free_count == mem->free_size)
+    {
+        unsigned int new_size = max( mem->free_size * 2, 64 );
+        unsigned int *new_indices = realloc( mem->free_indices, new_size * sizeof(*new_indices) );
+
+        if (!new_indices) return;  /* leak the entry */
+        mem->free_indices = new_indices;
+        mem->free_size = new_size;
+    }
+    mem->free_indices[mem->free_count++] = index;
+}
+
+/* allocate the shared state of a new object; return NULL if in-process synchronization is not available */
+struct inproc_sync *alloc_inproc_sync( enum inproc_sync_type type, unsigned int state, unsigned int count )
+{
+    struct inproc_sync_mem *mem;
+    struct inproc_sync *sync;
+    inproc_sync_t *shm;
+    unsigned int index;
+
+    if (!(mem = get_inproc_sync_mem())) return NULL;
+    if (!(index = alloc_inproc_sync_index( mem ))) return NULL;
+    if (!(sync = mem_alloc( sizeof(*sync) )))
+    {
+        free_inproc_sync_index( mem, index );
+        clear_error();
+        return NULL;
+    }
+
+    sync->mem   = (struct inproc_sync_mem *)grab_object( mem );
+    sync->index = index;
+    sync->type  = type;
+    sync->queue = 0;
+
+    /* the serial number was already changed when the previous object was freed */
+    shm = &mem->objects[index];
+    shm->count     = count;
+    shm->abandoned = 0;
+    shm->type      = type;
+    __atomic_store_n( &shm->state, state, __ATOMIC_SEQ_CST );
+    return sync;
+}
+
+/* free the shared state of a destroyed object */
+void free_inproc_sync( struct inproc_sync *sync )
+{
+    struct inproc_sync_mem *mem;
+    inproc_sync_t *shm;
+
+    if (!sync) return;
+    mem = sync->mem;
+    shm = &mem->objects[sync->index];
+
+    /* make clients that still use it fall back to the server, and invalidate their handle caches */
+    shm->type = INPROC_SYNC_NONE;
+    __atomic_store_n( &shm->state, INPROC_SYNC_SERVER, __ATOMIC_SEQ_CST );
+    __atomic_fetch_add( &shm->serial, 1, __ATOMIC_SEQ_CST );
+    futex_wake( &shm->state, INT_MAX );
+
+    if (sync->type == INPROC_SYNC_COMPLETION) mem->completion_used[sync->queue] = INPROC_COMPLETION_RELEASED;
+    free_inproc_sync_index( mem, sync->index );
+    release_object( mem );
+    free( sync );
+}
+
+/* allocate the shared state and packet queue of a completion port; return NULL if not available */
+struct inproc_sync *alloc_inproc_completion(void)
+{
+    struct inproc_sync_mem *mem;
+    struct inproc_sync *sync;
+    inproc_completion_t *queue;
+    unsigned int i, pos;
+
+    if (!(mem = get_inproc_sync_mem())) return NULL;
+    for (pos = 0; pos < INPROC_COMPLETION_MAX_PORTS; pos++)
+    {
+        if (mem->completion_used[pos] == INPROC_COMPLETION_FREE) break;
+        if (mem->completion_used[pos] != INPROC_COMPLETION_RELEASED) continue;
+        /* clients may still access the queue through the state of the destroyed port; if that
+         * entry has been reused by another object in the meantime, we only wait longer than needed */
+        if (!__atomic_load_n( &mem->objects[mem->completion_owner[pos]].refs, __ATOMIC_SEQ_CST )) break;
+    }
+    if (pos == INPROC_COMPLETION_MAX_PORTS) return NULL;
+
+    queue = &mem->completions[pos];
+    queue->head = queue->tail = queue->waiters = 0;
+    for (i = 0; i < INPROC_COMPLETION_SIZE; i++) queue->packets[i].seq = i;
+
+    if (!(sync = alloc_inproc_sync( INPROC_SYNC_COMPLETION, 0, pos ))) return NULL;
+    sync->queue = pos;
+    mem->completion_used[pos] = INPROC_COMPLETION_USED;
+    mem->completion_owner[pos] = sync->index;
+    return sync;
+}
+
+/* retrieve the packet queue of a completion port */
+inproc_completion_t *get_inproc_completion( struct inproc_sync *sync )
+{
+    assert( sync->type == INPROC_SYNC_COMPLETION );
+    return &sync->mem->completions[sync->queue];
+}
+
+/* retrieve the shared state of an object */
+inproc_sync_t *get_inproc_sync( struct inproc_sync *sync )
+{
+    return &sync->mem->objects[sync->index];
+}
+
+/* return the current value of the object state word, without the server flag */
+unsigned int get_inproc_sync_state( struct inproc_sync *sync )
+{
+    return __atomic_load_n( &get_inproc_sync( sync )->state, __ATOMIC_SEQ_CST ) & ~INPROC_SYNC_SERVER;
+}
+
+/* atomically replace the object state if it still has the expected value */
+int update_inproc_sync_state( struct inproc_sync *sync, unsigned int old_state, unsigned int new_state )
+{
+    unsigned int *ptr = &get_inproc_sync( sync )->state;
+    unsigned int cur = __atomic_load_n( ptr, __ATOMIC_SEQ_CST );
+
+    do
+    {
+        if ((cur & ~INPROC_SYNC_SERVER) != old_state) return 0;
+    } while (!__atomic_compare_exchange_n( ptr, &cur, (cur & INPROC_SYNC_SERVER) | new_state,
+                                           0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ));
+    return 1;
+}
+
+/* atomically set the object state, returning the previous one */
+unsigned int set_inproc_sync_state( struct inproc_sync *sync, unsigned int state )
+{
+    unsigned int prev;
+
+    do prev = get_inproc_sync_state( sync );
+    while (!update_inproc_sync_state( sync, prev, state ));
+    return prev;
+}
+
+/* wake up client threads waiting on the object */
+void wake_inproc_sync( struct inproc_sync *sync, int count )
+{
+    futex_wake( &get_inproc_sync( sync )->state, count );
+}
+
+/* add a server-side waiter, taking over the object state from the clients */
+int add_inproc_sync_queue( struct object *obj, struct wait_queue_entry *entry, struct inproc_sync *sync )
+{
+    if (sync && list_empty( &obj->wait_queue ))
+    {
+        unsigned int *ptr = &get_inproc_sync( sync )->state;
+
+        __atomic_fetch_or( ptr, INPROC_SYNC_SERVER, __ATOMIC_SEQ_CST );
+        /* threads waiting in the client need to queue themselves on the server now */
+        futex_wake( ptr, INT_MAX );
+    }
+    return add_queue( obj, entry );
+}
+
+/* remove a server-side waiter, handing the object state back to the clients if it was the last one */
+void remove_inproc_sync_queue( struct object *obj, struct wait_queue_entry *entry, struct inproc_sync *sync )
+{
+    remove_queue( obj, entry );
+    if (sync && list_empty( &obj->wait_queue ))
+        __atomic_fetch_and( &get_inproc_sync( sync )->state, ~INPROC_SYNC_SERVER, __ATOMIC_SEQ_CST );
+}
+
+/* retrieve the shared memory holding the in-process synchronization objects of the process */
+DECL_HANDLER(get_inproc_sync_shm)
+{
+    struct inproc_sync_mem *mem;
+
+    if (!(mem = get_inproc_sync_mem()))
+    {
+        set_error( STATUS_NOT_SUPPORTED );
+        return;
+    }
+    reply->size = INPROC_SYNC_SHM_SIZE;
+    send_client_fd( current->process, mem->fd, 0 );
+}
+
+/* retrieve the in-process synchronization state of an object */
+DECL_HANDLER(get_inproc_sync)
+{
+    struct inproc_sync *sync;
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+
+    if (!(sync = get_event_inproc_sync( obj )) &&
+        !(sync = get_mutex_inproc_sync( obj )) &&
+        !(sync = get_semaphore_inproc_sync( obj )))
+        sync = get_completion_inproc_sync( obj );
+
+    /* objects created by other processes are only accessed through the server */
+    if (sync && sync->mem == current->process->inproc_sync)
+    {
+        reply->index  = sync->index;
+        reply->serial = __atomic_load_n( &get_inproc_sync( sync )->serial, __ATOMIC_SEQ_CST );
+    }
+    reply->access = get_handle_access( current->process, req->handle );
+    release_object( obj );
+}
@@ -53,7 +53,7 @@ static mach_port_t server_mach_port;
 
 void sigchld_callback(void)
 {
-    assert(0);  /* should never be called on MacOS */
+    /* only the registry save process can be a child of the server, it is waited for in registry.c */
 }
 
 static void mach_set_error(kern_return_t mach_error)
@@ -38,6 +38,8 @@
 /* command-line options */
 int debug_level = 0;
 int foreground = 0;
+int server_stats = 0;
+const char *server_stats_file = NULL;
 timeout_t master_socket_timeout = 3 * -TICKS_PER_SEC;  /* master socket timeout, default is 3 seconds */
 const char *server_argv0;
 
@@ -52,6 +54,7 @@ static void usage( FILE *fh )
     fprintf(fh, "   -h,    --help            display this help message\n");
     fprintf(fh, "   -k[n], --kill[=n]        kill the current wineserver, optionally with signal n\n");
     fprintf(fh, "   -p[n], --persistent[=n]  make server persistent, optionally for n seconds\n");
+    fprintf(fh, "   -s[f], --stats[=f]       collect request statistics, optionally writing them to file f\n");
     fprintf(fh, "   -v,    --version         display version information and exit\n");
     fprintf(fh, "   -w,    --wait            wait until the current wineserver terminates\n");
     fprintf(fh, "\n");
@@ -88,6 +91,10 @@ static void option_callback( int optc, char *optarg )
         else
             master_socket_timeout = TIMEOUT_INFINITE;
         break;
+    case 's':
+        server_stats = 1;
+        if (optarg && *optarg) server_stats_file = optarg;
+        break;
     case 'v':
         fprintf( stderr, "%s\n", PACKAGE_STRING );
         exit(0);
@@ -112,6 +119,7 @@ static struct long_option
     {"help",        0, 'h'},
     {"kill",        2, 'k'},
     {"persistent",  2, 'p'},
+    {"stats",       2, 's'},
     {"version",     0, 'v'},
     {"wait",        0, 'w'},
     { NULL }
@@ -216,7 +224,7 @@ int main( int argc, char *argv[] )
 {
     setvbuf( stderr, NULL, _IOLBF, 0 );
     server_argv0 = argv[0];
-    parse_options( argc, argv, "d::fhk::p::vw", long_options, option_callback );
+    parse_options( argc, argv, "d::fhk::p::s::vw", long_options, option_callback );
 
     /* setup temporary handlers before the real signal initialization is done */
     signal( SIGPIPE, SIG_IGN );
@@ -233,6 +241,7 @@ int main( int argc, char *argv[] )
     set_current_time();
     init_signals();
     init_memory();
+    init_inproc_sync();
     init_directories( load_intl_file() );
     init_registry();
     main_loop();
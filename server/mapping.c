@@ -25,6 +25,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
@@ -318,7 +319,7 @@ static int check_current_dir_for_exec(void)
 }
 
 /* create a temp file for anonymous mappings */
-static int create_temp_file( file_pos_t size )
+int create_temp_file( file_pos_t size )
 {
     static int temp_dir_fd = -1;
     char tmpfn[16];
@@ -1256,6 +1257,47 @@ int get_page_size(void)
     return page_mask + 1;
 }
 
+/* retrieve the size of the large pages supported by the host, 0 if none */
+static unsigned int get_large_page_size(void)
+{
+#ifdef __linux__
+    unsigned long size = 0, total = 0, hugetlb_size = 0;
+    char line[128];
+    FILE *f;
+
+    /* transparent huge pages, unless disabled */
+    if ((f = fopen( "/sys/kernel/mm/transparent_hugepage/enabled", "r" )))
+    {
+        if (fgets( line, sizeof(line), f ) && !strstr( line, "[never]" ))
+        {
+            FILE *f2 = fopen( "/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r" );
+            if (f2)
+            {
+                if (fscanf( f2, "%lu", &size ) != 1) size = 0;
+                fclose( f2 );
+            }
+        }
+        fclose( f );
+    }
+    if (size) return size;
+
+    /* otherwise a preallocated hugetlb pool */
+    if ((f = fopen( "/proc/meminfo", "r" )))
+    {
+        while (fgets( line, sizeof(line), f ))
+        {
+            if (sscanf( line, "HugePages_Total: %lu", &total ) == 1) continue;
+            if (sscanf( line, "Hugepagesize: %lu kB", &hugetlb_size ) == 1) hugetlb_size *= 1024;
+        }
+        fclose( f );
+    }
+    return total ? hugetlb_size : 0;
+#else
+    /* large page allocations use normal pages, which the system may promote to superpages */
+    return 2 * 1024 * 1024;
+#endif
+}
+
 struct object *create_user_data_mapping( struct object *root, const struct unicode_str *name,
                                         unsigned int attr, const struct security_descriptor *sd )
 {
@@ -1269,10 +1311,26 @@ struct object *create_user_data_mapping( struct object *root, const struct unico
     {
         user_shared_data = ptr;
         user_shared_data->SystemCall = 1;
+        user_shared_data->LargePageMinimum = get_large_page_size();
     }
     return &mapping->obj;
 }
 
+user_shm_t *user_shm = NULL;
+
+struct object *create_user_shm_mapping( struct object *root, const struct unicode_str *name,
+                                       unsigned int attr, const struct security_descriptor *sd )
+{
+    void *ptr;
+    struct mapping *mapping;
+
+    if (!(mapping = create_mapping( root, name, attr, sizeof(user_shm_t),
+                                    SEC_COMMIT, 0, FILE_READ_DATA | FILE_WRITE_DATA, sd ))) return NULL;
+    ptr = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
+    if (ptr != MAP_FAILED) user_shm = ptr;
+    return &mapping->obj;
+}
+
 /* create a file mapping */
 DECL_HANDLER(create_mapping)
 {
@@ -56,10 +56,16 @@ struct mutex
     struct thread *owner;           /* mutex owner */
     unsigned int   count;           /* recursion count */
     int            abandoned;       /* has it been abandoned? */
-    struct list    entry;           /* entry in owner thread mutex list */
+    struct list    entry;           /* entry in owner thread mutex list, or in inproc_mutexes */
+    struct inproc_sync *sync;       /* in-process synchronization state */
 };
 
+/* mutexes with an in-process state; the owner is only known by its thread id */
+static struct list inproc_mutexes = LIST_INIT( inproc_mutexes );
+
 static void mutex_dump( struct object *obj, int verbose );
+static int mutex_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void mutex_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static void mutex_destroy( struct object *obj );
@@ -70,8 +76,8 @@ static const struct object_ops mutex_ops =
     sizeof(struct mutex),      /* size */
     &mutex_type,               /* type */
     mutex_dump,                /* dump */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    mutex_add_queue,           /* add_queue */
+    mutex_remove_queue,        /* remove_queue */
     mutex_signaled,            /* signaled */
     mutex_satisfied,           /* satisfied */
     mutex_signal,              /* signal */
@@ -90,9 +96,43 @@ static const struct object_ops mutex_ops =
 };
 
 
+struct inproc_sync *get_mutex_inproc_sync( struct object *obj )
+{
+    if (obj->ops != &mutex_ops) return NULL;
+    return ((struct mutex *)obj)->sync;
+}
+
+/* return the id of the owner thread, 0 if the mutex is not owned */
+static thread_id_t get_mutex_owner( struct mutex *mutex )
+{
+    if (mutex->sync) return get_inproc_sync_state( mutex->sync );
+    return mutex->count ? mutex->owner->id : 0;
+}
+
+static unsigned int *get_mutex_count( struct mutex *mutex )
+{
+    if (mutex->sync) return &get_inproc_sync( mutex->sync )->count;
+    return &mutex->count;
+}
+
+static int *get_mutex_abandoned( struct mutex *mutex )
+{
+    if (mutex->sync) return &get_inproc_sync( mutex->sync )->abandoned;
+    return &mutex->abandoned;
+}
+
 /* grab a mutex for a given thread */
 static void do_grab( struct mutex *mutex, struct thread *thread )
 {
+    unsigned int *count = get_mutex_count( mutex );
+
+    if (mutex->sync)
+    {
+        /* the shared state cannot be trusted, don't assert on it */
+        if (!__atomic_fetch_add( count, 1, __ATOMIC_SEQ_CST )) set_inproc_sync_state( mutex->sync, thread->id );
+        return;
+    }
+
     assert( !mutex->count || (mutex->owner == thread) );
 
     if (!mutex->count++)  /* FIXME: avoid wrap-around */
@@ -106,6 +146,14 @@ static void do_grab( struct mutex *mutex, struct thread *thread )
 /* release a mutex once the recursion count is 0 */
 static void do_release( struct mutex *mutex )
 {
+    if (mutex->sync)
+    {
+        set_inproc_sync_state( mutex->sync, 0 );
+        wake_inproc_sync( mutex->sync, 1 );
+        wake_up( &mutex->obj, 0 );
+        return;
+    }
+
     assert( !mutex->count );
     /* remove the mutex from the thread list of owned mutexes */
     list_remove( &mutex->entry );
@@ -126,48 +174,89 @@ static struct mutex *create_mutex( struct object *root, const struct unicode_str
             mutex->count = 0;
             mutex->owner = NULL;
             mutex->abandoned = 0;
+            if ((mutex->sync = alloc_inproc_sync( INPROC_SYNC_MUTEX, 0, 0 )))
+                list_add_tail( &inproc_mutexes, &mutex->entry );
             if (owned) do_grab( mutex, current );
         }
     }
     return mutex;
 }
 
+/* find an in-process mutex owned by a given thread */
+static struct mutex *find_inproc_mutex( struct thread *thread )
+{
+    struct mutex *mutex;
+
+    LIST_FOR_EACH_ENTRY( mutex, &inproc_mutexes, struct mutex, entry )
+        if (get_mutex_owner( mutex ) == thread->id) return mutex;
+    return NULL;
+}
+
 void abandon_mutexes( struct thread *thread )
 {
+    struct mutex *mutex;
     struct list *ptr;
 
     while ((ptr = list_head( &thread->mutex_list )) != NULL)
     {
-        struct mutex *mutex = LIST_ENTRY( ptr, struct mutex, entry );
+        mutex = LIST_ENTRY( ptr, struct mutex, entry );
         assert( mutex->owner == thread );
         mutex->count = 0;
         mutex->abandoned = 1;
         do_release( mutex );
     }
+
+    /* in-process mutexes may have been acquired without the server knowing about it */
+    while ((mutex = find_inproc_mutex( thread )))
+    {
+        inproc_sync_t *sync = get_inproc_sync( mutex->sync );
+        __atomic_store_n( &sync->count, 0, __ATOMIC_SEQ_CST );
+        __atomic_store_n( &sync->abandoned, 1, __ATOMIC_SEQ_CST );
+        do_release( mutex );
+    }
 }
 
 static void mutex_dump( struct object *obj, int verbose )
 {
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
-    fprintf( stderr, "Mutex count=%u owner=%p\n", mutex->count, mutex->owner );
+    fprintf( stderr, "Mutex count=%u owner=%04x\n", *get_mutex_count( mutex ), get_mutex_owner( mutex ));
+}
+
+static int mutex_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct mutex *mutex = (struct mutex *)obj;
+    assert( obj->ops == &mutex_ops );
+    return add_inproc_sync_queue( obj, entry, mutex->sync );
+}
+
+static void mutex_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct mutex *mutex = (struct mutex *)obj;
+    assert( obj->ops == &mutex_ops );
+    remove_inproc_sync_queue( obj, entry, mutex->sync );
 }
 
 static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct mutex *mutex = (struct mutex *)obj;
+    thread_id_t owner;
+
     assert( obj->ops == &mutex_ops );
-    return (!mutex->count || (mutex->owner == get_wait_queue_thread( entry )));
+    owner = get_mutex_owner( mutex );
+    return (!owner || (owner == get_wait_queue_thread( entry )->id));
 }
 
 static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry )
 {
     struct mutex *mutex = (struct mutex *)obj;
+    int *abandoned = get_mutex_abandoned( mutex );
+
     assert( obj->ops == &mutex_ops );
 
     do_grab( mutex, get_wait_queue_thread( entry ));
-    if (mutex->abandoned) make_wait_abandoned( entry );
-    mutex->abandoned = 0;
+    if (*abandoned) make_wait_abandoned( entry );
+    *abandoned = 0;
 }
 
 static int mutex_signal( struct object *obj, unsigned int access )
@@ -180,12 +269,12 @@ static int mutex_signal( struct object *obj, unsigned int access )
         set_error( STATUS_ACCESS_DENIED );
         return 0;
     }
-    if (!mutex->count || (mutex->owner != current))
+    if (get_mutex_owner( mutex ) != current->id)
     {
         set_error( STATUS_MUTANT_NOT_OWNED );
         return 0;
     }
-    if (!--mutex->count) do_release( mutex );
+    if (!__atomic_sub_fetch( get_mutex_count( mutex ), 1, __ATOMIC_SEQ_CST )) do_release( mutex );
     return 1;
 }
 
@@ -194,6 +283,12 @@ static void mutex_destroy( struct object *obj )
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
 
+    if (mutex->sync)
+    {
+        list_remove( &mutex->entry );
+        free_inproc_sync( mutex->sync );
+        return;
+    }
     if (!mutex->count) return;
     mutex->count = 0;
     do_release( mutex );
@@ -240,11 +335,13 @@ DECL_HANDLER(release_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  0, &mutex_ops )))
     {
-        if (!mutex->count || (mutex->owner != current)) set_error( STATUS_MUTANT_NOT_OWNED );
+        unsigned int *count = get_mutex_count( mutex );
+
+        if (get_mutex_owner( mutex ) != current->id) set_error( STATUS_MUTANT_NOT_OWNED );
         else
         {
-            reply->prev_count = mutex->count;
-            if (!--mutex->count) do_release( mutex );
+            reply->prev_count = *count;
+            if (!--*count) do_release( mutex );
         }
         release_object( mutex );
     }
@@ -258,9 +355,9 @@ DECL_HANDLER(query_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  MUTANT_QUERY_STATE, &mutex_ops )))
     {
-        reply->count = mutex->count;
-        reply->owned = (mutex->owner == current);
-        reply->abandoned = mutex->abandoned;
+        reply->count = *get_mutex_count( mutex );
+        reply->owned = (get_mutex_owner( mutex ) == current->id);
+        reply->abandoned = *get_mutex_abandoned( mutex );
 
         release_object( mutex );
     }
@@ -23,11 +23,17 @@
 #include "config.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <poll.h>
 #include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -66,6 +72,8 @@ struct pipe_end
     struct list          message_queue;
     struct async_queue   read_q;     /* read queue */
     struct async_queue   write_q;    /* write queue */
+    struct fd           *sock_fd;    /* unix socket connected to the other end, if any */
+    struct timeout_user *flush_timeout; /* timer waiting for the other end to drain the socket */
 };
 
 struct pipe_server
@@ -244,6 +252,44 @@ static const struct fd_ops pipe_client_fd_ops =
     pipe_end_reselect_async       /* reselect_async */
 };
 
+/* socket functions, used once the pipe ends are connected through a unix socket pair */
+static int pipe_sock_get_poll_events( struct fd *fd );
+static void pipe_sock_poll_event( struct fd *fd, int event );
+
+static const struct fd_ops pipe_server_sock_fd_ops =
+{
+    pipe_sock_get_poll_events,    /* get_poll_events */
+    pipe_sock_poll_event,         /* poll_event */
+    pipe_end_get_fd_type,         /* get_fd_type */
+    pipe_end_read,                /* read */
+    pipe_end_write,               /* write */
+    pipe_end_flush,               /* flush */
+    pipe_end_get_file_info,       /* get_file_info */
+    pipe_end_get_volume_info,     /* get_volume_info */
+    pipe_server_ioctl,            /* ioctl */
+    default_fd_cancel_async,      /* cancel_async */
+    default_fd_queue_async,       /* queue_async */
+    pipe_end_reselect_async       /* reselect_async */
+};
+
+static const struct fd_ops pipe_client_sock_fd_ops =
+{
+    pipe_sock_get_poll_events,    /* get_poll_events */
+    pipe_sock_poll_event,         /* poll_event */
+    pipe_end_get_fd_type,         /* get_fd_type */
+    pipe_end_read,                /* read */
+    pipe_end_write,               /* write */
+    pipe_end_flush,               /* flush */
+    pipe_end_get_file_info,       /* get_file_info */
+    pipe_end_get_volume_info,     /* get_volume_info */
+    pipe_client_ioctl,            /* ioctl */
+    default_fd_cancel_async,      /* cancel_async */
+    default_fd_queue_async,       /* queue_async */
+    pipe_end_reselect_async       /* reselect_async */
+};
+
+static int use_pipe_sockets;  /* connect pipe ends through unix sockets (WINEPIPESOCKETS) */
+
 static void named_pipe_device_dump( struct object *obj, int verbose );
 static struct object *named_pipe_device_lookup_name( struct object *obj,
     struct unicode_str *name, unsigned int attr, struct object *root );
@@ -371,12 +417,180 @@ static void named_pipe_destroy( struct object *obj)
     free_async_queue( &pipe->waiters );
 }
 
+/* associate the completion port of one fd of a pipe end to the other one as well */
+static void copy_pipe_completion( struct fd *src, struct fd *dst )
+{
+    struct completion *completion;
+    apc_param_t key;
+
+    if ((completion = fd_get_completion( dst, &key )))
+    {
+        release_object( completion );
+        return;
+    }
+    if (!(completion = fd_get_completion( src, &key ))) return;
+    release_object( completion );
+    fd_copy_completion( src, dst );
+}
+
 static struct fd *pipe_end_get_fd( struct object *obj )
 {
     struct pipe_end *pipe_end = (struct pipe_end *) obj;
+
+    if (pipe_end->sock_fd)
+    {
+        copy_pipe_completion( pipe_end->fd, pipe_end->sock_fd );
+        copy_pipe_completion( pipe_end->sock_fd, pipe_end->fd );
+        /* the client falls back to the server whenever the socket would block, but it
+         * can't return partial writes of the nonblocking mode by itself */
+        if (!(pipe_end->flags & NAMED_PIPE_NONBLOCKING_MODE))
+            return (struct fd *) grab_object( pipe_end->sock_fd );
+    }
     return (struct fd *) grab_object( pipe_end->fd );
 }
 
+/* check if the pipe end has data waiting to be read */
+static int pipe_end_has_data( struct pipe_end *pipe_end )
+{
+    if (pipe_end->sock_fd) return check_fd_events( pipe_end->sock_fd, POLLIN ) != 0;
+    return !list_empty( &pipe_end->message_queue );
+}
+
+/* retrieve the amount of data not read yet from the socket of a pipe end */
+static data_size_t pipe_sock_get_avail( struct pipe_end *pipe_end )
+{
+    int avail = 0;
+
+    if (ioctl( get_unix_fd( pipe_end->sock_fd ), FIONREAD, &avail ) < 0) return 0;
+    return avail;
+}
+
+/* check if the other end didn't read everything that was written to the socket yet */
+static int pipe_sock_has_unread( struct pipe_end *pipe_end )
+{
+#ifdef TIOCOUTQ
+    int size = 0;
+    return !ioctl( get_unix_fd( pipe_end->sock_fd ), TIOCOUTQ, &size ) && size > 0;
+#else
+    return 0;
+#endif
+}
+
+/* read data from the socket of a pipe end; returns 0 if the read has to wait */
+static int pipe_sock_read( struct pipe_end *pipe_end, struct async *async )
+{
+    struct iosb *iosb = async_get_iosb( async );
+    int unix_fd = get_unix_fd( pipe_end->sock_fd );
+    unsigned int status = STATUS_SUCCESS;
+    data_size_t pos = 0;
+    char *buf = NULL;
+    ssize_t ret;
+
+    if (!check_fd_events( pipe_end->sock_fd, POLLIN ))
+    {
+        release_object( iosb );
+        return 0;
+    }
+
+    /* a zero-length read completes as soon as the socket is readable */
+    if (iosb->out_size)
+    {
+        if (!(buf = malloc( iosb->out_size )))
+        {
+            async_terminate( async, STATUS_NO_MEMORY );
+            release_object( iosb );
+            return 1;
+        }
+        while ((ret = recv( unix_fd, buf, iosb->out_size, MSG_DONTWAIT )) < 0 && errno == EINTR);
+        if (ret > 0) pos = ret;
+        else if (ret < 0 && errno == EAGAIN)
+        {
+            free( buf );
+            release_object( iosb );
+            return 0;
+        }
+        else status = STATUS_PIPE_BROKEN;
+    }
+
+    if (status == STATUS_SUCCESS)
+        async_request_complete( async, status, pos, pos, buf );
+    else
+    {
+        free( buf );
+        async_terminate( async, status );
+    }
+    release_object( iosb );
+    return 1;
+}
+
+/* write data to the socket of a pipe end; returns 0 if the write has to wait */
+static int pipe_sock_write( struct pipe_end *pipe_end, struct async *async )
+{
+    struct iosb *iosb = async_get_iosb( async );
+    int unix_fd = get_unix_fd( pipe_end->sock_fd );
+    unsigned int status = STATUS_SUCCESS;
+    ssize_t ret;
+
+    for (;;)
+    {
+        ret = send( unix_fd, (const char *)iosb->in_data + iosb->result,
+                    iosb->in_size - iosb->result, MSG_DONTWAIT );
+        if (ret >= 0)
+        {
+            iosb->result += ret;
+            if (iosb->result == iosb->in_size) break;
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN && !(pipe_end->flags & NAMED_PIPE_NONBLOCKING_MODE))
+        {
+            release_object( iosb );
+            return 0;
+        }
+        if (errno == EPIPE) status = STATUS_PIPE_CLOSING;
+        else if (errno != EAGAIN) status = STATUS_PIPE_BROKEN;
+        break;
+    }
+
+    if (status == STATUS_SUCCESS) async_request_complete( async, status, iosb->result, 0, NULL );
+    else async_terminate( async, status );
+    release_object( iosb );
+    return 1;
+}
+
+static void pipe_end_flush_timeout( void *private )
+{
+    struct pipe_end *pipe_end = private;
+
+    pipe_end->flush_timeout = NULL;
+    if (pipe_end->sock_fd && pipe_sock_has_unread( pipe_end ))
+        pipe_end->flush_timeout = add_timeout_user( -TICKS_PER_SEC / 100, pipe_end_flush_timeout, pipe_end );
+    else
+        fd_async_wake_up( pipe_end->fd, ASYNC_TYPE_WAIT, STATUS_SUCCESS );
+}
+
+/* shut down the socket of a pipe end; data still queued in the other end's socket remains readable */
+static void pipe_end_close_socket( struct pipe_end *pipe_end, unsigned int status )
+{
+    struct fd *sock_fd = pipe_end->sock_fd;
+
+    pipe_end->sock_fd = NULL;
+    if (pipe_end->flush_timeout) remove_timeout_user( pipe_end->flush_timeout );
+    pipe_end->flush_timeout = NULL;
+
+    shutdown( get_unix_fd( sock_fd ), SHUT_RDWR );
+    if (status == STATUS_PIPE_DISCONNECTED)
+    {
+        /* data already received is still readable after shutdown, discard it */
+        char buffer[4096];
+        while (recv( get_unix_fd( sock_fd ), buffer, sizeof(buffer), MSG_DONTWAIT ) > 0);
+    }
+    fd_async_wake_up( sock_fd, ASYNC_TYPE_READ, status );
+    fd_async_wake_up( sock_fd, ASYNC_TYPE_WRITE, status );
+    set_fd_events( sock_fd, -1 );
+    release_object( sock_fd );
+}
+
 static struct pipe_message *queue_message( struct pipe_end *pipe_end, struct iosb *iosb )
 {
     struct pipe_message *message;
@@ -418,7 +632,13 @@ static void pipe_end_disconnect( struct pipe_end *pipe_end, unsigned int status
     pipe_end->state = status == STATUS_PIPE_DISCONNECTED
         ? FILE_PIPE_DISCONNECTED_STATE : FILE_PIPE_CLOSING_STATE;
     fd_async_wake_up( pipe_end->fd, ASYNC_TYPE_WAIT, status );
-    async_wake_up( &pipe_end->read_q, status );
+    if (pipe_end->sock_fd && status == STATUS_PIPE_DISCONNECTED)
+    {
+        async_wake_up( &pipe_end->write_q, status );
+        pipe_end_close_socket( pipe_end, status );
+    }
+    /* with a socket, reads from a closing pipe end get the remaining data first */
+    if (!pipe_end->sock_fd) async_wake_up( &pipe_end->read_q, status );
     LIST_FOR_EACH_ENTRY_SAFE( message, next, &pipe_end->message_queue, struct pipe_message, entry )
     {
         async = message->async;
@@ -442,6 +662,7 @@ static void pipe_end_destroy( struct object *obj )
     struct pipe_message *message;
 
     pipe_end_disconnect( pipe_end, STATUS_PIPE_BROKEN );
+    if (pipe_end->sock_fd) pipe_end_close_socket( pipe_end, STATUS_PIPE_BROKEN );
 
     while (!list_empty( &pipe_end->message_queue ))
     {
@@ -551,6 +772,11 @@ struct object *create_named_pipe_device( struct object *root, const struct unico
                                          unsigned int attr, const struct security_descriptor *sd )
 {
     struct named_pipe_device *dev;
+#ifdef linux
+    const char *p;
+
+    if ((p = getenv( "WINEPIPESOCKETS" ))) use_pipe_sockets = atoi( p );
+#endif
 
     if ((dev = create_named_object( root, &named_pipe_device_ops, name, attr, sd )) &&
         get_error() != STATUS_OBJECT_NAME_EXISTS)
@@ -641,6 +867,19 @@ static void pipe_end_flush( struct fd *fd, struct async *async )
         return;
     }
 
+    if (pipe_end->sock_fd)
+    {
+        /* there's no notification when the other end reads, so poll the socket */
+        if (pipe_sock_has_unread( pipe_end ))
+        {
+            fd_queue_async( pipe_end->fd, async, ASYNC_TYPE_WAIT );
+            if (!pipe_end->flush_timeout)
+                pipe_end->flush_timeout = add_timeout_user( -TICKS_PER_SEC / 100, pipe_end_flush_timeout, pipe_end );
+            set_error( STATUS_PENDING );
+        }
+        return;
+    }
+
     if (pipe_end->connection && !list_empty( &pipe_end->connection->message_queue ))
     {
         fd_queue_async( pipe_end->fd, async, ASYNC_TYPE_WAIT );
@@ -653,6 +892,8 @@ static data_size_t pipe_end_get_avail( struct pipe_end *pipe_end )
     struct pipe_message *message;
     data_size_t avail = 0;
 
+    if (pipe_end->sock_fd) return pipe_sock_get_avail( pipe_end );
+
     LIST_FOR_EACH_ENTRY( message, &pipe_end->message_queue, struct pipe_message, entry )
         avail += message->iosb->in_size - message->read_pos;
 
@@ -933,6 +1174,20 @@ static void reselect_read_queue( struct pipe_end *pipe_end, int reselect_write )
 {
     struct async *async;
 
+    if (pipe_end->sock_fd)
+    {
+        ignore_reselect = 1;
+        while ((async = find_pending_async( &pipe_end->read_q )))
+        {
+            int done = pipe_sock_read( pipe_end, async );
+            release_object( async );
+            if (!done) break;
+        }
+        ignore_reselect = 0;
+        if (pipe_end->sock_fd) set_fd_events( pipe_end->sock_fd, pipe_sock_get_poll_events( pipe_end->sock_fd ) );
+        return;
+    }
+
     ignore_reselect = 1;
     while (!list_empty( &pipe_end->message_queue ) && (async = find_pending_async( &pipe_end->read_q )))
     {
@@ -956,6 +1211,21 @@ static void reselect_write_queue( struct pipe_end *pipe_end )
     struct pipe_message *message, *next;
     struct pipe_end *reader = pipe_end->connection;
     data_size_t avail = 0;
+    struct async *async;
+
+    if (pipe_end->sock_fd)
+    {
+        ignore_reselect = 1;
+        while ((async = find_pending_async( &pipe_end->write_q )))
+        {
+            int done = pipe_sock_write( pipe_end, async );
+            release_object( async );
+            if (!done) break;
+        }
+        ignore_reselect = 0;
+        if (pipe_end->sock_fd) set_fd_events( pipe_end->sock_fd, pipe_sock_get_poll_events( pipe_end->sock_fd ) );
+        return;
+    }
 
     if (!reader) return;
 
@@ -995,7 +1265,7 @@ static void pipe_end_read( struct fd *fd, struct async *async, file_pos_t pos )
     switch (pipe_end->state)
     {
     case FILE_PIPE_CONNECTED_STATE:
-        if ((pipe_end->flags & NAMED_PIPE_NONBLOCKING_MODE) && list_empty( &pipe_end->message_queue ))
+        if ((pipe_end->flags & NAMED_PIPE_NONBLOCKING_MODE) && !pipe_end_has_data( pipe_end ))
         {
             set_error( STATUS_PIPE_EMPTY );
             return;
@@ -1008,7 +1278,7 @@ static void pipe_end_read( struct fd *fd, struct async *async, file_pos_t pos )
         set_error( STATUS_PIPE_LISTENING );
         return;
     case FILE_PIPE_CLOSING_STATE:
-        if (!list_empty( &pipe_end->message_queue )) break;
+        if (pipe_end_has_data( pipe_end )) break;
         set_error( STATUS_PIPE_BROKEN );
         return;
     }
@@ -1041,6 +1311,14 @@ static void pipe_end_write( struct fd *fd, struct async *async, file_pos_t pos )
 
     if (!pipe_end->pipe->message_mode && !get_req_data_size()) return;
 
+    if (pipe_end->sock_fd)
+    {
+        queue_async( &pipe_end->write_q, async );
+        reselect_write_queue( pipe_end );
+        set_error( STATUS_PENDING );
+        return;
+    }
+
     iosb = async_get_iosb( async );
     message = queue_message( pipe_end->connection, iosb );
     release_object( iosb );
@@ -1062,6 +1340,8 @@ static void pipe_end_reselect_async( struct fd *fd, struct async_queue *queue )
         reselect_write_queue( pipe_end );
     else if (&pipe_end->read_q == queue)
         reselect_read_queue( pipe_end, 0 );
+    else if (fd != pipe_end->fd)
+        default_fd_reselect_async( fd, queue );
 }
 
 static enum server_fd_type pipe_end_get_fd_type( struct fd *fd )
@@ -1069,6 +1349,29 @@ static enum server_fd_type pipe_end_get_fd_type( struct fd *fd )
     return FD_TYPE_PIPE;
 }
 
+static int pipe_sock_get_poll_events( struct fd *fd )
+{
+    struct pipe_end *pipe_end = get_fd_user( fd );
+    int events = default_fd_get_poll_events( fd );
+
+    if (pipe_end->sock_fd != fd) return events;
+    if (async_waiting( &pipe_end->read_q )) events |= POLLIN;
+    if (async_waiting( &pipe_end->write_q )) events |= POLLOUT;
+    return events;
+}
+
+static void pipe_sock_poll_event( struct fd *fd, int event )
+{
+    struct pipe_end *pipe_end = get_fd_user( fd );
+
+    if (pipe_end->sock_fd == fd)
+    {
+        if (event & (POLLIN | POLLERR | POLLHUP)) reselect_read_queue( pipe_end, 0 );
+        if (pipe_end->sock_fd && (event & (POLLOUT | POLLERR | POLLHUP))) reselect_write_queue( pipe_end );
+    }
+    default_poll_event( fd, event );
+}
+
 static void pipe_end_peek( struct pipe_end *pipe_end )
 {
     unsigned reply_size = get_reply_max_size();
@@ -1089,7 +1392,7 @@ static void pipe_end_peek( struct pipe_end *pipe_end )
     case FILE_PIPE_CONNECTED_STATE:
         break;
     case FILE_PIPE_CLOSING_STATE:
-        if (!list_empty( &pipe_end->message_queue )) break;
+        if (pipe_end_has_data( pipe_end )) break;
         set_error( STATUS_PIPE_BROKEN );
         return;
     default:
@@ -1097,8 +1400,7 @@ static void pipe_end_peek( struct pipe_end *pipe_end )
         return;
     }
 
-    LIST_FOR_EACH_ENTRY( message, &pipe_end->message_queue, struct pipe_message, entry )
-        avail += message->iosb->in_size - message->read_pos;
+    avail = pipe_end_get_avail( pipe_end );
     reply_size = min( reply_size, avail );
 
     if (avail && pipe_end->pipe->message_mode)
@@ -1114,7 +1416,9 @@ static void pipe_end_peek( struct pipe_end *pipe_end )
     buffer->NumberOfMessages  = 0;  /* FIXME */
     buffer->MessageLength     = message_length;
 
-    if (reply_size)
+    if (reply_size && pipe_end->sock_fd)
+        recv( get_unix_fd( pipe_end->sock_fd ), buffer->Data, reply_size, MSG_PEEK | MSG_DONTWAIT );
+    else if (reply_size)
     {
         data_size_t write_pos = 0, writing;
         LIST_FOR_EACH_ENTRY( message, &pipe_end->message_queue, struct pipe_message, entry )
@@ -1147,7 +1451,7 @@ static void pipe_end_transceive( struct pipe_end *pipe_end, struct async *async
     }
 
     /* not allowed if we already have read data buffered */
-    if (!list_empty( &pipe_end->message_queue ))
+    if (pipe_end_has_data( pipe_end ))
     {
         set_error( STATUS_PIPE_BUSY );
         return;
@@ -1313,6 +1617,8 @@ static void init_pipe_end( struct pipe_end *pipe_end, struct named_pipe *pipe,
     pipe_end->flags = pipe_flags;
     pipe_end->connection = NULL;
     pipe_end->buffer_size = buffer_size;
+    pipe_end->sock_fd = NULL;
+    pipe_end->flush_timeout = NULL;
     init_async_queue( &pipe_end->read_q );
     init_async_queue( &pipe_end->write_q );
     list_init( &pipe_end->message_queue );
@@ -1339,7 +1645,8 @@ static struct pipe_server *create_pipe_server( struct named_pipe *pipe, unsigned
         release_object( server );
         return NULL;
     }
-    allow_fd_caching( server->pipe_end.fd );
+    /* with sockets, the fd used by the client changes when a byte mode pipe gets connected */
+    if (!use_pipe_sockets || pipe->message_mode) allow_fd_caching( server->pipe_end.fd );
     set_fd_signaled( server->pipe_end.fd, 1 );
     async_wake_up( &pipe->waiters, STATUS_SUCCESS );
     return server;
@@ -1363,7 +1670,7 @@ static struct pipe_end *create_pipe_client( struct named_pipe *pipe, data_size_t
         release_object( client );
         return NULL;
     }
-    allow_fd_caching( client->fd );
+    if (!use_pipe_sockets || pipe->message_mode) allow_fd_caching( client->fd );
     set_fd_signaled( client->fd, 1 );
 
     return client;
@@ -1389,6 +1696,44 @@ static int named_pipe_link_name( struct object *obj, struct object_name *name, s
     return 1;
 }
 
+/* connect both pipe ends through a unix socket pair, so that clients can exchange data directly.
+ * Only byte mode pipes are supported. A SOCK_SEQPACKET pair would keep message boundaries, but
+ * a short read discards the rest of the message, while a message mode pipe has to return it to
+ * the next read after STATUS_BUFFER_OVERFLOW, and a byte mode read on it may span messages.
+ * Message mode pipes keep going through the server buffers. */
+static void connect_pipe_sockets( struct pipe_end *server, struct pipe_end *client )
+{
+    int fds[2], i, size = 1024 * 1024;
+
+    if (server->pipe->message_mode) return;
+    if (socketpair( PF_UNIX, SOCK_STREAM, 0, fds )) return;
+    for (i = 0; i < 2; i++)
+    {
+        fcntl( fds[i], F_SETFL, O_NONBLOCK );
+        setsockopt( fds[i], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size) );
+    }
+
+    if (!(server->sock_fd = create_anonymous_fd( &pipe_server_sock_fd_ops, fds[0], &server->obj,
+                                                 get_fd_options( server->fd ) )))
+    {
+        close( fds[1] );
+        clear_error();
+        return;
+    }
+    if (!(client->sock_fd = create_anonymous_fd( &pipe_client_sock_fd_ops, fds[1], &client->obj,
+                                                 get_fd_options( client->fd ) )))
+    {
+        release_object( server->sock_fd );
+        server->sock_fd = NULL;
+        clear_error();
+        return;
+    }
+    allow_fd_caching( server->sock_fd );
+    allow_fd_caching( client->sock_fd );
+    set_fd_signaled( server->sock_fd, 1 );
+    set_fd_signaled( client->sock_fd, 1 );
+}
+
 static struct object *named_pipe_open_file( struct object *obj, const struct unicode_str *subpath,
                                             unsigned int access, unsigned int sharing, unsigned int options )
 {
@@ -1427,6 +1772,7 @@ static struct object *named_pipe_open_file( struct object *obj, const struct uni
         server->pipe_end.client_pid = client->client_pid;
         client->server_pid = server->pipe_end.server_pid;
         list_remove( &server->entry );
+        if (use_pipe_sockets) connect_pipe_sockets( &server->pipe_end, client );
     }
     return &client->obj;
 }
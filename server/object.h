@@ -22,6 +22,7 @@
 #define __WINE_SERVER_OBJECT_H
 
 #include <poll.h>
+#include <stdio.h>
 #include <sys/time.h>
 #include "wine/server_protocol.h"
 #include "wine/list.h"
@@ -214,10 +215,33 @@ extern struct event *get_event_obj( struct process *process, obj_handle_t handle
 extern struct keyed_event *get_keyed_event_obj( struct process *process, obj_handle_t handle, unsigned int access );
 extern void set_event( struct event *event );
 extern void reset_event( struct event *event );
+extern struct inproc_sync *get_event_inproc_sync( struct object *obj );
 
 /* mutex functions */
 
 extern void abandon_mutexes( struct thread *thread );
+extern struct inproc_sync *get_mutex_inproc_sync( struct object *obj );
+
+/* semaphore functions */
+
+extern struct inproc_sync *get_semaphore_inproc_sync( struct object *obj );
+
+/* in-process synchronization functions */
+
+struct inproc_sync;
+
+extern void init_inproc_sync(void);
+extern struct inproc_sync *alloc_inproc_sync( enum inproc_sync_type type, unsigned int state, unsigned int count );
+extern void free_inproc_sync( struct inproc_sync *sync );
+extern struct inproc_sync *alloc_inproc_completion(void);
+extern inproc_completion_t *get_inproc_completion( struct inproc_sync *sync );
+extern inproc_sync_t *get_inproc_sync( struct inproc_sync *sync );
+extern unsigned int get_inproc_sync_state( struct inproc_sync *sync );
+extern int update_inproc_sync_state( struct inproc_sync *sync, unsigned int old_state, unsigned int new_state );
+extern unsigned int set_inproc_sync_state( struct inproc_sync *sync, unsigned int state );
+extern void wake_inproc_sync( struct inproc_sync *sync, int count );
+extern int add_inproc_sync_queue( struct object *obj, struct wait_queue_entry *entry, struct inproc_sync *sync );
+extern void remove_inproc_sync_queue( struct object *obj, struct wait_queue_entry *entry, struct inproc_sync *sync );
 
 /* serial functions */
 
@@ -240,6 +264,7 @@ extern unsigned short supported_machines[8];
 extern unsigned short native_machine;
 extern void init_registry(void);
 extern void flush_registry(void);
+extern void dump_registry_stats( FILE *file );
 
 static inline int is_machine_32bit( unsigned short machine )
 {
@@ -294,6 +319,8 @@ extern struct object *create_symlink( struct object *root, const struct unicode_
   /* command-line options */
 extern int debug_level;
 extern int foreground;
+extern int server_stats;
+extern const char *server_stats_file;
 extern timeout_t master_socket_timeout;
 extern const char *server_argv0;
 
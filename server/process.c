@@ -675,10 +675,13 @@ struct process *create_process( int fd, struct process *parent, unsigned int fla
     process->peb             = 0;
     process->ldt_copy        = 0;
     process->dir_cache       = NULL;
+    process->inproc_sync     = NULL;
     process->winstation      = 0;
     process->desktop         = 0;
     process->token           = NULL;
     process->trace_data      = 0;
+    process->req_count       = 0;
+    process->req_time        = 0;
     process->rawinput_devices = NULL;
     process->rawinput_device_count = 0;
     process->rawinput_mouse  = NULL;
@@ -779,6 +782,7 @@ static void process_destroy( struct object *obj )
     if (process->idle_event) release_object( process->idle_event );
     if (process->id) free_ptid( process->id );
     if (process->token) release_object( process->token );
+    if (process->inproc_sync) release_object( process->inproc_sync );
     list_remove( &process->rawinput_entry );
     free( process->rawinput_devices );
     free( process->dir_cache );
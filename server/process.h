@@ -78,7 +78,10 @@ struct process
     client_ptr_t         peb;             /* PEB address in client address space */
     client_ptr_t         ldt_copy;        /* pointer to LDT copy in client addr space */
     struct dir_cache    *dir_cache;       /* map of client-side directory cache */
+    struct inproc_sync_mem *inproc_sync;  /* shared memory of in-process synchronization objects */
     unsigned int         trace_data;      /* opaque data used by the process tracing mechanism */
+    unsigned int         req_count;       /* number of requests handled, if collecting statistics */
+    timeout_t            req_time;        /* time spent handling requests, if collecting statistics */
     struct rawinput_device *rawinput_devices;     /* list of registered rawinput devices */
     unsigned int         rawinput_device_count;   /* number of registered rawinput devices */
     const struct rawinput_device *rawinput_mouse; /* rawinput mouse device, if any */
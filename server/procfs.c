@@ -90,7 +90,7 @@ static int open_proc_lwpctl( struct thread *thread )
 /* handle a SIGCHLD signal */
 void sigchld_callback(void)
 {
-    assert( 0 );  /* should only be called when using ptrace */
+    /* only the registry save process can be a child of the server, it is waited for in registry.c */
 }
 
 /* initialize the process tracing mechanism */
@@ -119,6 +119,8 @@ struct thread_input
     unsigned char          keystate[256]; /* state of each key */
     unsigned char          desktop_keystate[256]; /* desktop keystate when keystate was synced */
     int                    keystate_lock; /* keystate is locked */
+    unsigned int           shm_index;     /* index of the entry in the USER shared memory */
+    unsigned int           shm_id;        /* unique id of the shared memory entry */
 };
 
 struct msg_queue
@@ -146,6 +148,7 @@ struct msg_queue
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
     int                    keystate_lock;   /* owns an input keystate lock */
+    unsigned int           shm_index;       /* index of the owner thread entry in the USER shared memory */
 };
 
 struct hotkey
@@ -239,6 +242,75 @@ static unsigned int cursor_history_latest;
 static void queue_hardware_message( struct desktop *desktop, struct message *msg, int always_queue );
 static void free_message( struct message *msg );
 
+/* publish the state of a desktop in the USER shared memory */
+void update_shared_desktop( struct desktop *desktop )
+{
+    desktop_shm_t *shared;
+
+    if (!desktop->shm_index) return;
+    shared = &user_shm->desktops[desktop->shm_index];
+    shared_write_begin( &shared->seq );
+    shared->id            = desktop->shm_id;
+    shared->foreground    = desktop->foreground_input ? desktop->foreground_input->active : 0;
+    shared->cursor_x      = desktop->cursor.x;
+    shared->cursor_y      = desktop->cursor.y;
+    shared->cursor_change = desktop->cursor.last_change;
+    memcpy( shared->keystate, desktop->keystate, sizeof(shared->keystate) );
+    shared_write_end( &shared->seq );
+}
+
+/* publish the state of a thread input in the USER shared memory */
+static void update_shared_input( struct thread_input *input )
+{
+    input_shm_t *shared;
+
+    if (input->desktop && input->desktop->foreground_input == input)
+        update_shared_desktop( input->desktop );
+    if (!input->shm_index) return;
+    shared = &user_shm->inputs[input->shm_index];
+    shared_write_begin( &shared->seq );
+    shared->id           = input->shm_id;
+    shared->focus        = input->focus;
+    shared->capture      = input->capture;
+    shared->active       = input->active;
+    shared->menu_owner   = input->menu_owner;
+    shared->move_size    = input->move_size;
+    shared->caret        = input->caret;
+    shared->caret_rect   = input->caret_rect;
+    shared->cursor       = input->cursor;
+    shared->cursor_count = input->cursor_count;
+    shared_write_end( &shared->seq );
+}
+
+/* set the thread input located by the shared memory entry of a thread */
+static void set_thread_shm_input( struct thread *thread, struct thread_input *input )
+{
+    thread_shm_t *shared;
+
+    if (!thread->user_shm) return;
+    shared = &user_shm->threads[thread->user_shm];
+    shared_write_begin( &shared->seq );
+    shared->input    = input ? input->shm_index : 0;
+    shared->input_id = input ? input->shm_id : 0;
+    shared_write_end( &shared->seq );
+}
+
+/* publish the wakeup bits and masks of a queue in its owner thread USER shared memory entry */
+static void update_shared_queue( struct msg_queue *queue )
+{
+    thread_shm_t *shared;
+
+    if (!queue->shm_index) return;
+    shared = &user_shm->threads[queue->shm_index];
+    shared_write_begin( &shared->seq );
+    shared->queue        = 1;
+    shared->wake_bits    = queue->wake_bits;
+    shared->wake_mask    = queue->wake_mask;
+    shared->changed_bits = queue->changed_bits;
+    shared->changed_mask = queue->changed_mask;
+    shared_write_end( &shared->seq );
+}
+
 /* set the caret window in a given thread input */
 static void set_caret_window( struct thread_input *input, user_handle_t win )
 {
@@ -273,12 +345,16 @@ static struct thread_input *create_thread_input( struct thread *thread )
         memset( input->keystate, 0, sizeof(input->keystate) );
         input->keystate_lock = 0;
 
+        input->shm_index    = 0;
+
         if (!(input->desktop = get_thread_desktop( thread, 0 /* FIXME: access rights */ )))
         {
             release_object( input );
             return NULL;
         }
         memcpy( input->desktop_keystate, input->desktop->keystate, sizeof(input->desktop_keystate) );
+        input->shm_index = alloc_user_shm_entry( USER_SHM_INPUT, &input->shm_id );
+        update_shared_input( input );
     }
     return input;
 }
@@ -314,6 +390,7 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
         queue->keystate_lock   = 0;
+        queue->shm_index       = thread->user_shm;
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
@@ -321,6 +398,8 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         for (i = 0; i < NB_MSG_KINDS; i++) list_init( &queue->msg_list[i] );
 
         thread->queue = queue;
+        set_thread_shm_input( thread, input );
+        update_shared_queue( queue );
     }
     if (new_input) release_object( new_input );
     return queue;
@@ -330,6 +409,17 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
 void free_msg_queue( struct thread *thread )
 {
     remove_thread_hooks( thread );
+    if (thread->user_shm)
+    {
+        thread_shm_t *shared = &user_shm->threads[thread->user_shm];
+        shared_write_begin( &shared->seq );
+        shared->id    = 0;
+        shared->queue = 0;
+        shared_write_end( &shared->seq );
+        if (thread->queue) thread->queue->shm_index = 0;
+        free_user_shm_entry( USER_SHM_THREAD, thread->user_shm );
+        thread->user_shm = 0;
+    }
     if (!thread->queue) return;
     release_object( thread->queue );
     thread->queue = NULL;
@@ -374,11 +464,14 @@ static int assign_thread_input( struct thread *thread, struct thread_input *new_
     {
         queue->input->cursor_count -= queue->cursor_count;
         if (queue->keystate_lock) unlock_input_keystate( queue->input );
+        update_shared_input( queue->input );
         release_object( queue->input );
     }
     queue->input = (struct thread_input *)grab_object( new_input );
     if (queue->keystate_lock) lock_input_keystate( queue->input );
     new_input->cursor_count += queue->cursor_count;
+    update_shared_input( new_input );
+    set_thread_shm_input( thread, new_input );
     return 1;
 }
 
@@ -474,6 +567,7 @@ static int update_desktop_cursor_pos( struct desktop *desktop, user_handle_t win
     desktop->cursor.x = x;
     desktop->cursor.y = y;
     desktop->cursor.last_change = get_tick_count();
+    update_shared_desktop( desktop );
 
     if (!win || !is_window_visible( win ) || is_window_transparent( win ))
         win = shallow_window_from_point( desktop, x, y );
@@ -566,6 +660,7 @@ static void set_foreground_input( struct desktop *desktop, struct thread_input *
     if (desktop->foreground_input == input) return;
     set_clip_rectangle( desktop, NULL, SET_CURSOR_NOCLIP, 1 );
     desktop->foreground_input = input;
+    update_shared_desktop( desktop );
 }
 
 /* get the hook table for a given thread */
@@ -601,6 +696,7 @@ static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
+    update_shared_queue( queue );
 }
 
 /* clear some queue bits */
@@ -613,6 +709,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
         if (queue->keystate_lock) unlock_input_keystate( queue->input );
         queue->keystate_lock = 0;
     }
+    update_shared_queue( queue );
 }
 
 /* check if message is matched by the filter */
@@ -1150,6 +1247,7 @@ static void msg_queue_satisfied( struct object *obj, struct wait_queue_entry *en
     struct msg_queue *queue = (struct msg_queue *)obj;
     queue->wake_mask = 0;
     queue->changed_mask = 0;
+    update_shared_queue( queue );
 }
 
 static void msg_queue_destroy( struct object *obj )
@@ -1186,6 +1284,7 @@ static void msg_queue_destroy( struct object *obj )
     if (queue->timeout) remove_timeout_user( queue->timeout );
     queue->input->cursor_count -= queue->cursor_count;
     if (queue->keystate_lock) unlock_input_keystate( queue->input );
+    update_shared_input( queue->input );
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
@@ -1214,9 +1313,21 @@ static void thread_input_destroy( struct object *obj )
     struct desktop *desktop;
 
     empty_msg_list( &input->msg_list );
+    if (input->shm_index)
+    {
+        input_shm_t *shared = &user_shm->inputs[input->shm_index];
+        shared_write_begin( &shared->seq );
+        shared->id = 0;
+        shared_write_end( &shared->seq );
+        free_user_shm_entry( USER_SHM_INPUT, input->shm_index );
+    }
     if ((desktop = input->desktop))
     {
-        if (desktop->foreground_input == input) desktop->foreground_input = NULL;
+        if (desktop->foreground_input == input)
+        {
+            desktop->foreground_input = NULL;
+            update_shared_desktop( desktop );
+        }
         release_object( desktop );
     }
 }
@@ -1232,6 +1343,7 @@ static inline void thread_input_cleanup_window( struct msg_queue *queue, user_ha
     if (window == input->menu_owner) input->menu_owner = 0;
     if (window == input->move_size) input->move_size = 0;
     if (window == input->caret) set_caret_window( input, 0 );
+    update_shared_input( input );
 }
 
 /* check if the specified window can be set in the input data of a given queue */
@@ -1291,6 +1403,7 @@ int attach_thread_input( struct thread *thread_from, struct thread *thread_to )
     {
         if (!input->focus) input->focus = thread_from->queue->input->focus;
         if (!input->active) input->active = thread_from->queue->input->active;
+        update_shared_input( input );
     }
 
     ret = assign_thread_input( thread_from, input );
@@ -1526,6 +1639,8 @@ static void update_input_key_state( struct desktop *desktop, unsigned char *keys
         }
         break;
     }
+
+    if (keystate == desktop->keystate) update_shared_desktop( desktop );
 }
 
 /* release the hardware message currently being processed by the given thread */
@@ -2009,6 +2124,7 @@ static int queue_mouse_message( struct desktop *desktop, user_handle_t win, cons
     };
 
     desktop->cursor.last_change = get_tick_count();
+    update_shared_desktop( desktop );
     flags = input->mouse.flags;
     time  = input->mouse.time;
     if (!time) time = desktop->cursor.last_change;
@@ -2860,6 +2976,7 @@ DECL_HANDLER(set_queue_mask)
             if (req->skip_wait) queue->wake_mask = queue->changed_mask = 0;
             else wake_up( &queue->obj, 0 );
         }
+        update_shared_queue( queue );
     }
 }
 
@@ -2873,6 +2990,7 @@ DECL_HANDLER(get_queue_status)
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         queue->changed_bits &= ~req->clear_bits;
+        update_shared_queue( queue );
     }
     else reply->wake_bits = reply->changed_bits = 0;
 }
@@ -3115,6 +3233,7 @@ DECL_HANDLER(get_message)
     if (get_win == -1 && current->process->idle_event) set_event( current->process->idle_event );
     queue->wake_mask = req->wake_mask;
     queue->changed_mask = req->changed_mask;
+    update_shared_queue( queue );
     set_error( STATUS_PENDING );  /* FIXME */
 }
 
@@ -3477,6 +3596,38 @@ DECL_HANDLER(get_thread_input)
 }
 
 
+/* retrieve the entry of the current thread in the USER shared memory */
+DECL_HANDLER(get_thread_user_shm)
+{
+    struct desktop *desktop;
+    thread_shm_t *shared;
+    unsigned int id;
+
+    if (!current->user_shm)
+    {
+        if (!(current->user_shm = alloc_user_shm_entry( USER_SHM_THREAD, &id ))) return;
+        shared = &user_shm->threads[current->user_shm];
+        shared_write_begin( &shared->seq );
+        shared->id = id;
+        shared_write_end( &shared->seq );
+
+        if ((desktop = get_thread_desktop( current, 0 )))
+        {
+            set_thread_shm_desktop( current, desktop );
+            release_object( desktop );
+        }
+        else clear_error();
+        if (current->queue)
+        {
+            set_thread_shm_input( current, current->queue->input );
+            current->queue->shm_index = current->user_shm;
+            update_shared_queue( current->queue );
+        }
+    }
+    reply->index = current->user_shm;
+}
+
+
 /* retrieve queue keyboard state for current thread or global async state */
 DECL_HANDLER(get_key_state)
 {
@@ -3489,7 +3640,11 @@ DECL_HANDLER(get_key_state)
         if (req->key >= 0)
         {
             reply->state = desktop->keystate[req->key & 0xff];
-            desktop->keystate[req->key & 0xff] &= ~0x40;
+            if (desktop->keystate[req->key & 0xff] & 0x40)
+            {
+                desktop->keystate[req->key & 0xff] &= ~0x40;
+                update_shared_desktop( desktop );
+            }
         }
         set_reply_data( desktop->keystate, size );
         release_object( desktop );
@@ -3520,6 +3675,7 @@ DECL_HANDLER(set_key_state)
     if (req->async && (desktop = get_thread_desktop( current, 0 )))
     {
         memcpy( desktop->keystate, get_req_data(), size );
+        update_shared_desktop( desktop );
         release_object( desktop );
     }
 }
@@ -3561,6 +3717,7 @@ DECL_HANDLER(set_focus_window)
     {
         reply->previous = queue->input->focus;
         queue->input->focus = get_user_full_handle( req->handle );
+        update_shared_input( queue->input );
     }
 }
 
@@ -3577,6 +3734,7 @@ DECL_HANDLER(set_active_window)
         {
             reply->previous = queue->input->active;
             queue->input->active = get_user_full_handle( req->handle );
+            update_shared_input( queue->input );
         }
         else set_error( STATUS_INVALID_HANDLE );
     }
@@ -3604,6 +3762,7 @@ DECL_HANDLER(set_capture_window)
         input->menu_owner = (req->flags & CAPTURE_MENU) ? input->capture : 0;
         input->move_size = (req->flags & CAPTURE_MOVESIZE) ? input->capture : 0;
         reply->full_handle = input->capture;
+        update_shared_input( input );
     }
 }
 
@@ -3626,6 +3785,7 @@ DECL_HANDLER(set_caret_window)
         set_caret_window( input, get_user_full_handle(req->handle) );
         input->caret_rect.right  = input->caret_rect.left + req->width;
         input->caret_rect.bottom = input->caret_rect.top + req->height;
+        update_shared_input( input );
     }
 }
 
@@ -3654,6 +3814,7 @@ DECL_HANDLER(set_caret_info)
         input->caret_rect.bottom += req->y - input->caret_rect.top;
         input->caret_rect.left = req->x;
         input->caret_rect.top  = req->y;
+        update_shared_input( input );
     }
     if (req->flags & SET_CARET_HIDE)
     {
@@ -3719,6 +3880,7 @@ DECL_HANDLER(set_cursor)
 
     new_cursor = input->cursor_count < 0 ? 0 : input->cursor;
     if (prev_cursor != new_cursor) update_desktop_cursor_handle( desktop, input, new_cursor );
+    if (req->flags & (SET_CURSOR_HANDLE | SET_CURSOR_COUNT)) update_shared_input( input );
 
     reply->new_x       = desktop->cursor.x;
     reply->new_y       = desktop->cursor.y;
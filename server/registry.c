@@ -26,15 +26,20 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "ntstatus.h"
@@ -84,12 +89,16 @@ struct key
     int               nb_subkeys;  /* count of allocated subkeys */
     struct key      **subkeys;     /* subkeys array */
     struct key       *wow6432node; /* Wow6432Node subkey */
+    struct name_index *subkey_index; /* hash index of the subkeys, for keys with many subkeys */
     int               last_value;  /* last in use value */
     int               nb_values;   /* count of allocated values in array */
     struct key_value *values;      /* values array */
+    struct name_index *value_index; /* hash index of the values, for keys with many values */
     unsigned int      flags;       /* flags */
     timeout_t         modif;       /* last modification time */
     struct list       notify_list; /* list of notifications */
+    struct hive      *hive;        /* binary hive the key was loaded from */
+    const struct hive_key *hive_key; /* hive image of the subkeys and values, until they are loaded */
 };
 
 /* key flags */
@@ -114,6 +123,7 @@ struct key_value
 
 #define MIN_SUBKEYS  8   /* min. number of allocated subkeys per key */
 #define MIN_VALUES   8   /* min. number of allocated values per key */
+#define MIN_INDEXED  64  /* min. number of subkeys or values to use a hash index */
 
 #define MAX_NAME_LEN  256    /* max. length of a key name */
 #define MAX_VALUE_LEN 16383  /* max. length of a value name */
@@ -131,13 +141,15 @@ static const WCHAR symlink_value[] = {'S','y','m','b','o','l','i','c','L','i','n
 static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_value) };
 
 static void set_periodic_save_timer(void);
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
+static struct key_value *find_value( struct key *key, const struct unicode_str *name, int *index );
+static void load_hive_key( struct key *key );
 
 /* information about where to save a registry branch */
 struct save_branch_info
 {
     struct key  *key;
     const char  *filename;
+    struct hive *hive;      /* binary hive of the branch, if enabled */
 };
 
 #define MAX_SAVE_BRANCH_INFO 3
@@ -211,6 +223,232 @@ static inline struct key *get_parent( const struct key *key )
     return (struct key *)parent;
 }
 
+/* make sure that the subkeys and values of a key are loaded from its binary hive */
+static inline void load_key_contents( struct key *key )
+{
+    if (key->hive_key) load_hive_key( key );
+}
+
+/*
+ * Name indexes
+ *
+ * The subkeys and values of a key are stored in arrays sorted by name, which are
+ * binary searched. Once a key has MIN_INDEXED subkeys or values, the corresponding
+ * array gets a hash index instead: lookups go through the index, new entries are
+ * appended to the array, and the array is only sorted again when it's enumerated.
+ */
+
+/* hash index of the subkey or value names of a key */
+struct name_index
+{
+    unsigned int       size;       /* number of buckets, a power of 2 */
+    int                sorted;     /* whether the indexed array is sorted */
+    int               *buckets;    /* array index + 1 of the entry in each bucket, 0 if empty */
+};
+
+typedef void (*get_name_func)( const struct key *key, int i, struct unicode_str *name );
+
+static void get_subkey_name( const struct key *key, int i, struct unicode_str *name )
+{
+    name->str = key->subkeys[i]->obj.name->name;
+    name->len = key->subkeys[i]->obj.name->len;
+}
+
+static void get_value_name( const struct key *key, int i, struct unicode_str *name )
+{
+    name->str = key->values[i].name;
+    name->len = key->values[i].namelen;
+}
+
+/* compare two names in the order of the subkey and value arrays */
+static int compare_names( const WCHAR *name1, data_size_t len1, const WCHAR *name2, data_size_t len2 )
+{
+    int res = memicmp_strW( name1, name2, min( len1, len2 ));
+    if (!res) res = len1 - len2;
+    return res;
+}
+
+static int compare_subkeys( const void *p1, const void *p2 )
+{
+    const struct key *key1 = *(struct key * const *)p1, *key2 = *(struct key * const *)p2;
+    return compare_names( key1->obj.name->name, key1->obj.name->len, key2->obj.name->name, key2->obj.name->len );
+}
+
+static int compare_values( const void *p1, const void *p2 )
+{
+    const struct key_value *value1 = p1, *value2 = p2;
+    return compare_names( value1->name, value1->namelen, value2->name, value2->namelen );
+}
+
+/* hash a name for an index; the case-insensitive string hash needs more mixing to use the low bits */
+static inline unsigned int index_hash( const struct name_index *index, const struct unicode_str *name )
+{
+    unsigned int hash = hash_strW( name->str, name->len, ~0u );
+
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3b;
+    hash ^= hash >> 16;
+    return hash & (index->size - 1);
+}
+
+/* find the bucket holding a name, or the empty bucket where it should be added */
+static unsigned int index_find_bucket( const struct key *key, const struct name_index *index,
+                                       get_name_func get_name, const struct unicode_str *name )
+{
+    unsigned int bucket = index_hash( index, name );
+    struct unicode_str entry;
+
+    while (index->buckets[bucket])
+    {
+        get_name( key, index->buckets[bucket] - 1, &entry );
+        if (entry.len == name->len && !memicmp_strW( entry.str, name->str, name->len )) break;
+        bucket = (bucket + 1) & (index->size - 1);
+    }
+    return bucket;
+}
+
+/* look up a name in an index; return its array index or -1 */
+static int index_lookup( const struct key *key, const struct name_index *index,
+                         get_name_func get_name, const struct unicode_str *name )
+{
+    return index->buckets[index_find_bucket( key, index, get_name, name )] - 1;
+}
+
+/* add an array entry to an index */
+static void index_add( const struct key *key, struct name_index *index, get_name_func get_name, int pos )
+{
+    struct unicode_str name;
+
+    get_name( key, pos, &name );
+    index->buckets[index_find_bucket( key, index, get_name, &name )] = pos + 1;
+}
+
+/* remove the entry of a bucket, moving up the following entries of the same chain */
+static void index_remove_bucket( const struct key *key, struct name_index *index,
+                                 get_name_func get_name, unsigned int bucket )
+{
+    unsigned int next = bucket, home, mask = index->size - 1;
+    struct unicode_str name;
+
+    index->buckets[bucket] = 0;
+    for (;;)
+    {
+        next = (next + 1) & mask;
+        if (!index->buckets[next]) break;
+        get_name( key, index->buckets[next] - 1, &name );
+        home = index_hash( index, &name );
+        if (((next - home) & mask) < ((next - bucket) & mask)) continue;
+        index->buckets[bucket] = index->buckets[next];
+        index->buckets[next] = 0;
+        bucket = next;
+    }
+}
+
+/* fill an index from the contents of the array */
+static void index_fill( const struct key *key, struct name_index *index, get_name_func get_name, int count )
+{
+    struct unicode_str prev, name;
+    int i;
+
+    memset( index->buckets, 0, index->size * sizeof(*index->buckets) );
+    index->sorted = 1;
+    for (i = 0; i < count; i++)
+    {
+        get_name( key, i, &name );
+        if (i && compare_names( prev.str, prev.len, name.str, name.len ) > 0) index->sorted = 0;
+        index->buckets[index_find_bucket( key, index, get_name, &name )] = i + 1;
+        prev = name;
+    }
+}
+
+/* create or resize an index for an array of the given size */
+static int index_resize( const struct key *key, struct name_index **index, get_name_func get_name, int count )
+{
+    unsigned int size = 2 * MIN_INDEXED;
+    int *buckets;
+
+    while (size < 2 * (unsigned int)count) size *= 2;
+    if (*index && (*index)->size == size) return 1;
+    if (!(buckets = malloc( size * sizeof(*buckets) ))) return 0;
+    if (*index) free( (*index)->buckets );
+    else if (!(*index = malloc( sizeof(**index) )))
+    {
+        free( buckets );
+        return 0;
+    }
+    (*index)->size    = size;
+    (*index)->buckets = buckets;
+    index_fill( key, *index, get_name, count );
+    return 1;
+}
+
+static void free_name_index( struct name_index **index )
+{
+    if (!*index) return;
+    free( (*index)->buckets );
+    free( *index );
+    *index = NULL;
+}
+
+/* sort the subkeys array if needed before enumerating it */
+static void sort_subkeys( struct key *key )
+{
+    if (!key->subkey_index || key->subkey_index->sorted) return;
+    qsort( key->subkeys, key->last_subkey + 1, sizeof(*key->subkeys), compare_subkeys );
+    index_fill( key, key->subkey_index, get_subkey_name, key->last_subkey + 1 );
+}
+
+/* sort the values array if needed before enumerating it */
+static void sort_values( struct key *key )
+{
+    if (!key->value_index || key->value_index->sorted) return;
+    qsort( key->values, key->last_value + 1, sizeof(*key->values), compare_values );
+    index_fill( key, key->value_index, get_value_name, key->last_value + 1 );
+}
+
+/* update the index after an entry has been appended to an array; return FALSE if the array had to be sorted */
+static int index_append( struct key *key, struct name_index **index, get_name_func get_name, int count )
+{
+    struct unicode_str prev, name;
+
+    if (!*index && count < MIN_INDEXED) return 1;
+    if (!*index || 2 * count > (*index)->size)
+    {
+        if (index_resize( key, index, get_name, count )) return 1;
+        /* without an index the array has to be sorted */
+        if (get_name == get_subkey_name) qsort( key->subkeys, count, sizeof(*key->subkeys), compare_subkeys );
+        else qsort( key->values, count, sizeof(*key->values), compare_values );
+        free_name_index( index );
+        return 0;
+    }
+    index_add( key, *index, get_name, count - 1 );
+    if (count < 2 || !(*index)->sorted) return 1;
+    get_name( key, count - 2, &prev );
+    get_name( key, count - 1, &name );
+    if (compare_names( prev.str, prev.len, name.str, name.len ) > 0) (*index)->sorted = 0;
+    return 1;
+}
+
+/* update the index before an entry is removed from an array; return TRUE if the last
+ * entry should be moved in its place instead of shifting down the following entries */
+static int index_remove( struct key *key, struct name_index *index, get_name_func get_name, int pos, int last )
+{
+    struct unicode_str name;
+    unsigned int i;
+
+    get_name( key, pos, &name );
+    index_remove_bucket( key, index, get_name, index_find_bucket( key, index, get_name, &name ));
+    if (pos == last) return 0;
+    if (!index->sorted)
+    {
+        get_name( key, last, &name );
+        index->buckets[index_find_bucket( key, index, get_name, &name )] = pos + 1;
+        return 1;
+    }
+    for (i = 0; i < index->size; i++) if (index->buckets[i] > pos + 1) index->buckets[i]--;
+    return 0;
+}
+
 /*
  * The registry text file format v2 used by this code is similar to the one
  * used by REGEDIT import/export functionality, with the following differences:
@@ -286,11 +524,22 @@ static void dump_value( const struct key_value *value, FILE *f )
 }
 
 /* find the named child of a given key and return its index */
-static struct key *find_subkey( const struct key *key, const struct unicode_str *name, int *index )
+static struct key *find_subkey( struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
     data_size_t len;
 
+    load_key_contents( key );
+    if (key->subkey_index)
+    {
+        if ((i = index_lookup( key, key->subkey_index, get_subkey_name, name )) != -1)
+        {
+            *index = i;
+            return key->subkeys[i];
+        }
+        *index = key->last_subkey + 1;  /* new subkeys are appended */
+        return NULL;
+    }
     min = 0;
     max = key->last_subkey;
     while (min <= max)
@@ -337,11 +586,14 @@ static int grow_subkeys( struct key *key )
 }
 
 /* save a registry and all its subkeys to a text file */
-static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
+static void save_subkeys( struct key *key, const struct key *base, FILE *f )
 {
     int i;
 
     if (key->flags & KEY_VOLATILE) return;
+    load_key_contents( key );
+    sort_subkeys( key );
+    sort_values( key );
     /* save key if it has either some values or no subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
     if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
@@ -566,6 +818,7 @@ static struct object *key_lookup_name( struct object *obj, struct unicode_str *n
     {
         name->str += next / sizeof(WCHAR);
         name->len -= next;
+        load_key_contents( found );
         if ((attr & OBJ_KEY_WOW64) && found->wow6432node && !is_wow6432node( name->str, name->len ))
             found = found->wow6432node;
     }
@@ -592,6 +845,7 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
         return 0;
     }
 
+    load_key_contents( parent_key );
     if (parent_key->last_subkey + 1 == parent_key->nb_subkeys)
     {
         /* need to grow the array */
@@ -604,6 +858,8 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
     for (i = ++parent_key->last_subkey; i > index; i--)
         parent_key->subkeys[i] = parent_key->subkeys[i - 1];
     parent_key->subkeys[index] = (struct key *)grab_object( key );
+    key->obj.name = name;  /* needed by the index, set by the caller as well */
+    index_append( parent_key, &parent_key->subkey_index, get_subkey_name, parent_key->last_subkey + 1 );
     if (is_wow6432node( name->name, name->len ) &&
         !is_wow6432node( parent_key->obj.name->name, parent_key->obj.name->len ))
         parent_key->wow6432node = key;
@@ -625,9 +881,25 @@ static void key_unlink_name( struct object *obj, struct object_name *name )
         return;
     }
 
-    for (i = 0; i <= parent->last_subkey; i++) if (parent->subkeys[i] == key) break;
-    assert( i <= parent->last_subkey );
-    for ( ; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
+    if (parent->subkey_index)
+    {
+        struct unicode_str tmp = { name->name, name->len };
+
+        key->obj.name = name;  /* needed by the index, already cleared by the caller */
+        i = index_lookup( parent, parent->subkey_index, get_subkey_name, &tmp );
+        assert( i != -1 && parent->subkeys[i] == key );
+        if (index_remove( parent, parent->subkey_index, get_subkey_name, i, parent->last_subkey ))
+            parent->subkeys[i] = parent->subkeys[parent->last_subkey];
+        else
+            for ( ; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
+        key->obj.name = NULL;
+    }
+    else
+    {
+        for (i = 0; i <= parent->last_subkey; i++) if (parent->subkeys[i] == key) break;
+        assert( i <= parent->last_subkey );
+        for ( ; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
+    }
     parent->last_subkey--;
     name->parent = NULL;
     if (parent->wow6432node == key) parent->wow6432node = NULL;
@@ -669,12 +941,14 @@ static void key_destroy( struct object *obj )
         free( key->values[i].data );
     }
     free( key->values );
+    free_name_index( &key->value_index );
     for (i = 0; i <= key->last_subkey; i++)
     {
         key->subkeys[i]->obj.name->parent = NULL;
         release_object( key->subkeys[i] );
     }
     free( key->subkeys );
+    free_name_index( &key->subkey_index );
     /* unconditionally notify everything waiting on this key */
     while ((ptr = list_head( &key->notify_list )))
     {
@@ -704,10 +978,14 @@ static struct key *create_key_object( struct object *parent, const struct unicod
             key->nb_subkeys  = 0;
             key->subkeys     = NULL;
             key->wow6432node = NULL;
+            key->subkey_index = NULL;
             key->nb_values   = 0;
             key->last_value  = -1;
             key->values      = NULL;
+            key->value_index = NULL;
             key->modif       = modif;
+            key->hive        = NULL;
+            key->hive_key    = NULL;
             list_init( &key->notify_list );
 
             if (options & REG_OPTION_CREATE_LINK) key->flags |= KEY_SYMLINK;
@@ -747,6 +1025,27 @@ static void make_clean( struct key *key )
     for (i = 0; i <= key->last_subkey; i++) make_clean( key->subkeys[i] );
 }
 
+/* mark a key and all its subkeys as clean, including subkeys that are dirty without their parent */
+static void make_subtree_clean( struct key *key )
+{
+    int i;
+
+    if (key->flags & KEY_VOLATILE) return;
+    key->flags &= ~KEY_DIRTY;
+    for (i = 0; i <= key->last_subkey; i++) make_subtree_clean( key->subkeys[i] );
+}
+
+/* mark a key and all its subkeys as dirty, loading them from the hive if needed */
+static void make_subtree_dirty( struct key *key )
+{
+    int i;
+
+    if (key->flags & KEY_VOLATILE) return;
+    load_key_contents( key );
+    key->flags |= KEY_DIRTY;
+    for (i = 0; i <= key->last_subkey; i++) make_subtree_dirty( key->subkeys[i] );
+}
+
 /* go through all the notifications and send them if necessary */
 static void check_notify( struct key *key, unsigned int change, int not_subtree )
 {
@@ -774,9 +1073,10 @@ static void touch_key( struct key *key, unsigned int change )
 /* get the wow6432node key if any, grabbing it and releasing the original key */
 static struct key *grab_wow6432node( struct key *key )
 {
-    struct key *ret = key->wow6432node;
+    struct key *ret;
 
-    if (!ret) return key;
+    load_key_contents( key );
+    if (!(ret = key->wow6432node)) return key;
     if (ret->flags & KEY_WOWSHARE) return key;
     grab_object( ret );
     release_object( key );
@@ -793,6 +1093,7 @@ static struct key *get_wow6432node( struct key *key )
     if (!key)
         return NULL;
 
+    load_key_contents( key );
     if (key->wow6432node)
         return key->wow6432node;
 
@@ -916,6 +1217,7 @@ static void enum_key( struct key *key, int index, int info_class, struct enum_ke
         return;
     }
 
+    load_key_contents( key );
     if (index != -1)  /* -1 means use the specified key directly */
     {
         if ((index < 0) || (index > key->last_subkey))
@@ -923,7 +1225,9 @@ static void enum_key( struct key *key, int index, int info_class, struct enum_ke
             set_error( STATUS_NO_MORE_ENTRIES );
             return;
         }
+        sort_subkeys( key );
         key = key->subkeys[index];
+        load_key_contents( key );
     }
 
     namelen = key->obj.name->len;
@@ -1034,24 +1338,42 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
     new_name_ptr->parent = &parent->obj;
     memcpy( new_name_ptr->name, new_name->str, new_name->len );
 
-    for (cur_index = 0; cur_index <= parent->last_subkey; cur_index++)
-        if (parent->subkeys[cur_index] == key) break;
-
-    if (cur_index < index && (index - cur_index) > 1)
+    if (parent->subkey_index)
     {
-        --index;
-        for (i = cur_index; i < index; ++i) parent->subkeys[i] = parent->subkeys[i+1];
+        /* keep the key in place, the array will be sorted when needed */
+        struct unicode_str old_name = { key->obj.name->name, key->obj.name->len };
+        unsigned int bucket = index_find_bucket( parent, parent->subkey_index, get_subkey_name, &old_name );
+
+        cur_index = parent->subkey_index->buckets[bucket] - 1;
+        index_remove_bucket( parent, parent->subkey_index, get_subkey_name, bucket );
+        free( key->obj.name );
+        key->obj.name = new_name_ptr;
+        index_add( parent, parent->subkey_index, get_subkey_name, cur_index );
+        parent->subkey_index->sorted = 0;
     }
-    else if (cur_index > index)
+    else
     {
-        for (i = cur_index; i > index; --i) parent->subkeys[i] = parent->subkeys[i-1];
-    }
-    parent->subkeys[index] = key;
+        for (cur_index = 0; cur_index <= parent->last_subkey; cur_index++)
+            if (parent->subkeys[cur_index] == key) break;
+
+        if (cur_index < index && (index - cur_index) > 1)
+        {
+            --index;
+            for (i = cur_index; i < index; ++i) parent->subkeys[i] = parent->subkeys[i+1];
+        }
+        else if (cur_index > index)
+        {
+            for (i = cur_index; i > index; --i) parent->subkeys[i] = parent->subkeys[i-1];
+        }
+        parent->subkeys[index] = key;
 
-    free( key->obj.name );
-    key->obj.name = new_name_ptr;
+        free( key->obj.name );
+        key->obj.name = new_name_ptr;
+    }
 
     if (debug_level > 1) dump_operation( key, NULL, "Rename" );
+    /* the hive image of the subkeys is stored under the old name */
+    if (key->hive) make_subtree_dirty( key );
     touch_key( key, REG_NOTIFY_CHANGE_NAME );
 }
 
@@ -1073,6 +1395,7 @@ static int delete_key( struct key *key, int recurse )
         return 0;
     }
 
+    load_key_contents( key );
     if (recurse)
     {
         while (key->last_subkey >= 0)
@@ -1117,11 +1440,22 @@ static int grow_values( struct key *key )
 }
 
 /* find the named value of a given key and return its index in the array */
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index )
+static struct key_value *find_value( struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
     data_size_t len;
 
+    load_key_contents( key );
+    if (key->value_index)
+    {
+        if ((i = index_lookup( key, key->value_index, get_value_name, name )) != -1)
+        {
+            *index = i;
+            return &key->values[i];
+        }
+        *index = key->last_value + 1;  /* new values are appended */
+        return NULL;
+    }
     min = 0;
     max = key->last_value;
     while (min <= max)
@@ -1165,6 +1499,8 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
     value->namelen = name->len;
     value->len     = 0;
     value->data    = NULL;
+    if (!index_append( key, &key->value_index, get_value_name, key->last_value + 1 ))
+        return find_value( key, name, &index );
     return value;
 }
 
@@ -1259,12 +1595,14 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
         return;
     }
 
+    load_key_contents( key );
     if (i < 0 || i > key->last_value) set_error( STATUS_NO_MORE_ENTRIES );
     else
     {
         void *data;
         data_size_t namelen, maxlen;
 
+        sort_values( key );
         value = &key->values[i];
         reply->type = value->type;
         namelen = value->namelen;
@@ -1309,7 +1647,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
 static void delete_value( struct key *key, const struct unicode_str *name )
 {
     struct key_value *value;
-    int i, index, nb_values;
+    int i, index, nb_values, swap = 0;
 
     if (key->flags & KEY_PREDEF)
     {
@@ -1323,9 +1661,11 @@ static void delete_value( struct key *key, const struct unicode_str *name )
         return;
     }
     if (debug_level > 1) dump_operation( key, value, "Delete" );
+    if (key->value_index) swap = index_remove( key, key->value_index, get_value_name, index, key->last_value );
     free( value->name );
     free( value->data );
-    for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
+    if (swap) key->values[index] = key->values[key->last_value];
+    else for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
     key->last_value--;
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
 
@@ -1805,28 +2145,736 @@ static void load_registry( struct key *key, obj_handle_t handle )
     }
 }
 
+/*
+ * Binary hive format
+ *
+ * When WINEREGISTRYHIVE=1 is set in the environment of the server, each registry
+ * branch is also stored in a binary image next to its text file (system.reg is
+ * stored in system.hive). At startup, the image is read and its checksum verified,
+ * then the keys are created lazily: the subkeys and values of a key are only loaded
+ * from the image the first time they are accessed.
+ *
+ * The periodic saves then append a journal record to the image for each modified
+ * key, holding its values and the names of its subkeys, instead of rewriting the
+ * whole branch. Both the journal and the image are flushed to disk before they are
+ * relied upon. The image is rewritten once the journal grows too large, and when
+ * the server exits, after exporting the branch to the text file. The image stores
+ * the size, time and inode of the text file it matches, so that a text file that
+ * was modified or saved by a server without hive support is imported instead.
+ */
+
+#define HIVE_MAGIC   "WINEHIVE"
+#define HIVE_VERSION 2
+#define HIVE_MIN_JOURNAL_SIZE (4 * 1024 * 1024)  /* journal size always allowed before rewriting the image */
+
+struct hive_header
+{
+    char               magic[8];     /* HIVE_MAGIC */
+    unsigned int       version;      /* HIVE_VERSION */
+    unsigned int       prefix_type;  /* architecture of the prefix */
+    unsigned long long base_size;    /* size of the image; journal records follow */
+    unsigned long long text_size;    /* size of the matching text file */
+    unsigned long long text_time;    /* modification time of the matching text file, in nanoseconds */
+    unsigned long long text_inode;   /* inode of the matching text file */
+    unsigned int       root;         /* offset of the branch root key */
+    unsigned int       checksum;     /* checksum of the image following this header */
+};
+
+struct hive_key
+{
+    timeout_t          modif;        /* last modification time */
+    unsigned int       flags;        /* key flags (only KEY_SYMLINK) */
+    unsigned int       name;         /* offset of the name */
+    unsigned int       namelen;      /* length of the name in bytes */
+    unsigned int       class;        /* offset of the class name */
+    unsigned int       classlen;     /* length of the class name in bytes */
+    unsigned int       subkeys;      /* offset of the array of subkey offsets */
+    unsigned int       subkey_count; /* number of subkeys */
+    unsigned int       values;       /* offset of the array of values */
+    unsigned int       value_count;  /* number of values */
+    unsigned int       pad;
+};
+
+struct hive_value
+{
+    unsigned int       type;         /* value type */
+    unsigned int       name;         /* offset of the name */
+    unsigned int       namelen;      /* length of the name in bytes */
+    unsigned int       data;         /* offset of the data */
+    unsigned int       len;          /* length of the data */
+    unsigned int       pad;
+};
+
+/* journal record; its key only contains the names of the subkeys */
+struct hive_record
+{
+    unsigned int       size;         /* size of the record, including this header */
+    unsigned int       checksum;     /* checksum of the data following this header */
+    unsigned int       path;         /* offset of the key path, relative to the branch root */
+    unsigned int       pathlen;      /* length of the path in bytes */
+    unsigned int       key;          /* offset of the key */
+    unsigned int       pad;
+};
+
+/* a binary hive file */
+struct hive
+{
+    char              *filename;     /* name of the hive file */
+    int                fd;           /* file descriptor for appending to the journal, -1 if no valid image */
+    char              *base;         /* contents of the image */
+    unsigned char     *visited;      /* bitmap of the image keys that have been loaded */
+    size_t             base_size;    /* size of the image */
+    size_t             journal_size; /* size of the journal following the image */
+    int                text_stale;   /* branch modified since the text file was saved */
+};
+
+/* output buffer for hive data */
+struct hive_writer
+{
+    FILE              *file;         /* output file, or NULL to write to memory */
+    char              *data;         /* memory buffer */
+    size_t             size;         /* size of the data written so far */
+    size_t             start;        /* start of the current journal record, offsets are relative to it */
+    size_t             alloc;        /* allocated size of the memory buffer */
+    unsigned int       checksum;     /* checksum of the data written to the file */
+    int                error;        /* write error */
+};
+
+static int use_registry_hive;
+
+static unsigned int hive_checksum( unsigned int sum, const char *data, size_t size )
+{
+    while (size--) sum = sum * 31 + (unsigned char)*data++;
+    return sum;
+}
+
+/* return a pointer to data in a hive image, or NULL if it's out of bounds */
+static const void *hive_ptr( const char *base, size_t size, unsigned int offset, size_t len, size_t align )
+{
+    if (offset % align || offset > size || len > size - offset) return NULL;
+    return base + offset;
+}
+
+static const struct hive_key *get_hive_key( const char *base, size_t size, unsigned int offset )
+{
+    const struct hive_key *hkey = hive_ptr( base, size, offset, sizeof(*hkey), 8 );
+
+    if (!hkey || hkey->namelen % sizeof(WCHAR) || hkey->namelen > MAX_NAME_LEN * sizeof(WCHAR)) return NULL;
+    if (!hive_ptr( base, size, hkey->name, hkey->namelen, sizeof(WCHAR) )) return NULL;
+    if (!hive_ptr( base, size, hkey->class, hkey->classlen, sizeof(WCHAR) )) return NULL;
+    if (hkey->subkey_count > size / sizeof(unsigned int) ||
+        !hive_ptr( base, size, hkey->subkeys, hkey->subkey_count * sizeof(unsigned int), sizeof(unsigned int) ))
+        return NULL;
+    if (hkey->value_count > size / sizeof(struct hive_value) ||
+        !hive_ptr( base, size, hkey->values, hkey->value_count * sizeof(struct hive_value), 8 ))
+        return NULL;
+    return hkey;
+}
+
+/* replace the class name of a key by the one of its hive image */
+static int load_hive_class( struct key *key, const char *base, const struct hive_key *hkey )
+{
+    WCHAR *class = NULL;
+
+    if (hkey->classlen && !(class = memdup( base + hkey->class, hkey->classlen ))) return 0;
+    free( key->class );
+    key->class    = class;
+    key->classlen = hkey->classlen;
+    return 1;
+}
+
+/* replace the values of a key by the ones of its hive image */
+static int load_hive_values( struct key *key, const char *base, size_t size, const struct hive_key *hkey )
+{
+    const struct hive_value *hvalues = (const struct hive_value *)(base + hkey->values);
+    struct key_value *values = NULL;
+    int i, count = 0, nb_values = 0;
+
+    if (hkey->value_count)
+    {
+        nb_values = max( hkey->value_count, MIN_VALUES );
+        if (!(values = mem_alloc( nb_values * sizeof(*values) ))) return 0;
+    }
+    for (count = 0; count < hkey->value_count; count++)
+    {
+        const struct hive_value *hvalue = &hvalues[count];
+        struct key_value *value = &values[count];
+
+        if (hvalue->namelen % sizeof(WCHAR) || hvalue->namelen > MAX_VALUE_LEN * sizeof(WCHAR) ||
+            !hive_ptr( base, size, hvalue->name, hvalue->namelen, sizeof(WCHAR) ) ||
+            !hive_ptr( base, size, hvalue->data, hvalue->len, 1 ))
+            break;
+        value->name    = NULL;
+        value->data    = NULL;
+        value->namelen = hvalue->namelen;
+        value->type    = hvalue->type;
+        value->len     = hvalue->len;
+        if (hvalue->namelen && !(value->name = memdup( base + hvalue->name, hvalue->namelen ))) break;
+        if (hvalue->len && !(value->data = memdup( base + hvalue->data, hvalue->len )))
+        {
+            free( value->name );
+            break;
+        }
+    }
+
+    for (i = 0; i <= key->last_value; i++)
+    {
+        free( key->values[i].name );
+        free( key->values[i].data );
+    }
+    free( key->values );
+    key->values     = values;
+    key->nb_values  = nb_values;
+    key->last_value = count - 1;
+
+    /* the image is written in sorted order, but don't rely on it */
+    free_name_index( &key->value_index );
+    if (count < MIN_INDEXED || !index_resize( key, &key->value_index, get_value_name, count ))
+        qsort( key->values, count, sizeof(*key->values), compare_values );
+    return count == hkey->value_count;
+}
+
+/* mark a key of the hive image as loaded; fails if it's reachable more than once */
+static int visit_hive_key( struct hive *hive, unsigned int offset )
+{
+    unsigned int index = offset / 8;
+
+    if (hive->visited[index / 8] & (1 << (index % 8))) return 0;
+    hive->visited[index / 8] |= 1 << (index % 8);
+    return 1;
+}
+
+/* create the subkeys and load the values of a key from its hive image */
+static void load_hive_key( struct key *key )
+{
+    struct hive *hive = key->hive;
+    const struct hive_key *hkey = key->hive_key;
+    const unsigned int *subkeys = (const unsigned int *)(hive->base + hkey->subkeys);
+    unsigned int i, error = get_error();
+    struct unicode_str name;
+    struct key *subkey;
+
+    key->hive_key = NULL;
+    if (!load_hive_values( key, hive->base, hive->base_size, hkey )) goto failed;
+
+    for (i = 0; i < hkey->subkey_count; i++)
+    {
+        const struct hive_key *child = get_hive_key( hive->base, hive->base_size, subkeys[i] );
+
+        /* a key referenced twice would allow cycles and exponential trees */
+        if (!child || !child->namelen || !visit_hive_key( hive, subkeys[i] )) goto failed;
+        name.str = (const WCHAR *)(hive->base + child->name);
+        name.len = child->namelen;
+        if (get_path_element( name.str, name.len ) != name.len) goto failed;
+        if (!(subkey = create_key_object( &key->obj, &name, OBJ_OPENIF, 0, child->modif, NULL ))) goto failed;
+        if (get_error() != STATUS_OBJECT_NAME_EXISTS)
+        {
+            subkey->flags = (subkey->flags & ~KEY_DIRTY) | (child->flags & KEY_SYMLINK);
+            subkey->hive  = hive;
+            if (child->subkey_count || child->value_count) subkey->hive_key = child;
+            load_hive_class( subkey, hive->base, child );
+        }
+        release_object( subkey );
+        set_error( error );
+    }
+    set_error( error );
+    return;
+
+failed:
+    fprintf( stderr, "wineserver: corrupted registry hive %s\n", hive->filename );
+    set_error( error );
+}
+
+/* write data to a hive; return its offset, aligned to 8 bytes */
+static unsigned int hive_write( struct hive_writer *writer, const void *data, size_t size )
+{
+    static const char padding[8];
+    size_t pad = (8 - size % 8) % 8, pos = writer->size;
+
+    if (writer->error) return 0;
+    if (pos + size + pad > UINT_MAX)
+    {
+        writer->error = 1;
+        return 0;
+    }
+    if (writer->file)
+    {
+        if (fwrite( data, 1, size, writer->file ) != size || fwrite( padding, 1, pad, writer->file ) != pad)
+            writer->error = 1;
+        writer->checksum = hive_checksum( writer->checksum, data, size );
+        writer->checksum = hive_checksum( writer->checksum, padding, pad );
+    }
+    else
+    {
+        if (pos + size + pad > writer->alloc)
+        {
+            size_t alloc = max( writer->alloc * 2, pos + size + pad + 4096 );
+            char *new_data = realloc( writer->data, alloc );
+
+            if (!new_data)
+            {
+                writer->error = 1;
+                return 0;
+            }
+            writer->data  = new_data;
+            writer->alloc = alloc;
+        }
+        memcpy( writer->data + pos, data, size );
+        memset( writer->data + pos + size, 0, pad );
+    }
+    writer->size = pos + size + pad;
+    return pos - writer->start;
+}
+
+/* write the image of a key and its values; subkeys are written recursively, or only by name */
+static unsigned int write_hive_key( struct hive_writer *writer, struct key *key, int recurse )
+{
+    struct hive_value *values = NULL;
+    unsigned int *subkeys = NULL;
+    struct hive_key hkey;
+    int i;
+
+    load_key_contents( key );
+    sort_subkeys( key );
+    sort_values( key );
+    memset( &hkey, 0, sizeof(hkey) );
+
+    if (key->last_subkey >= 0 && !(subkeys = mem_alloc( (key->last_subkey + 1) * sizeof(*subkeys) )))
+    {
+        writer->error = 1;
+        return 0;
+    }
+    for (i = 0; i <= key->last_subkey; i++)
+    {
+        struct key *subkey = key->subkeys[i];
+        struct hive_key stub;
+
+        if (subkey->flags & KEY_VOLATILE) continue;
+        if (recurse) subkeys[hkey.subkey_count++] = write_hive_key( writer, subkey, 1 );
+        else
+        {
+            memset( &stub, 0, sizeof(stub) );
+            stub.modif   = subkey->modif;
+            stub.namelen = subkey->obj.name->len;
+            stub.name    = hive_write( writer, subkey->obj.name->name, stub.namelen );
+            subkeys[hkey.subkey_count++] = hive_write( writer, &stub, sizeof(stub) );
+        }
+    }
+    hkey.subkeys = hive_write( writer, subkeys, hkey.subkey_count * sizeof(*subkeys) );
+    free( subkeys );
+
+    if (key->last_value >= 0 && !(values = mem_alloc( (key->last_value + 1) * sizeof(*values) )))
+    {
+        writer->error = 1;
+        return 0;
+    }
+    for (i = 0; i <= key->last_value; i++)
+    {
+        memset( &values[i], 0, sizeof(values[i]) );
+        values[i].type    = key->values[i].type;
+        values[i].namelen = key->values[i].namelen;
+        values[i].name    = hive_write( writer, key->values[i].name, key->values[i].namelen );
+        values[i].len     = key->values[i].len;
+        values[i].data    = hive_write( writer, key->values[i].data, key->values[i].len );
+    }
+    hkey.value_count = key->last_value + 1;
+    hkey.values = hive_write( writer, values, hkey.value_count * sizeof(*values) );
+    free( values );
+
+    hkey.modif    = key->modif;
+    hkey.flags    = key->flags & KEY_SYMLINK;
+    hkey.namelen  = key->obj.name->len;
+    hkey.name     = hive_write( writer, key->obj.name->name, hkey.namelen );
+    hkey.classlen = key->classlen;
+    hkey.class    = hive_write( writer, key->class, key->classlen );
+    return hive_write( writer, &hkey, sizeof(hkey) );
+}
+
+/* write the path of a key relative to the branch root */
+static unsigned int write_hive_path( struct hive_writer *writer, struct key *key, struct key *base,
+                                     unsigned int *len )
+{
+    struct key *parent;
+    WCHAR *path;
+    data_size_t pos;
+    unsigned int ret;
+
+    for (*len = 0, parent = key; parent && parent != base; parent = get_parent( parent ))
+        *len += parent->obj.name->len + sizeof(WCHAR);
+    if (*len) *len -= sizeof(WCHAR);
+    if (!(path = mem_alloc( *len + 1 )))
+    {
+        writer->error = 1;
+        return 0;
+    }
+    for (pos = *len, parent = key; parent && parent != base; parent = get_parent( parent ))
+    {
+        pos -= parent->obj.name->len;
+        memcpy( (char *)path + pos, parent->obj.name->name, parent->obj.name->len );
+        if (pos) path[(pos -= sizeof(WCHAR)) / sizeof(WCHAR)] = '\\';
+    }
+    ret = hive_write( writer, path, *len );
+    free( path );
+    return ret;
+}
+
+/* write journal records for the modified keys of a branch */
+static void write_hive_records( struct hive_writer *writer, struct key *key, struct key *base )
+{
+    struct hive_record record;
+    size_t start;
+    int i;
+
+    /* subkeys can be dirty without their parent if they were created internally */
+    if (key->flags & KEY_VOLATILE) return;
+    for (i = 0; i <= key->last_subkey; i++) write_hive_records( writer, key->subkeys[i], base );
+    if (!(key->flags & KEY_DIRTY)) return;
+
+    start = writer->start = writer->size;
+    memset( &record, 0, sizeof(record) );
+    hive_write( writer, &record, sizeof(record) );
+    record.path = write_hive_path( writer, key, base, &record.pathlen );
+    record.key  = write_hive_key( writer, key, 0 );
+    record.size = writer->size - start;
+    if (writer->error) return;
+    record.checksum = hive_checksum( 0, writer->data + start + sizeof(record), record.size - sizeof(record) );
+    memcpy( writer->data + start, &record, sizeof(record) );
+}
+
+/* apply a journal record to a branch */
+static int replay_hive_record( struct key *base, const char *data, size_t size )
+{
+    const struct hive_record *record = (const struct hive_record *)data;
+    const struct hive_key *hkey;
+    const unsigned int *subkeys;
+    struct unicode_str name;
+    struct key *key;
+    unsigned int j;
+    char *keep;
+    int i;
+
+    if (size < sizeof(*record) || record->size < sizeof(*record) || record->size > size) return 0;
+    size = record->size;
+    if (record->checksum != hive_checksum( 0, data + sizeof(*record), size - sizeof(*record) )) return 0;
+    if (!(hkey = get_hive_key( data, size, record->key ))) return 0;
+    if (!(name.str = hive_ptr( data, size, record->path, record->pathlen, sizeof(WCHAR) ))) return 0;
+    name.len = record->pathlen;
+
+    if (!name.len) key = (struct key *)grab_object( base );
+    else if (!(key = create_key_recursive( base, &name, hkey->modif ))) return 0;
+
+    load_key_contents( key );
+    key->modif = hkey->modif;
+    key->flags = (key->flags & ~KEY_SYMLINK) | (hkey->flags & KEY_SYMLINK);
+    load_hive_class( key, data, hkey );
+    load_hive_values( key, data, size, hkey );
+
+    /* delete the subkeys that didn't exist anymore */
+    if (key->last_subkey >= 0)
+    {
+        if (!(keep = mem_alloc( key->last_subkey + 1 )))
+        {
+            release_object( key );
+            return 0;
+        }
+        memset( keep, 0, key->last_subkey + 1 );
+        subkeys = (const unsigned int *)(data + hkey->subkeys);
+        for (j = 0; j < hkey->subkey_count; j++)
+        {
+            const struct hive_key *child;
+            struct unicode_str child_name;
+
+            if (!(child = get_hive_key( data, size, subkeys[j] ))) continue;
+            child_name.str = (const WCHAR *)(data + child->name);
+            child_name.len = child->namelen;
+            if (find_subkey( key, &child_name, &i )) keep[i] = 1;
+        }
+        for (i = key->last_subkey; i >= 0; i--)
+        {
+            struct key *subkey = key->subkeys[i];
+            if (!keep[i] && !(subkey->flags & KEY_VOLATILE)) delete_key( subkey, 1 );
+        }
+        free( keep );
+    }
+    release_object( key );
+    return 1;
+}
+
+/* get the information about the text file matching a hive */
+static void get_hive_text_stamp( const char *filename, struct hive_header *header )
+{
+    struct stat st;
+
+    if (stat( filename, &st )) return;
+    header->text_size  = st.st_size;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    header->text_time  = st.st_mtime * 1000000000ull + st.st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    header->text_time  = st.st_mtime * 1000000000ull + st.st_mtimespec.tv_nsec;
+#else
+    header->text_time  = st.st_mtime * 1000000000ull;
+#endif
+    header->text_inode = st.st_ino;
+}
+
+/* allocate the hive of a registry branch */
+static struct hive *create_hive( const char *filename )
+{
+    size_t len = strlen( filename );
+    struct hive *hive;
+
+    if (len > 4 && !strcmp( filename + len - 4, ".reg" )) len -= 4;
+    if (!(hive = mem_alloc( sizeof(*hive) ))) return NULL;
+    if (!(hive->filename = mem_alloc( len + sizeof(".hive") )))
+    {
+        free( hive );
+        return NULL;
+    }
+    memcpy( hive->filename, filename, len );
+    strcpy( hive->filename + len, ".hive" );
+    hive->fd           = -1;
+    hive->base         = NULL;
+    hive->visited      = NULL;
+    hive->base_size    = 0;
+    hive->journal_size = 0;
+    hive->text_stale   = 0;
+    return hive;
+}
+
+/* load a registry branch from its hive, if it matches the text file */
+static int load_hive( struct hive *hive, const char *text_filename, struct key *key )
+{
+    struct hive_header header, text;
+    const struct hive_header *map_header;
+    const struct hive_key *root;
+    unsigned char *visited = NULL;
+    struct stat st;
+    size_t pos, size;
+    ssize_t ret;
+    char *ptr;
+    int fd;
+
+    if ((fd = open( hive->filename, O_RDWR | O_APPEND )) == -1) return 0;
+    if (fstat( fd, &st ) || st.st_size < sizeof(header) || st.st_size != (size_t)st.st_size) goto failed;
+
+    /* read the file instead of mapping it, so that it can't crash us if it gets truncated */
+    if (!(ptr = mem_alloc( st.st_size ))) goto failed;
+    for (size = 0; size < st.st_size; size += ret)
+    {
+        if ((ret = read( fd, ptr + size, st.st_size - size )) > 0) continue;
+        if (!ret) break;
+        if (errno != EINTR) goto unmap;
+        ret = 0;
+    }
+    if (size < sizeof(header)) goto unmap;
+    map_header = (const struct hive_header *)ptr;
+
+    memset( &text, 0, sizeof(text) );
+    get_hive_text_stamp( text_filename, &text );
+    if (memcmp( map_header->magic, HIVE_MAGIC, sizeof(map_header->magic) ) ||
+        map_header->version != HIVE_VERSION ||
+        map_header->base_size < sizeof(header) || map_header->base_size > size ||
+        map_header->text_size != text.text_size || map_header->text_time != text.text_time ||
+        map_header->text_inode != text.text_inode)
+        goto unmap;
+    if (map_header->checksum != hive_checksum( 0, ptr + sizeof(header), map_header->base_size - sizeof(header) ))
+    {
+        fprintf( stderr, "wineserver: corrupted registry hive %s\n", hive->filename );
+        goto unmap;
+    }
+    if (map_header->prefix_type != PREFIX_UNKNOWN)
+    {
+        if (prefix_type == PREFIX_UNKNOWN) prefix_type = map_header->prefix_type;
+        else if (prefix_type != map_header->prefix_type) goto unmap;
+    }
+    if (!(root = get_hive_key( ptr, map_header->base_size, map_header->root ))) goto unmap;
+    if (!(visited = mem_alloc( map_header->base_size / 64 + 1 ))) goto unmap;
+    memset( visited, 0, map_header->base_size / 64 + 1 );
+
+    hive->fd        = fd;
+    hive->base      = ptr;
+    hive->visited   = visited;
+    hive->base_size = map_header->base_size;
+    visit_hive_key( hive, map_header->root );
+
+    key->modif = root->modif;
+    key->hive  = hive;
+    if (root->subkey_count || root->value_count) key->hive_key = root;
+    load_hive_class( key, hive->base, root );
+
+    /* apply the journal, and drop a possibly truncated last record */
+    for (pos = hive->base_size; pos < size; pos += ((const struct hive_record *)(hive->base + pos))->size)
+        if (!replay_hive_record( key, hive->base + pos, size - pos )) break;
+    if (pos < st.st_size)
+    {
+        fprintf( stderr, "wineserver: ignoring invalid journal data in %s\n", hive->filename );
+        ftruncate( fd, pos );
+    }
+    hive->journal_size = pos - hive->base_size;
+    hive->text_stale   = hive->journal_size != 0;
+    make_clean( key );
+    if (debug_level) fprintf( stderr, "wineserver: loaded registry hive %s\n", hive->filename );
+    return 1;
+
+unmap:
+    free( ptr );
+failed:
+    close( fd );
+    return 0;
+}
+
+/* rewrite the image of a branch; this loads all of its keys */
+static int save_hive_image( struct hive *hive, struct key *key, const char *text_filename )
+{
+    struct hive_writer writer;
+    struct hive_header header;
+    char tmp[32];
+    int fd, count = 0;
+
+    for (;;)
+    {
+        snprintf( tmp, sizeof(tmp), "reg%lx%04x.tmp", (long) getpid(), count++ );
+        if ((fd = open( tmp, O_CREAT | O_EXCL | O_RDWR, 0666 )) != -1) break;
+        if (errno != EEXIST) return 0;
+    }
+
+    memset( &writer, 0, sizeof(writer) );
+    if (!(writer.file = fdopen( dup( fd ), "w" )))
+    {
+        close( fd );
+        unlink( tmp );
+        return 0;
+    }
+
+    memset( &header, 0, sizeof(header) );
+    hive_write( &writer, &header, sizeof(header) );
+    writer.checksum = 0;
+    memcpy( header.magic, HIVE_MAGIC, sizeof(header.magic) );
+    header.version     = HIVE_VERSION;
+    header.prefix_type = prefix_type;
+    header.root        = write_hive_key( &writer, key, 1 );
+    header.base_size   = writer.size;
+    header.checksum    = writer.checksum;
+    get_hive_text_stamp( text_filename, &header );
+    if (fseek( writer.file, 0, SEEK_SET ) || fwrite( &header, sizeof(header), 1, writer.file ) != 1)
+        writer.error = 1;
+    if (fclose( writer.file )) writer.error = 1;
+
+    /* make sure the data is on disk before replacing the previous image */
+    if (writer.error || fsync( fd ) || rename( tmp, hive->filename ))
+    {
+        close( fd );
+        unlink( tmp );
+        return 0;
+    }
+    fsync( config_dir_fd );
+
+    /* all the keys have been loaded, the previous image is no longer needed */
+    free( hive->base );
+    free( hive->visited );
+    if (hive->fd != -1) close( hive->fd );
+    lseek( fd, 0, SEEK_END );
+    hive->fd           = fd;
+    hive->base         = NULL;
+    hive->visited      = NULL;
+    hive->base_size    = header.base_size;
+    hive->journal_size = 0;
+    if (debug_level > 1) fprintf( stderr, "%s: saved registry hive\n", hive->filename );
+    return 1;
+}
+
+/* append the modified keys of a branch to the hive journal */
+static int save_hive_journal( struct hive *hive, struct key *key )
+{
+    struct hive_writer writer;
+    size_t pos;
+    ssize_t ret;
+
+    memset( &writer, 0, sizeof(writer) );
+    write_hive_records( &writer, key, key );
+    if (writer.error)
+    {
+        free( writer.data );
+        return 0;
+    }
+    for (pos = 0; pos < writer.size; pos += ret)
+    {
+        if ((ret = write( hive->fd, writer.data + pos, writer.size - pos )) > 0) continue;
+        if (ret == -1 && errno == EINTR)
+        {
+            ret = 0;
+            continue;
+        }
+        break;
+    }
+    /* the records are only considered saved once they are on disk */
+    if (pos < writer.size || fsync( hive->fd ))
+    {
+        /* don't leave a partial record behind */
+        ftruncate( hive->fd, hive->base_size + hive->journal_size );
+        lseek( hive->fd, 0, SEEK_END );
+        free( writer.data );
+        return 0;
+    }
+    hive->journal_size += writer.size;
+    free( writer.data );
+    if (debug_level > 1) fprintf( stderr, "%s: appended %lu bytes to the journal\n",
+                                  hive->filename, (unsigned long)writer.size );
+    return 1;
+}
+
+/* save the modified keys of a branch to its hive */
+static int save_branch_hive( struct save_branch_info *info )
+{
+    struct hive *hive = info->hive;
+    struct key *key = info->key;
+    int ret;
+
+    if (hive->fd == -1 || hive->journal_size > hive->base_size / 2 + HIVE_MIN_JOURNAL_SIZE)
+        ret = save_hive_image( hive, key, info->filename );
+    else if (!(key->flags & KEY_DIRTY))
+        return 1;
+    else
+        ret = save_hive_journal( hive, key );
+
+    if (ret && (key->flags & KEY_DIRTY))
+    {
+        hive->text_stale = 1;
+        make_subtree_clean( key );
+    }
+    return ret;
+}
+
 /* load one of the initial registry files */
 static int load_init_registry_from_file( const char *filename, struct key *key )
 {
-    FILE *f;
+    struct hive *hive = NULL;
+    FILE *f = NULL;
+    int ret = 0;
 
-    if ((f = fopen( filename, "r" )))
+    if (use_registry_hive && (hive = create_hive( filename ))) ret = load_hive( hive, filename, key );
+
+    if (!ret && (f = fopen( filename, "r" )))
     {
         load_keys( key, filename, f, 0 );
         fclose( f );
         if (get_error() == STATUS_NOT_REGISTRY_FILE)
         {
             fprintf( stderr, "%s is not a valid registry file\n", filename );
+            if (hive) free( hive->filename );
+            free( hive );
             return 1;
         }
+        ret = 1;
     }
 
     assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
 
     save_branch_info[save_branch_count].filename = filename;
+    save_branch_info[save_branch_count].hive = hive;
     save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
     make_object_permanent( &key->obj );
-    return (f != NULL);
+    return ret;
 }
 
 static WCHAR *format_user_registry_path( const struct sid *sid, struct unicode_str *path )
@@ -1901,6 +2949,8 @@ void init_registry(void)
 
     if (fchdir( config_dir_fd ) == -1) fatal_error( "chdir to config dir: %s\n", strerror( errno ));
 
+    if ((p = getenv( "WINEREGISTRYHIVE" ))) use_registry_hive = atoi( p );
+
     /* create the root key */
     root_key = create_key_object( NULL, &root_name, OBJ_PERMANENT, 0, current_time, NULL );
     assert( root_key );
@@ -2107,16 +3157,327 @@ done:
     return ret;
 }
 
+/* export a branch to its text file and rewrite its hive image */
+static int flush_branch_hive( struct save_branch_info *info )
+{
+    struct hive *hive = info->hive;
+    struct key *key = info->key;
+
+    if (!(key->flags & KEY_DIRTY) && !hive->text_stale) return 1;
+
+    /* the text file can be outdated even if the branch wasn't modified since the last journal save */
+    key->flags |= KEY_DIRTY;
+    if (save_branch( key, info->filename ))
+    {
+        hive->text_stale = 0;
+        save_hive_image( hive, key, info->filename );
+        return 1;
+    }
+    /* keep the changes in the journal at least */
+    if (hive->fd != -1) save_branch_hive( info );
+    return 0;
+}
+
+/*
+ * Background saving
+ *
+ * The periodic saves of the text registry files are done by a child process, so
+ * that the server can keep processing requests while the branches are written.
+ * The child gets a copy-on-write snapshot of the registry at the time of the fork,
+ * and the branches are marked clean right away in the server; the ones that the
+ * child fails to save are marked dirty again once it reports its results.
+ */
+
+/* results sent back by the save process */
+struct save_result
+{
+    unsigned int      saved;       /* mask of the branches that were saved */
+    timeout_t         write_time;  /* time spent writing the files */
+};
+
+/* a child process saving registry branches */
+struct save_process
+{
+    struct object     obj;         /* object header */
+    struct fd        *fd;          /* pipe to receive the results */
+    pid_t             pid;         /* unix pid of the process */
+    unsigned int      branches;    /* mask of the branches being saved */
+    struct save_result result;     /* results received so far */
+    data_size_t       result_size; /* size of the results received so far */
+};
+
+/* registry save statistics */
+struct save_stats
+{
+    unsigned int      count;          /* number of background saves */
+    unsigned int      failed;         /* number of branches that failed to save */
+    timeout_t         snapshot_time;  /* total time spent forking the save process */
+    timeout_t         snapshot_max;   /* longest fork */
+    timeout_t         write_time;     /* total time spent writing in the save process */
+    timeout_t         write_max;      /* longest write */
+};
+
+static void save_process_dump( struct object *obj, int verbose );
+static void save_process_destroy( struct object *obj );
+
+static const struct object_ops save_process_ops =
+{
+    sizeof(struct save_process), /* size */
+    &no_type,                 /* type */
+    save_process_dump,        /* dump */
+    no_add_queue,             /* add_queue */
+    NULL,                     /* remove_queue */
+    NULL,                     /* signaled */
+    NULL,                     /* satisfied */
+    no_signal,                /* signal */
+    no_get_fd,                /* get_fd */
+    default_map_access,       /* map_access */
+    default_get_sd,           /* get_sd */
+    default_set_sd,           /* set_sd */
+    no_get_full_name,         /* get_full_name */
+    no_lookup_name,           /* lookup_name */
+    no_link_name,             /* link_name */
+    NULL,                     /* unlink_name */
+    no_open_file,             /* open_file */
+    no_kernel_obj_list,       /* get_kernel_obj_list */
+    no_close_handle,          /* close_handle */
+    save_process_destroy      /* destroy */
+};
+
+static void save_process_poll_event( struct fd *fd, int event );
+
+static const struct fd_ops save_process_fd_ops =
+{
+    NULL,                     /* get_poll_events */
+    save_process_poll_event,  /* poll_event */
+    NULL,                     /* flush */
+    NULL,                     /* get_fd_type */
+    NULL,                     /* ioctl */
+    NULL,                     /* queue_async */
+    NULL                      /* reselect_async */
+};
+
+static struct save_process *save_process;  /* currently running save process */
+static struct save_stats save_stats;
+
+static void save_process_dump( struct object *obj, int verbose )
+{
+    struct save_process *process = (struct save_process *)obj;
+    fprintf( stderr, "Registry save process pid=%d branches=%x\n", (int)process->pid, process->branches );
+}
+
+static void save_process_destroy( struct object *obj )
+{
+    struct save_process *process = (struct save_process *)obj;
+    if (process->fd) release_object( process->fd );
+}
+
+/* close the file descriptors inherited from the server, except stdio, the config dir and the result pipe */
+static void close_save_process_fds( int result_fd )
+{
+    struct rlimit rlim;
+    struct dirent *de;
+    DIR *dir;
+    int fd, max_fd = 1024;
+
+    if ((dir = opendir( "/proc/self/fd" )))
+    {
+        while ((de = readdir( dir )))
+        {
+            if (de->d_name[0] < '0' || de->d_name[0] > '9') continue;
+            fd = atoi( de->d_name );
+            if (fd > 2 && fd != result_fd && fd != config_dir_fd && fd != dirfd( dir )) close( fd );
+        }
+        closedir( dir );
+        return;
+    }
+    if (!getrlimit( RLIMIT_NOFILE, &rlim ) && rlim.rlim_cur != RLIM_INFINITY && rlim.rlim_cur < INT_MAX)
+        max_fd = rlim.rlim_cur;
+    for (fd = 3; fd < max_fd; fd++) if (fd != result_fd && fd != config_dir_fd) close( fd );
+}
+
+/* body of the save process */
+static void DECLSPEC_NORETURN run_save_process( int fd, unsigned int branches )
+{
+    static const int signals[] = { SIGCHLD, SIGHUP, SIGINT, SIGIO, SIGQUIT, SIGTERM, SIGUSR1 };
+    struct save_result result;
+    timeout_t start = monotonic_counter();
+    sigset_t sigset;
+    int i;
+
+    /* don't forward signals to the server handlers */
+    for (i = 0; i < ARRAY_SIZE(signals); i++) signal( signals[i], SIG_DFL );
+    sigemptyset( &sigset );
+    sigprocmask( SIG_SETMASK, &sigset, NULL );
+
+    /* don't keep the master socket and the client connections alive */
+    close_save_process_fds( fd );
+
+    result.saved = 0;
+    for (i = 0; i < save_branch_count; i++)
+    {
+        if (!(branches & (1 << i))) continue;
+        if (save_branch( save_branch_info[i].key, save_branch_info[i].filename )) result.saved |= 1 << i;
+    }
+    result.write_time = monotonic_counter() - start;
+    write( fd, &result, sizeof(result) );
+    _exit( 0 );
+}
+
+/* process the results of the save process once it has exited */
+static void finish_save_process( struct save_process *process )
+{
+    unsigned int failed = process->branches;
+    int i, status;
+
+    while (waitpid( process->pid, &status, 0 ) == -1 && errno == EINTR);
+
+    if (process->result_size == sizeof(process->result))
+    {
+        failed &= ~process->result.saved;
+        save_stats.write_time += process->result.write_time;
+        if (process->result.write_time > save_stats.write_max) save_stats.write_max = process->result.write_time;
+        if (debug_level > 1) fprintf( stderr, "wineserver: registry saved in %llu us\n",
+                                      (unsigned long long)process->result.write_time / 10 );
+    }
+    for (i = 0; i < save_branch_count; i++)
+    {
+        if (!(failed & (1 << i))) continue;
+        fprintf( stderr, "wineserver: could not save registry branch to %s\n", save_branch_info[i].filename );
+        save_branch_info[i].key->flags |= KEY_DIRTY;  /* retry on the next save */
+        save_stats.failed++;
+    }
+    if (save_process == process) save_process = NULL;
+    release_object( process );
+}
+
+static void save_process_poll_event( struct fd *fd, int event )
+{
+    struct save_process *process = get_fd_user( fd );
+    int ret = 0;
+
+    /* the results are complete once the pipe is closed by the exiting process */
+    if (event & POLLIN)
+    {
+        char *buffer = (char *)&process->result + process->result_size;
+        char dummy;
+
+        if (process->result_size < sizeof(process->result))
+            ret = read( get_unix_fd( fd ), buffer, sizeof(process->result) - process->result_size );
+        else
+            ret = read( get_unix_fd( fd ), &dummy, 1 );
+        if (ret > 0)
+        {
+            if (process->result_size < sizeof(process->result)) process->result_size += ret;
+            return;
+        }
+        if (ret == -1 && (errno == EINTR || errno == EAGAIN)) return;
+    }
+    set_fd_events( fd, -1 );
+    finish_save_process( process );
+}
+
+/* wait for the save process to terminate, if any */
+static void wait_save_process(void)
+{
+    struct save_process *process = save_process;
+    int ret;
+
+    if (!process) return;
+    while (process->result_size < sizeof(process->result))
+    {
+        ret = read( get_unix_fd( process->fd ), (char *)&process->result + process->result_size,
+                    sizeof(process->result) - process->result_size );
+        if (ret > 0) process->result_size += ret;
+        else if (!ret || errno != EINTR) break;
+    }
+    set_fd_events( process->fd, -1 );
+    finish_save_process( process );
+}
+
+/* start a process to save the given branches in the background */
+static int start_save_process( unsigned int branches )
+{
+    struct save_process *process;
+    timeout_t start = monotonic_counter(), time;
+    int i, fd[2];
+    pid_t pid;
+
+    if (pipe( fd ) == -1) return 0;
+
+    switch ((pid = fork()))
+    {
+    case -1:
+        close( fd[0] );
+        close( fd[1] );
+        return 0;
+    case 0:
+        close( fd[0] );
+        run_save_process( fd[1], branches );
+    }
+
+    close( fd[1] );
+    if (!(process = alloc_object( &save_process_ops )))
+    {
+        close( fd[0] );
+        while (waitpid( pid, NULL, 0 ) == -1 && errno == EINTR);
+        return 0;
+    }
+    process->pid         = pid;
+    process->branches    = branches;
+    process->result_size = 0;
+    if (!(process->fd = create_anonymous_fd( &save_process_fd_ops, fd[0], &process->obj, 0 )))
+    {
+        release_object( process );
+        while (waitpid( pid, NULL, 0 ) == -1 && errno == EINTR);
+        return 0;
+    }
+    set_fd_events( process->fd, POLLIN );
+    save_process = process;
+
+    for (i = 0; i < save_branch_count; i++)
+        if (branches & (1 << i)) make_clean( save_branch_info[i].key );
+
+    time = monotonic_counter() - start;
+    save_stats.count++;
+    save_stats.snapshot_time += time;
+    if (time > save_stats.snapshot_max) save_stats.snapshot_max = time;
+    if (debug_level > 1) fprintf( stderr, "wineserver: started registry save process %d in %llu us\n",
+                                  (int)pid, (unsigned long long)time / 10 );
+    return 1;
+}
+
+/* write the registry save statistics */
+void dump_registry_stats( FILE *file )
+{
+    fprintf( file, "# registry saves failed snapshot_total_us snapshot_max_us write_total_us write_max_us\n" );
+    fprintf( file, "registry %u %u %llu %llu %llu %llu\n", save_stats.count, save_stats.failed,
+             (unsigned long long)save_stats.snapshot_time / 10, (unsigned long long)save_stats.snapshot_max / 10,
+             (unsigned long long)save_stats.write_time / 10, (unsigned long long)save_stats.write_max / 10 );
+}
+
 /* periodic saving of the registry */
 static void periodic_save( void *arg )
 {
+    unsigned int branches = 0;
     int i;
 
-    if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
-    for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].filename );
-    if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
+    /* skip this save if the previous one is still running */
+    if (!save_process && fchdir( config_dir_fd ) != -1)
+    {
+        for (i = 0; i < save_branch_count; i++)
+        {
+            if (save_branch_info[i].hive) save_branch_hive( &save_branch_info[i] );
+            else if (save_branch_info[i].key->flags & KEY_DIRTY) branches |= 1 << i;
+        }
+        if (branches && !start_save_process( branches ))
+        {
+            for (i = 0; i < save_branch_count; i++)
+                if (branches & (1 << i)) save_branch( save_branch_info[i].key, save_branch_info[i].filename );
+        }
+        if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
+    }
     set_periodic_save_timer();
 }
 
@@ -2132,9 +3493,20 @@ void flush_registry(void)
 {
     int i;
 
+    wait_save_process();
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
+        if (save_branch_info[i].hive)
+        {
+            if (!flush_branch_hive( &save_branch_info[i] ))
+            {
+                fprintf( stderr, "wineserver: could not save registry branch to %s",
+                         save_branch_info[i].filename );
+                perror( " " );
+            }
+            continue;
+        }
         if (!save_branch( save_branch_info[i].key, save_branch_info[i].filename ))
         {
             fprintf( stderr, "wineserver: could not save registry branch to %s",
@@ -72,6 +72,24 @@
 static const char * const server_socket_name = "socket";   /* name of the socket file */
 static const char * const server_lock_name = "lock";       /* name of the server lock file */
 
+/* request statistics collected with --stats */
+#define STATS_HISTOGRAM_SIZE 16  /* handler time buckets: < 1us, then powers of two up to >= 16ms */
+
+struct request_stats
+{
+    unsigned int       count;       /* number of requests handled */
+    timeout_t          total_time;  /* total time spent handling them */
+    timeout_t          max_time;    /* longest time spent handling one */
+    unsigned long long bytes_in;    /* request bytes received, including headers */
+    unsigned long long bytes_out;   /* reply bytes sent, including headers */
+    unsigned int       histogram[STATS_HISTOGRAM_SIZE];  /* distribution of handler times */
+};
+
+static struct request_stats req_stats[REQ_NB_REQUESTS];
+static unsigned int poll_count;        /* number of main loop iterations that found ready fds */
+static unsigned int max_queue_depth;   /* largest number of ready fds in a single iteration */
+static unsigned long long total_queue_depth;  /* total number of ready fds */
+
 struct master_socket
 {
     struct object        obj;        /* object header */
@@ -289,10 +307,14 @@ static void send_reply( union generic_reply *reply )
 }
 
 /* call a request handler */
+/* requests of all clients are handled one at a time on the main thread, the handlers */
+/* use global state (current thread, object lists, handle tables) without any locking */
 static void call_req_handler( struct thread *thread )
 {
     union generic_reply reply;
     enum request req = thread->req.request_header.req;
+    timeout_t start = server_stats ? monotonic_counter() : 0;
+    data_size_t reply_bytes = 0;
 
     current = thread;
     current->reply_size = 0;
@@ -313,6 +335,7 @@ static void call_req_handler( struct thread *thread )
             reply.reply_header.error = current->error;
             reply.reply_header.reply_size = current->reply_size;
             if (debug_level) trace_reply( req, &reply );
+            reply_bytes = sizeof(reply) + current->reply_size;
             send_reply( &reply );
         }
         else
@@ -322,6 +345,79 @@ static void call_req_handler( struct thread *thread )
         }
     }
     current = NULL;
+
+    if (server_stats && req < REQ_NB_REQUESTS)
+    {
+        timeout_t time = monotonic_counter() - start, usecs;
+        struct request_stats *stats = &req_stats[req];
+        unsigned int bucket = 0;
+
+        stats->count++;
+        stats->total_time += time;
+        if (time > stats->max_time) stats->max_time = time;
+        stats->bytes_in += sizeof(thread->req) + thread->req.request_header.request_size;
+        stats->bytes_out += reply_bytes;
+        for (usecs = time / 10; usecs && bucket < STATS_HISTOGRAM_SIZE - 1; usecs >>= 1) bucket++;
+        stats->histogram[bucket]++;
+        thread->process->req_count++;
+        thread->process->req_time += time;
+    }
+}
+
+/* record the number of fds found ready by one iteration of the main loop */
+void update_queue_stats( unsigned int depth )
+{
+    if (!depth) return;
+    poll_count++;
+    total_queue_depth += depth;
+    if (depth > max_queue_depth) max_queue_depth = depth;
+}
+
+static int dump_process_stats( struct process *process, void *arg )
+{
+    FILE *file = arg;
+
+    if (process->req_count)
+        fprintf( file, "process %04x %d %u %llu\n", process->id, process->unix_pid,
+                 process->req_count, (unsigned long long)process->req_time / 10 );
+    return 0;
+}
+
+/* write the request dispatch statistics, one record per line */
+void dump_request_stats(void)
+{
+    FILE *file = stderr;
+    unsigned int i, j;
+
+    if (!server_stats) return;
+    if (server_stats_file && !(file = fopen( server_stats_file, "a" )))
+    {
+        fprintf( stderr, "wineserver: cannot open %s: %s\n", server_stats_file, strerror( errno ));
+        return;
+    }
+
+    fprintf( file, "# wineserver statistics pid=%ld uptime=%llu\n", (long)getpid(),
+             (unsigned long long)(current_time - server_start_time) / 10 );
+    fprintf( file, "# request name count total_us max_us bytes_in bytes_out histogram (<1us,<2us,<4us,...,>=16384us)\n" );
+    for (i = 0; i < REQ_NB_REQUESTS; i++)
+    {
+        const struct request_stats *stats = &req_stats[i];
+
+        if (!stats->count) continue;
+        fprintf( file, "request %s %u %llu %llu %llu %llu", get_req_name( i ), stats->count,
+                 (unsigned long long)stats->total_time / 10, (unsigned long long)stats->max_time / 10,
+                 stats->bytes_in, stats->bytes_out );
+        for (j = 0; j < STATS_HISTOGRAM_SIZE; j++) fprintf( file, "%c%u", j ? ',' : ' ', stats->histogram[j] );
+        fputc( '\n', file );
+    }
+    fprintf( file, "# process id unix_pid count total_us\n" );
+    enum_processes( dump_process_stats, file );
+    fprintf( file, "# queue iterations total_depth max_depth\n" );
+    fprintf( file, "queue %u %llu %u\n", poll_count, total_queue_depth, max_queue_depth );
+    dump_registry_stats( file );
+
+    if (file != stderr) fclose( file );
+    else fflush( file );
 }
 
 /* read a request from a thread */
@@ -911,6 +1007,7 @@ static void close_socket_timeout( void *arg )
 {
     master_timeout = NULL;
     flush_registry();
+    dump_request_stats();
     if (debug_level) fprintf( stderr, "wineserver: exiting (pid=%ld)\n", (long) getpid() );
 
 #ifdef DEBUG_OBJECTS
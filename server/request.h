@@ -54,6 +54,8 @@ extern int receive_fd( struct process *process );
 extern int send_client_fd( struct process *process, int fd, obj_handle_t handle );
 extern void read_request( struct thread *thread );
 extern void write_reply( struct thread *thread );
+extern void update_queue_stats( unsigned int depth );
+extern void dump_request_stats(void);
 extern timeout_t monotonic_counter(void);
 extern void open_master_socket(void);
 extern void close_master_socket( timeout_t timeout );
@@ -65,6 +67,7 @@ extern int server_dir_fd, config_dir_fd;
 
 extern void trace_request(void);
 extern void trace_reply( enum request req, const union generic_reply *reply );
+extern const char *get_req_name( enum request req );
 
 /* get current tick count to return to client */
 static inline unsigned int get_tick_count(void)
@@ -162,6 +165,8 @@ DECL_HANDLER(create_semaphore);
 DECL_HANDLER(release_semaphore);
 DECL_HANDLER(query_semaphore);
 DECL_HANDLER(open_semaphore);
+DECL_HANDLER(get_inproc_sync_shm);
+DECL_HANDLER(get_inproc_sync);
 DECL_HANDLER(create_file);
 DECL_HANDLER(open_file_object);
 DECL_HANDLER(alloc_file_handle);
@@ -252,6 +257,7 @@ DECL_HANDLER(register_async);
 DECL_HANDLER(cancel_async);
 DECL_HANDLER(get_async_result);
 DECL_HANDLER(set_async_direct_result);
+DECL_HANDLER(set_async_client_results);
 DECL_HANDLER(read);
 DECL_HANDLER(write);
 DECL_HANDLER(ioctl);
@@ -303,6 +309,7 @@ DECL_HANDLER(register_hotkey);
 DECL_HANDLER(unregister_hotkey);
 DECL_HANDLER(attach_thread_input);
 DECL_HANDLER(get_thread_input);
+DECL_HANDLER(get_thread_user_shm);
 DECL_HANDLER(get_last_input_time);
 DECL_HANDLER(get_key_state);
 DECL_HANDLER(set_key_state);
@@ -453,6 +460,8 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_release_semaphore,
     (req_handler)req_query_semaphore,
     (req_handler)req_open_semaphore,
+    (req_handler)req_get_inproc_sync_shm,
+    (req_handler)req_get_inproc_sync,
     (req_handler)req_create_file,
     (req_handler)req_open_file_object,
     (req_handler)req_alloc_file_handle,
@@ -543,6 +552,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_cancel_async,
     (req_handler)req_get_async_result,
     (req_handler)req_set_async_direct_result,
+    (req_handler)req_set_async_client_results,
     (req_handler)req_read,
     (req_handler)req_write,
     (req_handler)req_ioctl,
@@ -594,6 +604,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_unregister_hotkey,
     (req_handler)req_attach_thread_input,
     (req_handler)req_get_thread_input,
+    (req_handler)req_get_thread_user_shm,
     (req_handler)req_get_last_input_time,
     (req_handler)req_get_key_state,
     (req_handler)req_set_key_state,
@@ -1016,6 +1027,15 @@ C_ASSERT( FIELD_OFFSET(struct open_semaphore_request, rootdir) == 20 );
 C_ASSERT( sizeof(struct open_semaphore_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct open_semaphore_reply, handle) == 8 );
 C_ASSERT( sizeof(struct open_semaphore_reply) == 16 );
+C_ASSERT( sizeof(struct get_inproc_sync_shm_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_inproc_sync_shm_reply, size) == 8 );
+C_ASSERT( sizeof(struct get_inproc_sync_shm_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_inproc_sync_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_inproc_sync_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_inproc_sync_reply, index) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_inproc_sync_reply, serial) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_inproc_sync_reply, access) == 16 );
+C_ASSERT( sizeof(struct get_inproc_sync_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, sharing) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, create) == 20 );
@@ -1048,7 +1068,9 @@ C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, type) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, cacheable) == 12 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, access) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, options) == 20 );
-C_ASSERT( sizeof(struct get_handle_fd_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, handle_flags) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, file_info) == 28 );
+C_ASSERT( sizeof(struct get_handle_fd_reply) == 32 );
 C_ASSERT( FIELD_OFFSET(struct get_directory_cache_entry_request, handle) == 12 );
 C_ASSERT( sizeof(struct get_directory_cache_entry_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_directory_cache_entry_reply, entry) == 8 );
@@ -1083,17 +1105,21 @@ C_ASSERT( sizeof(struct unlock_file_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct recv_socket_request, oob) == 12 );
 C_ASSERT( FIELD_OFFSET(struct recv_socket_request, async) == 16 );
 C_ASSERT( FIELD_OFFSET(struct recv_socket_request, force_async) == 56 );
+C_ASSERT( FIELD_OFFSET(struct recv_socket_request, client_poll) == 60 );
 C_ASSERT( sizeof(struct recv_socket_request) == 64 );
 C_ASSERT( FIELD_OFFSET(struct recv_socket_reply, wait) == 8 );
 C_ASSERT( FIELD_OFFSET(struct recv_socket_reply, options) == 12 );
 C_ASSERT( FIELD_OFFSET(struct recv_socket_reply, nonblocking) == 16 );
+C_ASSERT( FIELD_OFFSET(struct recv_socket_reply, client_poll) == 20 );
 C_ASSERT( sizeof(struct recv_socket_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct send_socket_request, async) == 16 );
 C_ASSERT( FIELD_OFFSET(struct send_socket_request, force_async) == 56 );
+C_ASSERT( FIELD_OFFSET(struct send_socket_request, client_poll) == 60 );
 C_ASSERT( sizeof(struct send_socket_request) == 64 );
 C_ASSERT( FIELD_OFFSET(struct send_socket_reply, wait) == 8 );
 C_ASSERT( FIELD_OFFSET(struct send_socket_reply, options) == 12 );
 C_ASSERT( FIELD_OFFSET(struct send_socket_reply, nonblocking) == 16 );
+C_ASSERT( FIELD_OFFSET(struct send_socket_reply, client_poll) == 20 );
 C_ASSERT( sizeof(struct send_socket_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct socket_get_events_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct socket_get_events_request, event) == 16 );
@@ -1482,6 +1508,8 @@ C_ASSERT( FIELD_OFFSET(struct set_async_direct_result_request, mark_pending) ==
 C_ASSERT( sizeof(struct set_async_direct_result_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct set_async_direct_result_reply, handle) == 8 );
 C_ASSERT( sizeof(struct set_async_direct_result_reply) == 16 );
+C_ASSERT( sizeof(struct set_async_client_results_request) == 16 );
+C_ASSERT( sizeof(struct set_async_client_results_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct read_request, async) == 16 );
 C_ASSERT( FIELD_OFFSET(struct read_request, pos) == 56 );
 C_ASSERT( sizeof(struct read_request) == 64 );
@@ -1793,6 +1821,9 @@ C_ASSERT( FIELD_OFFSET(struct get_thread_input_reply, cursor) == 36 );
 C_ASSERT( FIELD_OFFSET(struct get_thread_input_reply, show_count) == 40 );
 C_ASSERT( FIELD_OFFSET(struct get_thread_input_reply, rect) == 44 );
 C_ASSERT( sizeof(struct get_thread_input_reply) == 64 );
+C_ASSERT( sizeof(struct get_thread_user_shm_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_thread_user_shm_reply, index) == 8 );
+C_ASSERT( sizeof(struct get_thread_user_shm_reply) == 16 );
 C_ASSERT( sizeof(struct get_last_input_time_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_last_input_time_reply, time) == 8 );
 C_ASSERT( sizeof(struct get_last_input_time_reply) == 16 );
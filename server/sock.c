@@ -1161,6 +1161,27 @@ static void complete_async_poll( struct poll_req *req, unsigned int status )
     }
 }
 
+/* estimate the number of datagrams in the receive queue, so that as many pending
+ * receives can be alerted at once instead of going through a poll cycle for each */
+static unsigned int get_queued_datagrams( struct sock *sock )
+{
+#if defined(linux) && defined(SO_MEMINFO)
+    static const unsigned int max_batch = 16;
+    /* the kernel accounts roughly this much per queued datagram besides its data */
+    static const unsigned int overhead = 768;
+    unsigned int meminfo[16];  /* SK_MEMINFO_VARS */
+    socklen_t len = sizeof(meminfo);
+    int fd = get_unix_fd( sock->fd ), first;
+
+    if (ioctl( fd, FIONREAD, &first ) < 0 || first < 0) return 1;
+    if (getsockopt( fd, SOL_SOCKET, SO_MEMINFO, meminfo, &len ) < 0 || !len) return 1;
+    /* meminfo[0] is SK_MEMINFO_RMEM_ALLOC */
+    return max( 1, min( max_batch, meminfo[0] / (first + overhead) ));
+#else
+    return 1;
+#endif
+}
+
 static void complete_async_polls( struct sock *sock, int event, int error )
 {
     int flags = get_poll_flags( sock, event );
@@ -1232,7 +1253,10 @@ static int sock_dispatch_asyncs( struct sock *sock, int event, int error )
         if (async_waiting( &sock->read_q ))
         {
             if (debug_level) fprintf( stderr, "activating read queue for socket %p\n", sock );
-            async_wake_up( &sock->read_q, STATUS_ALERTED );
+            if (sock->type == WS_SOCK_DGRAM)
+                async_wake_up_count( &sock->read_q, get_queued_datagrams( sock ));
+            else
+                async_wake_up( &sock->read_q, STATUS_ALERTED );
         }
         event &= ~(POLLIN | POLLPRI);
     }
@@ -3839,6 +3863,15 @@ struct object *create_socket_device( struct object *root, const struct unicode_s
     return create_named_object( root, &socket_device_ops, name, attr, sd );
 }
 
+/* check if a pending async can be polled by the client: the socket must be connected and not
+ * shared with other processes, and the asyncs queued before it must be polled by the client too
+ * to keep them in order */
+static int sock_can_client_poll( struct sock *sock, struct async_queue *queue )
+{
+    if (sock->state != SOCK_CONNECTED && sock->state != SOCK_CONNECTIONLESS) return 0;
+    return is_fd_overlapped( sock->fd ) && sock->obj.handle_count == 1 && async_queue_client_polled( queue );
+}
+
 DECL_HANDLER(recv_socket)
 {
     struct sock *sock = (struct sock *)get_handle_obj( current->process, req->async.handle, 0, &sock_ops );
@@ -3893,6 +3926,12 @@ DECL_HANDLER(recv_socket)
         if (timeout)
             async_set_timeout( async, timeout, STATUS_IO_TIMEOUT );
 
+        if (status == STATUS_PENDING && req->client_poll && sock_can_client_poll( sock, &sock->read_q ))
+        {
+            async_set_client_poll( async );
+            reply->client_poll = 1;
+        }
+
         if (status == STATUS_PENDING || status == STATUS_ALERTED)
             queue_async( &sock->read_q, async );
 
@@ -4016,6 +4055,12 @@ DECL_HANDLER(send_socket)
         if (timeout)
             async_set_timeout( async, timeout, STATUS_IO_TIMEOUT );
 
+        if (status == STATUS_PENDING && req->client_poll && sock_can_client_poll( sock, &sock->write_q ))
+        {
+            async_set_client_poll( async );
+            reply->client_poll = 1;
+        }
+
         if (status == STATUS_PENDING || status == STATUS_ALERTED)
         {
             queue_async( &sock->write_q, async );
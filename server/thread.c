@@ -243,6 +243,7 @@ static inline void init_thread_structure( struct thread *thread )
     thread->suspend         = 0;
     thread->dbg_hidden      = 0;
     thread->desktop_users   = 0;
+    thread->user_shm        = 0;
     thread->token           = NULL;
     thread->desc            = NULL;
     thread->desc_len        = 0;
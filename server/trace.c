@@ -1372,6 +1372,25 @@ static void dump_varargs_handle_infos( const char *prefix, data_size_t size )
     fputc( '}', stderr );
 }
 
+static void dump_varargs_async_client_results( const char *prefix, data_size_t size )
+{
+    const struct async_client_result *result;
+
+    fprintf( stderr, "%s{", prefix );
+    while (size >= sizeof(*result))
+    {
+        result = cur_data;
+        fprintf( stderr, "{handle=%04x,status=%08x", result->handle, result->status );
+        dump_uint64( ",user=", &result->user );
+        dump_uint64( ",information=", &result->information );
+        fputc( '}', stderr );
+        size -= sizeof(*result);
+        remove_data( sizeof(*result) );
+        if (size) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+}
+
 static void dump_varargs_directory_entries( const char *prefix, data_size_t size )
 {
     fprintf( stderr, "%s{", prefix );
@@ -1954,6 +1973,27 @@ static void dump_open_semaphore_reply( const struct open_semaphore_reply *req )
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_get_inproc_sync_shm_request( const struct get_inproc_sync_shm_request *req )
+{
+}
+
+static void dump_get_inproc_sync_shm_reply( const struct get_inproc_sync_shm_reply *req )
+{
+    dump_uint64( " size=", &req->size );
+}
+
+static void dump_get_inproc_sync_request( const struct get_inproc_sync_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_inproc_sync_reply( const struct get_inproc_sync_reply *req )
+{
+    fprintf( stderr, " index=%08x", req->index );
+    fprintf( stderr, ", serial=%08x", req->serial );
+    fprintf( stderr, ", access=%08x", req->access );
+}
+
 static void dump_create_file_request( const struct create_file_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
@@ -2019,6 +2059,8 @@ static void dump_get_handle_fd_reply( const struct get_handle_fd_reply *req )
     fprintf( stderr, ", cacheable=%d", req->cacheable );
     fprintf( stderr, ", access=%08x", req->access );
     fprintf( stderr, ", options=%08x", req->options );
+    fprintf( stderr, ", handle_flags=%08x", req->handle_flags );
+    fprintf( stderr, ", file_info=%d", req->file_info );
 }
 
 static void dump_get_directory_cache_entry_request( const struct get_directory_cache_entry_request *req )
@@ -2093,6 +2135,7 @@ static void dump_recv_socket_request( const struct recv_socket_request *req )
     fprintf( stderr, " oob=%d", req->oob );
     dump_async_data( ", async=", &req->async );
     fprintf( stderr, ", force_async=%d", req->force_async );
+    fprintf( stderr, ", client_poll=%d", req->client_poll );
 }
 
 static void dump_recv_socket_reply( const struct recv_socket_reply *req )
@@ -2100,12 +2143,14 @@ static void dump_recv_socket_reply( const struct recv_socket_reply *req )
     fprintf( stderr, " wait=%04x", req->wait );
     fprintf( stderr, ", options=%08x", req->options );
     fprintf( stderr, ", nonblocking=%d", req->nonblocking );
+    fprintf( stderr, ", client_poll=%d", req->client_poll );
 }
 
 static void dump_send_socket_request( const struct send_socket_request *req )
 {
     dump_async_data( " async=", &req->async );
     fprintf( stderr, ", force_async=%d", req->force_async );
+    fprintf( stderr, ", client_poll=%d", req->client_poll );
 }
 
 static void dump_send_socket_reply( const struct send_socket_reply *req )
@@ -2113,6 +2158,7 @@ static void dump_send_socket_reply( const struct send_socket_reply *req )
     fprintf( stderr, " wait=%04x", req->wait );
     fprintf( stderr, ", options=%08x", req->options );
     fprintf( stderr, ", nonblocking=%d", req->nonblocking );
+    fprintf( stderr, ", client_poll=%d", req->client_poll );
 }
 
 static void dump_socket_get_events_request( const struct socket_get_events_request *req )
@@ -2909,6 +2955,16 @@ static void dump_set_async_direct_result_reply( const struct set_async_direct_re
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_set_async_client_results_request( const struct set_async_client_results_request *req )
+{
+    dump_varargs_async_client_results( " results=", cur_size );
+}
+
+static void dump_set_async_client_results_reply( const struct set_async_client_results_reply *req )
+{
+    dump_varargs_uints( " status=", cur_size );
+}
+
 static void dump_read_request( const struct read_request *req )
 {
     dump_async_data( " async=", &req->async );
@@ -3514,6 +3570,15 @@ static void dump_get_thread_input_reply( const struct get_thread_input_reply *re
     dump_rectangle( ", rect=", &req->rect );
 }
 
+static void dump_get_thread_user_shm_request( const struct get_thread_user_shm_request *req )
+{
+}
+
+static void dump_get_thread_user_shm_reply( const struct get_thread_user_shm_reply *req )
+{
+    fprintf( stderr, " index=%08x", req->index );
+}
+
 static void dump_get_last_input_time_request( const struct get_last_input_time_request *req )
 {
 }
@@ -4680,6 +4745,8 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_release_semaphore_request,
     (dump_func)dump_query_semaphore_request,
     (dump_func)dump_open_semaphore_request,
+    (dump_func)dump_get_inproc_sync_shm_request,
+    (dump_func)dump_get_inproc_sync_request,
     (dump_func)dump_create_file_request,
     (dump_func)dump_open_file_object_request,
     (dump_func)dump_alloc_file_handle_request,
@@ -4770,6 +4837,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_cancel_async_request,
     (dump_func)dump_get_async_result_request,
     (dump_func)dump_set_async_direct_result_request,
+    (dump_func)dump_set_async_client_results_request,
     (dump_func)dump_read_request,
     (dump_func)dump_write_request,
     (dump_func)dump_ioctl_request,
@@ -4821,6 +4889,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_unregister_hotkey_request,
     (dump_func)dump_attach_thread_input_request,
     (dump_func)dump_get_thread_input_request,
+    (dump_func)dump_get_thread_user_shm_request,
     (dump_func)dump_get_last_input_time_request,
     (dump_func)dump_get_key_state_request,
     (dump_func)dump_set_key_state_request,
@@ -4968,6 +5037,8 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_release_semaphore_reply,
     (dump_func)dump_query_semaphore_reply,
     (dump_func)dump_open_semaphore_reply,
+    (dump_func)dump_get_inproc_sync_shm_reply,
+    (dump_func)dump_get_inproc_sync_reply,
     (dump_func)dump_create_file_reply,
     (dump_func)dump_open_file_object_reply,
     (dump_func)dump_alloc_file_handle_reply,
@@ -5058,6 +5129,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_get_async_result_reply,
     (dump_func)dump_set_async_direct_result_reply,
+    (dump_func)dump_set_async_client_results_reply,
     (dump_func)dump_read_reply,
     (dump_func)dump_write_reply,
     (dump_func)dump_ioctl_reply,
@@ -5109,6 +5181,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_unregister_hotkey_reply,
     NULL,
     (dump_func)dump_get_thread_input_reply,
+    (dump_func)dump_get_thread_user_shm_reply,
     (dump_func)dump_get_last_input_time_reply,
     (dump_func)dump_get_key_state_reply,
     NULL,
@@ -5256,6 +5329,8 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "release_semaphore",
     "query_semaphore",
     "open_semaphore",
+    "get_inproc_sync_shm",
+    "get_inproc_sync",
     "create_file",
     "open_file_object",
     "alloc_file_handle",
@@ -5346,6 +5421,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "cancel_async",
     "get_async_result",
     "set_async_direct_result",
+    "set_async_client_results",
     "read",
     "write",
     "ioctl",
@@ -5397,6 +5473,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "unregister_hotkey",
     "attach_thread_input",
     "get_thread_input",
+    "get_thread_user_shm",
     "get_last_input_time",
     "get_key_state",
     "set_key_state",
@@ -5697,6 +5774,11 @@ static const char *get_status_name( unsigned int status )
     return buffer;
 }
 
+const char *get_req_name( enum request req )
+{
+    return req < REQ_NB_REQUESTS ? req_names[req] : "?";
+}
+
 void trace_request(void)
 {
     enum request req = current->req.request_header.req;
@@ -34,6 +34,22 @@ static struct user_handle *freelist;
 static int nb_handles;
 static int allocated_handles;
 
+struct user_shm_entries
+{
+    unsigned int  max;         /* number of entries, index 0 is reserved */
+    unsigned int  next;        /* first never used index */
+    unsigned int *free;        /* stack of freed indices */
+    unsigned int  free_count;  /* number of freed indices */
+};
+
+static struct user_shm_entries shm_entries[] =
+{
+    { USER_SHM_MAX_DESKTOPS, 1 },  /* USER_SHM_DESKTOP */
+    { USER_SHM_MAX_INPUTS, 1 },    /* USER_SHM_INPUT */
+    { USER_SHM_MAX_THREADS, 1 },   /* USER_SHM_THREAD */
+};
+static unsigned int shm_last_id;
+
 static struct user_handle *handle_to_entry( user_handle_t handle )
 {
     unsigned short generation;
@@ -82,6 +98,14 @@ static inline struct user_handle *alloc_user_entry(void)
 static inline void *free_user_entry( struct user_handle *ptr )
 {
     void *ret;
+
+    if (ptr->type == USER_WINDOW && user_shm)
+    {
+        window_shm_t *shared = &user_shm->windows[ptr - handles];
+        shared_write_begin( &shared->seq );
+        shared->handle = 0;
+        shared_write_end( &shared->seq );
+    }
     ret = ptr->ptr;
     ptr->ptr  = freelist;
     ptr->type = 0;
@@ -176,6 +200,32 @@ void free_process_user_handles( struct process *process )
             free_user_entry( &handles[i] );
 }
 
+/* allocate an entry in the USER shared memory, return 0 if none is available */
+unsigned int alloc_user_shm_entry( enum user_shm_type type, unsigned int *id )
+{
+    struct user_shm_entries *entries = &shm_entries[type];
+    unsigned int index;
+
+    if (!user_shm) return 0;
+    if (entries->free_count) index = entries->free[--entries->free_count];
+    else if (entries->next < entries->max) index = entries->next++;
+    else return 0;
+
+    if (!++shm_last_id) shm_last_id = 1;
+    *id = shm_last_id;
+    return index;
+}
+
+/* free an entry of the USER shared memory, its owner must have cleared its id */
+void free_user_shm_entry( enum user_shm_type type, unsigned int index )
+{
+    struct user_shm_entries *entries = &shm_entries[type];
+
+    if (!index) return;
+    if (!entries->free && !(entries->free = malloc( entries->max * sizeof(*entries->free) ))) return;
+    entries->free[entries->free_count++] = index;
+}
+
 /* allocate an arbitrary user handle */
 DECL_HANDLER(alloc_user_handle)
 {
@@ -93,6 +93,8 @@ struct desktop
     struct global_cursor cursor;           /* global cursor information */
     unsigned char        keystate[256];    /* asynchronous key state */
     struct key_repeat    key_repeat;       /* key auto-repeat */
+    unsigned int         shm_index;        /* index of the entry in the USER shared memory */
+    unsigned int         shm_id;           /* unique id of the shared memory entry */
 };
 
 /* user handles functions */
@@ -105,6 +107,33 @@ extern void *free_user_handle( user_handle_t handle );
 extern void *next_user_handle( user_handle_t *handle, enum user_object type );
 extern void free_process_user_handles( struct process *process );
 
+/* USER shared memory functions */
+
+extern user_shm_t *user_shm;
+
+enum user_shm_type
+{
+    USER_SHM_DESKTOP,
+    USER_SHM_INPUT,
+    USER_SHM_THREAD
+};
+
+extern unsigned int alloc_user_shm_entry( enum user_shm_type type, unsigned int *id );
+extern void free_user_shm_entry( enum user_shm_type type, unsigned int index );
+extern void set_thread_shm_desktop( struct thread *thread, struct desktop *desktop );
+
+/* start updating a shared memory entry, clients retry their reads while the counter is odd */
+static inline void shared_write_begin( unsigned int *seq )
+{
+    __atomic_store_n( seq, *seq + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+}
+
+static inline void shared_write_end( unsigned int *seq )
+{
+    __atomic_store_n( seq, *seq + 1, __ATOMIC_RELEASE );
+}
+
 /* clipboard functions */
 
 extern void cleanup_clipboard_window( struct desktop *desktop, user_handle_t window );
@@ -119,6 +148,7 @@ extern struct thread *get_first_global_hook( struct desktop *desktop, int id );
 /* queue functions */
 
 extern void free_msg_queue( struct thread *thread );
+extern void update_shared_desktop( struct desktop *desktop );
 extern struct hook_table *get_queue_hooks( struct thread *thread );
 extern void set_queue_hooks( struct thread *thread, struct hook_table *hooks );
 extern void inc_queue_paint_count( struct thread *thread, int incr );
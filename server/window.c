@@ -200,6 +200,26 @@ static inline int is_desktop_window( const struct window *win )
     return !win->parent;  /* only desktop windows have no parent */
 }
 
+/* publish the state of a window in the USER shared memory */
+static void update_shared_window( struct window *win )
+{
+    window_shm_t *shared;
+
+    if (!user_shm) return;
+    shared = &user_shm->windows[((win->handle & 0xffff) - FIRST_USER_HANDLE) >> 1];
+    shared_write_begin( &shared->seq );
+    shared->handle     = win->handle;
+    shared->tid        = win->thread ? get_thread_id( win->thread ) : 0;
+    shared->pid        = win->thread ? get_process_id( win->thread->process ) : 0;
+    shared->style      = win->style;
+    shared->ex_style   = win->ex_style;
+    shared->id         = win->id;
+    shared->instance   = win->instance;
+    shared->user_data  = win->user_data;
+    shared->is_unicode = win->is_unicode;
+    shared_write_end( &shared->seq );
+}
+
 /* check if window is orphaned */
 static int is_orphan_window( struct window *win )
 {
@@ -316,6 +336,7 @@ static int link_window( struct window *win, struct window *previous )
     }
 
     win->is_linked = 1;
+    update_shared_window( win );
     return old_prev != win->entry.prev;
 }
 
@@ -495,6 +516,7 @@ static void detach_window_thread( struct window *win )
     /* destroyed when the desktop ref count reaches zero */
     release_object( win->desktop );
     win->thread = NULL;
+    update_shared_window( win );
 }
 
 /* get the process owning the top window of a given desktop */
@@ -1813,6 +1835,7 @@ static void set_window_pos( struct window *win, struct window *previous,
     if (!(swp_flags & SWP_NOZORDER) && win->parent) zorder_changed |= link_window( win, previous );
     if (swp_flags & SWP_SHOWWINDOW) win->style |= WS_VISIBLE;
     else if (swp_flags & SWP_HIDEWINDOW) win->style &= ~WS_VISIBLE;
+    update_shared_window( win );
 
     /* keep children at the same position relative to top right corner when the parent is mirrored */
     if (win->ex_style & WS_EX_LAYOUTRTL)
@@ -2094,6 +2117,7 @@ DECL_HANDLER(create_window)
 
     win->style = req->style;
     win->ex_style = req->ex_style;
+    update_shared_window( win );
 
     reply->handle      = win->handle;
     reply->parent      = win->parent ? win->parent->handle : 0;
@@ -2155,6 +2179,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->top_window );
             desktop->top_window->style  = WS_POPUP | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_shared_window( desktop->top_window );
         }
     }
 
@@ -2167,6 +2192,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->msg_window );
             desktop->msg_window->style = WS_POPUP | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_shared_window( desktop->msg_window );
         }
     }
 
@@ -2273,6 +2299,7 @@ DECL_HANDLER(set_window_info)
     if (req->flags & SET_WIN_USERDATA) win->user_data = req->user_data;
     if (req->flags & SET_WIN_EXTRA) memcpy( win->extra_bytes + req->extra_offset,
                                             &req->extra_value, req->extra_size );
+    if (req->flags) update_shared_window( win );
 
     /* changing window style triggers a non-client paint */
     if (req->flags & SET_WIN_STYLE) win->paint_flags |= PAINT_NONCLIENT;
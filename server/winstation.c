@@ -298,6 +298,8 @@ static struct desktop *create_desktop( const struct unicode_str *name, unsigned
             list_add_tail( &winstation->desktops, &desktop->entry );
             list_init( &desktop->hotkeys );
             list_init( &desktop->pointers );
+            desktop->shm_index = alloc_user_shm_entry( USER_SHM_DESKTOP, &desktop->shm_id );
+            update_shared_desktop( desktop );
         }
         else
         {
@@ -367,6 +369,14 @@ static void desktop_destroy( struct object *obj )
     if (desktop->global_hooks) release_object( desktop->global_hooks );
     if (desktop->close_timeout) remove_timeout_user( desktop->close_timeout );
     if (desktop->key_repeat.timeout) remove_timeout_user( desktop->key_repeat.timeout );
+    if (desktop->shm_index)
+    {
+        desktop_shm_t *shared = &user_shm->desktops[desktop->shm_index];
+        shared_write_begin( &shared->seq );
+        shared->id = 0;
+        shared_write_end( &shared->seq );
+        free_user_shm_entry( USER_SHM_DESKTOP, desktop->shm_index );
+    }
     release_object( desktop->winstation );
 }
 
@@ -385,10 +395,24 @@ static void close_desktop_timeout( void *private )
     post_desktop_message( desktop, WM_CLOSE, 0, 0 );  /* and signal the owner to quit */
 }
 
+/* set the desktop located by the shared memory entry of a thread */
+void set_thread_shm_desktop( struct thread *thread, struct desktop *desktop )
+{
+    thread_shm_t *shared;
+
+    if (!thread->user_shm) return;
+    shared = &user_shm->threads[thread->user_shm];
+    shared_write_begin( &shared->seq );
+    shared->desktop    = desktop ? desktop->shm_index : 0;
+    shared->desktop_id = desktop ? desktop->shm_id : 0;
+    shared_write_end( &shared->seq );
+}
+
 /* add a user of the desktop and cancel the close timeout */
 static void add_desktop_thread( struct desktop *desktop, struct thread *thread )
 {
     list_add_tail( &desktop->threads, &thread->desktop_entry );
+    set_thread_shm_desktop( thread, desktop );
 
     if (!thread->process->is_system)
     {
@@ -421,6 +445,7 @@ static void remove_desktop_user( struct desktop *desktop, struct thread *thread
 static void remove_desktop_thread( struct desktop *desktop, struct thread *thread )
 {
     list_remove( &thread->desktop_entry );
+    set_thread_shm_desktop( thread, NULL );
 
     if (!thread->process->is_system) remove_desktop_user( desktop, thread );
 